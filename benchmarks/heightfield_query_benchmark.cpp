@@ -0,0 +1,143 @@
+// Heightfield terrain queries and tile streaming, on a generated terrain of
+// tiles x tiles tiles (1 km a side by default) driven across by a point
+// streaming its tiles like a vehicle.
+//
+// Writes the tiles to --dir, prints CSV: metric,value
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "physics/heightfield_tiles.h"
+
+namespace {
+// Rolling hills with a friction map darker in the valleys
+float terrainHeight(double x, double y) {
+    return static_cast<float>(4 * std::sin(x * 0.01) * std::cos(y * 0.013) +
+                              0.5 * std::sin(x * 0.11 + y * 0.07));
+}
+
+void writeTerrain(const v3d::HeightfieldSettings& settings) {
+    v3d::HeightfieldTiles tiles(settings);
+    const uint32_t samples = settings.tileSamples;
+    const double cellSize = settings.tileSize / (samples - 1);
+    const uint32_t frictionSamples = 8;
+    std::vector<float> heights(size_t(samples) * samples);
+    std::vector<float> friction(frictionSamples * frictionSamples);
+
+    for (uint32_t ty = 0; ty < settings.numTilesY; ty++) {
+        for (uint32_t tx = 0; tx < settings.numTilesX; tx++) {
+            const double x0 = settings.originX + tx * settings.tileSize;
+            const double y0 = settings.originY + ty * settings.tileSize;
+            for (uint32_t j = 0; j < samples; j++)
+                for (uint32_t i = 0; i < samples; i++)
+                    heights[size_t(j) * samples + i] =
+                        terrainHeight(x0 + i * cellSize, y0 + j * cellSize);
+            for (uint32_t j = 0; j < frictionSamples; j++)
+                for (uint32_t i = 0; i < frictionSamples; i++)
+                    friction[j * frictionSamples + i] =
+                        terrainHeight(x0 + i * 8, y0 + j * 8) < 0 ? 0.6f
+                                                                  : 0.9f;
+            v3d::HeightfieldTiles::writeTile(tiles.getTilePath(tx, ty),
+                                             samples, heights,
+                                             frictionSamples, friction);
+        }
+    }
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::string directory = "heightfield_benchmark";
+    uint32_t numTiles = 16;
+    size_t numQueries = 10000000;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) {
+            directory = argv[++i];
+        } else if (strcmp(argv[i], "--tiles") == 0 && i + 1 < argc) {
+            numTiles = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--queries") == 0 && i + 1 < argc) {
+            numQueries = std::strtoull(argv[++i], nullptr, 10);
+        }
+    }
+
+    v3d::HeightfieldSettings settings;
+    settings.numTilesX = numTiles;
+    settings.numTilesY = numTiles;
+    settings.originX = -0.5 * numTiles * settings.tileSize;
+    settings.originY = settings.originX;
+    std::filesystem::create_directories(directory);
+    settings.tilePath = directory + "/tile_{x}_{y}.v3ht";
+
+    auto start = std::chrono::steady_clock::now();
+    writeTerrain(settings);
+    auto elapsed = [&start] {
+        const auto now = std::chrono::steady_clock::now();
+        const double s = std::chrono::duration<double>(now - start).count();
+        start = now;
+        return s;
+    };
+    std::printf("metric,value\n");
+    std::printf("write_s,%.3f\n", elapsed());
+
+    // Drive diagonally across the terrain at 20 m/s, 4 wheel queries per
+    // 1 ms step and a stream every step the point changes tile
+    v3d::HeightfieldTiles tiles(settings);
+    const double extent = numTiles * settings.tileSize;
+    const double speed = 20, stepSize = 1e-3;
+    const size_t numSteps = static_cast<size_t>(extent / speed / stepSize);
+    size_t maxMapped = 0;
+    int lastTile = -1;
+    double checksum = 0;
+    for (size_t step = 0; step < numSteps; step++) {
+        const double d = settings.originX + step * stepSize * speed;
+        const int tile = static_cast<int>((d - settings.originX) /
+                                          settings.tileSize);
+        if (tile != lastTile) {
+            tiles.stream({glm::dvec2(d, d)});
+            maxMapped = std::max(maxMapped, tiles.getNumMappedTiles());
+            lastTile = tile;
+        }
+        for (int wheel = 0; wheel < 4; wheel++) {
+            float height, slopeX, slopeY;
+            tiles.getHeightAndSlope(d + (wheel & 1) * 2.7,
+                                    d + (wheel >> 1) * 1.6, height, slopeX,
+                                    slopeY);
+            checksum += height + slopeX + slopeY +
+                        tiles.getFriction(d + (wheel & 1) * 2.7,
+                                          d + (wheel >> 1) * 1.6);
+        }
+    }
+    const double driveTime = elapsed();
+    std::printf("drive_steps,%zu\n", numSteps);
+    std::printf("drive_ms_per_step,%.6f\n", 1e3 * driveTime / numSteps);
+    std::printf("drive_max_mapped_tiles,%zu\n", maxMapped);
+    std::printf("drive_misses,%zu\n", tiles.getNumMisses());
+
+    // Random queries around the last position, tiles already mapped
+    const double end = settings.originX + extent - 1;
+    std::mt19937 random(42);
+    std::uniform_real_distribution<double> offset(-100, 0);
+    std::vector<glm::dvec2> points(4096);
+    for (glm::dvec2& point : points)
+        point = glm::dvec2(end + offset(random), end + offset(random));
+    tiles.stream({glm::dvec2(end, end)});
+    elapsed();
+    for (size_t i = 0; i < numQueries; i++) {
+        const glm::dvec2& point = points[i % points.size()];
+        float height, slopeX, slopeY;
+        tiles.getHeightAndSlope(point.x, point.y, height, slopeX, slopeY);
+        checksum += height + slopeX + slopeY;
+    }
+    const double queryTime = elapsed();
+    std::printf("query_ns,%.2f\n", 1e9 * queryTime / numQueries);
+    std::printf("mapped_mb,%.2f\n",
+                tiles.getMappedBytes() / (1024.0 * 1024.0));
+    std::printf("checksum,%.3f\n", checksum);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,89 @@
+// Throughput of the MultiWorldRunner on a Monte Carlo sweep of the sedan:
+// every world drives one vehicle at a swept throttle and records the
+// distance covered and the final speed.
+//
+// Run from a directory containing resources/vehicle_model, prints CSV:
+// threads,worlds,wall_s,sim_s,realtime_factor
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "multi_world_runner.h"
+
+namespace {
+constexpr const char* VehicleModelPath =
+    "resources/vehicle_model/sedan/vehicle/Sedan_Vehicle.json";
+
+v3d::MultiWorldRunner makeRunner(const v3d::MultiWorldSettings& settings,
+                                 std::vector<v3d::VehicleHandle>& vehicles) {
+    v3d::MultiWorldRunner runner(settings);
+    // One vehicle per world, each world only touches its own handle slot
+    runner.setSetup([&vehicles](v3d::SimulationWorld& world) {
+        auto handle = world.getPhysics()->createVehicle(VehicleModelPath);
+        handle->vehicle->Initialize(
+            chrono::ChCoordsys<>(chrono::ChVector3d(0, .5, 0)));
+        handle->vehicle->GetChassisBody()->SetFixed(false);
+        handle->driverInputs.m_throttle = world.getParameter("throttle");
+        vehicles[world.getIndex()] = handle;
+    });
+    runner.setFinish([&vehicles](v3d::SimulationWorld& world) {
+        auto& handle = vehicles[world.getIndex()];
+        world.setResult("distance", handle->vehicle->GetPos().Length());
+        world.setResult("speed", handle->vehicle->GetSpeed());
+        handle = v3d::VehicleHandle();
+    });
+    return runner;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    v3d::MultiWorldSettings settings;
+    settings.simTime = 5;
+    size_t repetitions = 4;
+    size_t maxThreads =
+        std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    std::string jsonPath;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--sim-time") == 0 && i + 1 < argc) {
+            settings.simTime = std::atof(argv[++i]);
+        } else if (strcmp(argv[i], "--repetitions") == 0 && i + 1 < argc) {
+            repetitions = std::strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--max-threads") == 0 && i + 1 < argc) {
+            maxThreads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            jsonPath = argv[++i];
+        }
+    }
+
+    v3d::ParameterSweep sweep;
+    sweep.addRange("throttle", 0.2, 1.0, 5).setRepetitions(repetitions);
+
+    std::printf("threads,worlds,wall_s,sim_s,realtime_factor\n");
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        settings.numThreads = threads;
+        std::vector<v3d::VehicleHandle> vehicles(sweep.combinations().size());
+        v3d::MultiWorldRunner runner = makeRunner(settings, vehicles);
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto runs = runner.run(sweep);
+        const double wall = std::chrono::duration<double>(
+                                std::chrono::steady_clock::now() - start)
+                                .count();
+
+        double sim = 0;
+        for (const auto& run : runs) sim += run.simTime;
+        std::printf("%zu,%zu,%.3f,%.1f,%.2f\n", threads, runs.size(), wall,
+                    sim, wall > 0 ? sim / wall : 0);
+        std::fflush(stdout);
+
+        if (!jsonPath.empty() && threads * 2 > maxThreads)
+            v3d::MultiWorldRunner::writeJson(jsonPath, runs);
+    }
+    return 0;
+}
@@ -0,0 +1,143 @@
+// Step throughput and accuracy of the physics profiles on the sedan
+// scenario: vehicles driving at constant throttle with a sinusoidal steering.
+// The chassis trajectories are compared with the run of the first profile
+// (the reference, normally the smallest step size).
+//
+// Run from a directory containing resources/vehicle_model, prints CSV:
+// profile,solver,collision,step_size,steps,ms_per_step,steps_per_second,
+// realtime_factor,final_drift_m,max_drift_m
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "physics/physics.h"
+
+namespace {
+constexpr const char* VehicleModelPath =
+    "resources/vehicle_model/sedan/vehicle/Sedan_Vehicle.json";
+// Distance between vehicles, they never touch
+constexpr double VehicleSpacing = 8.0;
+// Trajectories are compared at this interval, s
+constexpr double SampleInterval = 0.1;
+
+struct ProfileRun {
+    int steps = 0;
+    double wallTime = 0;  // s
+    // Chassis position of every vehicle at every sample
+    std::vector<chrono::ChVector3d> trajectory;
+};
+
+ProfileRun runProfile(const v3d::PhysicsProfile& profile, size_t numVehicles,
+                      double simTime) {
+    v3d::Physics physics;
+    physics.applyProfile(profile);
+    physics.setInterpolationEnabled(false);
+
+    std::vector<v3d::VehicleHandle> vehicles;
+    for (size_t i = 0; i < numVehicles; i++) {
+        auto handle = physics.createVehicle(VehicleModelPath);
+        const chrono::ChVector3d position(i * VehicleSpacing, .5, 0);
+        handle->vehicle->Initialize(chrono::ChCoordsys<>(position));
+        handle->vehicle->GetChassisBody()->SetFixed(false);
+        handle->driverInputs.m_throttle = 0.5;
+        vehicles.push_back(handle);
+    }
+
+    const double stepSize = physics.getStepSize();
+    const int numSamples =
+        static_cast<int>(std::round(simTime / SampleInterval));
+    const int stepsPerSample =
+        static_cast<int>(std::round(SampleInterval / stepSize));
+    physics.setMaxStepsPerFrame(stepsPerSample + 1);
+
+    ProfileRun run;
+    run.trajectory.reserve(numSamples * numVehicles);
+    for (int sample = 0; sample < numSamples; sample++) {
+        // Same inputs at the same simulated time for every profile
+        const double time = sample * SampleInterval;
+        for (auto& handle : vehicles)
+            handle->driverInputs.m_steering = 0.3 * std::sin(time);
+
+        // Half a step of margin on the first call, the accumulator then runs
+        // exactly stepsPerSample steps per sample
+        const double elapsed = sample == 0
+                                   ? (stepsPerSample + 0.5) * stepSize
+                                   : stepsPerSample * stepSize;
+        const auto start = std::chrono::steady_clock::now();
+        run.steps += physics.advance(elapsed);
+        run.wallTime += std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+
+        for (auto& handle : vehicles)
+            run.trajectory.push_back(handle->vehicle->GetPos());
+    }
+    return run;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::string profilesPath = "resources/physics_profiles/profiles.json";
+    size_t numVehicles = 4;
+    double simTime = 10;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--profiles") == 0 && i + 1 < argc) {
+            profilesPath = argv[++i];
+        } else if (strcmp(argv[i], "--vehicles") == 0 && i + 1 < argc) {
+            numVehicles = std::strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--sim-time") == 0 && i + 1 < argc) {
+            simTime = std::atof(argv[++i]);
+        }
+    }
+
+    std::vector<v3d::PhysicsProfile> profiles;
+    try {
+        profiles = v3d::PhysicsProfile::loadFile(profilesPath);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    std::printf(
+        "profile,solver,collision,step_size,steps,ms_per_step,"
+        "steps_per_second,realtime_factor,final_drift_m,max_drift_m\n");
+    ProfileRun reference;
+    for (size_t p = 0; p < profiles.size(); p++) {
+        const v3d::PhysicsProfile& profile = profiles[p];
+        const ProfileRun run = runProfile(profile, numVehicles, simTime);
+        if (p == 0) reference = run;
+
+        // Drift of the chassis positions against the reference run
+        double finalDrift = 0, maxDrift = 0;
+        const size_t numPositions =
+            std::min(run.trajectory.size(), reference.trajectory.size());
+        for (size_t i = 0; i < numPositions; i++) {
+            const double drift =
+                (run.trajectory[i] - reference.trajectory[i]).Length();
+            maxDrift = std::max(maxDrift, drift);
+            if (i + numVehicles >= numPositions)
+                finalDrift = std::max(finalDrift, drift);
+        }
+
+        const double wall = run.wallTime;
+        std::printf("%s,%s,%s,%g,%d,%.4f,%.1f,%.3f,%.5f,%.5f\n",
+                    profile.name.c_str(),
+                    profile.overrideSolver
+                        ? v3d::PhysicsProfile::solverName(profile.solver)
+                        : "default",
+                    v3d::PhysicsProfile::collisionSystemName(
+                        profile.collisionSystem),
+                    profile.stepSize, run.steps,
+                    run.steps > 0 ? 1000 * wall / run.steps : 0,
+                    wall > 0 ? run.steps / wall : 0,
+                    wall > 0 ? simTime / wall : 0, finalDrift, maxDrift);
+        std::fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,82 @@
+// Physics step time against the number of vehicles, with the vehicle phase
+// (Synchronize/Advance) run serially and in parallel.
+//
+// Run from a directory containing resources/vehicle_model, prints CSV:
+// vehicles,mode,ms_per_step
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "physics/physics.h"
+
+namespace {
+constexpr const char* VehicleModelPath =
+    "resources/vehicle_model/sedan/vehicle/Sedan_Vehicle.json";
+// Distance between vehicles, they never touch
+constexpr double VehicleSpacing = 8.0;
+
+double measureStepTime(size_t numVehicles, bool parallel, int numSteps) {
+    v3d::Physics physics;
+    physics.setInterpolationEnabled(false);
+    physics.setParallelVehiclesEnabled(parallel);
+    physics.setMaxStepsPerFrame(numSteps);
+
+    const size_t gridSize =
+        static_cast<size_t>(std::ceil(std::sqrt(double(numVehicles))));
+    for (size_t i = 0; i < numVehicles; i++) {
+        auto handle = physics.createVehicle(VehicleModelPath);
+        const chrono::ChVector3d position((i % gridSize) * VehicleSpacing, .5,
+                                          (i / gridSize) * VehicleSpacing);
+        handle->vehicle->Initialize(chrono::ChCoordsys<>(position));
+        handle->vehicle->GetChassisBody()->SetFixed(false);
+        handle->driverInputs.m_throttle = 0.5;
+    }
+
+    // Half a step of margin, the accumulator runs exactly n steps
+    const double stepSize = physics.getStepSize();
+    const int warmupSteps = 20;
+    physics.advance((warmupSteps + 0.5) * stepSize);
+
+    const auto start = std::chrono::steady_clock::now();
+    const int steps = physics.advance(numSteps * stepSize);
+    const double ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+    return steps > 0 ? ms / steps : 0;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    int numSteps = 500;
+    size_t maxVehicles = 200;
+    bool serialOnly = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+            numSteps = std::atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-vehicles") == 0 && i + 1 < argc) {
+            maxVehicles = std::strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--serial-only") == 0) {
+            serialOnly = true;
+        }
+    }
+
+    const std::vector<size_t> vehicleCounts = {1, 2, 5, 10, 25, 50, 100, 200};
+
+    std::printf("vehicles,mode,ms_per_step\n");
+    for (size_t numVehicles : vehicleCounts) {
+        if (numVehicles > maxVehicles) break;
+        for (bool parallel : {false, true}) {
+            if (parallel && serialOnly) continue;
+            const double ms = measureStepTime(numVehicles, parallel, numSteps);
+            std::printf("%zu,%s,%.4f\n", numVehicles,
+                        parallel ? "parallel" : "serial", ms);
+            std::fflush(stdout);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,35 @@
+//#Begin_prop
+//#End_prop
+
+//#Begin_vert
+
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec4 aColor;
+
+out vec4 color;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    gl_Position = projection * view * vec4(aPos, 1.0);
+    color = aColor;
+}
+
+//#End_vert
+
+//#Begin_frag
+
+#version 330 core
+out vec4 FragColor;
+
+in vec4 color;
+
+void main()
+{
+    FragColor = color;
+}
+
+//#End_frag
@@ -0,0 +1,88 @@
+//#Begin_prop
+(color      dye_color           color)
+(float      ambient             ambient)
+(bool       use_Unlit           unlit)
+//#End_prop
+
+//#Begin_vert
+
+#version 430 core
+// Only defined by the variants, default when loaded alone
+#ifndef V3D_INDIRECT_DRAW
+#define V3D_INDIRECT_DRAW 0
+#endif
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+
+#if V3D_INDIRECT_DRAW
+// Per draw data, one instance per indirect command (see GeometryPool)
+layout (location = 8) in mat4 aModel;
+layout (location = 12) in mat3 aNormalMatrix;
+layout (location = 15) in uint aMaterialIndex;
+#else
+uniform mat4 model;
+uniform mat3 normalMatrix;
+uniform int materialIndex;
+#endif
+
+out vec3 Normal;
+flat out uint MaterialIndex;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+#if V3D_INDIRECT_DRAW
+    mat4 modelMatrix = aModel;
+    Normal = normalize(aNormalMatrix * aNormal);
+    MaterialIndex = aMaterialIndex;
+#else
+    mat4 modelMatrix = model;
+    Normal = normalize(normalMatrix * aNormal);
+    MaterialIndex = uint(materialIndex);
+#endif
+    gl_Position = projection * view * modelMatrix * vec4(aPos, 1.0);
+}
+
+//#End_vert
+
+//#Begin_frag
+
+#version 430 core
+// Keywords are only defined by the variants, default when loaded alone
+#ifndef USE_UNLIT
+#define USE_UNLIT 0
+#endif
+out vec4 FragColor;
+
+// Same members and order as the property block (see MaterialLayout)
+struct MaterialData {
+    vec4 dye_color;
+    float ambient;
+};
+
+layout (std430, binding = 0) readonly buffer Materials {
+    MaterialData materials[];
+};
+
+vec3 light_direction = vec3(-0.5, 1.0, -0.3);
+
+in vec3 Normal;
+flat in uint MaterialIndex;
+
+void main()
+{
+    MaterialData material = materials[MaterialIndex];
+#if USE_UNLIT
+    FragColor = material.dye_color;
+#else
+    vec3 lightDir = normalize(light_direction);
+    float diff = max(dot(normalize(Normal), lightDir), 0.0);
+    float light = material.ambient + (1.0 - material.ambient) * diff;
+    FragColor = vec4(material.dye_color.rgb * light, material.dye_color.a);
+#endif
+}
+
+//#End_frag
@@ -11,17 +11,32 @@
 
 //#Begin_vert----------------------------------------------------------------------------
 
-#version 330 core
+#version 430 core
+// Only defined by the variants, default when loaded alone
+#ifndef V3D_INDIRECT_DRAW
+#define V3D_INDIRECT_DRAW 0
+#endif
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoord;
 
+#if V3D_INDIRECT_DRAW
+// Per draw data, one instance per indirect command (see GeometryPool)
+layout (location = 8) in mat4 aModel;
+layout (location = 12) in mat3 aNormalMatrix;
+layout (location = 15) in uint aMaterialIndex;
+#else
+uniform mat4 model;
+uniform mat3 normalMatrix;
+uniform int materialIndex;
+#endif
+
 out vec2 TexCoord;
 out vec3 Normal;
 out vec3 FragPos;
 out vec4 FragPosShadowSpace;
+flat out uint MaterialIndex;
 
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
@@ -29,16 +44,21 @@ uniform mat4 shadowMatrix;
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+#if V3D_INDIRECT_DRAW
+    mat4 modelMatrix = aModel;
+    Normal = aNormalMatrix * aNormal;
+    MaterialIndex = aMaterialIndex;
+#else
+    mat4 modelMatrix = model;
+    Normal = normalMatrix * aNormal;
+    MaterialIndex = uint(materialIndex);
+#endif
+    gl_Position = projection * view * modelMatrix * vec4(aPos, 1.0);
 
     TexCoord = aTexCoord;
 
-    FragPos = vec3(model * vec4(aPos, 1.0));
+    FragPos = vec3(modelMatrix * vec4(aPos, 1.0));
     FragPosShadowSpace = shadowMatrix * vec4(FragPos, 1.0);
-
-    //Normal = aNormal;
-
-    Normal = mat3(transpose(inverse(model))) * aNormal;
 }
 
 //#End_vert
@@ -48,10 +68,26 @@ void main()
 
 //#Begin_frag----------------------------------------------------------------------------
 
-#version 330 core
+#version 430 core
+// Keywords are only defined by the variants, default when loaded alone
+#ifndef USE_TRANSPARENCY
+#define USE_TRANSPARENCY 1
+#endif
 
 #define MAX_LIGHTS 10
 
+// Same members and order as the property block (see MaterialLayout), the
+// texture is not a material parameter
+struct MaterialData {
+    vec4 dye_color;
+    float specular_shinines;
+    float specular_intensity;
+};
+
+layout (std430, binding = 0) readonly buffer Materials {
+    MaterialData materials[];
+};
+
 struct SpotLight{
     vec4 color;
     float intensity;
@@ -74,22 +110,19 @@ in vec2 TexCoord;
 in vec3 Normal;
 in vec3 FragPos;
 in vec4 FragPosShadowSpace;
+flat in uint MaterialIndex;
 
 uniform vec3 viewPos;
 
 uniform sampler2D texture_diffuse1;
 uniform sampler2D shadowMap;
 
-uniform vec4 dye_color = vec4(1.f);
-uniform int use_Transparency = 1;
-
 //--------------------------------------------Lighting
 uniform float ambientLight;
 uniform vec4 ambientColor;
 
-uniform float specular_shinines = 32.f;
-uniform float specular_intensity = 1.f;
-
+float specular_shinines;
+float specular_intensity;
 
 uniform vec3 lightsrc_directional_direction;
 uniform vec4 lightsrc_directional_color;
@@ -107,13 +140,19 @@ float ShadowCalculation(vec4 posShadowSpace);
 
 void main()
 {
+    MaterialData material = materials[MaterialIndex];
+    specular_shinines = material.specular_shinines;
+    specular_intensity = material.specular_intensity;
+
     float shadow = ShadowCalculation(FragPosShadowSpace);
 
     //Albedo
     vec4 albedo = texture(texture_diffuse1, TexCoord);
 
+#if USE_TRANSPARENCY
     if(albedo.a == 0.0f)
         discard;
+#endif
 
     //Ambient light
     vec4 ambient = ambientLight * ambientColor;
@@ -161,7 +200,7 @@ void main()
         spotLight += calculateSpotLightPhong( viewPos,FragPos, normal, spotLights[i]);
     }
 
-    FragColor = dye_color * albedo * (ambient + ((1-shadow)*(diffuse + specular)) + pointLight + spotLight) ;
+    FragColor = material.dye_color * albedo * (ambient + ((1-shadow)*(diffuse + specular)) + pointLight + spotLight) ;
     //FragColor = vec4(normal,1.f);
 }
 
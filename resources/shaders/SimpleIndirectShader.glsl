@@ -0,0 +1,53 @@
+//#Begin_prop
+(vec4       dye_color           myColor)
+//#End_prop
+
+//#Begin_vert
+
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+
+// Per draw data, one instance per indirect command (see GeometryPool)
+layout (location = 8) in mat4 aModel;
+layout (location = 12) in mat3 aNormalMatrix;
+
+out vec4 pos;
+out vec3 Normal; // Pass normal to fragment shader
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    vec4 position = projection * view * aModel * vec4(aPos, 1.0);
+    gl_Position = position;
+    pos = vec4(position.x, position.y, position.z, 1.0);
+    
+    Normal = normalize(aNormalMatrix * aNormal); // Transformed normal
+}
+
+//#End_vert
+
+//#Begin_frag
+
+#version 330 core
+out vec4 FragColor;
+
+uniform vec4 dye_color;
+vec3 light_direction = vec3(-0.5, 1.0, -0.3);
+
+in vec4 pos;
+in vec3 Normal;
+
+void main()
+{
+    vec3 lightDir = normalize(light_direction);
+    float diff = max(dot(normalize(Normal), lightDir), 0.0);
+
+    vec3 finalColor = dye_color.rgb * diff; // Basic diffuse shading
+    FragColor = vec4(finalColor, dye_color.a);
+}
+
+//#End_frag
@@ -1,5 +1,6 @@
 //#Begin_prop
 (vec4       dye_color           myColor)
+(bool       use_Unlit           unlit)
 //#End_prop
 
 //#Begin_vert
@@ -31,6 +32,10 @@ void main()
 //#Begin_frag
 
 #version 330 core
+// Keywords are only defined by the variants, default when loaded alone
+#ifndef USE_UNLIT
+#define USE_UNLIT 0
+#endif
 out vec4 FragColor;
 
 uniform vec4 dye_color;
@@ -41,11 +46,15 @@ in vec3 Normal;
 
 void main()
 {
+#if USE_UNLIT
+    FragColor = dye_color;
+#else
     vec3 lightDir = normalize(light_direction);
     float diff = max(dot(normalize(Normal), lightDir), 0.0);
 
     vec3 finalColor = dye_color.rgb * diff; // Basic diffuse shading
     FragColor = vec4(finalColor, dye_color.a);
+#endif
 }
 
 //#End_frag
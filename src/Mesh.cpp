@@ -4,15 +4,118 @@
 #include <glad/glad.h>
 #include <plog/Log.h>
 
+#include <algorithm>
+#include <glm/glm.hpp>
+
 #include "OBJ-Loader-master/Source/OBJ_Loader.h"
+#include "rendering/geometry_arena.h"
 #include "rendering/graphics_backend.h"
 #include "rendering/opengl_backend.h"
+#include "rendering/vertex_compression.h"
 
 namespace v3d {
 
+void computeMeshBounds(const void* vertexBuffer, size_t numVertices,
+                       const VertexLayout& vertexLayout,
+                       rendering::AABB& aabb,
+                       rendering::BoundingSphere& sphere) {
+    aabb = rendering::AABB();
+    sphere = rendering::BoundingSphere();
+    if (vertexBuffer == nullptr || numVertices == 0) return;
+
+    const VertexAttribute* posAttribute = nullptr;
+    for (const auto& vAttribute : vertexLayout.attributes) {
+        if (vAttribute.location == 0) {
+            posAttribute = &vAttribute;
+            break;
+        }
+    }
+
+    if (posAttribute == nullptr || posAttribute->glType != GL_FLOAT ||
+        posAttribute->components < 3) {
+        PLOGW << "Unable to compute mesh bounds, unsupported position "
+                 "attribute. The mesh will never be culled\n";
+        return;
+    }
+
+    const auto* data = static_cast<const unsigned char*>(vertexBuffer);
+    auto readPosition = [&](size_t i) {
+        const float* p = reinterpret_cast<const float*>(
+            data + i * vertexLayout.stride + posAttribute->offset);
+        return glm::vec3(p[0], p[1], p[2]);
+    };
+
+    aabb.min = aabb.max = readPosition(0);
+    for (size_t i = 1; i < numVertices; i++) {
+        glm::vec3 pos = readPosition(i);
+        aabb.min = glm::min(aabb.min, pos);
+        aabb.max = glm::max(aabb.max, pos);
+    }
+
+    // Sphere centered on the box, radius from the farthest vertex which is
+    // tighter than the box half diagonal
+    sphere.center = aabb.center();
+    float maxDist2 = 0.f;
+    for (size_t i = 0; i < numVertices; i++) {
+        glm::vec3 d = readPosition(i) - sphere.center;
+        maxDist2 = std::max(maxDist2, glm::dot(d, d));
+    }
+    sphere.radius = glm::sqrt(maxDist2);
+}
+
 MeshOpenGL::MeshOpenGL(void* vertexDataBuffer, size_t vertexDataBufferSize,
                        VertexLayout vertexLayout, unsigned int* indicesBuffer,
-                       size_t indicesBufferSize) {
+                       size_t indicesBufferSize,
+                       rendering::GeometryArena* arena,
+                       bool compressVertices) {
+    m_numVertices = vertexDataBufferSize / vertexLayout.stride;
+    m_numIndices = indicesBufferSize;
+    m_uncompressedBytes =
+        vertexDataBufferSize + indicesBufferSize * sizeof(unsigned int);
+
+    const void* vertexData = vertexDataBuffer;
+    const void* indexData = indicesBuffer;
+    m_vertexBytes = vertexDataBufferSize;
+    m_indexType = GL_UNSIGNED_INT;
+
+    rendering::CompressedGeometry compressed;
+    if (compressVertices) {
+        compressed = rendering::compressGeometry(vertexDataBuffer,
+                                                 m_numVertices, vertexLayout,
+                                                 indicesBuffer, m_numIndices);
+    }
+    if (!compressed.vertices.empty()) {
+        vertexData = compressed.vertices.data();
+        indexData = compressed.indices.data();
+        vertexLayout = compressed.layout;
+        m_vertexBytes = compressed.vertices.size();
+        m_indexType = compressed.indexType;
+        m_vertexTransform = compressed.vertexTransform;
+    }
+    m_indexBytes = m_numIndices * rendering::indexTypeSize(m_indexType);
+    m_vertexLayout = vertexLayout;
+
+    const auto vertexBytes = static_cast<const unsigned char*>(vertexData);
+    m_vertexData.assign(vertexBytes, vertexBytes + m_vertexBytes);
+    if (m_indexType == GL_UNSIGNED_SHORT) {
+        auto shortIndices = static_cast<const uint16_t*>(indexData);
+        m_indexData.assign(shortIndices, shortIndices + m_numIndices);
+    } else {
+        auto intIndices = static_cast<const unsigned int*>(indexData);
+        m_indexData.assign(intIndices, intIndices + m_numIndices);
+    }
+
+    if (arena != nullptr) {
+        // Suballocate from the arena shared buffers
+        rendering::GeometryAllocation allocation =
+            arena->allocate(vertexLayout, vertexData, m_numVertices,
+                            indexData, m_numIndices, m_indexType);
+        m_pool = allocation.pool;
+        m_baseVertex = allocation.baseVertex;
+        m_firstIndex = allocation.firstIndex;
+        return;
+    }
+
     // Send vertex data to GPU
 
     // Generate buffers
@@ -24,13 +127,11 @@ MeshOpenGL::MeshOpenGL(void* vertexDataBuffer, size_t vertexDataBufferSize,
 
     // Load data into vertex/index buffers
     glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertexDataBufferSize, vertexDataBuffer,
-                 GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, m_vertexBytes, vertexData, GL_STATIC_DRAW);
 
-    m_numIndices = indicesBufferSize;
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indicesBufferSize * sizeof(size_t),
-                 indicesBuffer, GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indexBytes, indexData,
+                 GL_STATIC_DRAW);
 
     // Set the vertex attribute pointers
     // Vertex Positions
@@ -64,10 +165,20 @@ MeshOpenGL::MeshOpenGL(objl::Mesh& mesh) {
                  mesh.Vertices.data(), GL_STATIC_DRAW);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+    m_numVertices = mesh.Vertices.size();
     m_numIndices = mesh.Indices.size();
+    m_vertexBytes = m_numVertices * sizeof(objl::Vertex);
+    m_indexBytes = m_numIndices * sizeof(unsigned int);
+    m_uncompressedBytes = m_vertexBytes + m_indexBytes;
+    m_indexType = GL_UNSIGNED_INT;
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_numIndices * sizeof(unsigned int),
                  mesh.Indices.data(), GL_STATIC_DRAW);
 
+    const auto vertexBytes =
+        reinterpret_cast<const unsigned char*>(mesh.Vertices.data());
+    m_vertexData.assign(vertexBytes, vertexBytes + m_vertexBytes);
+    m_indexData = mesh.Indices;
+
     // Set the vertex attribute pointers
     // Vertex Positions
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(objl::Vertex),
@@ -82,20 +193,72 @@ MeshOpenGL::MeshOpenGL(objl::Mesh& mesh) {
 
     glBindVertexArray(0);  // unbind VAO
 
+    m_vertexLayout = {sizeof(objl::Vertex),
+                      {{0, 3, GL_FLOAT, 0, false, 0},
+                       {1, 3, GL_FLOAT, 0, false, 3 * sizeof(float)},
+                       {2, 2, GL_FLOAT, 0, false, 6 * sizeof(float)}}};
+    computeMeshBounds(mesh.Vertices.data(), mesh.Vertices.size(),
+                      m_vertexLayout, m_aabb, m_boundingSphere);
+
     PLOGV << "Buffer handles: " << m_VBO << "; " << m_VAO << "; " << m_EBO
           << "\n";
 };
 
 MeshOpenGL::~MeshOpenGL() {
+    // Arena storage is owned and released by the arena
+    if (isArenaAllocated()) return;
     glDeleteVertexArrays(1, &m_VAO);
     glDeleteBuffers(1, &m_VBO);
     glDeleteBuffers(1, &m_EBO);
 };
 
 void MeshOpenGL::draw() const {
+    if (isArenaAllocated()) {
+        glBindVertexArray(m_pool->getVAO());
+        glDrawElementsBaseVertex(
+            GL_TRIANGLES, m_numIndices, m_indexType,
+            reinterpret_cast<const void*>(
+                m_firstIndex * rendering::indexTypeSize(m_indexType)),
+            m_baseVertex);
+        glBindVertexArray(0);
+        return;
+    }
+
     // draw mesh
     glBindVertexArray(m_VAO);
-    glDrawElements(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, m_numIndices, m_indexType, 0);
     glBindVertexArray(0);
 }
+
+MeshNull::MeshNull(void* vertexDataBuffer, size_t vertexDataBufferSize,
+                   VertexLayout vertexLayout, unsigned int* indicesBuffer,
+                   size_t indicesBufferSize, bool compressVertices) {
+    m_numVertices = vertexDataBufferSize / vertexLayout.stride;
+    m_numIndices = indicesBufferSize;
+    m_vertexBytes = vertexDataBufferSize;
+    m_indexBytes = m_numIndices * sizeof(unsigned int);
+    m_uncompressedBytes = m_vertexBytes + m_indexBytes;
+
+    if (!compressVertices) return;
+    rendering::CompressedGeometry compressed = rendering::compressGeometry(
+        vertexDataBuffer, m_numVertices, vertexLayout, indicesBuffer,
+        m_numIndices);
+    if (compressed.vertices.empty()) return;
+    m_vertexBytes = compressed.vertices.size();
+    m_indexBytes = compressed.indices.size();
+    m_vertexTransform = compressed.vertexTransform;
+}
+
+MeshNull::MeshNull(objl::Mesh& mesh) {
+    m_numVertices = mesh.Vertices.size();
+    m_numIndices = mesh.Indices.size();
+    m_vertexBytes = m_numVertices * sizeof(objl::Vertex);
+    m_indexBytes = m_numIndices * sizeof(unsigned int);
+    m_uncompressedBytes = m_vertexBytes + m_indexBytes;
+
+    VertexLayout objlLayout{sizeof(objl::Vertex),
+                            {{0, 3, GL_FLOAT, 0, false, 0}}};
+    computeMeshBounds(mesh.Vertices.data(), mesh.Vertices.size(), objlLayout,
+                      m_aabb, m_boundingSphere);
+}
 }  // namespace v3d
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
@@ -8,6 +9,8 @@
 #include <type_traits>
 #include <vector>
 
+#include "rendering/bounding_volume.hpp"
+
 namespace objl {
 class Mesh;
 }  // namespace objl
@@ -16,6 +19,12 @@ namespace v3d {
 
 class ModelManager;
 
+namespace rendering {
+class GeometryArena;
+class GeometryPool;
+class StaticBatcher;
+}  // namespace rendering
+
 struct VertexAttribute {
     uint32_t location;    // layout location in shader
     uint32_t components;  // number of components (e.g. 3 for vec3)
@@ -24,19 +33,63 @@ struct VertexAttribute {
         vkFormat;  // VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32_SFLOAT etc.
     bool normalized;
     size_t offset;  // byte offset in struct
+
+    bool operator==(const VertexAttribute& other) const {
+        return location == other.location && components == other.components &&
+               glType == other.glType && normalized == other.normalized &&
+               offset == other.offset;
+    }
+    bool operator!=(const VertexAttribute& other) const {
+        return !(*this == other);
+    }
 };
 
 struct VertexLayout {
     size_t stride;
     std::vector<VertexAttribute> attributes;
+
+    bool operator==(const VertexLayout& other) const {
+        return stride == other.stride && attributes == other.attributes;
+    }
+    bool operator!=(const VertexLayout& other) const {
+        return !(*this == other);
+    }
 };
 
+/// @brief Compute the bounding volumes of a vertex buffer. The vertex position
+/// is read from the attribute bound to location 0.
+/// @param vertexBuffer Start of the interleaved vertex data
+/// @param numVertices Num of vertices in the buffer
+/// @param vertexLayout Layout used to interpret the buffer
+/// @param aabb Output axis aligned bounding box
+/// @param sphere Output bounding sphere
+void computeMeshBounds(const void* vertexBuffer, size_t numVertices,
+                       const VertexLayout& vertexLayout,
+                       rendering::AABB& aabb, rendering::BoundingSphere& sphere);
+
 class Mesh {
     friend class ModelManager;
+    friend class rendering::StaticBatcher;
 
    private:
    protected:
     std::string m_name;
+    rendering::AABB m_aabb;
+    rendering::BoundingSphere m_boundingSphere;
+    size_t m_numVertices = 0;
+    size_t m_numIndices = 0;
+    size_t m_vertexBytes = 0;
+    size_t m_indexBytes = 0;
+    size_t m_uncompressedBytes = 0;
+    glm::mat4 m_vertexTransform = glm::mat4(1.f);
+
+    struct Lod {
+        const Mesh* mesh;
+        float error;  // Relative to the bounding sphere radius
+    };
+    /// @brief Simplified versions of this mesh, finest first. Owned by the
+    /// ModelManager.
+    std::vector<Lod> m_lods;
     Mesh() {}
 
    public:
@@ -44,21 +97,117 @@ class Mesh {
 
     virtual void draw() const = 0;
     std::string_view getName() const { return m_name; }
+
+    /// @brief Local space bounding box
+    const rendering::AABB& getAABB() const { return m_aabb; }
+    /// @brief Local space bounding sphere, unbounded if it was not computed
+    const rendering::BoundingSphere& getBoundingSphere() const {
+        return m_boundingSphere;
+    }
+
+    size_t getNumVertices() const { return m_numVertices; }
+    size_t getNumIndices() const { return m_numIndices; }
+    /// @brief Num of triangles drawn, meshes are indexed triangle lists
+    size_t getNumTriangles() const { return m_numIndices / 3; }
+
+    /// @brief Bytes of the vertex/index data uploaded for this mesh
+    size_t getVertexBytes() const { return m_vertexBytes; }
+    size_t getIndexBytes() const { return m_indexBytes; }
+    /// @brief Bytes of the vertex and index data as provided by the loader
+    size_t getUncompressedBytes() const { return m_uncompressedBytes; }
+    bool isCompressed() const {
+        return m_vertexBytes + m_indexBytes < m_uncompressedBytes;
+    }
+
+    /// @brief Transform from the stored vertex positions to the mesh local
+    /// space, applied before the model matrix. Identity unless the positions
+    /// are quantized.
+    const glm::mat4& getVertexTransform() const { return m_vertexTransform; }
+
+    /// @brief Num of levels of detail, including this mesh as level 0
+    size_t getNumLods() const { return m_lods.size() + 1; }
+    /// @return The mesh of the level, clamped to the coarsest one
+    const Mesh* getLod(size_t level) const {
+        if (level == 0 || m_lods.empty()) return this;
+        return m_lods[std::min(level, m_lods.size()) - 1].mesh;
+    }
+    /// @brief Max geometric error of the level relative to the bounding
+    /// sphere radius, 0 for level 0
+    float getLodError(size_t level) const {
+        if (level == 0 || m_lods.empty()) return 0.f;
+        return m_lods[std::min(level, m_lods.size()) - 1].error;
+    }
 };
 
 class MeshOpenGL : public Mesh {
    public:
     MeshOpenGL() = delete;
+    /// @param arena Optional geometry arena. When provided the mesh data is
+    /// suballocated from the arena shared buffers instead of owning its own
+    /// VAO/VBO/EBO, allowing it to be drawn with multi-draw indirect.
+    /// @param compressVertices Upload the mesh in the compressed vertex
+    /// format (see rendering::CompressedVertex) with 16 bit indices when
+    /// possible
     MeshOpenGL(void* vertexDataBuffer, size_t vertexDataBufferSize,
                VertexLayout vertexLayout, unsigned int* indicesBuffer,
-               size_t indicesBufferSize);
+               size_t indicesBufferSize,
+               rendering::GeometryArena* arena = nullptr,
+               bool compressVertices = false);
     MeshOpenGL(objl::Mesh& mesh);
     ~MeshOpenGL() override;
 
     void draw() const override;
 
+    bool isArenaAllocated() const { return m_pool != nullptr; }
+    rendering::GeometryPool* getPool() const { return m_pool; }
+    int getBaseVertex() const { return m_baseVertex; }
+    unsigned int getFirstIndex() const { return m_firstIndex; }
+    /// @brief GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    unsigned int getIndexType() const { return m_indexType; }
+    /// @brief Layout of the uploaded vertices, the compressed one if the
+    /// mesh was compressed
+    const VertexLayout& getVertexLayout() const { return m_vertexLayout; }
+
+    /// @brief System memory copy of the uploaded vertices, in
+    /// getVertexLayout() format. Kept at load time so the geometry can be
+    /// processed (static batching) without reading the GPU buffers back.
+    const std::vector<unsigned char>& getVertexData() const {
+        return m_vertexData;
+    }
+    /// @brief Same, indices widened to 32 bit
+    const std::vector<unsigned int>& getIndexData() const {
+        return m_indexData;
+    }
+
    private:
     unsigned int m_VBO = 0, m_VAO = 0, m_EBO = 0;
-    size_t m_numIndices = 0;
+    unsigned int m_indexType = 0;
+    VertexLayout m_vertexLayout;
+    std::vector<unsigned char> m_vertexData;
+    std::vector<unsigned int> m_indexData;
+
+    // Arena suballocation, unused if the mesh owns its buffers
+    rendering::GeometryPool* m_pool = nullptr;
+    int m_baseVertex = 0;
+    unsigned int m_firstIndex = 0;
+};
+
+/**
+ * @brief Mesh of the NullGraphicsBackend. The geometry is discarded, only the
+ * vertex/index counts, the buffer sizes and the bounds are kept so render
+ * targets can be culled and their draws accounted without a GPU.
+ */
+class MeshNull : public Mesh {
+   public:
+    MeshNull() = delete;
+    /// @param compressVertices Account the sizes of the compressed vertex
+    /// format, as MeshOpenGL would upload
+    MeshNull(void* vertexDataBuffer, size_t vertexDataBufferSize,
+             VertexLayout vertexLayout, unsigned int* indicesBuffer,
+             size_t indicesBufferSize, bool compressVertices = false);
+    MeshNull(objl::Mesh& mesh);
+    ~MeshNull() override = default;
+
+    void draw() const override {};
 };
 }  // namespace v3d
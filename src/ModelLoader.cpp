@@ -81,7 +81,7 @@ std::tuple<size_t, void*, VertexLayout> OBJLoader::getMeshVertexBuffer(
         VertexAttribute{1, 3, GL_FLOAT, VK_FORMAT_R32G32B32_SFLOAT, GL_FALSE,
                         offsetof(objl::Vertex, Normal)});
     vLayout.attributes.push_back(
-        VertexAttribute{2, 2, GL_FLOAT, VK_FORMAT_R32G32B32_SFLOAT, GL_FALSE,
+        VertexAttribute{2, 2, GL_FLOAT, VK_FORMAT_R32G32_SFLOAT, GL_FALSE,
                         offsetof(objl::Vertex, TextureCoordinate)});
 
     return std::tuple<size_t, void*, VertexLayout>(
@@ -255,13 +255,13 @@ std::tuple<size_t, void*, VertexLayout> AssimpLoader::getMeshVertexBuffer(
         VertexAttribute{2, 2, GL_FLOAT, VK_FORMAT_R32G32_SFLOAT, GL_FALSE,
                         offsetof(AssimpLoaderVertex, textureCoord)});
     vLayout.attributes.push_back(
-        VertexAttribute{3, 3, GL_FLOAT, VK_FORMAT_R32G32B32_SFLOAT, GL_FALSE,
+        VertexAttribute{3, 4, GL_FLOAT, VK_FORMAT_R32G32B32A32_SFLOAT, GL_FALSE,
                         offsetof(AssimpLoaderVertex, color)});
     vLayout.attributes.push_back(
         VertexAttribute{4, 3, GL_FLOAT, VK_FORMAT_R32G32B32_SFLOAT, GL_FALSE,
                         offsetof(AssimpLoaderVertex, tangent)});
     vLayout.attributes.push_back(
-        VertexAttribute{5, 4, GL_FLOAT, VK_FORMAT_R32G32B32A32_SFLOAT, GL_FALSE,
+        VertexAttribute{5, 3, GL_FLOAT, VK_FORMAT_R32G32B32_SFLOAT, GL_FALSE,
                         offsetof(AssimpLoaderVertex, bitangent)});
 
     return std::tuple<size_t, void*, VertexLayout>(
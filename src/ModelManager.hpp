@@ -1,10 +1,16 @@
 #pragma once
 
+#include <plog/Log.h>
+
+#include <cstring>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "Model.h"
 #include "ModelLoader.h"
+#include "rendering/mesh_optimizer.h"
+#include "rendering/mesh_simplifier.h"
 
 namespace v3d {
 class ModelManager {
@@ -12,6 +18,8 @@ class ModelManager {
     std::unique_ptr<ModelLoader> m_loader;
     std::vector<std::unique_ptr<Model>> m_models;
     std::vector<std::unique_ptr<Mesh>> m_meshes;
+    rendering::MeshOptimizationSettings m_optimization;
+    rendering::MeshLodSettings m_lodSettings;
 
    public:
     explicit ModelManager(std::unique_ptr<ModelLoader> loader)
@@ -38,8 +46,30 @@ class ModelManager {
         return std::make_unique<ModelManager>(std::forward<Args>(args)...);
     }
 
-    template <typename MeshType>
-    Model* importModel(const std::string& filepath, const std::string& name) {
+    /// @brief Optimization applied to the meshes of the next imports
+    void setOptimizationSettings(
+        const rendering::MeshOptimizationSettings& settings) {
+        m_optimization = settings;
+    }
+    const rendering::MeshOptimizationSettings& getOptimizationSettings()
+        const {
+        return m_optimization;
+    }
+
+    /// @brief LOD chain generated for the meshes of the next imports
+    void setLodSettings(const rendering::MeshLodSettings& settings) {
+        m_lodSettings = settings;
+    }
+    const rendering::MeshLodSettings& getLodSettings() const {
+        return m_lodSettings;
+    }
+
+    /// @brief Import all the meshes of a model file
+    /// @tparam MeshType Mesh implementation to create
+    /// @param meshArgs Extra arguments forwarded to every MeshType constructor
+    template <typename MeshType, typename... MeshArgs>
+    Model* importModel(const std::string& filepath, const std::string& name,
+                       MeshArgs&&... meshArgs) {
         static_assert(std::is_base_of<Mesh, MeshType>::value,
                       "MeshType must inherit from the base class Mesh");
 
@@ -53,11 +83,43 @@ class ModelManager {
 
             unsigned int* indicesBuffer = m_loader->getMeshIndicesBuffer(i);
             size_t numIndices = m_loader->getMeshNumIndices(i);
+            size_t numVertices = m_loader->getMeshNumVertex(i);
+
+            // Optimized copies of the loader buffers
+            std::vector<unsigned char> vertices;
+            std::vector<unsigned int> indices;
+            if (m_optimization.enabled && numIndices > 0) {
+                auto data = static_cast<const unsigned char*>(vertexBuffer);
+                vertices.assign(data, data + vertexBufferSize);
+                indices.assign(indicesBuffer, indicesBuffer + numIndices);
+
+                auto stats = rendering::optimizeMesh(vertices, vertexLayout,
+                                                     indices, m_optimization);
+                PLOGD << "Optimized mesh " << m_loader->getMeshName(i)
+                      << " in " << stats.time << " ms: vertices "
+                      << stats.verticesBefore << " -> " << stats.verticesAfter
+                      << ", ACMR " << stats.before.acmr << " -> "
+                      << stats.after.acmr << ", ATVR " << stats.before.atvr
+                      << " -> " << stats.after.atvr << "\n";
+
+                vertexBuffer = vertices.data();
+                vertexBufferSize = vertices.size();
+                indicesBuffer = indices.data();
+                numVertices = stats.verticesAfter;
+            }
+
             std::unique_ptr<Mesh> mesh = std::make_unique<MeshType>(
                 vertexBuffer, vertexBufferSize, vertexLayout, indicesBuffer,
-                numIndices);
+                numIndices, meshArgs...);
 
             mesh->m_name = m_loader->getMeshName(i);
+            computeMeshBounds(vertexBuffer, numVertices, vertexLayout,
+                              mesh->m_aabb, mesh->m_boundingSphere);
+
+            if (m_lodSettings.enabled && numIndices > 0)
+                generateLods<MeshType>(*mesh, vertexBuffer, numVertices,
+                                       vertexLayout, indicesBuffer, numIndices,
+                                       meshArgs...);
 
             model->m_meshes.push_back(mesh.get());
             m_meshes.push_back(std::move(mesh));
@@ -65,6 +127,60 @@ class ModelManager {
         m_models.push_back(std::move(model));
         return model_ptr;
     }
+
+   private:
+    /// @brief Build the LOD chain of a mesh. Every level is simplified from
+    /// the full resolution indices, its vertices are compacted and cache
+    /// optimized. The levels are owned by m_meshes but not listed in the
+    /// model, they are only reached through Mesh::getLod.
+    template <typename MeshType, typename... MeshArgs>
+    void generateLods(Mesh& mesh, const void* vertexBuffer, size_t numVertices,
+                      const VertexLayout& vertexLayout,
+                      const unsigned int* indicesBuffer, size_t numIndices,
+                      MeshArgs&... meshArgs) {
+        const float radius = mesh.m_boundingSphere.radius;
+        if (radius <= 0.f) return;
+
+        size_t previousIndices = numIndices;
+        float targetRatio = 1.f;
+        for (size_t level = 0; level < m_lodSettings.errors.size(); level++) {
+            targetRatio *= m_lodSettings.reduction;
+            auto target = static_cast<size_t>(numIndices * targetRatio);
+
+            float error = 0.f;
+            std::vector<unsigned int> indices = rendering::simplifyMesh(
+                vertexBuffer, numVertices, vertexLayout, indicesBuffer,
+                numIndices, target, m_lodSettings.errors[level] * radius,
+                &error);
+            if (indices.empty() ||
+                indices.size() > previousIndices * m_lodSettings.minReduction)
+                break;
+            previousIndices = indices.size();
+
+            auto data = static_cast<const unsigned char*>(vertexBuffer);
+            std::vector<unsigned char> vertices(
+                data, data + numVertices * vertexLayout.stride);
+            rendering::optimizeVertexCache(indices, numVertices);
+            rendering::optimizeVertexFetch(vertices, vertexLayout.stride,
+                                           indices);
+
+            std::unique_ptr<Mesh> lod = std::make_unique<MeshType>(
+                vertices.data(), vertices.size(), vertexLayout, indices.data(),
+                indices.size(), meshArgs...);
+            lod->m_name = mesh.m_name + "_LOD" + std::to_string(level + 1);
+            // The bounds of the full mesh keep the culling and the LOD
+            // selection stable across levels
+            lod->m_aabb = mesh.m_aabb;
+            lod->m_boundingSphere = mesh.m_boundingSphere;
+
+            PLOGD << "Generated " << lod->m_name << ": triangles "
+                  << numIndices / 3 << " -> " << indices.size() / 3
+                  << ", error " << error / radius << "\n";
+
+            mesh.m_lods.push_back({lod.get(), error / radius});
+            m_meshes.push_back(std::move(lod));
+        }
+    }
 };
 
 }  // namespace v3d
@@ -14,7 +14,9 @@ REGISTER_COMPONENT(CinemaASCIIComponent);
 REGISTER_COMPONENT(TestComponent);
 
 ComponentBase::~ComponentBase() {
-    if (m_scene != nullptr) m_scene->getEngine()->unregisterGizmosTarget(this);
+    // Scenes of a MultiWorldRunner have no engine
+    if (m_scene != nullptr && m_scene->getEngine() != nullptr)
+        m_scene->getEngine()->unregisterGizmosTarget(this);
 }
 
 entity_ptr ComponentBase::getEntityPtr() {
@@ -26,7 +28,8 @@ std::string ComponentBase::getEntityName() {
 }
 
 void ComponentBase::_init() {
-    if (m_scene != nullptr) m_scene->getEngine()->registerGizmosTarget(this);
+    if (m_scene != nullptr && m_scene->getEngine() != nullptr)
+        m_scene->getEngine()->registerGizmosTarget(this);
 }
 
 const char* CINEMA_ART_IMAGE = R"(
@@ -7,6 +7,7 @@
 #include "physics/Vehicle.h"
 #include "physics/VehicleInteractiveController.h"
 #include "physics/rigidbody.h"
+#include "rendering/material.h"
 #include "rendering/mesh_renderer.h"
 #include "transform.h"
 
@@ -16,6 +17,8 @@ class DemoSedanVehicle : public v3d::Engine {
    private:
    protected:
     AssimpLoader* m_modelLoader = nullptr;
+    std::unique_ptr<rendering::Material> m_bodyPaint;
+    std::unique_ptr<rendering::Material> m_parkedPaint;
 
     std::unique_ptr<ModelLoader> makeModelLoader() override {
         // Init Model manager with Assimp as loader
@@ -60,25 +63,59 @@ class DemoSedanVehicle : public v3d::Engine {
         auto modelpath =
             "resources/vehicle_model/sedan/"
             "sedan_chassis_vis_fix.obj";
-        Model* porscheModel = m_modelManager->importModel<MeshOpenGL>(
-            modelpath, "Porsche 911 GT2");
+        Model* porscheModel = importModel(modelpath, "Porsche 911 GT2");
+
+        // Body paint, null without a backend able to compile the material
+        // shader (the meshes keep the default shader then)
+        auto materialShader = m_graphicsBackend->getShaderVariants(
+            "resources/shaders/MaterialShader.glsl");
+        if (materialShader != nullptr) {
+            m_bodyPaint = std::make_unique<rendering::Material>(
+                "Sedan paint", materialShader);
+            m_bodyPaint->setColor(glm::vec4(0.7f, 0.08f, 0.06f, 1.f));
+            m_bodyPaint->setFloat("ambient", 0.25f);
+
+            m_parkedPaint = std::make_unique<rendering::Material>(
+                "Parked sedan paint", materialShader);
+            m_parkedPaint->setColor(glm::vec4(0.55f, 0.6f, 0.65f, 1.f));
+            m_parkedPaint->setFloat("ambient", 0.3f);
+        }
 
         for (auto mesh : porscheModel->getMeshes()) {
             auto porscheEntity =
                 m_scene->instantiateEntity(std::string(mesh->getName()));
-            auto porscheRigidBody =
-                m_scene->getComponentOfType<RigidBody>(porscheEntity);
-            porscheRigidBody->setFixed(false);
             auto porscheTransform =
                 m_scene->getComponentOfType<Transform>(porscheEntity);
             auto porscheRenderer =
                 m_scene->createEntityComponentOfType<MeshRenderer>(
                     porscheEntity);
             porscheRenderer->setMesh(mesh);
+            porscheRenderer->setMaterial(m_bodyPaint.get());
 
             porscheEntity->setParent(porscheRootEntity);
         }
 
+        // Static scenery: a row of parked sedans, never moved so the backend
+        // merges them into a single static batch
+        constexpr int NumParkedSedans = 6;
+        for (int i = 0; i < NumParkedSedans; i++) {
+            auto parkedEntity = m_scene->instantiateEntity(
+                "Parked sedan " + std::to_string(i));
+            for (auto mesh : porscheModel->getMeshes()) {
+                auto meshEntity = m_scene->instantiateEntity(
+                    std::string(mesh->getName()), parkedEntity);
+                auto parkedRenderer =
+                    m_scene->createEntityComponentOfType<MeshRenderer>(
+                        meshEntity);
+                parkedRenderer->setMesh(mesh);
+                parkedRenderer->setMaterial(m_parkedPaint.get());
+                parkedRenderer->setStatic(true);
+            }
+            // Kinematic children follow the parent
+            m_scene->getComponentOfType<Transform>(parkedEntity)
+                ->setPos(glm::vec3(-15.f + 6.f * i, 0.5f, -8.f));
+        }
+
         auto chasissPath =
             "resources/vehicle_model/sedan/"
             "sedan_chassis_vis_fix.obj";
@@ -88,18 +125,19 @@ class DemoSedanVehicle : public v3d::Engine {
 
    public:
     DemoSedanVehicle() = delete;
-    DemoSedanVehicle(uint32_t width, uint32_t height,
-                     rendering::GraphicsBackendType graphicsBackendType)
-        : v3d::Engine(width, height, graphicsBackendType) {};
-    ~DemoSedanVehicle() override {};
+    DemoSedanVehicle(const EngineConfig& config) : v3d::Engine(config) {};
+    ~DemoSedanVehicle() override {
+        // The queued frames and the render targets refer to the paints
+        stopRenderThread();
+        m_scene.reset();
+    };
 };
 
 }  // namespace demos
 
 }  // namespace v3d
 
-int demoSedanVehicle(uint32_t width, uint32_t height,
-                     v3d::rendering::GraphicsBackendType graphicsBackendType) {
+int demoSedanVehicle(const v3d::EngineConfig& config) {
     const char* DEMO_LOG_START_MESSAGE = R"(
 .--------------------------------------------------------------.
 |                        Starting Demo: Sedan Vehicle          |
@@ -110,8 +148,7 @@ int demoSedanVehicle(uint32_t width, uint32_t height,
     try {
         {
             // Create the 3D engine instance
-            v3d::demos::DemoSedanVehicle demo(width, height,
-                                              graphicsBackendType);
+            v3d::demos::DemoSedanVehicle demo(config);
 
             // Initialize and run the 3D engine
             demo.run();
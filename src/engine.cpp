@@ -5,10 +5,13 @@
 #include <assimp/scene.h>
 #include <plog/Log.h>
 
+#include <algorithm>
 #include <atomic>
 #include <boost/stacktrace.hpp>
 #include <cassert>
+#include <cmath>
 #include <csignal>
+#include <fstream>
 #include <ostream>
 #include <sstream>
 #include <string>
@@ -25,6 +28,7 @@
 #include "rendering/mesh_renderer.h"
 #include "rendering/null_graphics_backend.hpp"
 #include "transform.h"
+#include "utils/exception.hpp"
 
 // ------------------------------- TEMP ----------------------------------
 #include "chrono_vehicle/ChConfigVehicle.h"
@@ -126,9 +130,11 @@ void initImgui(GLFWwindow* window, float mainScale, bool darkMode = true) {
     ImGui_ImplOpenGL3_Init(glsl_version);
 }
 
-void imgui_beginFrame_() {
+void imgui_beginFrame_(bool rendererFrame = true) {
     // GUI window
-    ImGui_ImplOpenGL3_NewFrame();
+    // The renderer frame needs the context, it is started by the render
+    // thread when there is one
+    if (rendererFrame) ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
 }
@@ -140,7 +146,76 @@ void imgui_RenderFrame() {
 
 namespace v3d {
 Engine::Engine(uint32_t width, uint32_t height,
-               rendering::GraphicsBackendType graphicsBackendType) {
+               rendering::GraphicsBackendType graphicsBackendType)
+    : Engine(EngineConfig{width, height, graphicsBackendType}) {}
+
+Model* Engine::importModel(const std::string& filepath,
+                           const std::string& name) {
+    Model* model = nullptr;
+    switch (m_gBackendType) {
+        case rendering::GraphicsBackendType::NONE:
+            model = m_modelManager->importModel<MeshNull>(
+                filepath, name, m_config.compressVertices);
+            // Accounted and pooled like the OpenGL backend would, every
+            // level of detail lives in the geometry arena
+            for (auto mesh : model->getMeshes())
+                for (size_t level = 0; level < mesh->getNumLods(); level++)
+                    static_cast<rendering::NullGraphicsBackend*>(
+                        m_graphicsBackend.get())
+                        ->addImportedMesh(*mesh->getLod(level));
+            break;
+        case rendering::GraphicsBackendType::OPENGL_API:
+        case rendering::GraphicsBackendType::OPENGL_OFFSCREEN_API:
+            // Uploads the meshes, needs the context
+            m_graphicsBackend->runOnRenderThread([&] {
+                model = m_modelManager->importModel<MeshOpenGL>(
+                    filepath, name, m_graphicsBackend->getGeometryArena(),
+                    m_config.compressVertices);
+            });
+            break;
+        default:
+            throw exception::NotImplemented();
+    }
+
+    size_t vertices = 0, vertexBytes = 0, indexBytes = 0, sourceBytes = 0;
+    for (auto mesh : model->getMeshes()) {
+        vertices += mesh->getNumVertices();
+        vertexBytes += mesh->getVertexBytes();
+        indexBytes += mesh->getIndexBytes();
+        sourceBytes += mesh->getUncompressedBytes();
+    }
+    const size_t bytes = vertexBytes + indexBytes;
+    PLOGI << "Model " << name << ": " << vertices << " vertices, "
+          << vertexBytes / 1024 << " KB vertex + " << indexBytes / 1024
+          << " KB index data (" << sourceBytes / 1024 << " KB uncompressed, "
+          << (sourceBytes > 0 ? 100 - 100 * bytes / sourceBytes : 0)
+          << "% saved)\n";
+    return model;
+}
+
+std::pair<const char*, rendering::WindowBackendHint> Engine::windowParams(
+    rendering::GraphicsBackendType graphicsBackendType) {
+    switch (graphicsBackendType) {
+        case rendering::GraphicsBackendType::NONE:
+            return {"Vector3D Headless", rendering::WindowBackendHint::NONE};
+        case rendering::GraphicsBackendType::VULKAN_API:
+            return {"Vector3D Vulkan",
+                    rendering::WindowBackendHint::VULKAN_API};
+        case rendering::GraphicsBackendType::OPENGL_API:
+            return {"Vector3D OpenGL",
+                    rendering::WindowBackendHint::OPENGL_API};
+        case rendering::GraphicsBackendType::OPENGL_OFFSCREEN_API:
+            return {"Vector3D OpenGL Offscreen",
+                    rendering::WindowBackendHint::OPENGL_OFFSCREEN_API};
+        default:
+            throw std::runtime_error(
+                "Failed to initialize engine, invalid graphics backend type!");
+    }
+}
+
+Engine::Engine(const EngineConfig& config)
+    : m_config(config),
+      m_framePacer(config.framePacing, config.targetFrameRate) {
     m_engineStartTime = std::chrono::steady_clock::now();
 
     // Initialize signal handler to log unhandled errors and other signals
@@ -148,41 +223,112 @@ Engine::Engine(uint32_t width, uint32_t height,
 
     PLOGI << "Initializing Engine" << std::endl;
 
+    m_phSystem.applyProfile(m_config.physicsProfile);
+    if (m_config.heightfield)
+        m_phSystem.setTerrain(
+            std::make_shared<HeightfieldTerrain>(*m_config.heightfield));
+    if (!m_config.physicsTimingsFile.empty())
+        m_phSystem.openTimingsCsv(m_config.physicsTimingsFile);
+
+    if (m_config.headless) {
+        // No platform layer at all, the null backend only creates the meshes
+        m_gBackendType = rendering::GraphicsBackendType::NONE;
+        m_graphicsBackend =
+            std::make_unique<rendering::NullGraphicsBackend>(nullptr);
+        PLOGI << "Headless mode, no window nor graphics context\n";
+    } else {
+        initWindowAndGraphics();
+    }
+
+    m_componentRegistry = &editor::EditorComponentRegistry::instance();
+    m_editor = std::make_unique<editor::Editor>(this);
+
+    // Init Model loader and manager
+    std::unique_ptr<ModelLoader> modelLoader = makeModelLoader();
+    m_modelManager = std::make_unique<ModelManager>(std::move(modelLoader));
+    rendering::MeshOptimizationSettings meshOptimization;
+    meshOptimization.enabled = m_config.optimizeMeshes;
+    m_modelManager->setOptimizationSettings(meshOptimization);
+    rendering::MeshLodSettings meshLods;
+    meshLods.enabled = m_config.generateLods;
+    m_modelManager->setLodSettings(meshLods);
+
+    // Instantiate default keyboard device and mappings, the keyboard reads
+    // the window
+    if (!m_config.headless) initDefaultInput();
+
+    PLOGI << "Engine Initialized" << std::endl;
+
+    PLOGV << "Initializing Scene" << std::endl;
+    // Initialize the scene and add entities
+    m_scene = Scene::create(this, &m_phSystem);
+
+    // Pre-initialize scene component vectors, required to be able to add
+    // components dynamically (not known at compile-time, for example adding a
+    // component through the GUI)
+    registerComponents(m_scene.get(), m_componentRegistry);
+    PLOGV << "Scene Initialized" << std::endl;
+
+    m_scene->print_entities();
+};
+
+void Engine::initWindowAndGraphics() {
+    const uint32_t width = m_config.width;
+    const uint32_t height = m_config.height;
+    const rendering::GraphicsBackendType graphicsBackendType =
+        m_config.graphicsBackend;
+
     // Initialize GLFW and create a window
     glfwSetErrorCallback(glfw_error_callback);
 
+    m_gBackendType = graphicsBackendType;
+    auto [windowTitle, windowHint] = windowParams(m_gBackendType);
+
+    Window::initPlatformHint(windowHint);
     if (!glfwInit()) throw std::runtime_error("Failed initializing GLFW!");
 
-    m_gBackendType = graphicsBackendType;
+    // The null platform used for offscreen rendering has no real monitor
+    GLFWmonitor* primaryMonitor = glfwGetPrimaryMonitor();
     float mainScale =
-        ImGui_ImplGlfw_GetContentScaleForMonitor(glfwGetPrimaryMonitor());
+        primaryMonitor != nullptr &&
+                windowHint != rendering::WindowBackendHint::OPENGL_OFFSCREEN_API
+            ? ImGui_ImplGlfw_GetContentScaleForMonitor(primaryMonitor)
+            : 1.f;
 
     switch (m_gBackendType) {
         case v3d::rendering::GraphicsBackendType::NONE:
-            m_window = std::make_unique<Window>(
-                "Vector3D Headless", rendering::WindowBackendHint::NONE, width,
-                height, mainScale, true);
+            m_window = std::make_unique<Window>(windowTitle, windowHint, width,
+                                                height, mainScale, true);
 
             m_graphicsBackend =
                 std::make_unique<rendering::NullGraphicsBackend>(
                     m_window.get());
             break;
         case rendering::GraphicsBackendType::VULKAN_API:
-            m_window = std::make_unique<Window>(
-                "Vector3D Vulkan", rendering::WindowBackendHint::VULKAN_API,
-                width, height, mainScale, true);
+            m_window = std::make_unique<Window>(windowTitle, windowHint, width,
+                                                height, mainScale, true);
 
             m_graphicsBackend =
                 std::make_unique<rendering::VulkanBackend>(m_window.get());
             break;
         case rendering::GraphicsBackendType::OPENGL_API:
-            m_window = std::make_unique<Window>(
-                "Vector3D OpenGL", rendering::WindowBackendHint::OPENGL_API,
-                width, height, mainScale, true);
+            m_window = std::make_unique<Window>(windowTitle, windowHint, width,
+                                                height, mainScale, true);
 
             m_graphicsBackend =
                 std::make_unique<rendering::OpenGlBackend>(m_window.get());
             break;
+        case rendering::GraphicsBackendType::OPENGL_OFFSCREEN_API:
+            // No vsync and no window scale, frames are rendered as fast as
+            // possible at the requested resolution
+            m_window = std::make_unique<Window>(
+                windowTitle, windowHint, width, height, 1.f, false,
+                m_config.offscreen.contextApi);
+
+            m_graphicsBackend =
+                std::make_unique<rendering::OpenGlOffscreenBackend>(
+                    m_window.get(), m_config.offscreen);
+            break;
         default:
             throw std::runtime_error(
                 "Failed to initialize engine, invalid graphics backend type!");
@@ -190,33 +336,12 @@ Engine::Engine(uint32_t width, uint32_t height,
     }
 
     initImgui(m_window->getWindow(), mainScale, true);
-
-    m_componentRegistry = &editor::EditorComponentRegistry::instance();
-    m_editor = std::make_unique<editor::Editor>(this);
-
-    // Init Model loader and manager
-    std::unique_ptr<ModelLoader> modelLoader = makeModelLoader();
-    m_modelManager = std::make_unique<ModelManager>(std::move(modelLoader));
-
-    // Instantiate default keyboard device and mappings
-    initDefaultInput();
-
-    PLOGI << "Engine Initialized" << std::endl;
-
-    PLOGV << "Initializing Scene" << std::endl;
-    // Initialize the scene and add entities
-    m_scene = Scene::create(this, &m_phSystem);
-
-    // Pre-initialize scene component vectors, required to be able to add
-    // components dynamically (not known at compile-time, for example adding a
-    // component through the GUI)
-    registerComponents(m_scene.get(), m_componentRegistry);
-    PLOGV << "Scene Initialized" << std::endl;
-
-    m_scene->print_entities();
-};
+}
 
 Engine::~Engine() {
+    // Draws the queued frames, the scene and the backend must still be alive
+    stopRenderThread();
+
     m_scene.reset();
 
     // Clear managers resources
@@ -228,33 +353,60 @@ Engine::~Engine() {
     m_editor.reset();
 
     // Imgui cleanup
-    ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
-    ImGui::DestroyContext();
+    if (!m_config.headless) {
+        ImGui_ImplOpenGL3_Shutdown();
+        ImGui_ImplGlfw_Shutdown();
+        ImGui::DestroyContext();
+    }
 
     m_graphicsBackend.reset();
     m_window.reset();
-    glfwTerminate();
+    if (!m_config.headless) glfwTerminate();
 }
 
 void Engine::start() {
     engineStartPre();
-    m_scene->m_components.for_each(
-        [](ComponentBase& component) { component.start(); });
+    m_scene->start();
     engineStart();
 }
 
 void Engine::mainLoop() {
     bool running = !recieved_forced_close_signal;
 
+    PLOGI << "Engine started in "
+          << std::chrono::duration<double, std::milli>(
+                 std::chrono::steady_clock::now() - m_engineStartTime)
+                 .count()
+          << " ms\n";
+
     std::cout << "Initial Frame count " << m_last_frame_dt.count() << "\n";
 
     ImGuiIO& io = ImGui::GetIO();
     (void)io;
 
+    applyFramePacing();
+
+    // The game thread records the frame into a snapshot, the render thread
+    // draws it with the GUI and presents it
+    if (m_config.renderThread && m_graphicsBackend->supportsRenderThread()) {
+        m_renderThread = std::make_unique<rendering::RenderThread>(
+            m_window.get(), m_config.renderThreadFrames,
+            [this](rendering::RenderSnapshot& frame) {
+                m_graphicsBackend->renderFrame(frame);
+                ImGui_ImplOpenGL3_NewFrame();
+                if (ImDrawData* drawData = frame.gui.getDrawData())
+                    ImGui_ImplOpenGL3_RenderDrawData(drawData);
+                m_graphicsBackend->present();
+            });
+        m_graphicsBackend->setRenderThread(m_renderThread.get());
+    }
+
+    if (m_config.physicsThread) m_phSystem.startThread();
+
     // Main game loop
     while (running) {
-        running = !recieved_forced_close_signal && !m_window->shouldClose();
+        running = !recieved_forced_close_signal && !m_window->shouldClose() &&
+                  (m_config.maxFrames == 0 || m_frameCount < m_config.maxFrames);
 
         const auto frame_start = std::chrono::steady_clock::now();
         double last_frame_dt = m_last_frame_dt.count();
@@ -276,7 +428,7 @@ void Engine::mainLoop() {
         }
 
         // Start the Dear ImGui frame
-        imgui_beginFrame_();
+        imgui_beginFrame_(m_renderThread == nullptr);
 
         // Update logic
         logicFrameUpdatePre(last_frame_dt);
@@ -285,13 +437,19 @@ void Engine::mainLoop() {
 
         // Update Physics
         physicsFrameUpdatePre();
-        for (int i = 0; i < m_phSystem.getStepPerFrame(); i++) m_phSystem.stepSimulation();
+        m_phSystem.advance(last_frame_dt);
         physicsFrameUpdate();
 
         // Render frame
         // TODO: Pass time and dt, to be able to pass them to a shader
         graphicsFrameUpdatePre();
-        m_graphicsBackend->update();
+        rendering::RenderSnapshot* renderFrame = nullptr;
+        if (m_renderThread) {
+            renderFrame = &m_renderThread->beginFrame();
+            m_graphicsBackend->captureFrame(*renderFrame);
+        } else {
+            m_graphicsBackend->update();
+        }
         graphicsFrameUpdate();
 
         // Render GUI
@@ -303,14 +461,19 @@ void Engine::mainLoop() {
         // Render debbug window
         renderEngineDebugGui(last_frame_dt);
 
-        // Render Imgui UI
-        imgui_RenderFrame();
+        if (renderFrame != nullptr) {
+            submitRenderThreadFrame(*renderFrame);
+        } else {
+            // Render Imgui UI
+            imgui_RenderFrame();
 
-        // Swap buffer
-        m_graphicsBackend->present();
+            // Swap buffer
+            m_graphicsBackend->present();
+        }
+        m_frameCount++;
 
-        // Enforce physics soft-realtime
-        m_phSystem.spin(1.f / (float)m_targetFrameRate);  // Target 60 fps
+        // Enforce soft-realtime, sleeps the rest of the frame budget
+        m_framePacer.endFrame();
 
         // Update deltatime
         const auto frame_end = std::chrono::steady_clock::now();
@@ -320,6 +483,147 @@ void Engine::mainLoop() {
         // std::chrono::duration_cast<std::chrono::milliseconds>(diff).count()
         // << "\n";
     }
+
+    m_phSystem.stopThread();
+    stopRenderThread();
+}
+
+void Engine::stopRenderThread() {
+    if (!m_renderThread) return;
+    m_renderThread.reset();
+    m_graphicsBackend->setRenderThread(nullptr);
+}
+
+void Engine::headlessLoop() {
+    const double dt = m_config.headlessTimeStep;
+    if (!(dt > 0))
+        throw std::invalid_argument("Headless time step must be positive");
+
+    PLOGI << "Engine started in "
+          << std::chrono::duration<double, std::milli>(
+                 std::chrono::steady_clock::now() - m_engineStartTime)
+                 .count()
+          << " ms, headless, " << dt * 1000 << " ms ticks"
+          << (m_config.maxSpeed ? ", max speed" : ", realtime") << "\n";
+
+    // Never drop simulated time, a tick must fit in the steps of a frame
+    const int stepsPerTick =
+        static_cast<int>(std::ceil(dt / m_phSystem.getStepSize())) + 1;
+    if (m_phSystem.getMaxStepsPerFrame() < stepsPerTick)
+        m_phSystem.setMaxStepsPerFrame(stepsPerTick);
+
+    // Realtime runs are paced like the main loop, at one tick per period
+    FramePacer pacer(FramePacingMode::FIXED_RATE, 1 / dt);
+
+    HeadlessStats stats;
+    double totalTickTime = 0;
+    const auto runStart = std::chrono::steady_clock::now();
+    while (!recieved_forced_close_signal &&
+           (m_config.simTime <= 0 || stats.simTime < m_config.simTime) &&
+           (m_config.maxFrames == 0 || m_frameCount < m_config.maxFrames)) {
+        const auto tickStart = std::chrono::steady_clock::now();
+
+        // Update logic
+        logicFrameUpdatePre(dt);
+        m_scene->update(dt);
+        logicFrameUpdate(dt);
+
+        // Update Physics, a tick is always simulated in full
+        physicsFrameUpdatePre();
+        stats.physicsSteps += m_phSystem.advance(dt);
+        physicsFrameUpdate();
+
+        const double tickTime =
+            std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - tickStart)
+                .count();
+        totalTickTime += tickTime;
+        stats.maxTickTime = std::max(stats.maxTickTime, tickTime);
+        stats.ticks++;
+        stats.simTime += dt;
+        m_frameCount++;
+
+        if (!m_config.maxSpeed) pacer.endFrame();
+    }
+    stats.wallTime = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - runStart)
+                         .count();
+    stats.meanTickTime = stats.ticks > 0 ? totalTickTime / stats.ticks : 0;
+
+    PLOGI << "Headless run: " << stats.ticks << " ticks, " << stats.simTime
+          << " s simulated in " << stats.wallTime << " s ("
+          << (stats.wallTime > 0 ? stats.simTime / stats.wallTime : 0)
+          << "x realtime)\n";
+    writeHeadlessStats(stats);
+}
+
+void Engine::writeHeadlessStats(const HeadlessStats& stats) {
+    if (m_config.statsFile.empty()) return;
+
+    std::ofstream file(m_config.statsFile);
+    if (!file) {
+        PLOGE << "Failed to write the headless stats to "
+              << m_config.statsFile;
+        return;
+    }
+
+    const double realtimeFactor =
+        stats.wallTime > 0 ? stats.simTime / stats.wallTime : 0;
+    const double ticksPerSecond =
+        stats.wallTime > 0 ? stats.ticks / stats.wallTime : 0;
+    const double stepsPerSecond =
+        stats.wallTime > 0 ? stats.physicsSteps / stats.wallTime : 0;
+    file << "{\n"
+         << "  \"ticks\": " << stats.ticks << ",\n"
+         << "  \"tick_time_step\": " << m_config.headlessTimeStep << ",\n"
+         << "  \"max_speed\": " << (m_config.maxSpeed ? "true" : "false")
+         << ",\n"
+         << "  \"sim_time\": " << stats.simTime << ",\n"
+         << "  \"wall_time\": " << stats.wallTime << ",\n"
+         << "  \"realtime_factor\": " << realtimeFactor << ",\n"
+         << "  \"ticks_per_second\": " << ticksPerSecond << ",\n"
+         << "  \"mean_tick_ms\": " << stats.meanTickTime << ",\n"
+         << "  \"max_tick_ms\": " << stats.maxTickTime << ",\n"
+         << "  \"physics_step_size\": " << m_phSystem.getStepSize() << ",\n"
+         << "  \"physics_steps\": " << stats.physicsSteps << ",\n"
+         << "  \"physics_steps_per_second\": " << stepsPerSecond << ",\n"
+         << "  \"clamped_ticks\": " << m_phSystem.getNumClampedFrames()
+         << ",\n"
+         << "  \"bodies\": " << m_phSystem.getNumBodies() << ",\n"
+         << "  \"vehicles\": " << m_phSystem.getNumVehicles() << "\n"
+         << "}\n";
+    PLOGI << "Headless stats written to " << m_config.statsFile << "\n";
+}
+
+void Engine::applyFramePacing() {
+    const bool vsync = m_framePacer.getMode() == FramePacingMode::VSYNC;
+    m_graphicsBackend->runOnRenderThread(
+        [this, vsync] { m_window->setVsync(vsync); });
+}
+
+void Engine::submitRenderThreadFrame(rendering::RenderSnapshot& frame) {
+    ImGui::Render();
+    ImDrawData* drawData = ImGui::GetDrawData();
+
+    // The snapshot doesn't carry the texture requests (font atlas), they are
+    // processed now. Queued after the submitted frames, so a texture is never
+    // destroyed under a frame still using it.
+    if (drawData->Textures != nullptr) {
+        bool pendingTextures = false;
+        for (ImTextureData* texture : *drawData->Textures)
+            pendingTextures |= texture->Status != ImTextureStatus_OK;
+
+        if (pendingTextures) {
+            m_renderThread->runSync([drawData] {
+                for (ImTextureData* texture : *drawData->Textures)
+                    if (texture->Status != ImTextureStatus_OK)
+                        ImGui_ImplOpenGL3_UpdateTexture(texture);
+            });
+        }
+    }
+
+    frame.gui.capture(drawData);
+    m_renderThread->submitFrame();
 }
 
 void Engine::initDefaultInput() {
@@ -339,13 +643,22 @@ void Engine::processInput(GLFWwindow* window) {}
 
 void Engine::renderEngineDebugGui(double delta) {
     ImGui::Begin("Debbug");
-    int targetFPS = m_targetFrameRate;
-    if (ImGui::InputInt("Target FPS", &targetFPS, 1, 10)) {
-        m_targetFrameRate = targetFPS;
-    }
+    const FramePacingMode framePacing = m_framePacer.getMode();
+    m_framePacer.renderDebbugGUI();
+    if (m_framePacer.getMode() != framePacing) applyFramePacing();
     ImGui::Spacing();
     if (ImGui::CollapsingHeader("Physics")) m_phSystem.renderDebbugGUI();
     ImGui::Spacing();
+    if (ImGui::CollapsingHeader("Rendering")) {
+        if (m_renderThread) {
+            ImGui::Text("Render thread: %zu frames, wait %.2f ms, draw %.2f ms",
+                        m_renderThread->getNumSnapshots(),
+                        m_renderThread->getLastWaitTime(),
+                        m_renderThread->getLastRenderTime());
+        }
+        m_graphicsBackend->renderDebbugGUI();
+    }
+    ImGui::Spacing();
 
     ImGui::End();
 }
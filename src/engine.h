@@ -5,11 +5,14 @@
 #include <chrono>
 #include <cstdlib>
 #include <iostream>
+#include <optional>
 #include <stdexcept>
+#include <string>
 
 #include "ModelManager.hpp"
 #include "editor/ComponentRegistry.h"
 #include "editor/Editor.h"
+#include "frame_pacer.h"
 #include "input/InputDevice.hpp"
 #include "input/InputKeys.hpp"
 #include "input/InputManager.h"
@@ -17,6 +20,8 @@
 #include "plog/Log.h"
 #include "rendering/null_graphics_backend.hpp"
 #include "rendering/opengl_backend.h"
+#include "rendering/opengl_offscreen_backend.h"
+#include "rendering/render_thread.h"
 #include "rendering/rendering_def.h"
 #include "rendering/vulkan_backend.h"
 #include "scene.h"
@@ -24,16 +29,75 @@
 
 namespace v3d {
 #define DEFAULT_GRAPHICS_BACKEND_TYPE rendering::GraphicsBackendType::VULKAN_API
+
+/// @brief Engine startup options
+struct EngineConfig {
+    uint32_t width = 1920;
+    uint32_t height = 1080;
+    rendering::GraphicsBackendType graphicsBackend =
+        DEFAULT_GRAPHICS_BACKEND_TYPE;
+    /// @brief Used by GraphicsBackendType::OPENGL_OFFSCREEN_API
+    rendering::OffscreenSettings offscreen;
+    /// @brief Stop the main loop after this many frames, 0 runs until the
+    /// window is closed
+    uint64_t maxFrames = 0;
+    /// @brief Import models in the compressed vertex format
+    bool compressVertices = true;
+    /// @brief Run the mesh optimization pass on import (vertex
+    /// deduplication, vertex cache, overdraw and vertex fetch ordering)
+    bool optimizeMeshes = true;
+    /// @brief Generate simplified levels of detail of the imported meshes
+    bool generateLods = true;
+    /// @brief Draw on a render thread owning the graphics context, frame N
+    /// is drawn while the game thread simulates frame N+1. Ignored by the
+    /// backends without support (offscreen, Vulkan).
+    bool renderThread = true;
+    /// @brief Frame snapshots in flight with the render thread, 2 or more.
+    /// Each extra one adds a frame of latency.
+    uint32_t renderThreadFrames = 2;
+    /// @brief Step the physics continuously on its own thread, the main loop
+    /// only takes its newest poses and queues the driver inputs. Ignored by
+    /// headless runs, their ticks stay deterministic.
+    bool physicsThread = false;
+    /// @brief How the main loop waits between frames
+    FramePacingMode framePacing = FramePacingMode::FIXED_RATE;
+    /// @brief Frames per second of FramePacingMode::FIXED_RATE
+    double targetFrameRate = 60;
+    /// @brief Solver, collision system, threads and step size of the physics
+    PhysicsProfile physicsProfile;
+    /// @brief Tiled heightfield of the vehicle terrain, flat if unset
+    std::optional<HeightfieldSettings> heightfield;
+    /// @brief CSV file of the physics step timings, one row per frame with
+    /// steps, empty to skip
+    std::string physicsTimingsFile;
+    /// @brief Simulate without GLFW, graphics context nor ImGui (display
+    /// less servers). Meshes are imported as with GraphicsBackendType::NONE.
+    bool headless = false;
+    /// @brief Simulated seconds before a headless run stops, 0 runs until
+    /// maxFrames or a close signal
+    double simTime = 0;
+    /// @brief Logic tick of a headless run, simulated seconds
+    double headlessTimeStep = 1.0 / 60;
+    /// @brief Run the headless ticks back to back instead of at realtime
+    bool maxSpeed = false;
+    /// @brief JSON file of the headless throughput stats, empty to skip
+    std::string statsFile = "headless_stats.json";
+};
+
 class Engine {
    public:
     Engine(uint32_t width, uint32_t height,
            rendering::GraphicsBackendType graphicsBackendType =
                DEFAULT_GRAPHICS_BACKEND_TYPE);
+    explicit Engine(const EngineConfig& config);
     virtual ~Engine();
 
     void run() {
         start();
-        mainLoop();
+        if (m_config.headless)
+            headlessLoop();
+        else
+            mainLoop();
     }
 
     inline void registerRenderTarget(rendering::IRenderable* renderTarget) {
@@ -68,11 +132,16 @@ class Engine {
 
     InputManager* getInputManager() { return &m_inputManager; }
 
+    /// @brief Import a model creating its meshes for the active graphics
+    /// backend
+    Model* importModel(const std::string& filepath, const std::string& name);
+
    protected:
     // TODO: change member pointers to smart pointers
     std::unique_ptr<editor::Editor> m_editor;
     std::unique_ptr<ModelManager> m_modelManager = nullptr;
 
+    EngineConfig m_config;
     rendering::GraphicsBackendType m_gBackendType =
         DEFAULT_GRAPHICS_BACKEND_TYPE;
     std::unique_ptr<rendering::GraphicsBackend> m_graphicsBackend;
@@ -80,8 +149,11 @@ class Engine {
     // rendering::OpenGlBackend* m_openGlBackend;
     // rendering::NullGraphicsBackend* m_nullGraphicsBackend;
     std::unique_ptr<Window> m_window;
+    // Set while the main loop runs with a render thread
+    std::unique_ptr<rendering::RenderThread> m_renderThread;
 
-    int m_targetFrameRate = 60;
+    FramePacer m_framePacer;
+    uint64_t m_frameCount = 0;
 
     InputManager m_inputManager;
 
@@ -93,6 +165,10 @@ class Engine {
     std::chrono::duration<double> m_last_frame_dt =
         std::chrono::duration<double>(1 / 60);
 
+    /// @brief Window title and backend hint of a graphics backend type
+    static std::pair<const char*, rendering::WindowBackendHint> windowParams(
+        rendering::GraphicsBackendType graphicsBackendType);
+
     /// @brief Called after engine initialization, but before all components
     /// have been initialized
     virtual void engineStartPre() {}
@@ -123,11 +199,36 @@ class Engine {
 
     virtual void renderEngineDebugGui(double delta);
 
+    /// @brief Draw the frames queued on the render thread and stop it. The
+    /// snapshots refer to the materials of the render targets, derived
+    /// engines owning materials call it before destroying them.
+    void stopRenderThread();
+
    private:
+    /// @brief Throughput of a headless run
+    struct HeadlessStats {
+        uint64_t ticks = 0;
+        double simTime = 0;       // s
+        double wallTime = 0;      // s
+        double meanTickTime = 0;  // ms
+        double maxTickTime = 0;   // ms
+        int physicsSteps = 0;
+    };
+
     editor::EditorComponentRegistry* m_componentRegistry;
 
+    /// @brief Create the window, graphics backend and ImGui context
+    void initWindowAndGraphics();
     void start();
     void mainLoop();
+    /// @brief Run logic and physics in fixed ticks of headlessTimeStep, no
+    /// rendering, no input and no GUI
+    void headlessLoop();
+    void writeHeadlessStats(const HeadlessStats& stats);
+    /// @brief Capture the GUI of the frame and hand it to the render thread
+    void submitRenderThreadFrame(rendering::RenderSnapshot& frame);
+    /// @brief Set the swap interval of the pacing mode
+    void applyFramePacing();
 
     void processInput(GLFWwindow* window);
     /// @brief Pre-initialize scene component vectors, required to be able to
@@ -14,6 +14,7 @@ class RigidBody;
 
 class Entity : public IEditorGUISelectable {
     friend class Scene;
+    friend class RigidBody;
 
    public:
     std::string getName() const { return m_name; }
@@ -94,7 +95,6 @@ class Entity : public IEditorGUISelectable {
     void setParent(entity_ptr newParent);
 
     Scene* m_scene = nullptr;
-    // TODO: Add reference to Transform and Rigidbody
 
    protected:
     std::string m_name = "entity";
@@ -105,6 +105,7 @@ class Entity : public IEditorGUISelectable {
     std::vector<componentID_t> m_components;
 
     Transform* m_transform = nullptr;
+    // Null unless the entity takes part in the physics
     RigidBody* m_rigidBody = nullptr;
 
    private:
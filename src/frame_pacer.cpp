@@ -0,0 +1,147 @@
+#include "frame_pacer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+
+#include "imgui.h"
+
+#if defined(_MSC_VER)
+#include <windows.h>
+#include <timeapi.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+namespace v3d {
+
+FramePacer::FramePacer(FramePacingMode mode, double targetRate)
+    : m_mode(mode) {
+    setTargetRate(targetRate);
+#if defined(_MSC_VER)
+    // Default timer resolution is ~15 ms, too coarse to sleep a frame
+    timeBeginPeriod(1);
+#endif
+}
+
+FramePacer::~FramePacer() {
+#if defined(_MSC_VER)
+    timeEndPeriod(1);
+#endif
+}
+
+void FramePacer::setMode(FramePacingMode mode) {
+    m_mode = mode;
+    m_started = false;
+}
+
+void FramePacer::setTargetRate(double targetRate) {
+    if (!(targetRate > 0))
+        throw std::invalid_argument("FramePacer target rate must be positive");
+
+    m_targetRate = targetRate;
+    m_period = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / targetRate));
+    m_started = false;
+}
+
+void FramePacer::endFrame() {
+    m_lastSleepTime = 0;
+    m_lastSpinTime = 0;
+
+    if (m_mode == FramePacingMode::FIXED_RATE) {
+        const Clock::time_point now = Clock::now();
+        if (!m_started) {
+            m_deadline = now + m_period;
+            m_started = true;
+        } else if (now > m_deadline + m_period) {
+            // Too late to catch up, restart from this frame
+            m_numMissedFrames++;
+            m_deadline = now;
+        }
+
+        waitUntil(m_deadline);
+        m_deadline += m_period;
+    }
+
+    recordFrame(Clock::now());
+}
+
+void FramePacer::waitUntil(Clock::time_point deadline) {
+    const auto spinMargin = std::max<Clock::duration>(
+        m_minSpinMargin,
+        std::chrono::nanoseconds(static_cast<int64_t>(2 * m_oversleep)));
+
+    Clock::time_point now = Clock::now();
+    const Clock::time_point sleepEnd = deadline - spinMargin;
+    if (now < sleepEnd) {
+        const Clock::time_point sleepStart = now;
+        std::this_thread::sleep_until(sleepEnd);
+        now = Clock::now();
+
+        const double oversleep =
+            std::chrono::duration<double, std::nano>(now - sleepEnd).count();
+        m_oversleep = 0.9 * m_oversleep + 0.1 * std::max(oversleep, 0.0);
+        m_lastSleepTime =
+            std::chrono::duration<double, std::milli>(now - sleepStart).count();
+    }
+
+    const Clock::time_point spinStart = now;
+    while (now < deadline) {
+        std::this_thread::yield();
+        now = Clock::now();
+    }
+    m_lastSpinTime =
+        std::chrono::duration<double, std::milli>(now - spinStart).count();
+}
+
+void FramePacer::recordFrame(Clock::time_point frameEnd) {
+    if (m_lastFrameEnd != Clock::time_point()) {
+        m_lastFrameTime = std::chrono::duration<double, std::milli>(
+                              frameEnd - m_lastFrameEnd)
+                              .count();
+
+        m_history[m_historyOffset] = static_cast<float>(m_lastFrameTime);
+        m_historyOffset = (m_historyOffset + 1) % HistorySize;
+        m_historyCount = std::min(m_historyCount + 1, HistorySize);
+
+        double sum = 0, sumSquares = 0;
+        for (size_t i = 0; i < m_historyCount; i++) {
+            sum += m_history[i];
+            sumSquares += double(m_history[i]) * m_history[i];
+        }
+        m_meanFrameTime = sum / m_historyCount;
+        m_jitter = std::sqrt(std::max(
+            sumSquares / m_historyCount - m_meanFrameTime * m_meanFrameTime,
+            0.0));
+    }
+    m_lastFrameEnd = frameEnd;
+}
+
+void FramePacer::renderDebbugGUI() {
+    static const char* modes[] = {"Unlimited", "Fixed rate", "VSync"};
+    int mode = static_cast<int>(m_mode);
+    if (ImGui::Combo("Frame pacing", &mode, modes, 3))
+        setMode(static_cast<FramePacingMode>(mode));
+
+    if (m_mode == FramePacingMode::FIXED_RATE) {
+        int targetRate = static_cast<int>(std::round(m_targetRate));
+        if (ImGui::InputInt("Target FPS", &targetRate, 1, 10) &&
+            targetRate > 0)
+            setTargetRate(targetRate);
+    }
+
+    ImGui::Text("Frame: %.2f ms, mean %.2f ms, jitter %.3f ms",
+                m_lastFrameTime, m_meanFrameTime, m_jitter);
+    ImGui::Text("Sleep %.2f ms, spin %.3f ms, missed %zu", m_lastSleepTime,
+                m_lastSpinTime, m_numMissedFrames);
+    // Oldest frame first once the ring is full
+    const size_t plotOffset =
+        m_historyCount < HistorySize ? 0 : m_historyOffset;
+    ImGui::PlotLines("Frame time", m_history.data(),
+                     static_cast<int>(m_historyCount),
+                     static_cast<int>(plotOffset));
+}
+
+}  // namespace v3d
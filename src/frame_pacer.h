@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+
+namespace v3d {
+
+enum class FramePacingMode {
+    /// @brief No wait, frames run as fast as possible
+    UNLIMITED,
+    /// @brief Wait until the frame budget of the target rate is spent
+    FIXED_RATE,
+    /// @brief Paced by the buffer swap, no wait in the pacer
+    VSYNC,
+};
+
+/**
+ * @brief Limits the frame rate of the main loop without burning a core.
+ *
+ * The remaining budget of the frame is slept, only the last part is spun to
+ * absorb the wake up latency of the OS scheduler. The spin margin adapts to
+ * the oversleep measured on previous frames and never goes below
+ * minSpinMargin. Deadlines advance by a fixed period, a late frame doesn't
+ * shift the following ones unless it is late by more than a frame.
+ *
+ * Frame times (between two endFrame calls) are tracked over the last
+ * HistorySize frames to report their mean and jitter (standard deviation).
+ */
+class FramePacer {
+   public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr size_t HistorySize = 120;
+
+    FramePacer(FramePacingMode mode = FramePacingMode::FIXED_RATE,
+               double targetRate = 60);
+    ~FramePacer();
+
+    FramePacer(const FramePacer&) = delete;
+    FramePacer& operator=(const FramePacer&) = delete;
+
+    /// @brief Wait for the end of the current frame budget
+    void endFrame();
+
+    FramePacingMode getMode() const { return m_mode; }
+    void setMode(FramePacingMode mode);
+    /// @brief Frames per second of FramePacingMode::FIXED_RATE
+    double getTargetRate() const { return m_targetRate; }
+    void setTargetRate(double targetRate);
+    /// @brief Minimum time spun before a deadline
+    void setMinSpinMargin(Clock::duration margin) { m_minSpinMargin = margin; }
+
+    /// @brief Duration of the last frame, ms
+    double getLastFrameTime() const { return m_lastFrameTime; }
+    /// @brief Mean frame time of the history, ms
+    double getMeanFrameTime() const { return m_meanFrameTime; }
+    /// @brief Standard deviation of the frame time of the history, ms
+    double getJitter() const { return m_jitter; }
+    /// @brief Time slept and spun by the last endFrame, ms
+    double getLastSleepTime() const { return m_lastSleepTime; }
+    double getLastSpinTime() const { return m_lastSpinTime; }
+    /// @brief Frames that missed their deadline by more than a frame
+    size_t getNumMissedFrames() const { return m_numMissedFrames; }
+
+    void renderDebbugGUI();
+
+   private:
+    FramePacingMode m_mode;
+    double m_targetRate;
+    Clock::duration m_period;
+    Clock::duration m_minSpinMargin = std::chrono::microseconds(300);
+    // Average wake up latency of the sleeps, ns
+    double m_oversleep = 0;
+
+    Clock::time_point m_deadline;
+    Clock::time_point m_lastFrameEnd;
+    bool m_started = false;
+
+    // Frame times ring, ms
+    std::array<float, HistorySize> m_history = {};
+    size_t m_historyOffset = 0;
+    size_t m_historyCount = 0;
+
+    double m_lastFrameTime = 0;
+    double m_meanFrameTime = 0;
+    double m_jitter = 0;
+    double m_lastSleepTime = 0;
+    double m_lastSpinTime = 0;
+    size_t m_numMissedFrames = 0;
+
+    /// @brief Sleep then spin until the deadline
+    void waitUntil(Clock::time_point deadline);
+    void recordFrame(Clock::time_point frameEnd);
+};
+
+}  // namespace v3d
@@ -51,6 +51,27 @@ int main(int argc, char* argv[]) {
     v3d::rendering::GraphicsBackendType graphicsBackend =
         v3d::rendering::GraphicsBackendType::OPENGL_API;
 
+    // Offscreen rendering options, only used by the offscreen backend
+    v3d::rendering::OffscreenSettings offscreen;
+    uint64_t maxFrames = 0;
+    bool compressVertices = true;
+    bool optimizeMeshes = true;
+    bool generateLods = true;
+    bool renderThread = true;
+    uint32_t renderThreadFrames = 2;
+    bool physicsThread = false;
+    v3d::FramePacingMode framePacing = v3d::FramePacingMode::FIXED_RATE;
+    double targetFrameRate = 60;
+    bool headless = false;
+    double simTime = 0;
+    double headlessTimeStep = 1.0 / 60;
+    bool maxSpeed = false;
+    std::string statsFile = "headless_stats.json";
+    std::string physicsProfilePath;
+    std::string physicsProfileName;
+    std::string heightfieldPath;
+    std::string physicsTimingsFile;
+
     for (int i = 1; i < argc; i++) {
         // Parse logging options
         if (strcmp(argv[i], "--width") == 0 && i + 1 < argc) {
@@ -98,14 +119,121 @@ int main(int argc, char* argv[]) {
         } else if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc) {
             if (i + 1 < argc) {
                 if (strcmp(argv[i + 1], "vulkan") == 0) {
+                    graphicsBackend =
+                        v3d::rendering::GraphicsBackendType::VULKAN_API;
                     i++;
                 } else if (strcmp(argv[i + 1], "opengl") == 0) {
+                    graphicsBackend =
+                        v3d::rendering::GraphicsBackendType::OPENGL_API;
+                    i++;
+                } else if (strcmp(argv[i + 1], "offscreen") == 0) {
+                    graphicsBackend = v3d::rendering::GraphicsBackendType::
+                        OPENGL_OFFSCREEN_API;
+                    i++;
+                } else if (strcmp(argv[i + 1], "none") == 0) {
+                    graphicsBackend = v3d::rendering::GraphicsBackendType::NONE;
                     i++;
                 }
             }
+        } else if (strcmp(argv[i], "--offscreen-context") == 0 &&
+                   i + 1 < argc) {
+            if (strcmp(argv[i + 1], "egl") == 0) {
+                offscreen.contextApi = v3d::rendering::OffscreenContextAPI::EGL;
+                i++;
+            } else if (strcmp(argv[i + 1], "osmesa") == 0) {
+                offscreen.contextApi =
+                    v3d::rendering::OffscreenContextAPI::OSMESA;
+                i++;
+            }
+        } else if (strcmp(argv[i], "--dump-frames") == 0 && i + 1 < argc) {
+            if (strcmp(argv[i + 1], "png") == 0) {
+                offscreen.dumpFormat = v3d::rendering::FrameDumpFormat::PNG;
+                i++;
+            } else if (strcmp(argv[i + 1], "raw") == 0) {
+                offscreen.dumpFormat = v3d::rendering::FrameDumpFormat::RAW;
+                i++;
+            } else if (strcmp(argv[i + 1], "none") == 0) {
+                offscreen.dumpFormat = v3d::rendering::FrameDumpFormat::NONE;
+                i++;
+            }
+        } else if (strcmp(argv[i], "--dump-dir") == 0 && i + 1 < argc) {
+            offscreen.dumpDirectory = argv[++i];
+        } else if (strcmp(argv[i], "--dump-interval") == 0 && i + 1 < argc) {
+            offscreen.dumpInterval = std::stoul(argv[++i]);
+        } else if (strcmp(argv[i], "--stats-interval") == 0 && i + 1 < argc) {
+            offscreen.statsInterval = std::stoul(argv[++i]);
+        } else if (strcmp(argv[i], "--max-frames") == 0 && i + 1 < argc) {
+            maxFrames = std::stoull(argv[++i]);
+        } else if (strcmp(argv[i], "--no-vertex-compression") == 0) {
+            compressVertices = false;
+        } else if (strcmp(argv[i], "--no-mesh-optimization") == 0) {
+            optimizeMeshes = false;
+        } else if (strcmp(argv[i], "--no-lod") == 0) {
+            generateLods = false;
+        } else if (strcmp(argv[i], "--no-render-thread") == 0) {
+            renderThread = false;
+        } else if (strcmp(argv[i], "--render-thread-frames") == 0 &&
+                   i + 1 < argc) {
+            renderThreadFrames = std::stoul(argv[++i]);
+        } else if (strcmp(argv[i], "--physics-thread") == 0) {
+            physicsThread = true;
+        } else if (strcmp(argv[i], "--frame-pacing") == 0 && i + 1 < argc) {
+            if (strcmp(argv[i + 1], "unlimited") == 0) {
+                framePacing = v3d::FramePacingMode::UNLIMITED;
+                i++;
+            } else if (strcmp(argv[i + 1], "fixed") == 0) {
+                framePacing = v3d::FramePacingMode::FIXED_RATE;
+                i++;
+            } else if (strcmp(argv[i + 1], "vsync") == 0) {
+                framePacing = v3d::FramePacingMode::VSYNC;
+                i++;
+            }
+        } else if (strcmp(argv[i], "--target-fps") == 0 && i + 1 < argc) {
+            targetFrameRate = std::stod(argv[++i]);
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+        } else if (strcmp(argv[i], "--sim-time") == 0 && i + 1 < argc) {
+            simTime = std::stod(argv[++i]);
+        } else if (strcmp(argv[i], "--tick") == 0 && i + 1 < argc) {
+            headlessTimeStep = std::stod(argv[++i]);
+        } else if (strcmp(argv[i], "--max-speed") == 0) {
+            maxSpeed = true;
+        } else if (strcmp(argv[i], "--stats-file") == 0 && i + 1 < argc) {
+            statsFile = argv[++i];
+        } else if (strcmp(argv[i], "--physics-profile") == 0 && i + 1 < argc) {
+            physicsProfilePath = argv[++i];
+        } else if (strcmp(argv[i], "--physics-profile-name") == 0 &&
+                   i + 1 < argc) {
+            physicsProfileName = argv[++i];
+        } else if (strcmp(argv[i], "--terrain") == 0 && i + 1 < argc) {
+            heightfieldPath = argv[++i];
+        } else if (strcmp(argv[i], "--physics-timings") == 0 &&
+                   i + 1 < argc) {
+            physicsTimingsFile = argv[++i];
         }
     }
 
+    v3d::EngineConfig config;
+    config.width = width;
+    config.height = height;
+    config.graphicsBackend = graphicsBackend;
+    config.offscreen = offscreen;
+    config.maxFrames = maxFrames;
+    config.compressVertices = compressVertices;
+    config.optimizeMeshes = optimizeMeshes;
+    config.generateLods = generateLods;
+    config.renderThread = renderThread;
+    config.renderThreadFrames = renderThreadFrames;
+    config.physicsThread = physicsThread;
+    config.framePacing = framePacing;
+    config.targetFrameRate = targetFrameRate;
+    config.headless = headless;
+    config.simTime = simTime;
+    config.headlessTimeStep = headlessTimeStep;
+    config.maxSpeed = maxSpeed;
+    config.statsFile = statsFile;
+    config.physicsTimingsFile = physicsTimingsFile;
+
     // Initialize the logger
     // log to file and console
     static plog::RollingFileAppender<plog::TxtFormatter> fileAppender(
@@ -115,9 +243,28 @@ int main(int argc, char* argv[]) {
 
     PLOGN << LOG_START_MESSAGE;
 
+    if (!physicsProfilePath.empty()) {
+        try {
+            config.physicsProfile = v3d::PhysicsProfile::load(
+                physicsProfilePath, physicsProfileName);
+        } catch (const std::exception& e) {
+            PLOGE << "Exception: " << e.what();
+            return EXIT_FAILURE;
+        }
+    }
+    if (!heightfieldPath.empty()) {
+        try {
+            config.heightfield =
+                v3d::HeightfieldTerrain::loadSettings(heightfieldPath);
+        } catch (const std::exception& e) {
+            PLOGE << "Exception: " << e.what();
+            return EXIT_FAILURE;
+        }
+    }
+
     switch (demoIndex) {
         case 1:
-            demoSedanVehicle(width, height, graphicsBackend);
+            demoSedanVehicle(config);
             break;
         default:
             break;
@@ -0,0 +1,340 @@
+#include "multi_world_runner.h"
+
+#include <plog/Log.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+
+#include "scene.h"
+
+namespace v3d {
+
+namespace {
+const char* SeedParameter = "seed";
+
+void writeJsonString(std::ostream& out, const std::string& value) {
+    out << '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\')
+            out << '\\' << c;
+        else if (c == '\n')
+            out << "\\n";
+        else
+            out << c;
+    }
+    out << '"';
+}
+
+/// @brief JSON has no NaN nor infinity, they are written as null
+void writeJsonNumber(std::ostream& out, double value) {
+    if (std::isfinite(value))
+        out << value;
+    else
+        out << "null";
+}
+
+void writeJsonValues(std::ostream& out,
+                     const std::map<std::string, double>& values) {
+    out << '{';
+    bool first = true;
+    for (const auto& [name, value] : values) {
+        if (!first) out << ", ";
+        first = false;
+        writeJsonString(out, name);
+        out << ": ";
+        writeJsonNumber(out, value);
+    }
+    out << '}';
+}
+
+void writeJsonAggregated(std::ostream& out, const AggregatedResults& results,
+                         const char* indent) {
+    out << "{\n";
+    bool first = true;
+    for (const auto& [name, result] : results) {
+        if (!first) out << ",\n";
+        first = false;
+        out << indent << "  ";
+        writeJsonString(out, name);
+        out << ": {\"count\": " << result.count << ", \"mean\": ";
+        writeJsonNumber(out, result.mean);
+        out << ", \"std_dev\": ";
+        writeJsonNumber(out, result.stdDev);
+        out << ", \"min\": ";
+        writeJsonNumber(out, result.min);
+        out << ", \"max\": ";
+        writeJsonNumber(out, result.max);
+        out << "}";
+    }
+    out << "\n" << indent << "}";
+}
+
+AggregatedResults aggregateRuns(
+    const std::vector<const WorldRunResult*>& runs) {
+    // Sum and sum of squares per result, then reduced to the statistics
+    std::map<std::string, std::pair<double, double>> sums;
+    AggregatedResults aggregated;
+    for (const WorldRunResult* run : runs) {
+        if (!run->error.empty()) continue;
+        for (const auto& [name, value] : run->results) {
+            AggregatedResult& result = aggregated[name];
+            auto& [sum, sumSquares] = sums[name];
+            result.min =
+                result.count == 0 ? value : std::min(result.min, value);
+            result.max =
+                result.count == 0 ? value : std::max(result.max, value);
+            result.count++;
+            sum += value;
+            sumSquares += value * value;
+        }
+    }
+
+    for (auto& [name, result] : aggregated) {
+        const auto& [sum, sumSquares] = sums[name];
+        result.mean = sum / result.count;
+        const double variance =
+            sumSquares / result.count - result.mean * result.mean;
+        result.stdDev = std::sqrt(std::max(variance, 0.0));
+    }
+    return aggregated;
+}
+}  // namespace
+
+SimulationWorld::SimulationWorld(size_t index,
+                                 const WorldParameters& parameters)
+    : m_index(index), m_parameters(parameters) {
+    m_scene = Scene::create(nullptr, &m_physics);
+}
+
+ParameterSweep& ParameterSweep::add(const std::string& name,
+                                    std::vector<double> values) {
+    if (values.empty())
+        throw std::invalid_argument("Parameter sweep '" + name +
+                                    "' has no values");
+    if (name == SeedParameter)
+        throw std::invalid_argument(
+            "Parameter name 'seed' is reserved for the repetitions");
+
+    m_parameters.emplace_back(name, std::move(values));
+    return *this;
+}
+
+ParameterSweep& ParameterSweep::addRange(const std::string& name, double min,
+                                         double max, size_t count) {
+    std::vector<double> values(count);
+    for (size_t i = 0; i < count; i++)
+        values[i] = count > 1 ? min + (max - min) * i / (count - 1) : min;
+    return add(name, std::move(values));
+}
+
+ParameterSweep& ParameterSweep::setRepetitions(size_t repetitions) {
+    if (repetitions == 0)
+        throw std::invalid_argument("Parameter sweep needs a repetition");
+    m_repetitions = repetitions;
+    return *this;
+}
+
+std::vector<WorldParameters> ParameterSweep::combinations() const {
+    size_t numCombinations = 1;
+    for (const auto& [name, values] : m_parameters)
+        numCombinations *= values.size();
+
+    std::vector<WorldParameters> combinations;
+    combinations.reserve(numCombinations * m_repetitions);
+    for (size_t i = 0; i < numCombinations; i++) {
+        // Mixed radix decomposition of the combination index, the last
+        // parameter varies the fastest
+        WorldParameters parameters;
+        size_t remainder = i;
+        for (auto it = m_parameters.rbegin(); it != m_parameters.rend(); ++it) {
+            parameters[it->first] = it->second[remainder % it->second.size()];
+            remainder /= it->second.size();
+        }
+
+        for (size_t seed = 0; seed < m_repetitions; seed++) {
+            if (m_repetitions > 1)
+                parameters[SeedParameter] = static_cast<double>(seed);
+            combinations.push_back(parameters);
+        }
+    }
+    return combinations;
+}
+
+MultiWorldRunner::MultiWorldRunner(MultiWorldSettings settings)
+    : m_settings(settings) {
+    if (!(m_settings.tickTimeStep > 0))
+        throw std::invalid_argument("MultiWorldRunner tick must be positive");
+}
+
+std::vector<WorldRunResult> MultiWorldRunner::run(
+    const ParameterSweep& sweep) {
+    const std::vector<WorldParameters> combinations = sweep.combinations();
+    std::vector<WorldRunResult> runs(combinations.size());
+
+    size_t numThreads = m_settings.numThreads;
+    if (numThreads == 0)
+        numThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    numThreads = std::min(numThreads, combinations.size());
+
+    PLOGI << "Running " << combinations.size() << " worlds on " << numThreads
+          << " threads, " << m_settings.simTime << " s each\n";
+    const auto start = std::chrono::steady_clock::now();
+
+    // Workers take the next run until none is left
+    std::atomic<size_t> nextRun{0};
+    std::vector<std::thread> workers;
+    workers.reserve(numThreads);
+    for (size_t t = 0; t < numThreads; t++) {
+        workers.emplace_back([&] {
+            for (size_t i = nextRun++; i < combinations.size();
+                 i = nextRun++) {
+                runs[i] = runWorld(i, combinations[i]);
+            }
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+
+    const double wallTime = std::chrono::duration<double>(
+                                std::chrono::steady_clock::now() - start)
+                                .count();
+    double simTime = 0;
+    size_t numFailed = 0;
+    for (const WorldRunResult& run : runs) {
+        simTime += run.simTime;
+        if (!run.error.empty()) numFailed++;
+    }
+    PLOGI << "Worlds done in " << wallTime << " s, " << simTime
+          << " s simulated (" << (wallTime > 0 ? simTime / wallTime : 0)
+          << "x realtime), " << numFailed << " failed\n";
+    return runs;
+}
+
+WorldRunResult MultiWorldRunner::runWorld(size_t index,
+                                          const WorldParameters& parameters) {
+    WorldRunResult run;
+    run.index = index;
+    run.parameters = parameters;
+
+    const auto start = std::chrono::steady_clock::now();
+    try {
+        SimulationWorld world(index, parameters);
+        Physics* physics = world.getPhysics();
+        physics->setNumThreads(1);
+        physics->setParallelVehiclesEnabled(false);
+        physics->setInterpolationEnabled(false);
+        // Never drop simulated time, a tick must fit in the steps of a frame
+        const double dt = m_settings.tickTimeStep;
+        const int stepsPerTick =
+            static_cast<int>(std::ceil(dt / physics->getStepSize())) + 1;
+        if (physics->getMaxStepsPerFrame() < stepsPerTick)
+            physics->setMaxStepsPerFrame(stepsPerTick);
+
+        if (m_setup) m_setup(world);
+        world.getScene()->start();
+
+        while (run.simTime < m_settings.simTime) {
+            if (m_tick) m_tick(world, dt);
+            world.getScene()->update(dt);
+            run.physicsSteps += physics->advance(dt);
+            run.simTime += dt;
+        }
+
+        if (m_finish) m_finish(world);
+        run.results = world.getResults();
+    } catch (const std::exception& e) {
+        run.error = e.what();
+        PLOGE << "World " << index << " failed: " << e.what();
+    }
+    run.wallTime = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+    return run;
+}
+
+AggregatedResults MultiWorldRunner::aggregate(
+    const std::vector<WorldRunResult>& runs) {
+    std::vector<const WorldRunResult*> all;
+    all.reserve(runs.size());
+    for (const WorldRunResult& run : runs) all.push_back(&run);
+    return aggregateRuns(all);
+}
+
+std::vector<std::pair<WorldParameters, AggregatedResults>>
+MultiWorldRunner::aggregateByParameters(
+    const std::vector<WorldRunResult>& runs) {
+    // Groups in order of first appearance, the sweep order
+    std::vector<std::pair<WorldParameters, std::vector<const WorldRunResult*>>>
+        groups;
+    for (const WorldRunResult& run : runs) {
+        WorldParameters parameters = run.parameters;
+        parameters.erase(SeedParameter);
+        auto it = std::find_if(groups.begin(), groups.end(),
+                               [&parameters](const auto& group) {
+                                   return group.first == parameters;
+                               });
+        if (it == groups.end()) {
+            groups.emplace_back(std::move(parameters),
+                                std::vector<const WorldRunResult*>());
+            it = std::prev(groups.end());
+        }
+        it->second.push_back(&run);
+    }
+
+    std::vector<std::pair<WorldParameters, AggregatedResults>> aggregated;
+    aggregated.reserve(groups.size());
+    for (const auto& [parameters, groupRuns] : groups)
+        aggregated.emplace_back(parameters, aggregateRuns(groupRuns));
+    return aggregated;
+}
+
+void MultiWorldRunner::writeJson(const std::string& path,
+                                 const std::vector<WorldRunResult>& runs) {
+    std::ofstream file(path);
+    if (!file) {
+        PLOGE << "Failed to write the world results to " << path;
+        return;
+    }
+    file.precision(10);
+
+    file << "{\n  \"runs\": [\n";
+    for (size_t i = 0; i < runs.size(); i++) {
+        const WorldRunResult& run = runs[i];
+        file << "    {\"index\": " << run.index << ", \"parameters\": ";
+        writeJsonValues(file, run.parameters);
+        file << ", \"results\": ";
+        writeJsonValues(file, run.results);
+        file << ", \"sim_time\": ";
+        writeJsonNumber(file, run.simTime);
+        file << ", \"wall_time\": ";
+        writeJsonNumber(file, run.wallTime);
+        file << ", \"physics_steps\": " << run.physicsSteps;
+        if (!run.error.empty()) {
+            file << ", \"error\": ";
+            writeJsonString(file, run.error);
+        }
+        file << "}" << (i + 1 < runs.size() ? "," : "") << "\n";
+    }
+    file << "  ],\n  \"aggregate\": ";
+    writeJsonAggregated(file, aggregate(runs), "  ");
+
+    file << ",\n  \"aggregate_by_parameters\": [\n";
+    const auto groups = aggregateByParameters(runs);
+    for (size_t i = 0; i < groups.size(); i++) {
+        file << "    {\"parameters\": ";
+        writeJsonValues(file, groups[i].first);
+        file << ", \"results\": ";
+        writeJsonAggregated(file, groups[i].second, "    ");
+        file << "}" << (i + 1 < groups.size() ? "," : "") << "\n";
+    }
+    file << "  ]\n}\n";
+
+    PLOGI << "World results written to " << path << "\n";
+}
+
+}  // namespace v3d
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "physics/physics.h"
+
+namespace v3d {
+class Scene;
+
+/// @brief Parameter values of a run, by name
+using WorldParameters = std::map<std::string, double>;
+/// @brief Values recorded by a run, by name
+using WorldResults = std::map<std::string, double>;
+
+/**
+ * @brief Isolated simulation world, a Scene and the Physics system it runs
+ * on.
+ *
+ * Worlds have no Engine: no rendering, gizmos nor input. Components needing
+ * one (MeshRenderer, VehicleInteractiveController) must not be added.
+ */
+class SimulationWorld {
+   public:
+    SimulationWorld(size_t index, const WorldParameters& parameters);
+
+    SimulationWorld(const SimulationWorld&) = delete;
+    SimulationWorld& operator=(const SimulationWorld&) = delete;
+
+    /// @brief Index of the run in the sweep
+    size_t getIndex() const { return m_index; }
+    const WorldParameters& getParameters() const { return m_parameters; }
+    /// @brief Value of a swept parameter, throws std::out_of_range if the
+    /// sweep has no such parameter
+    double getParameter(const std::string& name) const {
+        return m_parameters.at(name);
+    }
+
+    Scene* getScene() { return m_scene.get(); }
+    Physics* getPhysics() { return &m_physics; }
+
+    void setResult(const std::string& name, double value) {
+        m_results[name] = value;
+    }
+    const WorldResults& getResults() const { return m_results; }
+
+   private:
+    size_t m_index;
+    WorldParameters m_parameters;
+    WorldResults m_results;
+    // Declared before the scene, the components remove their bodies from it
+    // when destroyed
+    Physics m_physics;
+    std::shared_ptr<Scene> m_scene;
+};
+
+/**
+ * @brief Cartesian product of parameter values. Every combination is run
+ * getRepetitions() times, each repetition has a "seed" parameter with its
+ * index (Monte Carlo runs).
+ */
+class ParameterSweep {
+   public:
+    /// @brief Sweep a parameter over the given values
+    ParameterSweep& add(const std::string& name, std::vector<double> values);
+    /// @brief Sweep a parameter over count evenly spaced values of
+    /// [min, max]
+    ParameterSweep& addRange(const std::string& name, double min, double max,
+                             size_t count);
+    ParameterSweep& setRepetitions(size_t repetitions);
+    size_t getRepetitions() const { return m_repetitions; }
+
+    /// @brief Parameters of every run
+    std::vector<WorldParameters> combinations() const;
+
+   private:
+    std::vector<std::pair<std::string, std::vector<double>>> m_parameters;
+    size_t m_repetitions = 1;
+};
+
+struct WorldRunResult {
+    size_t index = 0;
+    WorldParameters parameters;
+    WorldResults results;
+    double simTime = 0;   // s
+    double wallTime = 0;  // s
+    int physicsSteps = 0;
+    /// @brief Message of the exception that stopped the run, empty on
+    /// success
+    std::string error;
+};
+
+/// @brief Statistics of a result over the successful runs
+struct AggregatedResult {
+    size_t count = 0;
+    double mean = 0;
+    /// @brief Population standard deviation
+    double stdDev = 0;
+    double min = 0;
+    double max = 0;
+};
+using AggregatedResults = std::map<std::string, AggregatedResult>;
+
+struct MultiWorldSettings {
+    /// @brief Simulated seconds of each run
+    double simTime = 10;
+    /// @brief Logic tick, simulated seconds
+    double tickTimeStep = 1.0 / 60;
+    /// @brief Worker threads, 0 uses one per hardware thread
+    size_t numThreads = 0;
+};
+
+/**
+ * @brief Runs every combination of a ParameterSweep in its own
+ * SimulationWorld, on a pool of worker threads.
+ *
+ * A world is created, set up, simulated and destroyed by the worker running
+ * it, worlds share no simulation state. The parallelism is across worlds:
+ * Chrono runs single threaded in each world and the vehicles of a world are
+ * stepped serially.
+ *
+ * The callbacks are called concurrently from the workers, each call with
+ * its own world.
+ */
+class MultiWorldRunner {
+   public:
+    /// @brief Populate the world (entities, vehicles) from its parameters
+    using SetupFunction = std::function<void(SimulationWorld&)>;
+    /// @brief Called before each tick with the tick duration, drives the
+    /// world (inputs, controllers)
+    using TickFunction = std::function<void(SimulationWorld&, double)>;
+    /// @brief Record the results of the run with SimulationWorld::setResult
+    using FinishFunction = std::function<void(SimulationWorld&)>;
+
+    explicit MultiWorldRunner(MultiWorldSettings settings = {});
+
+    void setSetup(SetupFunction setup) { m_setup = std::move(setup); }
+    void setTick(TickFunction tick) { m_tick = std::move(tick); }
+    void setFinish(FinishFunction finish) { m_finish = std::move(finish); }
+
+    /// @brief Run the sweep, blocks until every world is done
+    /// @return One result per combination, in sweep order
+    std::vector<WorldRunResult> run(const ParameterSweep& sweep);
+
+    /// @brief Statistics of every result over all the runs
+    static AggregatedResults aggregate(const std::vector<WorldRunResult>& runs);
+    /// @brief Statistics of every result over the repetitions of each
+    /// parameter combination (runs differing only by "seed")
+    static std::vector<std::pair<WorldParameters, AggregatedResults>>
+    aggregateByParameters(const std::vector<WorldRunResult>& runs);
+
+    /// @brief Write the runs and their aggregated results as JSON
+    static void writeJson(const std::string& path,
+                          const std::vector<WorldRunResult>& runs);
+
+   private:
+    MultiWorldSettings m_settings;
+    SetupFunction m_setup;
+    TickFunction m_tick;
+    FinishFunction m_finish;
+
+    WorldRunResult runWorld(size_t index, const WorldParameters& parameters);
+};
+
+}  // namespace v3d
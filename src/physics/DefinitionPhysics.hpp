@@ -1,5 +1,7 @@
 #pragma once
 
+#include <deque>
+
 #include "chrono_vehicle/wheeled_vehicle/vehicle/WheeledVehicle.h"
 #include "object_ptr.hpp"
 
@@ -8,8 +10,10 @@ class Physics;
 class Vehicle;
 class ConstrainLink;
 
-using VehicleRaw_ptr = object_ptr<std::vector<chrono::vehicle::WheeledVehicle>,
-                                  chrono::vehicle::WheeledVehicle, size_t>;
+/// @brief Vehicles are never moved once created, a deque only appends
+using VehiclePool = std::deque<chrono::vehicle::WheeledVehicle>;
+using VehicleRaw_ptr =
+    object_ptr<VehiclePool, chrono::vehicle::WheeledVehicle, size_t>;
 
 struct VehicleInputs {
     // chrono::vehicle::WheeledVehicle* vehicle;
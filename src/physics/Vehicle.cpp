@@ -20,12 +20,8 @@ void Vehicle::init() {
     m_vehicleModelPathDirty = true;
     m_isLoaded = false;
 
-    // Set the rigidbody to this instance
-    auto rigidBody = m_scene->getComponentOfType<RigidBody>(m_entity);
-    assert(rigidBody != nullptr &&
-           "Failed to initialize Transform. Missing required component "
-           "Transform from the entity");
-    m_rigidBody = rigidBody;
+    // The chassis replaces the body of the entity once loaded
+    m_rigidBody = RigidBody::getOrCreate(m_scene, m_entity);
 }
 
 void Vehicle::start() {
@@ -61,7 +57,16 @@ void Vehicle::update(double deltaTime) {
     // // std::cout << vehicle->GetChassisBody()->GetRotAxis() << "\n";
 }
 
+void Vehicle::submitDriverInputs() {
+    // The physics thread, when running, reads its own copy of the inputs
+    if (m_isLoaded)
+        m_scene->getPhysics()->setDriverInputs(m_vehicleHandle.index(),
+                                               m_driverInputs);
+}
+
 void Vehicle::onDrawGizmos(rendering::GizmosManager* gizmos) {
+    // The wheels are read from Chrono, not from the pose snapshot
+    auto lock = m_scene->getPhysics()->lockSystem();
     auto vehicle = m_vehicleHandle->vehicle;
 
     // gizmos->draw_cube(physics::toV3d(vehicle->GetPos()), .25,
@@ -82,6 +87,7 @@ void Vehicle::onDrawGizmos(rendering::GizmosManager* gizmos) {
 }
 
 void Vehicle::drawEditorGUI_Properties() {
+    auto lock = m_scene->getPhysics()->lockSystem();
     auto vehicle = m_vehicleHandle->vehicle;
 
     ImGui::Text("Main");
@@ -128,6 +134,8 @@ void Vehicle::loadVehicleModelJSON() {
     // Load model
 
     Physics* physics = m_scene->getPhysics();
+    // Initialize adds the vehicle bodies to the system
+    auto lock = physics->lockSystem();
 
     // m_vehicle =
     // chrono_types::make_unique<chrono::vehicle::WheeledVehicle>(&physics->m_system,
@@ -146,6 +154,7 @@ void Vehicle::loadVehicleModelJSON() {
 
     m_vehicleModelPathDirty = false;
     m_isLoaded = true;
+    submitDriverInputs();
 }
 
 }  // namespace v3d
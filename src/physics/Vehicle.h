@@ -20,12 +20,16 @@ class Vehicle : public ComponentBase {
 
     RigidBody* m_rigidBody = nullptr;
     VehicleHandle m_vehicleHandle;
+    // Inputs set by the logic, handed to the physics system on change
+    chrono::vehicle::DriverInputs m_driverInputs{};
     bool m_parkingBrake;  // Apply parking brake
 
     chrono::ChVector3d m_initPos{0, .5, 0};
     chrono::ChQuaterniond m_initRot{1, 0, 0, 0};
 
     void loadVehicleModelJSON();
+    /// @brief Hand m_driverInputs to the physics system
+    void submitDriverInputs();
 
     // chrono::vehicle::WheeledVehicle* getVehicleRaw() { return
     // m_vehicle->vehicle; }; chrono::vehicle::DriverInputs*
@@ -66,35 +70,40 @@ class Vehicle : public ComponentBase {
         m_initRot = rotation;
     }
 
-    inline double getSteering() {
-        return m_vehicleHandle->driverInputs.m_steering;
-    }
-    inline double getThrottle() {
-        return m_vehicleHandle->driverInputs.m_throttle;
-    }
-    inline double getBraking() {
-        return m_vehicleHandle->driverInputs.m_braking;
-    }
-    inline double getClutch() { return m_vehicleHandle->driverInputs.m_clutch; }
+    inline double getSteering() { return m_driverInputs.m_steering; }
+    inline double getThrottle() { return m_driverInputs.m_throttle; }
+    inline double getBraking() { return m_driverInputs.m_braking; }
+    inline double getClutch() { return m_driverInputs.m_clutch; }
 
     inline void setSteering(double steering) {
-        m_vehicleHandle->driverInputs.m_steering = steering;
+        m_driverInputs.m_steering = steering;
+        submitDriverInputs();
     }
     inline void setThrottle(double throttle) {
-        m_vehicleHandle->driverInputs.m_throttle = throttle;
+        m_driverInputs.m_throttle = throttle;
+        submitDriverInputs();
     }
     inline void setBraking(double braking) {
-        m_vehicleHandle->driverInputs.m_braking = braking;
+        m_driverInputs.m_braking = braking;
+        submitDriverInputs();
     }
     inline void setClutch(double clutch) {
-        m_vehicleHandle->driverInputs.m_clutch = clutch;
+        m_driverInputs.m_clutch = clutch;
+        submitDriverInputs();
+    }
+
+    /// @brief Set all the inputs, handed to the physics system once
+    inline void setDriverInputs(const chrono::vehicle::DriverInputs& inputs) {
+        m_driverInputs = inputs;
+        submitDriverInputs();
     }
 
     void resetDriverInputs() {
-        m_vehicleHandle->driverInputs.m_steering = 0.0;
-        m_vehicleHandle->driverInputs.m_throttle = 0.0;
-        m_vehicleHandle->driverInputs.m_braking = 0.0;
-        m_vehicleHandle->driverInputs.m_clutch = 0.0;
+        m_driverInputs.m_steering = 0.0;
+        m_driverInputs.m_throttle = 0.0;
+        m_driverInputs.m_braking = 0.0;
+        m_driverInputs.m_clutch = 0.0;
+        submitDriverInputs();
     }
 
     inline void applyParking(bool parking) { m_parkingBrake = parking; }
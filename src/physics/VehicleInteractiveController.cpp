@@ -33,10 +33,13 @@ void VehicleInteractiveController::update(double deltaTime) {
     throtle = accelerate - back;
     steering = steerLeft - steerRight;
 
-    m_vehicle->setThrottle(throtle);
-    m_vehicle->setBraking(brake);
-    m_vehicle->setSteering(steering);
-    m_vehicle->setClutch(clutch);
+    // A single submission, queued once per frame to the physics thread
+    chrono::vehicle::DriverInputs inputs{};
+    inputs.m_throttle = throtle;
+    inputs.m_braking = brake;
+    inputs.m_steering = steering;
+    inputs.m_clutch = clutch;
+    m_vehicle->setDriverInputs(inputs);
 }
 
 void VehicleInteractiveController::drawEditorGUI_Properties() {
@@ -3,23 +3,76 @@
 
 #include "collider.h"
 #include "physics/physics.h"
+#include "transform.h"
 
 namespace v3d {
 void ColliderBase::init() {
-    // Set the rigidbody
-    auto rigidBody = m_scene->getComponentOfType<RigidBody>(m_entity);
-    assert(rigidBody != nullptr &&
-           "Failed to initialize Collider. Missing required component "
-           "RigidBody from the entity");
-    m_rigidBody = rigidBody;
-
     m_collisionMaterial = m_scene->getPhysics()->getDefaultCollisionMaterial();
 
     initColliderProperties();
 
+    // Merge the shape into the compound body of an ancestor, the entity
+    // keeps a kinematic transform following the body
+    if (RigidBody* compound = findCompoundBody()) {
+        auto transform = m_scene->getComponentOfType<Transform>(m_entity);
+        Transform* bodyTransform = transform->getParent();
+        while (bodyTransform->getRigidBody() != compound)
+            bodyTransform = bodyTransform->getParent();
+
+        const glm::quat bodyRot = bodyTransform->getRotation();
+        const glm::vec3 pos = glm::inverse(bodyRot) *
+                              (transform->getPos() - bodyTransform->getPos());
+        const glm::quat rot = glm::inverse(bodyRot) * transform->getRotation();
+        m_rigidBody = compound;
+        m_compoundPart = true;
+        m_rigidBody->addCompoundCollider(
+            *this, chrono::ChFramed(chrono::ChVector3d(pos.x, pos.y, pos.z),
+                                    chrono::ChQuaterniond(rot.w, rot.x, rot.y,
+                                                          rot.z)));
+        return;
+    }
+
+    // Otherwise the collider makes the entity take part in the physics
+    m_rigidBody = RigidBody::getOrCreate(m_scene, m_entity);
     m_rigidBody->addCollider(*this);
 }
 
+void ColliderBase::setMass(double mass) {
+    m_mass = mass;
+    // Only the compound parts contribute their mass to the body
+    if (m_rigidBody != nullptr && m_compoundPart)
+        m_rigidBody->updateMassProperties();
+}
+
+void ColliderBase::onShapeChanged() {
+    if (m_rigidBody == nullptr) return;
+    m_rigidBody->rebuildCollisionShapes();
+    // The inertia of a part depends on its shape
+    if (m_compoundPart) m_rigidBody->updateMassProperties();
+}
+
+RigidBody* ColliderBase::findCompoundBody() {
+    auto transform = m_scene->getComponentOfType<Transform>(m_entity);
+    if (transform == nullptr || transform->hasRigidBody()) return nullptr;
+
+    for (Transform* parent = transform->getParent(); parent != nullptr;
+         parent = parent->getParent()) {
+        if (parent->hasRigidBody()) {
+            RigidBody* body = parent->getRigidBody();
+            return body->isCompound() ? body : nullptr;
+        }
+    }
+    return nullptr;
+}
+
+void ColliderBox::setSize(const glm::vec3& lengths) {
+    m_lengths = lengths;
+    if (m_collisionShape == nullptr) return;  // Created by init
+    m_collisionShape = chrono_types::make_shared<chrono::ChCollisionShapeBox>(
+        m_collisionMaterial, lengths.x, lengths.y, lengths.z);
+    onShapeChanged();
+}
+
 void ColliderBox::onDrawGizmos(rendering::GizmosManager* gizmos) {
     // auto hlenghts = m_collisionShape->GetHalflengths();
 
@@ -28,6 +28,12 @@ class ColliderBase : public ComponentBase {
     void start() override {};
     void update(double deltaTime) override {};
 
+    /// @brief Mass of the shape, aggregated into the body when the collider
+    /// is merged into a compound body (see RigidBody::setCompound). Can be
+    /// changed after init, the body is updated.
+    void setMass(double mass);
+    double getMass() const { return m_mass; }
+
     // //TODO: fuction to edit shape
     // template <typename T, typename... Args>
     // void recreateShape_TODO_CAMBIAR_NOMBRE(Args&&... args);
@@ -37,40 +43,59 @@ class ColliderBase : public ComponentBase {
     RigidBody* m_rigidBody = nullptr;
     std::shared_ptr<chrono::ChContactMaterialSMC> m_collisionMaterial;
     // std::shared_ptr<T> m_collisionShape;
+    double m_mass = 0;
+    // Merged into the compound body of an ancestor
+    bool m_compoundPart = false;
+
+    /// @brief Give the body the current shape after init
+    void onShapeChanged();
 
     virtual std::shared_ptr<chrono::ChCollisionShape> getRawShape() = 0;
+    /// @brief Inertia of the shape about its center for m_mass
+    virtual chrono::ChMatrix33d getLocalInertia() const {
+        return chrono::ChMatrix33d::Zero();
+    }
 
     virtual void initColliderProperties() = 0;
+
+   private:
+    /// @brief Nearest ancestor body when it is compound and this entity has
+    /// no body of its own
+    RigidBody* findCompoundBody();
 };
 
 class ColliderBox : public ColliderBase {
    public:
     std::string getComponentName() override { return "Box Collider"; };
 
-    void setSize(float x, float y, float z) {
-        m_collisionShape.reset();
-        m_collisionShape =
-            chrono_types::make_shared<chrono::ChCollisionShapeBox>(
-                m_collisionMaterial, x, y, z);
-    }
-    void setSize(glm::vec3& lengths) {
-        m_collisionShape.reset();
-        m_collisionShape =
-            chrono_types::make_shared<chrono::ChCollisionShapeBox>(
-                m_collisionMaterial, lengths.x, lengths.y, lengths.z);
-    }
+    /// @brief Side lengths of the box, replaces the shape on the body when
+    /// called after init
+    void setSize(float x, float y, float z) { setSize(glm::vec3(x, y, z)); }
+    void setSize(const glm::vec3& lengths);
 
    protected:
     std::shared_ptr<chrono::ChCollisionShapeBox> m_collisionShape;
+    glm::vec3 m_lengths = glm::vec3(0.1, 0.2, 0.3);
 
     std::shared_ptr<chrono::ChCollisionShape> getRawShape() override {
         return m_collisionShape;
     }
 
+    chrono::ChMatrix33d getLocalInertia() const override {
+        const double x2 = m_lengths.x * m_lengths.x;
+        const double y2 = m_lengths.y * m_lengths.y;
+        const double z2 = m_lengths.z * m_lengths.z;
+        chrono::ChMatrix33d inertia = chrono::ChMatrix33d::Zero();
+        inertia(0, 0) = m_mass / 12 * (y2 + z2);
+        inertia(1, 1) = m_mass / 12 * (x2 + z2);
+        inertia(2, 2) = m_mass / 12 * (x2 + y2);
+        return inertia;
+    }
+
     void initColliderProperties() override {
         m_collisionShape =
             chrono_types::make_shared<chrono::ChCollisionShapeBox>(
-                m_collisionMaterial, 0.1, 0.2, 0.3);
+                m_collisionMaterial, m_lengths.x, m_lengths.y, m_lengths.z);
     };
 
     void onDrawGizmos(rendering::GizmosManager* gizmos);
@@ -0,0 +1,167 @@
+#include "physics/heightfield_terrain.h"
+
+#include <plog/Log.h>
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "chrono_thirdparty/rapidjson/document.h"
+#include "chrono_vehicle/ChWorldFrame.h"
+
+namespace v3d {
+
+namespace {
+using chrono::vehicle::ChWorldFrame;
+
+double readNumber(const rapidjson::Value& json, const char* key,
+                  const std::string& path) {
+    if (!json[key].IsNumber())
+        throw std::runtime_error("Heightfield " + path + ": '" + key +
+                                 "' must be a number");
+    return json[key].GetDouble();
+}
+
+void readPair(const rapidjson::Value& json, const char* key,
+              const std::string& path, double& x, double& y) {
+    const rapidjson::Value& value = json[key];
+    if (!value.IsArray() || value.Size() != 2 || !value[0].IsNumber() ||
+        !value[1].IsNumber())
+        throw std::runtime_error("Heightfield " + path + ": '" + key +
+                                 "' must be an array of 2 numbers");
+    x = value[0].GetDouble();
+    y = value[1].GetDouble();
+}
+}  // namespace
+
+HeightfieldTerrain::HeightfieldTerrain(const HeightfieldSettings& settings)
+    : m_tiles(settings) {
+    PLOGI << "Heightfield terrain: " << settings.numTilesX << "x"
+          << settings.numTilesY << " tiles of " << settings.tileSize << " m, "
+          << settings.tileSamples << " samples a side\n";
+}
+
+HeightfieldTerrain::HeightfieldTerrain(const std::string& descriptionPath)
+    : HeightfieldTerrain(loadSettings(descriptionPath)) {}
+
+HeightfieldSettings HeightfieldTerrain::loadSettings(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) throw std::runtime_error("Failed to open heightfield " + path);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+
+    rapidjson::Document json;
+    json.Parse(buffer.str().c_str());
+    if (json.HasParseError() || !json.IsObject())
+        throw std::runtime_error("Invalid JSON in heightfield " + path);
+
+    HeightfieldSettings settings;
+    if (json.HasMember("tile_size"))
+        settings.tileSize = readNumber(json, "tile_size", path);
+    if (json.HasMember("tile_samples")) {
+        const rapidjson::Value& samples = json["tile_samples"];
+        if (!samples.IsUint() || samples.GetUint() < 2)
+            throw std::runtime_error("Heightfield " + path +
+                                     ": 'tile_samples' must be 2 or more");
+        settings.tileSamples = samples.GetUint();
+    }
+    if (json.HasMember("tiles")) {
+        double x, y;
+        readPair(json, "tiles", path, x, y);
+        if (x < 1 || y < 1)
+            throw std::runtime_error("Heightfield " + path +
+                                     ": 'tiles' must be positive");
+        settings.numTilesX = static_cast<uint32_t>(x);
+        settings.numTilesY = static_cast<uint32_t>(y);
+    }
+    if (json.HasMember("origin"))
+        readPair(json, "origin", path, settings.originX, settings.originY);
+    if (json.HasMember("height_offset"))
+        settings.heightOffset = readNumber(json, "height_offset", path);
+    if (json.HasMember("default_friction"))
+        settings.defaultFriction =
+            static_cast<float>(readNumber(json, "default_friction", path));
+    if (json.HasMember("load_radius"))
+        settings.loadRadius = readNumber(json, "load_radius", path);
+    if (json.HasMember("unload_radius"))
+        settings.unloadRadius = readNumber(json, "unload_radius", path);
+
+    std::string tilePath = settings.tilePath;
+    if (json.HasMember("tile_path")) {
+        if (!json["tile_path"].IsString())
+            throw std::runtime_error("Heightfield " + path +
+                                     ": 'tile_path' must be a string");
+        tilePath = json["tile_path"].GetString();
+    }
+    // Relative to the description
+    const std::filesystem::path directory =
+        std::filesystem::path(path).parent_path();
+    settings.tilePath = (directory / tilePath).string();
+    return settings;
+}
+
+void HeightfieldTerrain::setFocusPoints(
+    const std::vector<chrono::ChVector3d>& points) {
+    if (points.size() != m_focusPoints.size()) m_focusChanged = true;
+    m_focusPoints.resize(points.size());
+    m_streamedPoints.resize(points.size());
+    m_streamedTiles.resize(points.size(), glm::ivec2(-1));
+
+    const HeightfieldSettings& settings = m_tiles.getSettings();
+    auto tileOf = [&](const glm::dvec2& point) {
+        return glm::ivec2(
+            static_cast<int>(
+                std::floor((point.x - settings.originX) / settings.tileSize)),
+            static_cast<int>(
+                std::floor((point.y - settings.originY) / settings.tileSize)));
+    };
+    // The hysteresis of the radii keeps the tiles a point needs mapped while
+    // it moves, half of it leaves margin for the point to keep moving
+    const double restreamDistance =
+        0.5 * (settings.unloadRadius - settings.loadRadius);
+    for (size_t i = 0; i < points.size(); i++) {
+        const chrono::ChVector3d iso = ChWorldFrame::ToISO(points[i]);
+        m_focusPoints[i] = glm::dvec2(iso.x(), iso.y());
+        if (tileOf(m_focusPoints[i]) != m_streamedTiles[i] ||
+            glm::distance(m_focusPoints[i], m_streamedPoints[i]) >
+                restreamDistance)
+            m_focusChanged = true;
+    }
+    if (!m_focusChanged) return;
+
+    // Streamed from these positions on the next Synchronize
+    for (size_t i = 0; i < points.size(); i++) {
+        m_streamedPoints[i] = m_focusPoints[i];
+        m_streamedTiles[i] = tileOf(m_focusPoints[i]);
+    }
+}
+
+void HeightfieldTerrain::Synchronize(double time) {
+    // Runs before the vehicles query the terrain, never concurrently
+    if (!m_focusChanged) return;
+    m_tiles.stream(m_focusPoints);
+    m_focusChanged = false;
+}
+
+double HeightfieldTerrain::GetHeight(const chrono::ChVector3d& loc) const {
+    const chrono::ChVector3d iso = ChWorldFrame::ToISO(loc);
+    return m_tiles.getHeight(iso.x(), iso.y());
+}
+
+chrono::ChVector3d HeightfieldTerrain::GetNormal(
+    const chrono::ChVector3d& loc) const {
+    const chrono::ChVector3d iso = ChWorldFrame::ToISO(loc);
+    const glm::vec3 normal = m_tiles.getNormal(iso.x(), iso.y());
+    return ChWorldFrame::FromISO(
+        chrono::ChVector3d(normal.x, normal.y, normal.z));
+}
+
+float HeightfieldTerrain::GetCoefficientFriction(
+    const chrono::ChVector3d& loc) const {
+    const chrono::ChVector3d iso = ChWorldFrame::ToISO(loc);
+    return m_tiles.getFriction(iso.x(), iso.y());
+}
+
+}  // namespace v3d
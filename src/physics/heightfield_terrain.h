@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "chrono/core/ChVector3.h"
+#include "chrono_vehicle/ChTerrain.h"
+#include "glm/glm.hpp"
+#include "physics/heightfield_tiles.h"
+
+namespace v3d {
+
+/**
+ * @brief Vehicle terrain sampled from a tiled heightfield, for terrains too
+ * large to keep in memory.
+ *
+ * Tiles are memory-mapped around the focus points (the vehicles, set by
+ * Physics before each step) and unmapped once far from all of them. The tire
+ * models query the height, normal and friction at their contact points,
+ * there is no collision shape for the other bodies.
+ *
+ * Described by a JSON file, tile paths are relative to it:
+ * @code
+ * {
+ *     "tile_size": 64,
+ *     "tile_samples": 129,
+ *     "tiles": [64, 64],
+ *     "origin": [-2048, -2048],
+ *     "height_offset": 0,
+ *     "tile_path": "tiles/tile_{x}_{y}.v3ht",
+ *     "default_friction": 0.8,
+ *     "load_radius": 150,
+ *     "unload_radius": 250
+ * }
+ * @endcode
+ */
+class HeightfieldTerrain : public chrono::vehicle::ChTerrain {
+   public:
+    explicit HeightfieldTerrain(const HeightfieldSettings& settings);
+    /// @brief Terrain of a JSON description, throws std::runtime_error if
+    /// the file can't be read or a value is invalid
+    explicit HeightfieldTerrain(const std::string& descriptionPath);
+
+    static HeightfieldSettings loadSettings(const std::string& path);
+
+    /// @brief World positions the tiles are streamed around on the next
+    /// Synchronize
+    void setFocusPoints(const std::vector<chrono::ChVector3d>& points);
+
+    void Synchronize(double time) override;
+    double GetHeight(const chrono::ChVector3d& loc) const override;
+    chrono::ChVector3d GetNormal(const chrono::ChVector3d& loc) const override;
+    float GetCoefficientFriction(const chrono::ChVector3d& loc) const override;
+
+    const HeightfieldTiles& getTiles() const { return m_tiles; }
+
+   private:
+    HeightfieldTiles m_tiles;
+    std::vector<glm::dvec2> m_focusPoints;
+    // Focus points and their tiles (from the origin) when last streamed,
+    // streaming again once one of them changes tile or moves farther than
+    // half the gap between the load and unload radii
+    std::vector<glm::dvec2> m_streamedPoints;
+    std::vector<glm::ivec2> m_streamedTiles;
+    bool m_focusChanged = false;
+};
+
+}  // namespace v3d
@@ -0,0 +1,349 @@
+#include "physics/heightfield_tiles.h"
+
+#include <plog/Log.h>
+
+#include <algorithm>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define V3D_HEIGHTFIELD_SSE
+#include <emmintrin.h>
+#endif
+
+namespace v3d {
+
+namespace {
+const char TileMagic[4] = {'V', '3', 'H', 'T'};
+const uint32_t TileVersion = 1;
+
+struct TileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t samples;
+    uint32_t frictionSamples;
+};
+static_assert(sizeof(TileHeader) == 16, "Tile header must be 16 bytes");
+
+void replaceAll(std::string& text, const std::string& from,
+                const std::string& to) {
+    for (size_t pos = text.find(from); pos != std::string::npos;
+         pos = text.find(from, pos + to.size()))
+        text.replace(pos, from.size(), to);
+}
+}  // namespace
+
+struct HeightfieldTiles::Tile {
+    boost::interprocess::file_mapping file;
+    boost::interprocess::mapped_region region;
+    // Null for a hole
+    const float* heights = nullptr;
+    const float* friction = nullptr;
+    uint32_t frictionSamples = 0;
+};
+
+HeightfieldTiles::HeightfieldTiles(HeightfieldSettings settings)
+    : m_settings(std::move(settings)) {
+    if (m_settings.tileSamples < 2)
+        throw std::invalid_argument("Heightfield tiles need 2 samples a side");
+    if (m_settings.numTilesX == 0 || m_settings.numTilesY == 0)
+        throw std::invalid_argument("Heightfield has no tiles");
+    if (!(m_settings.tileSize > 0))
+        throw std::invalid_argument("Heightfield tile size must be positive");
+    m_settings.unloadRadius =
+        std::max(m_settings.unloadRadius, m_settings.loadRadius);
+
+    m_cellsPerTile = m_settings.tileSamples - 1;
+    m_invCellSize = m_cellsPerTile / m_settings.tileSize;
+
+    const size_t numTiles =
+        size_t(m_settings.numTilesX) * m_settings.numTilesY;
+    m_tiles.resize(numTiles);
+    m_mapped = std::make_unique<std::atomic<const Tile*>[]>(numTiles);
+    for (size_t i = 0; i < numTiles; i++) m_mapped[i] = nullptr;
+}
+
+HeightfieldTiles::~HeightfieldTiles() = default;
+
+std::string HeightfieldTiles::getTilePath(uint32_t x, uint32_t y) const {
+    std::string path = m_settings.tilePath;
+    replaceAll(path, "{x}", std::to_string(x));
+    replaceAll(path, "{y}", std::to_string(y));
+    return path;
+}
+
+void HeightfieldTiles::stream(const std::vector<glm::dvec2>& points) {
+    const double tileSize = m_settings.tileSize;
+    // Distance from a point to the rectangle of a tile
+    auto distance = [&](size_t index, const glm::dvec2& point) {
+        const double minX =
+            m_settings.originX + (index % m_settings.numTilesX) * tileSize;
+        const double minY =
+            m_settings.originY + (index / m_settings.numTilesX) * tileSize;
+        const double dx =
+            std::max({minX - point.x, 0.0, point.x - (minX + tileSize)});
+        const double dy =
+            std::max({minY - point.y, 0.0, point.y - (minY + tileSize)});
+        return std::sqrt(dx * dx + dy * dy);
+    };
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Unmap the tiles out of reach of every point, the hysteresis between
+    // the two radii keeps a tile from being mapped again right away
+    auto far = [&](size_t index) {
+        for (const glm::dvec2& point : points)
+            if (distance(index, point) <= m_settings.unloadRadius)
+                return false;
+        return true;
+    };
+    auto end = std::remove_if(
+        m_mappedIndices.begin(), m_mappedIndices.end(), [&](size_t index) {
+            if (!far(index)) return false;
+            m_mapped[index] = nullptr;
+            m_tiles[index].reset();
+            return true;
+        });
+    m_mappedIndices.erase(end, m_mappedIndices.end());
+
+    const double radius = m_settings.loadRadius;
+    const int maxX = static_cast<int>(m_settings.numTilesX) - 1;
+    const int maxY = static_cast<int>(m_settings.numTilesY) - 1;
+    for (const glm::dvec2& point : points) {
+        const int x0 = std::max(
+            static_cast<int>(std::floor(
+                (point.x - radius - m_settings.originX) / tileSize)),
+            0);
+        const int x1 = std::min(
+            static_cast<int>(std::floor(
+                (point.x + radius - m_settings.originX) / tileSize)),
+            maxX);
+        const int y0 = std::max(
+            static_cast<int>(std::floor(
+                (point.y - radius - m_settings.originY) / tileSize)),
+            0);
+        const int y1 = std::min(
+            static_cast<int>(std::floor(
+                (point.y + radius - m_settings.originY) / tileSize)),
+            maxY);
+
+        for (int y = y0; y <= y1; y++) {
+            for (int x = x0; x <= x1; x++) {
+                const size_t index = size_t(y) * m_settings.numTilesX + x;
+                if (m_tiles[index] == nullptr &&
+                    distance(index, point) <= radius)
+                    mapTile(index);
+            }
+        }
+    }
+}
+
+const HeightfieldTiles::Tile* HeightfieldTiles::mapTile(size_t index) const {
+    // Called with m_mutex held
+    if (m_tiles[index] != nullptr) return m_tiles[index].get();
+
+    const uint32_t x = static_cast<uint32_t>(index % m_settings.numTilesX);
+    const uint32_t y = static_cast<uint32_t>(index / m_settings.numTilesX);
+    const std::string path = getTilePath(x, y);
+
+    auto tile = std::make_unique<Tile>();
+    std::ifstream exists(path, std::ios::binary);
+    if (exists) {
+        exists.close();
+        try {
+            namespace bip = boost::interprocess;
+            tile->file = bip::file_mapping(path.c_str(), bip::read_only);
+            tile->region = bip::mapped_region(tile->file, bip::read_only);
+
+            const size_t size = tile->region.get_size();
+            const auto* data =
+                static_cast<const char*>(tile->region.get_address());
+            TileHeader header;
+            if (size < sizeof(header))
+                throw std::runtime_error("truncated header");
+            std::memcpy(&header, data, sizeof(header));
+            if (std::memcmp(header.magic, TileMagic, 4) != 0 ||
+                header.version != TileVersion)
+                throw std::runtime_error("not a version 1 tile");
+            if (header.samples != m_settings.tileSamples)
+                throw std::runtime_error("tile samples don't match");
+
+            const size_t numHeights = size_t(header.samples) * header.samples;
+            const size_t numFriction =
+                size_t(header.frictionSamples) * header.frictionSamples;
+            if (size < sizeof(header) + (numHeights + numFriction) * 4)
+                throw std::runtime_error("truncated data");
+
+            // The region is page aligned, the floats after the header are
+            // aligned too
+            tile->heights =
+                reinterpret_cast<const float*>(data + sizeof(header));
+            tile->frictionSamples = header.frictionSamples;
+            if (numFriction > 0) tile->friction = tile->heights + numHeights;
+        } catch (const std::exception& e) {
+            // A broken tile is a hole, the queries can't throw from the
+            // vehicle step
+            PLOGE << "Failed to map heightfield tile " << path << ": "
+                  << e.what();
+            tile = std::make_unique<Tile>();
+        }
+    }
+
+    const Tile* mapped = tile.get();
+    m_tiles[index] = std::move(tile);
+    m_mappedIndices.push_back(index);
+    m_mapped[index].store(mapped, std::memory_order_release);
+    return mapped;
+}
+
+const HeightfieldTiles::Tile* HeightfieldTiles::locate(double x, double y,
+                                                       uint32_t& cellX,
+                                                       uint32_t& cellY,
+                                                       float& fracX,
+                                                       float& fracY) const {
+    // Clamped to the edges of the heightfield
+    const double maxU = double(m_settings.numTilesX) * m_cellsPerTile;
+    const double maxV = double(m_settings.numTilesY) * m_cellsPerTile;
+    const double u =
+        std::clamp((x - m_settings.originX) * m_invCellSize, 0.0, maxU);
+    const double v =
+        std::clamp((y - m_settings.originY) * m_invCellSize, 0.0, maxV);
+    const uint32_t cu = std::min(static_cast<uint32_t>(u),
+                                 static_cast<uint32_t>(maxU) - 1);
+    const uint32_t cv = std::min(static_cast<uint32_t>(v),
+                                 static_cast<uint32_t>(maxV) - 1);
+    fracX = static_cast<float>(u - cu);
+    fracY = static_cast<float>(v - cv);
+    cellX = cu % m_cellsPerTile;
+    cellY = cv % m_cellsPerTile;
+
+    const size_t index = size_t(cv / m_cellsPerTile) * m_settings.numTilesX +
+                         cu / m_cellsPerTile;
+    const Tile* tile = m_mapped[index].load(std::memory_order_acquire);
+    if (tile != nullptr) return tile;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_numMisses++;
+    return mapTile(index);
+}
+
+void HeightfieldTiles::getHeightAndSlope(double x, double y, float& height,
+                                         float& slopeX, float& slopeY) const {
+    uint32_t cellX, cellY;
+    float fx, fy;
+    const Tile* tile = locate(x, y, cellX, cellY, fx, fy);
+    if (tile->heights == nullptr) {
+        height = static_cast<float>(m_settings.heightOffset);
+        slopeX = slopeY = 0;
+        return;
+    }
+
+    const uint32_t samples = m_settings.tileSamples;
+    const float* h = tile->heights + size_t(cellY) * samples + cellX;
+    const float invCell = static_cast<float>(m_invCellSize);
+    const float gx = 1 - fx, gy = 1 - fy;
+
+#ifdef V3D_HEIGHTFIELD_SSE
+    // corners (h00, h10, h01, h11), differences along x then along y
+    // (h10 - h00, h11 - h01, h01 - h00, h11 - h10)
+    const __m128 corners = _mm_setr_ps(h[0], h[1], h[samples], h[samples + 1]);
+    const __m128 diffs =
+        _mm_sub_ps(_mm_shuffle_ps(corners, corners, _MM_SHUFFLE(3, 2, 3, 1)),
+                   _mm_shuffle_ps(corners, corners, _MM_SHUFFLE(1, 0, 2, 0)));
+    const __m128 heightTerms = _mm_mul_ps(
+        corners, _mm_mul_ps(_mm_setr_ps(gx, fx, gx, fx),
+                            _mm_setr_ps(gy, gy, fy, fy)));
+    const __m128 slopeTerms = _mm_mul_ps(
+        diffs, _mm_mul_ps(_mm_setr_ps(gy, fy, gx, fx), _mm_set1_ps(invCell)));
+    // Pairwise sums (h0 + h1, h2 + h3, sx0 + sx1, sy0 + sy1)
+    const __m128 sums = _mm_add_ps(
+        _mm_shuffle_ps(heightTerms, slopeTerms, _MM_SHUFFLE(2, 0, 2, 0)),
+        _mm_shuffle_ps(heightTerms, slopeTerms, _MM_SHUFFLE(3, 1, 3, 1)));
+    alignas(16) float result[4];
+    _mm_store_ps(result, sums);
+    height = result[0] + result[1];
+    slopeX = result[2];
+    slopeY = result[3];
+#else
+    const float h00 = h[0], h10 = h[1];
+    const float h01 = h[samples], h11 = h[samples + 1];
+    height = gy * (gx * h00 + fx * h10) + fy * (gx * h01 + fx * h11);
+    slopeX = (gy * (h10 - h00) + fy * (h11 - h01)) * invCell;
+    slopeY = (gx * (h01 - h00) + fx * (h11 - h10)) * invCell;
+#endif
+    height += static_cast<float>(m_settings.heightOffset);
+}
+
+float HeightfieldTiles::getHeight(double x, double y) const {
+    float height, slopeX, slopeY;
+    getHeightAndSlope(x, y, height, slopeX, slopeY);
+    return height;
+}
+
+glm::vec3 HeightfieldTiles::getNormal(double x, double y) const {
+    float height, slopeX, slopeY;
+    getHeightAndSlope(x, y, height, slopeX, slopeY);
+    return glm::normalize(glm::vec3(-slopeX, -slopeY, 1));
+}
+
+float HeightfieldTiles::getFriction(double x, double y) const {
+    uint32_t cellX, cellY;
+    float fx, fy;
+    const Tile* tile = locate(x, y, cellX, cellY, fx, fy);
+    if (tile->friction == nullptr) return m_settings.defaultFriction;
+
+    // Nearest friction sample to the position in the tile
+    const uint32_t samples = tile->frictionSamples;
+    const float scale = static_cast<float>(samples) / m_cellsPerTile;
+    const uint32_t i =
+        std::min(static_cast<uint32_t>((cellX + fx) * scale), samples - 1);
+    const uint32_t j =
+        std::min(static_cast<uint32_t>((cellY + fy) * scale), samples - 1);
+    return tile->friction[size_t(j) * samples + i];
+}
+
+size_t HeightfieldTiles::getNumMappedTiles() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mappedIndices.size();
+}
+
+size_t HeightfieldTiles::getMappedBytes() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t bytes = 0;
+    for (size_t index : m_mappedIndices)
+        bytes += m_tiles[index]->region.get_size();
+    return bytes;
+}
+
+void HeightfieldTiles::writeTile(const std::string& path, uint32_t samples,
+                                 const std::vector<float>& heights,
+                                 uint32_t frictionSamples,
+                                 const std::vector<float>& friction) {
+    if (heights.size() != size_t(samples) * samples ||
+        friction.size() != size_t(frictionSamples) * frictionSamples)
+        throw std::invalid_argument("Heightfield tile data size mismatch");
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("Failed to write heightfield tile " + path);
+
+    TileHeader header;
+    std::memcpy(header.magic, TileMagic, 4);
+    header.version = TileVersion;
+    header.samples = samples;
+    header.frictionSamples = frictionSamples;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(heights.data()),
+               heights.size() * sizeof(float));
+    file.write(reinterpret_cast<const char*>(friction.data()),
+               friction.size() * sizeof(float));
+    if (!file)
+        throw std::runtime_error("Failed to write heightfield tile " + path);
+}
+
+}  // namespace v3d
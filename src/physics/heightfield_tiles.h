@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+namespace v3d {
+
+/// @brief Layout of a tiled heightfield. Positions are horizontal ISO
+/// coordinates (x forward, y left), heights are along ISO z (up).
+struct HeightfieldSettings {
+    /// @brief Side of a tile, m
+    double tileSize = 64;
+    /// @brief Height samples per tile side, the edge samples are repeated in
+    /// the neighbour tile so a cell never spans two tiles
+    uint32_t tileSamples = 129;
+    uint32_t numTilesX = 1;
+    uint32_t numTilesY = 1;
+    /// @brief Min corner of tile (0, 0), m
+    double originX = 0;
+    double originY = 0;
+    /// @brief Added to the sampled heights, m
+    double heightOffset = 0;
+    /// @brief Path of a tile, {x} and {y} are replaced by its indices
+    std::string tilePath = "tile_{x}_{y}.v3ht";
+    /// @brief Friction of the tiles without friction map and of the holes
+    float defaultFriction = 0.8f;
+    /// @brief Tiles closer than loadRadius to a focus point are mapped,
+    /// tiles farther than unloadRadius from all of them are unmapped, m
+    double loadRadius = 150;
+    double unloadRadius = 250;
+};
+
+/**
+ * @brief Height tiles of a HeightfieldSettings, memory-mapped on demand.
+ *
+ * A tile file holds a 16 byte header ("V3HT", version, tile samples,
+ * friction samples, little endian uint32) followed by the heights
+ * (float32, row major, y rows of x samples) and the friction map (float32,
+ * frictionSamples per side, nearest sample, 0 samples uses the default
+ * friction). A missing tile is a hole at heightOffset.
+ *
+ * Queries are thread safe and lock free on mapped tiles, a query on an
+ * unmapped tile maps it under a mutex. stream() unmaps tiles and must not
+ * run concurrently with the queries.
+ */
+class HeightfieldTiles {
+   public:
+    explicit HeightfieldTiles(HeightfieldSettings settings);
+    ~HeightfieldTiles();
+
+    HeightfieldTiles(const HeightfieldTiles&) = delete;
+    HeightfieldTiles& operator=(const HeightfieldTiles&) = delete;
+
+    const HeightfieldSettings& getSettings() const { return m_settings; }
+
+    /// @brief Map the tiles around the focus points and unmap the far ones
+    void stream(const std::vector<glm::dvec2>& points);
+
+    /// @brief Bilinear height, m
+    float getHeight(double x, double y) const;
+    /// @brief Bilinear height and its slope along x and y
+    void getHeightAndSlope(double x, double y, float& height, float& slopeX,
+                           float& slopeY) const;
+    /// @brief Unit normal from the bilinear slope
+    glm::vec3 getNormal(double x, double y) const;
+    float getFriction(double x, double y) const;
+
+    size_t getNumTiles() const { return m_tiles.size(); }
+    size_t getNumMappedTiles() const;
+    /// @brief Size of the mapped tile files, bytes
+    size_t getMappedBytes() const;
+    /// @brief Tiles mapped by a query instead of stream(), a focus point
+    /// missing or a load radius too small
+    size_t getNumMisses() const { return m_numMisses.load(); }
+
+    std::string getTilePath(uint32_t x, uint32_t y) const;
+
+    /// @brief Write a tile file, throws std::runtime_error on failure
+    static void writeTile(const std::string& path, uint32_t samples,
+                          const std::vector<float>& heights,
+                          uint32_t frictionSamples,
+                          const std::vector<float>& friction);
+
+   private:
+    struct Tile;
+
+    HeightfieldSettings m_settings;
+    uint32_t m_cellsPerTile;
+    // Cells per m
+    double m_invCellSize;
+
+    // Owners by tile index, only changed with m_mutex held
+    mutable std::vector<std::unique_ptr<Tile>> m_tiles;
+    // Read without locking by the queries, set once the tile is mapped
+    mutable std::unique_ptr<std::atomic<const Tile*>[]> m_mapped;
+    mutable std::vector<size_t> m_mappedIndices;
+    mutable std::mutex m_mutex;
+    mutable std::atomic<size_t> m_numMisses{0};
+
+    /// @brief Tile of a cell and the cell coordinates inside it
+    const Tile* locate(double x, double y, uint32_t& cellX, uint32_t& cellY,
+                       float& fracX, float& fracY) const;
+    const Tile* mapTile(size_t index) const;
+};
+
+}  // namespace v3d
@@ -1,9 +1,16 @@
 #include "physics/physics.h"
 
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
+#include "glm/gtc/quaternion.hpp"
 #include "physics/ConstrainLink.h"
 #include "physics/Vehicle.h"
 #include "physics/collider.h"
 #include "physics/rigidbody.h"
+#include "plog/Log.h"
+#include "utils/scoped_timer.hpp"
 
 // ------------------------------- TEMP ----------------------------------
 #include "chrono/physics/ChBodyEasy.h"
@@ -20,22 +27,32 @@
 
 namespace v3d {
 
-Physics::Physics() {
-    // test_chrono2();
+void Physics::initGlobalState() {
+    // Process wide Chrono state, shared by every Physics instance. Set once
+    // so that worlds can be created concurrently (see MultiWorldRunner).
+    static std::once_flag initialized;
+    std::call_once(initialized, [] {
+        chrono::vehicle::ChWorldFrame::SetYUP();
+
+        // // Rotation matrix from ISO -> custom frame
+        // chrono::ChMatrix33<double> R(
+        //     chrono::ChVector3d(1,  0,  0),
+        //     chrono::ChVector3d(0.0000000, -0.4480736, -0.8939967),
+        //     chrono::ChVector3d(0.0000000,  0.8939967, -0.4480736)
+        // );
 
-    chrono::vehicle::ChWorldFrame::SetYUP();
+        // chrono::vehicle::ChWorldFrame::Set(R);
 
-    // // Rotation matrix from ISO -> custom frame
-    // chrono::ChMatrix33<double> R(
-    //     chrono::ChVector3d(1,  0,  0),
-    //     chrono::ChVector3d(0.0000000, -0.4480736, -0.8939967),
-    //     chrono::ChVector3d(0.0000000,  0.8939967, -0.4480736)
-    // );
+        chrono::vehicle::SetDataPath("resources/vehicle_model/");
+    });
+}
+
+Physics::Physics() {
+    // test_chrono2();
 
-    // chrono::vehicle::ChWorldFrame::Set(R);
+    initGlobalState();
 
-    chrono::vehicle::SetDataPath("resources/vehicle_model/");
-    m_system.SetCollisionSystemType(chrono::ChCollisionSystem::Type::BULLET);
+    m_system.SetCollisionSystemType(m_profile.collisionSystem);
     // -9.8067
     m_system.SetGravitationalAcceleration(chrono::ChVector3d(0, -9.8067, 0));
 
@@ -61,30 +78,133 @@ Physics::Physics() {
     // m_terrain = rigid_terrain;
 };
 
+void Physics::applyProfile(const PhysicsProfile& profile) {
+    chrono::ChCollisionSystem::Type collisionSystem = profile.collisionSystem;
+    if (collisionSystem != m_profile.collisionSystem) {
+        if (m_system.GetBodies().empty()) {
+            m_system.SetCollisionSystemType(collisionSystem);
+        } else {
+            PLOGW << "Physics profile '" << profile.name
+                  << "': the collision system can't change once bodies are "
+                     "added, keeping "
+                  << PhysicsProfile::collisionSystemName(
+                         m_profile.collisionSystem);
+            collisionSystem = m_profile.collisionSystem;
+        }
+    }
+
+    if (profile.overrideSolver) m_system.SetSolverType(profile.solver);
+    if (auto solver = m_system.GetSolver()->AsIterative()) {
+        if (profile.maxIterations > 0)
+            solver->SetMaxIterations(profile.maxIterations);
+        if (profile.tolerance > 0) solver->SetTolerance(profile.tolerance);
+    }
+
+    // A count left to 0 keeps the current one
+    if (profile.numThreadsChrono > 0 || profile.numThreadsCollision > 0 ||
+        profile.numThreadsEigen > 0) {
+        m_system.SetNumThreads(
+            profile.numThreadsChrono > 0 ? profile.numThreadsChrono
+                                         : m_system.GetNumThreadsChrono(),
+            profile.numThreadsCollision > 0
+                ? profile.numThreadsCollision
+                : m_system.GetNumThreadsCollision(),
+            profile.numThreadsEigen > 0 ? profile.numThreadsEigen
+                                        : m_system.GetNumThreadsEigen());
+    }
+
+    m_step_size = profile.stepSize;
+    m_maxStepsPerFrame = profile.maxStepsPerFrame;
+
+    m_profile = profile;
+    m_profile.collisionSystem = collisionSystem;
+    PLOGI << "Physics profile '" << m_profile.name << "': "
+          << (m_profile.overrideSolver
+                  ? PhysicsProfile::solverName(m_profile.solver)
+                  : "default")
+          << " solver, "
+          << PhysicsProfile::collisionSystemName(m_profile.collisionSystem)
+          << " collision, " << m_step_size << " s steps\n";
+}
+
+void Physics::setTerrain(
+    std::shared_ptr<chrono::vehicle::ChTerrain> terrain) {
+    auto lock = lockSystem();
+    m_terrain = terrain;
+    m_heightfield = std::dynamic_pointer_cast<HeightfieldTerrain>(terrain);
+}
+
 void Physics::addBody(RigidBody& body) {
+    auto lock = lockSystem();
     m_system.AddBody(body.m_body);
+    trackPose(body);
     // m_system.ShowHierarchy(std::cout);
 }
 
 void Physics::addBody(std::shared_ptr<chrono::ChBody> body) {
+    auto lock = lockSystem();
     m_system.AddBody(body);
 }
 
 void Physics::removeBody(RigidBody& body) {
+    auto lock = lockSystem();
+    untrackPose(body);
     m_system.RemoveBody(body.m_body);
     // m_system.ShowHierarchy(std::cout);
 }
 void Physics::removeBody(std::shared_ptr<chrono::ChBody> body) {
+    auto lock = lockSystem();
     m_system.RemoveBody(body);
 }
 
+void Physics::trackPose(RigidBody& body) {
+    auto lock = lockSystem();
+    if (body.m_poseSlot >= 0) untrackPose(body);
+
+    int slot;
+    if (!m_freePoseSlots.empty()) {
+        slot = m_freePoseSlots.back();
+        m_freePoseSlots.pop_back();
+    } else {
+        slot = static_cast<int>(m_poseBodies.size());
+        m_poseBodies.emplace_back();
+        m_poses.resize(m_poseBodies.size());
+        m_previousPoses.resize(m_poseBodies.size());
+    }
+
+    m_poseBodies[slot] = {body.m_body.get(), &body.getReferenceFrame()};
+    body.m_poseSlot = slot;
+    refreshPose(body);
+}
+
+void Physics::untrackPose(RigidBody& body) {
+    auto lock = lockSystem();
+    if (body.m_poseSlot < 0) return;
+    m_poseBodies[body.m_poseSlot] = PoseSource();
+    m_freePoseSlots.push_back(body.m_poseSlot);
+    body.m_poseSlot = -1;
+}
+
+void Physics::refreshPose(const RigidBody& body) {
+    if (body.m_poseSlot < 0) return;
+    auto lock = lockSystem();
+    // No interpolation from a pose that was jumped over
+    const chrono::ChCoordsysd& pose = body.getReferenceFrame().GetCoordsys();
+    m_poses.write(body.m_poseSlot, pose);
+    m_previousPoses.write(body.m_poseSlot, pose);
+    // Shown before the next step of the thread
+    if (m_thread) m_thread->writeSnapshotPose(body.m_poseSlot, pose);
+}
+
 void Physics::addLink(ConstrainLink& link) {
+    auto lock = lockSystem();
     m_system.AddLink(link.m_link);
     // std::cout << "Link added to system" << std::endl;
     // m_system.ShowHierarchy(std::cout);
 }
 
 void Physics::removeLink(ConstrainLink& link) {
+    auto lock = lockSystem();
     m_system.RemoveLink(link.m_link);
 }
 
@@ -102,6 +222,7 @@ void Physics::removeLink(ConstrainLink& link) {
 // }
 
 VehicleHandle Physics::createVehicle(std::string vehicleModelPath) {
+    auto lock = lockSystem();
     // Create vehicle
     auto& vehicle =
         m_vehicles.emplace_back(&m_system, vehicleModelPath, true, true);
@@ -122,11 +243,23 @@ VehicleHandle Physics::createVehicle(std::string vehicleModelPath) {
 void Physics::showHierarchy() { m_system.ShowHierarchy(std::cout); }
 
 void Physics::stepSimulation() {
+    double* phases = m_frameTimings.phases.data();
+    utils::ScopedTimer stepTimer(phases[PhysicsTimings::TOTAL]);
     double simulationStepSize = m_step_size;
     double time = m_system.GetChTime();
 
-    // Sync data between vehicle subsystems and terrain
-    m_terrain->Synchronize(time);
+    // Sync data between vehicle subsystems and terrain, the heightfield
+    // maps its tiles before the vehicles query them
+    {
+        utils::ScopedTimer timer(phases[PhysicsTimings::TERRAIN_SYNC]);
+        if (m_heightfield) {
+            m_terrainFocus.clear();
+            for (VehicleInputs& inputs : m_vehicleInputs)
+                m_terrainFocus.push_back(inputs.vehicle->GetPos());
+            m_heightfield->setFocusPoints(m_terrainFocus);
+        }
+        m_terrain->Synchronize(time);
+    }
     // for (auto vehicle : m_vehicles){
     //     // TODO: Store WheeledVehicle component instead and get DriverInputs
     //     from there vehicle.Synchronize(time, vehicle, *m_terrain);
@@ -138,37 +271,139 @@ void Physics::stepSimulation() {
     //     vehicle.Synchronize(time, driverInput, *m_terrain);
     // }
 
-    for (int i = 0; i < m_vehicleInputs.size(); i++) {
-        auto vehicle = m_vehicleInputs[i].vehicle;
-        auto driverInput = m_vehicleInputs[i].driverInputs;
-        vehicle->Synchronize(time, driverInput, *m_terrain);
+    // Vehicles are independent until the dynamics step, Synchronize and
+    // Advance of each one only touch its own subsystems. A single parallel
+    // loop runs both, each thread times its phases and the busiest thread
+    // is recorded.
+    const int numVehicles = static_cast<int>(m_vehicleInputs.size());
+    double syncTime = 0, advanceTime = 0;
+#pragma omp parallel if (m_parallelVehicles && numVehicles > 1) \
+    reduction(max : syncTime, advanceTime)
+    {
+        double threadSyncTime = 0, threadAdvanceTime = 0;
+#pragma omp for schedule(static)
+        for (int i = 0; i < numVehicles; i++) {
+            VehicleInputs& inputs = m_vehicleInputs[i];
+            {
+                utils::ScopedTimer timer(threadSyncTime);
+                inputs.vehicle->Synchronize(time, inputs.driverInputs,
+                                            *m_terrain);
+            }
+            utils::ScopedTimer timer(threadAdvanceTime);
+            inputs.vehicle->Advance(simulationStepSize);
+        }
+        syncTime = threadSyncTime;
+        advanceTime = threadAdvanceTime;
+    }
+    phases[PhysicsTimings::VEHICLE_SYNC] += syncTime;
+    phases[PhysicsTimings::VEHICLE_ADVANCE] += advanceTime;
+
+    // Advance simulation for one timestep for all modules
+    m_terrain->Advance(simulationStepSize);
+    m_system.DoStepDynamics(simulationStepSize);
+
+    // Chrono resets its timers every step, s
+    phases[PhysicsTimings::COLLISION] += 1e3 * m_system.GetTimerCollision();
+    phases[PhysicsTimings::SOLVER] +=
+        1e3 * (m_system.GetTimerLSsetup() + m_system.GetTimerLSsolve());
+    phases[PhysicsTimings::UPDATE] += 1e3 * m_system.GetTimerUpdate();
+}
+
+void Physics::startThread() {
+    if (m_thread) return;
+    m_lastThreadSteps = 0;
+    m_thread = std::make_unique<PhysicsThread>(*this);
+}
+
+void Physics::setDriverInputs(size_t vehicle,
+                              const chrono::vehicle::DriverInputs& inputs) {
+    if (!m_thread) {
+        applyDriverInputs(vehicle, inputs);
+    } else if (!m_thread->pushDriverInputs(vehicle, inputs)) {
+        PLOGW << "Physics thread input queue full, driver inputs dropped";
     }
+}
 
-    // const auto steering = 0;
-    // const auto throttle = 0;
-    // const auto braking = 0;
-    // const auto clutch = 1;
+int Physics::advance(double elapsed) {
+    if (m_thread) {
+        // The steps run on the physics thread, the poses are drawn between
+        // the last two by the time since the last one
+        const PhysicsSnapshot& snapshot = m_thread->acquire();
+        m_lastNumSteps =
+            static_cast<int>(snapshot.numSteps - m_lastThreadSteps);
+        m_lastThreadSteps = snapshot.numSteps;
+        const double sinceStep =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                          snapshot.time)
+                .count();
+        m_interpolationAlpha = std::clamp(sinceStep / m_step_size, 0.0, 1.0);
+        return m_lastNumSteps;
+    }
 
-    // for (auto vehicle : m_vehicles){
-    //     vehicle.Synchronize(time, chrono::vehicle::DriverInputs{steering,
-    //     throttle, braking, clutch}, *m_terrain);;
-    // }
+    m_lastNumSteps = runSteps(elapsed);
+    m_interpolationAlpha = std::clamp(m_accumulator / m_step_size, 0.0, 1.0);
+    return m_lastNumSteps;
+}
 
-    // // // // for (auto vehicleInput : m_vehicleInputs){
-    // // // //     // vehicleInput.vehicle->Synchronize(time,
-    // vehicleInput.driverInputs, *m_terrain);
-    // // // //     vehicleInput.vehicle->Synchronize(time,
-    // chrono::vehicle::DriverInputs{steering, throttle, braking, clutch},
-    // *m_terrain);
-    // // // // }
+int Physics::runSteps(double elapsed) {
+    m_accumulator += elapsed;
 
-    // Advance simulation for one timestep for all modules
-    m_terrain->Advance(simulationStepSize);
-    for (auto vehicle : m_vehicles) {
-        vehicle.Advance(simulationStepSize);
+    int numSteps = static_cast<int>(m_accumulator / m_step_size);
+    if (numSteps > m_maxStepsPerFrame) {
+        // Spiral of death guard: the time that can't be simulated is dropped
+        m_numClampedFrames++;
+        m_droppedTime += (numSteps - m_maxStepsPerFrame) * m_step_size;
+        m_accumulator -= (numSteps - m_maxStepsPerFrame) * m_step_size;
+        numSteps = m_maxStepsPerFrame;
     }
 
-    m_system.DoStepDynamics(simulationStepSize);
+    for (int i = 0; i < numSteps; i++) {
+        // Only the state before the last step is interpolated from
+        if (m_interpolate && i == numSteps - 1) extractPoses(m_previousPoses);
+        stepSimulation();
+        m_accumulator -= m_step_size;
+    }
+    // Read from Chrono once per frame, the pose readers use the buffer
+    if (numSteps > 0) {
+        extractPoses(m_poses);
+        recordTimings(numSteps);
+    }
+    return numSteps;
+}
+
+void Physics::recordTimings(int numSteps) {
+    m_frameTimings.simTime = m_system.GetChTime();
+    m_frameTimings.numSteps = numSteps;
+    m_frameTimings.numBodies = m_system.GetBodies().size();
+    m_frameTimings.numLinks = m_system.GetLinks().size();
+    m_frameTimings.numContacts = m_system.GetNumContacts();
+    m_timings.record(m_frameTimings);
+    m_frameTimings = PhysicsTimings();
+}
+
+void Physics::extractPoses(PoseBuffer& poses) {
+    const int numSlots = static_cast<int>(m_poseBodies.size());
+    for (int slot = 0; slot < numSlots; slot++) {
+        const PoseSource& source = m_poseBodies[slot];
+        // Fixed bodies only move through refreshPose
+        if (source.body == nullptr || source.body->IsFixed()) continue;
+        poses.write(slot, source.frame->GetCoordsys());
+    }
+}
+
+void Physics::getInterpolatedPose(int slot, glm::vec3& position,
+                                  glm::quat& rotation) const {
+    const PoseBuffer& poses =
+        m_thread ? m_thread->getSnapshot().poses : m_poses;
+    const PoseBuffer& previousPoses =
+        m_thread ? m_thread->getSnapshot().previousPoses : m_previousPoses;
+    position = poses.getPos(slot);
+    rotation = poses.getRotation(slot);
+    if (!m_interpolate) return;
+
+    const float alpha = static_cast<float>(m_interpolationAlpha);
+    position = glm::mix(previousPoses.getPos(slot), position, alpha);
+    rotation = glm::slerp(previousPoses.getRotation(slot), rotation, alpha);
 }
 
 void Physics::printPosition() {
@@ -179,7 +414,40 @@ void Physics::printPosition() {
     }
 }
 void Physics::renderDebbugGUI() {
+    auto lock = lockSystem();
+    ImGui::Text("Profile: %s, %s solver, %s collision", m_profile.name.c_str(),
+                m_profile.overrideSolver
+                    ? PhysicsProfile::solverName(m_profile.solver)
+                    : "default",
+                PhysicsProfile::collisionSystemName(m_profile.collisionSystem));
     ImGui::InputDouble("Sim Step Size", &m_step_size, 0, 0, "%.6f");
-    ImGui::InputInt("Sim Steps per Frame ", &m_stepPerFrame, 1, 5);
+    ImGui::InputInt("Max Sim Steps per Frame", &m_maxStepsPerFrame, 1, 5);
+    ImGui::Checkbox("Interpolate Poses", &m_interpolate);
+    ImGui::Checkbox("Parallel Vehicles", &m_parallelVehicles);
+    const PhysicsTimings& timings = m_timings.getLast();
+    ImGui::Text("Vehicles: %zu, %.3f ms per step", m_vehicles.size(),
+                (timings.phases[PhysicsTimings::VEHICLE_SYNC] +
+                 timings.phases[PhysicsTimings::VEHICLE_ADVANCE]) /
+                    std::max(timings.numSteps, 1));
+    ImGui::Text("Steps: %d, alpha %.2f", m_lastNumSteps,
+                m_interpolationAlpha);
+    ImGui::Text("Clamped frames: %zu, %.3f s dropped", m_numClampedFrames,
+                m_droppedTime);
+    if (m_heightfield) {
+        const HeightfieldTiles& tiles = m_heightfield->getTiles();
+        ImGui::Text("Terrain tiles: %zu / %zu mapped, %.1f MB, %zu misses",
+                    tiles.getNumMappedTiles(), tiles.getNumTiles(),
+                    tiles.getMappedBytes() / (1024.0 * 1024.0),
+                    tiles.getNumMisses());
+    }
+    if (m_thread) {
+        ImGui::Text("Physics thread: %.0f Hz, %.3f ms per iteration",
+                    m_thread->getIterationRate(),
+                    m_thread->getLastIterationTime());
+    }
+    if (ImGui::TreeNode("Step timings")) {
+        m_timings.renderDebbugGUI();
+        ImGui::TreePop();
+    }
 };
 }  // namespace v3d
@@ -1,9 +1,19 @@
 #pragma once
-#include "chrono/core/ChRealtimeStep.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "chrono/core/ChCoordsys.h"
 #include "chrono/physics/ChSystemNSC.h"
 #include "chrono/physics/ChSystemSMC.h"
 #include "chrono_vehicle/terrain/FlatTerrain.h"
 #include "physics/DefinitionPhysics.hpp"
+#include "physics/heightfield_terrain.h"
+#include "physics/physics_profile.h"
+#include "physics/physics_thread.h"
+#include "physics/physics_timings.h"
+#include "physics/pose_buffer.h"
 #include "physics/utils.hpp"
 
 namespace v3d {
@@ -14,11 +24,20 @@ class ConstrainLink;
 
 class Physics {
     friend class Engine;
+    friend class PhysicsThread;
 
    public:
     Physics();
     ~Physics() {};
 
+    // Thread safety: while a PhysicsThread steps the system, the entry
+    // points below that add, remove or move bodies (addBody, removeBody,
+    // addLink, removeLink, createVehicle, setTerrain, trackPose,
+    // untrackPose, refreshPose) take lockSystem() themselves. Any other
+    // access to Chrono (ChBody getters and setters, vehicle subsystems)
+    // must hold lockSystem(). They must be called from the main thread.
+
+    /// @brief Add the body of a RigidBody and track its pose
     void addBody(
         RigidBody& body);  // TOOD: Refactor addBody to createBody, instead of
                            // registering the body create it directly from
@@ -45,34 +64,183 @@ class Physics {
     /// @brief Write the hierarchy of contained bodies to standard output
     void showHierarchy();
 
+    /// @brief Terrain of the vehicle tires, flat by default. A
+    /// HeightfieldTerrain is streamed around the vehicles.
+    void setTerrain(std::shared_ptr<chrono::vehicle::ChTerrain> terrain);
+    std::shared_ptr<chrono::vehicle::ChTerrain> getTerrain() {
+        return m_terrain;
+    }
+
+    /// @brief Configure the solver, collision system, threads and stepping.
+    /// The collision system can only be changed before adding bodies.
+    void applyProfile(const PhysicsProfile& profile);
+    const PhysicsProfile& getProfile() { return m_profile; }
+
     inline double getStepSize() { return m_step_size; }
     inline void setStepSize(double stepSize) { m_step_size = stepSize; }
 
-    inline double getStepPerFrame() { return m_stepPerFrame; }
-    inline void setStepPerFrame(int stepPerFrame) { m_stepPerFrame = stepPerFrame; }
+    inline int getMaxStepsPerFrame() { return m_maxStepsPerFrame; }
+    inline void setMaxStepsPerFrame(int maxSteps) {
+        m_maxStepsPerFrame = maxSteps;
+    }
+
+    /// @brief Advance the simulation by the elapsed wall time, in fixed
+    /// steps of getStepSize(). The time left over is carried to the next
+    /// call. When threaded, only takes the newest poses of the physics
+    /// thread.
+    /// @return Num of steps run
+    int advance(double elapsed);
+
+    /// @brief Step the simulation continuously on a PhysicsThread. Chrono
+    /// must then only be accessed with lockSystem() held.
+    void startThread();
+    /// @brief Stop the physics thread, advance() steps again
+    void stopThread() { m_thread.reset(); }
+    inline bool isThreaded() const { return m_thread != nullptr; }
+    /// @brief Exclusive access to Chrono while threaded, a lock owning
+    /// nothing otherwise. Only hold it around the code reading or writing
+    /// Chrono, the physics thread doesn't step meanwhile.
+    std::unique_lock<std::recursive_mutex> lockSystem() {
+        if (m_thread) return m_thread->lockSystem();
+        return std::unique_lock<std::recursive_mutex>();
+    }
+
+    /// @brief Driver inputs of the vehicle at index, applied before the
+    /// next step. Queued to the physics thread when threaded.
+    void setDriverInputs(size_t vehicle,
+                         const chrono::vehicle::DriverInputs& inputs);
+
+    /// @brief Track the pose of a RigidBody whose ChBody is already in the
+    /// system (vehicle chassis), addBody(RigidBody&) tracks it otherwise
+    void trackPose(RigidBody& body);
+    void untrackPose(RigidBody& body);
+    /// @brief Copy the current pose of a tracked body into the pose buffer,
+    /// after it was moved outside of a step
+    void refreshPose(const RigidBody& body);
+
+    /// @brief Poses of the tracked bodies after the last step, the
+    /// snapshot of the physics thread when threaded
+    const PoseBuffer& getPoses() const {
+        return m_thread ? m_thread->getSnapshot().poses : m_poses;
+    }
+    bool hasPose(int slot) const {
+        return slot >= 0 && static_cast<size_t>(slot) < getPoses().size();
+    }
+    /// @brief Pose of the body to draw, interpolated between the states
+    /// before and after the last step by the time left over in the
+    /// accumulator
+    void getInterpolatedPose(int slot, glm::vec3& position,
+                             glm::quat& rotation) const;
+    /// @brief Run the vehicles Synchronize and Advance in parallel, each
+    /// vehicle only touches its own subsystems
+    inline bool isParallelVehiclesEnabled() { return m_parallelVehicles; }
+    inline void setParallelVehiclesEnabled(bool enabled) {
+        m_parallelVehicles = enabled;
+    }
+    inline size_t getNumVehicles() { return m_vehicles.size(); }
+
+    /// @brief Simulated time, s
+    inline double getSimulationTime() {
+        if (m_thread) return m_thread->getSnapshot().simTime;
+        return m_system.GetChTime();
+    }
+    /// @brief Num of bodies after the last step, from the snapshot when
+    /// threaded
+    inline size_t getNumBodies() {
+        if (m_thread) return m_thread->getSnapshot().numBodies;
+        return m_system.GetBodies().size();
+    }
+    /// @brief Frames whose steps were clamped to getMaxStepsPerFrame()
+    inline size_t getNumClampedFrames() { return m_numClampedFrames; }
+
+    /// @brief Threads used by Chrono inside a step (solver, collision)
+    inline void setNumThreads(int numThreads) {
+        m_system.SetNumThreads(numThreads);
+    }
+
+    /// @brief Timings of the last frame with steps
+    PhysicsTimings getLastTimings() {
+        auto lock = lockSystem();
+        return m_timings.getLast();
+    }
+    /// @brief Stream the timings of every frame with steps to a CSV file
+    /// @return False if the file can't be opened
+    bool openTimingsCsv(const std::string& path) {
+        auto lock = lockSystem();
+        return m_timings.openCsv(path);
+    }
+
+    inline bool isInterpolationEnabled() { return m_interpolate; }
+    inline void setInterpolationEnabled(bool enabled) {
+        m_interpolate = enabled;
+    }
 
    private:
     chrono::ChSystemSMC m_system;
+    PhysicsProfile m_profile;
     std::shared_ptr<chrono::ChContactMaterialSMC> m_defaultCollMat =
         chrono_types::make_shared<chrono::ChContactMaterialSMC>();
 
     // Vehicle Simulation
     std::shared_ptr<chrono::vehicle::ChTerrain> m_terrain;
-    std::vector<chrono::vehicle::WheeledVehicle> m_vehicles;
+    // Set when m_terrain is a heightfield, streamed around the vehicles
+    std::shared_ptr<HeightfieldTerrain> m_heightfield;
+    std::vector<chrono::ChVector3d> m_terrainFocus;
+    VehiclePool m_vehicles;
     std::vector<VehicleInputs> m_vehicleInputs;
+    bool m_parallelVehicles = true;
     // std::vector<chrono::vehicle::DriverInputs> m_driverInputs;
 
     void stepSimulation();
-
-    // Enforce soft-realtime
-    void spin(double step_size) { realtime_timer.Spin(step_size); }
+    /// @brief Run the steps due after the elapsed time
+    int runSteps(double elapsed);
+    /// @brief Close the timings of the frame's steps
+    void recordTimings(int numSteps);
+    void applyDriverInputs(size_t vehicle,
+                           const chrono::vehicle::DriverInputs& inputs) {
+        m_vehicleInputs[vehicle].driverInputs = inputs;
+    }
+    /// @brief Set the global Chrono state (world frame, vehicle data path)
+    /// on the first call
+    static void initGlobalState();
 
     // Simulation step sizes
     double m_step_size = 4e-4;
-    chrono::ChRealtimeStepTimer realtime_timer;
 
-    // Max simulation steps per frame
-    int m_stepPerFrame = 20;
+    // Max simulation steps per frame, the simulation falls behind wall time
+    // instead of taking longer to catch up each frame
+    int m_maxStepsPerFrame = 100;
+    // Simulated time owed to wall time, less than a step after advance()
+    double m_accumulator = 0;
+    int m_lastNumSteps = 0;
+    size_t m_numClampedFrames = 0;
+    double m_droppedTime = 0;
+
+    /// @brief Tracked body and its reference frame, the pose of its entity
+    struct PoseSource {
+        const chrono::ChBody* body = nullptr;
+        const chrono::ChFrameMoving<>* frame = nullptr;
+    };
+    // Pose snapshot of the tracked bodies, by slot. Free slots have a null
+    // body and are reused.
+    std::vector<PoseSource> m_poseBodies;
+    std::vector<int> m_freePoseSlots;
+    PoseBuffer m_poses;
+    // Poses before the last step, for rendering interpolation
+    bool m_interpolate = true;
+    double m_interpolationAlpha = 1;
+    PoseBuffer m_previousPoses;
+
+    /// @brief Write the poses of the moving tracked bodies
+    void extractPoses(PoseBuffer& poses);
+
+    // Phases of the steps of the current frame, recorded after them
+    PhysicsTimings m_frameTimings;
+    PhysicsTimingsHistory m_timings;
+
+    // Declared last, stopped before the system is destroyed
+    std::unique_ptr<PhysicsThread> m_thread;
+    uint64_t m_lastThreadSteps = 0;
 
     void printPosition();
     void renderDebbugGUI();
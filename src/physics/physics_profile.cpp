@@ -0,0 +1,183 @@
+#include "physics/physics_profile.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#include "chrono_thirdparty/rapidjson/document.h"
+
+namespace v3d {
+
+namespace {
+using SolverType = chrono::ChSolver::Type;
+using CollisionType = chrono::ChCollisionSystem::Type;
+
+const std::pair<const char*, SolverType> SolverNames[] = {
+    {"PSOR", SolverType::PSOR},
+    {"PSSOR", SolverType::PSSOR},
+    {"PJACOBI", SolverType::PJACOBI},
+    {"PMINRES", SolverType::PMINRES},
+    {"BARZILAIBORWEIN", SolverType::BARZILAIBORWEIN},
+    {"APGD", SolverType::APGD},
+    {"ADMM", SolverType::ADMM},
+    {"SPARSE_LU", SolverType::SPARSE_LU},
+    {"SPARSE_QR", SolverType::SPARSE_QR},
+    {"GMRES", SolverType::GMRES},
+    {"MINRES", SolverType::MINRES},
+    {"BICGSTAB", SolverType::BICGSTAB},
+};
+
+const std::pair<const char*, CollisionType> CollisionSystemNames[] = {
+    {"BULLET", CollisionType::BULLET},
+    {"MULTICORE", CollisionType::MULTICORE},
+};
+
+int readPositiveInt(const rapidjson::Value& value, const char* key,
+                    const std::string& profile) {
+    if (!value.IsInt() || value.GetInt() < 1)
+        throw std::runtime_error("Physics profile '" + profile + "': '" +
+                                 key + "' must be a positive integer");
+    return value.GetInt();
+}
+
+PhysicsProfile parseProfile(const rapidjson::Value& json) {
+    if (!json.IsObject())
+        throw std::runtime_error("Physics profile must be a JSON object");
+
+    PhysicsProfile profile;
+    if (json.HasMember("name") && json["name"].IsString())
+        profile.name = json["name"].GetString();
+
+    if (json.HasMember("solver")) {
+        const std::string solver =
+            json["solver"].IsString() ? json["solver"].GetString() : "";
+        bool found = false;
+        for (const auto& [name, type] : SolverNames) {
+            if (solver == name) {
+                profile.solver = type;
+                found = true;
+            }
+        }
+        if (!found)
+            throw std::runtime_error("Physics profile '" + profile.name +
+                                     "': unknown solver '" + solver + "'");
+        profile.overrideSolver = true;
+    }
+    if (json.HasMember("max_iterations"))
+        profile.maxIterations = readPositiveInt(json["max_iterations"],
+                                                "max_iterations", profile.name);
+    if (json.HasMember("tolerance")) {
+        if (!json["tolerance"].IsNumber() || json["tolerance"].GetDouble() < 0)
+            throw std::runtime_error("Physics profile '" + profile.name +
+                                     "': invalid 'tolerance'");
+        profile.tolerance = json["tolerance"].GetDouble();
+    }
+
+    if (json.HasMember("collision_system")) {
+        const std::string collision =
+            json["collision_system"].IsString()
+                ? json["collision_system"].GetString()
+                : "";
+        bool found = false;
+        for (const auto& [name, type] : CollisionSystemNames) {
+            if (collision == name) {
+                profile.collisionSystem = type;
+                found = true;
+            }
+        }
+        if (!found)
+            throw std::runtime_error("Physics profile '" + profile.name +
+                                     "': unknown collision system '" +
+                                     collision + "'");
+    }
+
+    if (json.HasMember("threads")) {
+        const rapidjson::Value& threads = json["threads"];
+        if (threads.IsObject()) {
+            if (threads.HasMember("chrono"))
+                profile.numThreadsChrono = readPositiveInt(
+                    threads["chrono"], "threads.chrono", profile.name);
+            if (threads.HasMember("collision"))
+                profile.numThreadsCollision = readPositiveInt(
+                    threads["collision"], "threads.collision", profile.name);
+            if (threads.HasMember("eigen"))
+                profile.numThreadsEigen = readPositiveInt(
+                    threads["eigen"], "threads.eigen", profile.name);
+        } else {
+            // A single count for the three
+            const int numThreads =
+                readPositiveInt(threads, "threads", profile.name);
+            profile.numThreadsChrono = numThreads;
+            profile.numThreadsCollision = numThreads;
+            profile.numThreadsEigen = numThreads;
+        }
+    }
+
+    if (json.HasMember("step_size")) {
+        const rapidjson::Value& stepSize = json["step_size"];
+        if (!stepSize.IsNumber() || !(stepSize.GetDouble() > 0))
+            throw std::runtime_error("Physics profile '" + profile.name +
+                                     "': 'step_size' must be positive");
+        profile.stepSize = stepSize.GetDouble();
+    }
+    if (json.HasMember("max_steps_per_frame"))
+        profile.maxStepsPerFrame =
+            readPositiveInt(json["max_steps_per_frame"], "max_steps_per_frame",
+                            profile.name);
+    return profile;
+}
+}  // namespace
+
+std::vector<PhysicsProfile> PhysicsProfile::loadFile(const std::string& path) {
+    std::ifstream file(path);
+    if (!file)
+        throw std::runtime_error("Failed to open physics profiles " + path);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+
+    rapidjson::Document document;
+    document.Parse(buffer.str().c_str());
+    if (document.HasParseError())
+        throw std::runtime_error("Invalid JSON in physics profiles " + path);
+
+    std::vector<PhysicsProfile> profiles;
+    if (document.IsObject() && document.HasMember("profiles")) {
+        const rapidjson::Value& list = document["profiles"];
+        if (!list.IsArray())
+            throw std::runtime_error("'profiles' must be an array in " + path);
+        for (const auto& profile : list.GetArray())
+            profiles.push_back(parseProfile(profile));
+    } else {
+        profiles.push_back(parseProfile(document));
+    }
+    return profiles;
+}
+
+PhysicsProfile PhysicsProfile::load(const std::string& path,
+                                    const std::string& name) {
+    std::vector<PhysicsProfile> profiles = loadFile(path);
+    if (profiles.empty())
+        throw std::runtime_error("No physics profile in " + path);
+    if (name.empty()) return profiles.front();
+
+    for (PhysicsProfile& profile : profiles)
+        if (profile.name == name) return profile;
+    throw std::runtime_error("Physics profile '" + name + "' not found in " +
+                             path);
+}
+
+const char* PhysicsProfile::solverName(chrono::ChSolver::Type solver) {
+    for (const auto& [name, type] : SolverNames)
+        if (type == solver) return name;
+    return "UNKNOWN";
+}
+
+const char* PhysicsProfile::collisionSystemName(
+    chrono::ChCollisionSystem::Type collisionSystem) {
+    for (const auto& [name, type] : CollisionSystemNames)
+        if (type == collisionSystem) return name;
+    return "UNKNOWN";
+}
+
+}  // namespace v3d
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "chrono/collision/ChCollisionSystem.h"
+#include "chrono/solver/ChSolver.h"
+
+namespace v3d {
+
+/**
+ * @brief Solver, collision and stepping settings of a Physics system.
+ *
+ * Profiles are loaded from JSON, either a single profile object or
+ * {"profiles": [...]}. Every key is optional:
+ * @code
+ * {
+ *     "name": "psor_fast",
+ *     "solver": "PSOR",
+ *     "max_iterations": 50,
+ *     "tolerance": 1e-6,
+ *     "collision_system": "BULLET",
+ *     "threads": {"chrono": 4, "collision": 4, "eigen": 1},
+ *     "step_size": 1e-3,
+ *     "max_steps_per_frame": 100
+ * }
+ * @endcode
+ */
+struct PhysicsProfile {
+    std::string name = "default";
+    /// @brief False keeps the solver Chrono creates for the system
+    bool overrideSolver = false;
+    chrono::ChSolver::Type solver = chrono::ChSolver::Type::PSOR;
+    /// @brief Iterative solvers only, 0 keeps the solver default
+    int maxIterations = 0;
+    /// @brief Iterative solvers only, 0 keeps the solver default
+    double tolerance = 0;
+    chrono::ChCollisionSystem::Type collisionSystem =
+        chrono::ChCollisionSystem::Type::BULLET;
+    /// @brief Threads of the Chrono parallel loops, the collision detection
+    /// and Eigen, 0 keeps the Chrono default
+    int numThreadsChrono = 0;
+    int numThreadsCollision = 0;
+    int numThreadsEigen = 0;
+    double stepSize = 4e-4;
+    int maxStepsPerFrame = 100;
+
+    /// @brief Profiles of a JSON file, throws std::runtime_error if the file
+    /// can't be read or a value is invalid
+    static std::vector<PhysicsProfile> loadFile(const std::string& path);
+    /// @brief Profile of a JSON file by name, the first one if name is empty
+    static PhysicsProfile load(const std::string& path,
+                               const std::string& name = "");
+
+    static const char* solverName(chrono::ChSolver::Type solver);
+    static const char* collisionSystemName(
+        chrono::ChCollisionSystem::Type collisionSystem);
+};
+
+}  // namespace v3d
@@ -0,0 +1,108 @@
+#include "physics/physics_thread.h"
+
+#include <plog/Log.h>
+
+#include <algorithm>
+
+#include "physics/physics.h"
+
+namespace v3d {
+
+PhysicsThread::PhysicsThread(Physics& physics, size_t inputCapacity,
+                             double batchTime)
+    : m_physics(physics), m_batchTime(batchTime), m_inputs(inputCapacity) {
+    // Readers see the current poses until the first step is published
+    publish();
+    m_snapshots.update();
+
+    m_thread = std::thread(&PhysicsThread::threadMain, this);
+    PLOGI << "Physics thread started, " << m_physics.getStepSize()
+          << " s steps, " << m_batchTime << " s batches\n";
+}
+
+PhysicsThread::~PhysicsThread() {
+    m_stop = true;
+    m_thread.join();
+    PLOGI << "Physics thread stopped\n";
+}
+
+const PhysicsSnapshot& PhysicsThread::acquire() {
+    if (m_failed) std::rethrow_exception(m_error);
+    m_snapshots.update();
+    return m_snapshots.readBuffer();
+}
+
+void PhysicsThread::writeSnapshotPose(int slot,
+                                      const chrono::ChCoordsysd& pose) {
+    PhysicsSnapshot& snapshot = m_snapshots.readBuffer();
+    if (snapshot.poses.size() <= static_cast<size_t>(slot)) {
+        snapshot.poses.resize(slot + 1);
+        snapshot.previousPoses.resize(slot + 1);
+    }
+    snapshot.poses.write(slot, pose);
+    snapshot.previousPoses.write(slot, pose);
+}
+
+void PhysicsThread::threadMain() {
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point last = Clock::now();
+    Clock::time_point rateStart = last;
+    size_t rateIterations = 0;
+
+    while (!m_stop) {
+        const Clock::time_point start = Clock::now();
+        double batchTime;
+        try {
+            std::lock_guard<std::recursive_mutex> lock(m_systemMutex);
+            InputCommand command;
+            while (m_inputs.pop(command))
+                m_physics.applyDriverInputs(command.vehicle, command.inputs);
+
+            const int numSteps = m_physics.runSteps(
+                std::chrono::duration<double>(start - last).count());
+            if (numSteps > 0) {
+                m_numSteps += numSteps;
+                publish();
+            }
+            batchTime = std::max(m_physics.getStepSize(), m_batchTime);
+        } catch (...) {
+            m_error = std::current_exception();
+            m_failed = true;
+            PLOGE << "Physics thread stopped by an error";
+            return;
+        }
+        last = start;
+
+        const Clock::time_point end = Clock::now();
+        m_iterationTime =
+            std::chrono::duration<double, std::milli>(end - start).count();
+        rateIterations++;
+        const double rateTime =
+            std::chrono::duration<double>(end - rateStart).count();
+        if (rateTime >= 1) {
+            m_iterationRate = rateIterations / rateTime;
+            rateIterations = 0;
+            rateStart = end;
+        }
+
+        // The next batch is due a batch after this iteration started, a late
+        // wake up runs more steps
+        std::this_thread::sleep_until(
+            start + std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<double>(batchTime)));
+    }
+}
+
+void PhysicsThread::publish() {
+    PhysicsSnapshot& snapshot = m_snapshots.writeBuffer();
+    // Copy assignment reuses the capacity of the buffer
+    snapshot.poses = m_physics.m_poses;
+    snapshot.previousPoses = m_physics.m_previousPoses;
+    snapshot.simTime = m_physics.m_system.GetChTime();
+    snapshot.numSteps = m_numSteps;
+    snapshot.numBodies = m_physics.m_system.GetBodies().size();
+    snapshot.time = std::chrono::steady_clock::now();
+    m_snapshots.publish();
+}
+
+}  // namespace v3d
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "chrono_vehicle/ChSubsysDefs.h"
+#include "physics/pose_buffer.h"
+#include "utils/spsc_queue.hpp"
+#include "utils/triple_buffer.hpp"
+
+namespace v3d {
+class Physics;
+
+/// @brief State of the simulation published by the physics thread after
+/// its steps
+struct PhysicsSnapshot {
+    /// @brief Poses after the last step, by pose slot
+    PoseBuffer poses;
+    /// @brief Poses before the last step, for rendering interpolation
+    PoseBuffer previousPoses;
+    /// @brief Simulated time, s
+    double simTime = 0;
+    /// @brief Steps run since the thread started
+    uint64_t numSteps = 0;
+    size_t numBodies = 0;
+    /// @brief Wall time the last step ended
+    std::chrono::steady_clock::time_point time;
+};
+
+/**
+ * @brief Thread advancing a Physics system continuously at its fixed step,
+ * pipelined with the logic and rendering of the main thread.
+ *
+ * The thread wakes once per batch of steps (batchTime of wall time, at least
+ * a step) and runs the steps due since its last iteration. After them, it
+ * publishes the body poses once through a lock-free triple buffer that the
+ * main thread reads with acquire(). Driver inputs go
+ * the other way through a single-producer single-consumer queue and are
+ * applied before the next step. Neither side waits on the other for these.
+ *
+ * Everything else touching Chrono from another thread (adding bodies,
+ * reading velocities, the editor) must hold lockSystem(). The thread holds
+ * it for a single iteration, normally one step. The lock is recursive, so
+ * an entry point taking it can be called by code already holding it.
+ */
+class PhysicsThread {
+   public:
+    /// @param inputCapacity Driver inputs queued between two iterations
+    /// @param batchTime Wall time between two iterations, s. Shorter than a
+    /// step runs one step per iteration.
+    explicit PhysicsThread(Physics& physics, size_t inputCapacity = 1024,
+                           double batchTime = 1.0 / 240);
+    /// @brief Stop after the current iteration
+    ~PhysicsThread();
+
+    PhysicsThread(const PhysicsThread&) = delete;
+    PhysicsThread& operator=(const PhysicsThread&) = delete;
+
+    /// @brief Exclusive access to the physics system, blocks for at most
+    /// the current iteration of the thread
+    std::unique_lock<std::recursive_mutex> lockSystem() {
+        return std::unique_lock<std::recursive_mutex>(m_systemMutex);
+    }
+
+    /// @brief Queue driver inputs for the vehicle at index of the physics
+    /// system, producer side (one thread only)
+    /// @return False if the queue is full and the inputs are dropped
+    bool pushDriverInputs(size_t vehicle,
+                          const chrono::vehicle::DriverInputs& inputs) {
+        return m_inputs.push({vehicle, inputs});
+    }
+
+    /// @brief Take the newest snapshot, rethrows the error that stopped the
+    /// thread. Consumer side (one thread only).
+    const PhysicsSnapshot& acquire();
+    /// @brief Snapshot taken by the last acquire()
+    const PhysicsSnapshot& getSnapshot() const {
+        return m_snapshots.readBuffer();
+    }
+    /// @brief Write a pose into the snapshot held by the consumer, for a
+    /// body tracked or moved since the last step. Consumer side.
+    void writeSnapshotPose(int slot, const chrono::ChCoordsysd& pose);
+
+    /// @brief Iterations of the thread per second of wall time, over the
+    /// last second
+    double getIterationRate() const { return m_iterationRate.load(); }
+    /// @brief Duration of the last iteration, ms
+    double getLastIterationTime() const { return m_iterationTime.load(); }
+
+   private:
+    struct InputCommand {
+        size_t vehicle;
+        chrono::vehicle::DriverInputs inputs;
+    };
+
+    Physics& m_physics;
+    const double m_batchTime;
+    std::recursive_mutex m_systemMutex;
+    utils::SpscQueue<InputCommand> m_inputs;
+    utils::TripleBuffer<PhysicsSnapshot> m_snapshots;
+    uint64_t m_numSteps = 0;  // Thread
+
+    std::atomic<bool> m_stop{false};
+    std::atomic<double> m_iterationRate{0};
+    std::atomic<double> m_iterationTime{0};
+    // First error of the thread, rethrown by acquire()
+    std::atomic<bool> m_failed{false};
+    std::exception_ptr m_error;
+
+    std::thread m_thread;
+
+    void threadMain();
+    void publish();
+};
+
+}  // namespace v3d
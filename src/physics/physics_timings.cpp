@@ -0,0 +1,111 @@
+#include "physics/physics_timings.h"
+
+#include <plog/Log.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+
+#include "imgui.h"
+
+namespace v3d {
+
+namespace {
+// CSV column of each phase
+const char* const PhaseColumns[PhysicsTimings::NUM_PHASES] = {
+    "terrain_sync_ms", "vehicle_sync_ms", "vehicle_advance_ms",
+    "collision_ms",    "solver_ms",       "update_ms",
+    "total_ms"};
+}  // namespace
+
+const char* PhysicsTimings::phaseName(Phase phase) {
+    switch (phase) {
+        case TERRAIN_SYNC:
+            return "Terrain sync";
+        case VEHICLE_SYNC:
+            return "Vehicle sync";
+        case VEHICLE_ADVANCE:
+            return "Vehicle advance";
+        case COLLISION:
+            return "Collision";
+        case SOLVER:
+            return "Solver";
+        case UPDATE:
+            return "Update";
+        case TOTAL:
+            return "Total";
+        default:
+            return "unknown";
+    }
+}
+
+void PhysicsTimingsHistory::record(const PhysicsTimings& timings) {
+    m_last = timings;
+    for (size_t phase = 0; phase < PhysicsTimings::NUM_PHASES; phase++)
+        m_history[phase][m_historyOffset] =
+            static_cast<float>(timings.phases[phase]);
+    m_contactsHistory[m_historyOffset] =
+        static_cast<float>(timings.numContacts);
+    m_historyOffset = (m_historyOffset + 1) % HistorySize;
+    m_historyCount = std::min(m_historyCount + 1, HistorySize);
+
+    if (!m_csv.is_open()) return;
+    m_csv << timings.simTime << ',' << timings.numSteps;
+    for (double time : timings.phases) m_csv << ',' << time;
+    m_csv << ',' << timings.numBodies << ',' << timings.numLinks << ','
+          << timings.numContacts << '\n';
+    m_csvRows++;
+}
+
+bool PhysicsTimingsHistory::openCsv(const std::string& path) {
+    closeCsv();
+    m_csv.open(path, std::ios::trunc);
+    if (!m_csv) {
+        PLOGE << "Failed to write the physics timings to " << path;
+        return false;
+    }
+    m_csv.precision(9);
+    m_csv << "sim_time,steps";
+    for (const char* column : PhaseColumns) m_csv << ',' << column;
+    m_csv << ",bodies,links,contacts\n";
+    m_csvPath = path;
+    m_csvRows = 0;
+    PLOGI << "Writing the physics timings to " << path << "\n";
+    return true;
+}
+
+void PhysicsTimingsHistory::closeCsv() {
+    if (!m_csv.is_open()) return;
+    m_csv.close();
+    PLOGI << "Physics timings: " << m_csvRows << " frames written to "
+          << m_csvPath << "\n";
+}
+
+void PhysicsTimingsHistory::renderDebbugGUI() {
+    const int numSteps = std::max(m_last.numSteps, 1);
+    ImGui::Text("Last frame: %d steps, %zu bodies, %zu links, %zu contacts",
+                m_last.numSteps, m_last.numBodies, m_last.numLinks,
+                m_last.numContacts);
+    if (m_csv.is_open())
+        ImGui::Text("CSV: %s, %zu frames", m_csvPath.c_str(), m_csvRows);
+
+    // Oldest frame first once the ring is full
+    const int count = static_cast<int>(m_historyCount);
+    const int offset = static_cast<int>(
+        m_historyCount < HistorySize ? 0 : m_historyOffset);
+    const ImVec2 graphSize(0, 40);
+    char overlay[64];
+    for (size_t i = 0; i < PhysicsTimings::NUM_PHASES; i++) {
+        const auto phase = static_cast<PhysicsTimings::Phase>(i);
+        // Frame total in the graph, mean of a step in the overlay
+        std::snprintf(overlay, sizeof(overlay), "%.3f ms, %.1f us per step",
+                      m_last.phases[i], 1e3 * m_last.phases[i] / numSteps);
+        ImGui::PlotLines(PhysicsTimings::phaseName(phase), m_history[i].data(),
+                         count, offset, overlay, 0, FLT_MAX, graphSize);
+    }
+    std::snprintf(overlay, sizeof(overlay), "%zu", m_last.numContacts);
+    ImGui::PlotLines("Contacts", m_contactsHistory.data(), count, offset,
+                     overlay, 0, FLT_MAX, graphSize);
+}
+
+}  // namespace v3d
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <fstream>
+#include <string>
+
+namespace v3d {
+
+/// @brief Time spent by the physics steps of a frame in each phase, and the
+/// size of the system after them
+struct PhysicsTimings {
+    enum Phase {
+        /// @brief Terrain Synchronize, heightfield streaming included
+        TERRAIN_SYNC,
+        /// @brief Vehicle Synchronize (driver inputs, tire forces)
+        VEHICLE_SYNC,
+        /// @brief Vehicle Advance (tires, powertrain)
+        VEHICLE_ADVANCE,
+        /// @brief Chrono collision detection
+        COLLISION,
+        /// @brief Chrono solver setup and solve
+        SOLVER,
+        /// @brief Chrono update of the system state
+        UPDATE,
+        /// @brief Whole steps, the phases above and everything else
+        TOTAL,
+        NUM_PHASES
+    };
+
+    static const char* phaseName(Phase phase);
+
+    /// @brief Simulated time after the steps, s
+    double simTime = 0;
+    int numSteps = 0;
+    /// @brief Summed over the steps of the frame, ms
+    std::array<double, NUM_PHASES> phases = {};
+    size_t numBodies = 0;
+    size_t numLinks = 0;
+    size_t numContacts = 0;
+};
+
+/**
+ * @brief Rolling history of the PhysicsTimings of the last HistorySize
+ * frames with steps, optionally streamed to a CSV file (one row per frame).
+ *
+ * Written by the thread running the steps, read by the debug GUI. Both must
+ * hold Physics::lockSystem() when the physics is threaded.
+ */
+class PhysicsTimingsHistory {
+   public:
+    static constexpr size_t HistorySize = 240;
+
+    ~PhysicsTimingsHistory() { closeCsv(); }
+
+    void record(const PhysicsTimings& timings);
+    /// @brief Timings of the last frame with steps
+    const PhysicsTimings& getLast() const { return m_last; }
+
+    /// @brief Write every recorded frame to a CSV file, replacing it
+    /// @return False if the file can't be opened, logged
+    bool openCsv(const std::string& path);
+    void closeCsv();
+    bool isWritingCsv() const { return m_csv.is_open(); }
+
+    void renderDebbugGUI();
+
+   private:
+    // Frame rings, ms per phase then contacts
+    std::array<std::array<float, HistorySize>, PhysicsTimings::NUM_PHASES>
+        m_history = {};
+    std::array<float, HistorySize> m_contactsHistory = {};
+    size_t m_historyOffset = 0;
+    size_t m_historyCount = 0;
+    PhysicsTimings m_last;
+
+    std::ofstream m_csv;
+    std::string m_csvPath;
+    size_t m_csvRows = 0;
+};
+
+}  // namespace v3d
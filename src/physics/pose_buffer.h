@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "chrono/core/ChCoordsys.h"
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+namespace v3d {
+
+/**
+ * @brief Body poses in single precision, structure of arrays indexed by body
+ * slot.
+ *
+ * Written by Physics once per frame after the last step, read by the
+ * transforms, the renderers and the editor without going through Chrono.
+ * Each component is contiguous so the extraction loop writes linear arrays
+ * and readers only touch the slots they need.
+ */
+struct PoseBuffer {
+    std::vector<float> posX, posY, posZ;
+    std::vector<float> rotW, rotX, rotY, rotZ;
+
+    size_t size() const { return posX.size(); }
+
+    void resize(size_t size) {
+        posX.resize(size, 0.f);
+        posY.resize(size, 0.f);
+        posZ.resize(size, 0.f);
+        rotW.resize(size, 1.f);
+        rotX.resize(size, 0.f);
+        rotY.resize(size, 0.f);
+        rotZ.resize(size, 0.f);
+    }
+
+    void write(size_t slot, const chrono::ChCoordsysd& pose) {
+        posX[slot] = static_cast<float>(pose.pos.x());
+        posY[slot] = static_cast<float>(pose.pos.y());
+        posZ[slot] = static_cast<float>(pose.pos.z());
+        rotW[slot] = static_cast<float>(pose.rot.e0());
+        rotX[slot] = static_cast<float>(pose.rot.e1());
+        rotY[slot] = static_cast<float>(pose.rot.e2());
+        rotZ[slot] = static_cast<float>(pose.rot.e3());
+    }
+
+    glm::vec3 getPos(size_t slot) const {
+        return glm::vec3(posX[slot], posY[slot], posZ[slot]);
+    }
+    glm::quat getRotation(size_t slot) const {
+        return glm::quat(rotW[slot], rotX[slot], rotY[slot], rotZ[slot]);
+    }
+};
+
+}  // namespace v3d
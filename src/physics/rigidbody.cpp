@@ -1,6 +1,8 @@
 
 #include "physics/rigidbody.h"
 
+#include <atomic>
+
 #include "editor/ComponentRegistry.h"
 #include "entity.h"
 #include "physics/collider.h"
@@ -8,6 +10,7 @@
 #include "plog/Log.h"
 #include "rigidbody.h"
 #include "scene.h"
+#include "transform.h"
 
 namespace v3d {
 REGISTER_COMPONENT(RigidBody);
@@ -20,42 +23,188 @@ RigidBody::~RigidBody() {
 }
 
 void RigidBody::init() {
-    // Initialize chrono rigidbody and add to the system
-    // TODO: Relate to the parent
-    // TODO: Make all entities have entities have rigidbody but with physics
-    // disabled, to disable physics set the body to fixed:
-    // m_body->SetFixed(true)
-    m_body = chrono_types::make_shared<chrono::ChBody>();
+    // Initialize chrono rigidbody and add to the system. Bodies are only
+    // created for entities that ask for one, the others keep a kinematic
+    // Transform and never enter the physics system.
+    // The center of mass of a compound body is not at the entity origin,
+    // the body keeps a separate reference frame for it
+    auto body = chrono_types::make_shared<chrono::ChBodyAuxRef>();
+    m_bodyAuxRef = body.get();
+    m_body = body;
 
     // Initialize
-    m_body->SetMass(10);
-    m_body->SetInertiaXX(chrono::ChVector3d(4, 4, 4));
-    m_body->SetPos(chrono::ChVector3d(0, .1, 0));
+    updateMassProperties();
+    setReferenceFrame(chrono::ChFramed(chrono::ChVector3d(0, .1, 0)));
     m_body->SetPosDt(chrono::ChVector3d(0, 0, 0));
     // Init acceleration to earth gravity
     // m_body->SetPosDt2(chrono::ChVector3d(0, 0.91, 0));
 
     m_scene->getPhysics()->addBody(*this);
+
+    // The transform is now driven by the body, starting from its pose
+    entity_ptr entity = m_scene->getEntity(m_entity);
+    entity->m_rigidBody = this;
+    auto transform = m_scene->getComponentOfType<Transform>(m_entity);
+    if (transform != nullptr) transform->attachRigidBody(this);
 };
 
+RigidBody* RigidBody::getOrCreate(Scene* scene, entityID_t entity) {
+    auto rigidBody = scene->getComponentOfType<RigidBody>(entity);
+    if (rigidBody != nullptr) return rigidBody;
+    return scene->createEntityComponentOfType<RigidBody>(
+        scene->getEntity(entity));
+}
+
 void RigidBody::update(double deltaTime) {
     // std::cout << "Pos " << m_scene->getEntity(m_entity)->m_name << ": " <<
     // m_body->GetPos() << "\n";
 };
 
+void RigidBody::setPos(chrono::ChVector3d position) {
+    auto lock = m_scene->getPhysics()->lockSystem();
+    setReferenceFrame(
+        chrono::ChFramed(position, getReferenceFrame().GetRot()));
+    syncPose();
+}
+
 void RigidBody::addCollider(ColliderBase& collider) {
-    auto shape = collider.getRawShape();
-    m_body->AddCollisionShape(shape);
+    auto lock = m_scene->getPhysics()->lockSystem();
+    m_colliders.push_back(&collider);
+    m_body->AddCollisionShape(collider.getRawShape());
     m_body->EnableCollision(true);
 }
 
+void RigidBody::addCompoundCollider(ColliderBase& collider,
+                                    const chrono::ChFramed& frame) {
+    auto lock = m_scene->getPhysics()->lockSystem();
+    m_compoundColliders.push_back({&collider, frame});
+    m_body->AddCollisionShape(collider.getRawShape(), frame);
+    m_body->EnableCollision(true);
+    updateMassProperties();
+}
+
+void RigidBody::updateMassProperties() {
+    if (!m_body) return;
+    auto lock = m_scene->getPhysics()->lockSystem();
+
+    // Body itself and parts with a mass: mass, center of mass relative to
+    // the reference and inertia about it, in the reference axes
+    struct MassPart {
+        double mass;
+        chrono::ChVector3d position;
+        chrono::ChMatrix33d inertia;
+    };
+    std::vector<MassPart> parts;
+    const chrono::ChMatrix33d comRot = m_centerOfMass.GetRotMat();
+    parts.push_back({m_mass, m_centerOfMass.GetPos(),
+                     comRot * m_inertia * comRot.transpose()});
+    for (const CompoundCollider& part : m_compoundColliders) {
+        const double partMass = part.collider->getMass();
+        if (partMass <= 0) continue;
+        const chrono::ChMatrix33d rot = part.frame.GetRotMat();
+        parts.push_back(
+            {partMass, part.frame.GetPos(),
+             rot * part.collider->getLocalInertia() * rot.transpose()});
+    }
+
+    // Without parts the body keeps its own center of mass frame
+    if (parts.size() == 1) {
+        m_body->SetMass(m_mass);
+        m_body->SetInertia(m_inertia);
+        if (m_bodyAuxRef != nullptr)
+            m_bodyAuxRef->SetFrameCOMToRef(m_centerOfMass);
+        return;
+    }
+
+    double mass = 0;
+    chrono::ChVector3d centroid(0, 0, 0);
+    for (const MassPart& part : parts) {
+        mass += part.mass;
+        centroid += part.position * part.mass;
+    }
+    // A plain ChBody can't move its center of mass off its frame, the
+    // inertia is then taken about the reference
+    if (m_bodyAuxRef != nullptr && mass > 0)
+        centroid /= mass;
+    else
+        centroid = chrono::ChVector3d(0, 0, 0);
+
+    // Parallel axis theorem, every part moved to the centroid
+    chrono::ChMatrix33d inertia;
+    inertia.setZero();
+    for (const MassPart& part : parts) {
+        inertia += part.inertia;
+        const chrono::ChVector3d d = part.position - centroid;
+        const double d2 = d.Length2();
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++)
+                inertia(i, j) += part.mass * ((i == j ? d2 : 0) - d[i] * d[j]);
+    }
+
+    m_body->SetMass(mass);
+    m_body->SetInertia(inertia);
+    // Keeps the reference frame in place, only the center of mass moves
+    if (m_bodyAuxRef != nullptr)
+        m_bodyAuxRef->SetFrameCOMToRef(chrono::ChFramed(centroid));
+}
+
+void RigidBody::addCollisionShapes() {
+    for (ColliderBase* collider : m_colliders)
+        m_body->AddCollisionShape(collider->getRawShape());
+    for (const CompoundCollider& part : m_compoundColliders)
+        m_body->AddCollisionShape(part.collider->getRawShape(), part.frame);
+}
+
+void RigidBody::rebuildCollisionShapes() {
+    if (!m_body) return;
+    auto lock = m_scene->getPhysics()->lockSystem();
+
+    // A body already bound to the collision system is rebound with its new
+    // shapes
+    chrono::ChSystem* system = m_body->GetSystem();
+    std::shared_ptr<chrono::ChCollisionSystem> collisionSystem =
+        system != nullptr ? system->GetCollisionSystem() : nullptr;
+    if (collisionSystem) collisionSystem->UnbindItem(m_body);
+    if (auto model = m_body->GetCollisionModel()) model->Clear();
+    addCollisionShapes();
+    if (collisionSystem) collisionSystem->BindItem(m_body);
+}
+
 void RigidBody::hardResetBody(std::shared_ptr<chrono::ChBody> newBody) {
+    // Not stepped between the removal of the old body and the tracking of
+    // the new one
+    auto lock = m_scene->getPhysics()->lockSystem();
     // Remove the current body from the system
     // it will be deleted if it doesn't have external references
     m_scene->getPhysics()->removeBody(*this);
     m_body.reset();
 
     m_body = newBody;
+    m_bodyAuxRef = dynamic_cast<chrono::ChBodyAuxRef*>(m_body.get());
+    // The new body is already in the system, only its pose is tracked
+    m_scene->getPhysics()->trackPose(*this);
+
+    // The new body brings its own mass, the colliders move to it
+    m_mass = m_body->GetMass();
+    m_inertia = m_body->GetInertia();
+    m_centerOfMass = chrono::ChFramed();
+    if (m_bodyAuxRef != nullptr)
+        m_centerOfMass = m_bodyAuxRef->GetFrameCOMToRef();
+    addCollisionShapes();
+    if (!m_colliders.empty() || !m_compoundColliders.empty())
+        m_body->EnableCollision(true);
+    if (!m_compoundColliders.empty()) updateMassProperties();
+}
+
+void RigidBody::setReferenceFrame(const chrono::ChFramed& frame) {
+    if (m_bodyAuxRef != nullptr)
+        m_bodyAuxRef->SetFrameRefToAbs(frame);
+    else
+        m_body->SetCoordsys(frame.GetCoordsys());
+}
+
+void RigidBody::syncPose() {
+    if (m_scene) m_scene->getPhysics()->refreshPose(*this);
 }
 
 void RigidBody::setParent(RigidBody* parent) {
@@ -72,6 +221,7 @@ void RigidBody::setParent(RigidBody* parent) {
 }
 
 void RigidBody::drawEditorGUI_Properties() {
+    auto lock = m_scene->getPhysics()->lockSystem();
     bool fixed = isFixed();
     if (ImGui::Checkbox("Is Fixed", &fixed)) setFixed(fixed);
 
@@ -98,7 +248,8 @@ v3d::ConstraintParentChild::ConstraintParentChild(Physics* phSystem,
     : ConstrainLink(phSystem) {
     std::shared_ptr<chrono::ChLinkMateFix> link =
         chrono_types::make_shared<chrono::ChLinkMateFix>();
-    static int count = 0;
+    // Worlds may be built concurrently (MultiWorldRunner)
+    static std::atomic<int> count{0};
     link->SetName("constraint_parent_child_" + std::to_string(count++));
     link->Initialize(parent.m_body, child.m_body);
     m_link = link;
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 
 #include "chrono/core/ChVector3.h"
+#include "chrono/physics/ChBodyAuxRef.h"
 #include "chrono/physics/ChLinkMate.h"
 #include "chrono/physics/ChLinkMotorRotationSpeed.h"
 #include "chrono/physics/ChSystemSMC.h"
@@ -34,6 +36,7 @@ class RigidBody : public ComponentBase {
     friend class Transform;
     friend class Physics;
     friend class Vehicle;
+    friend class ColliderBase;
     friend class ConstraintParentChild;
     friend class ConstraintSpringDamper;
 
@@ -51,21 +54,52 @@ class RigidBody : public ComponentBase {
     void start() override {};
     void update(double deltaTime) override;
 
-    void setMass(double mass) { m_body->SetMass(mass); }
+    /// @brief RigidBody of the entity, created if the entity has none yet.
+    /// Used by the components that need physics (colliders, vehicles).
+    static RigidBody* getOrCreate(Scene* scene, entityID_t entity);
+
+    /// @brief Mass of the body itself, the colliders merged into a compound
+    /// body are added to it
+    void setMass(double mass) {
+        m_mass = mass;
+        updateMassProperties();
+    }
 
     void setInertia(chrono::ChVector3d inertia) {
-        m_body->SetInertiaXX(inertia);
+        m_inertia.setZero();
+        m_inertia(0, 0) = inertia.x();
+        m_inertia(1, 1) = inertia.y();
+        m_inertia(2, 2) = inertia.z();
+        updateMassProperties();
+    }
+
+    /**
+     * @brief Merge the colliders of the kinematic descendants into this body.
+     *
+     * A collider created on a descendant entity without RigidBody is added
+     * to this body with its frame relative to the body reference, its mass
+     * and inertia are aggregated into the body and the center of mass moves
+     * to the mass weighted centroid of the body and its parts. A rigid
+     * assembly is then simulated as one body instead of one body per part
+     * welded by ConstraintParentChild links. Only affects the colliders
+     * created afterwards.
+     */
+    void setCompound(bool compound) { m_compound = compound; }
+    bool isCompound() const { return m_compound; }
+    size_t getNumCompoundColliders() const {
+        return m_compoundColliders.size();
     }
 
     void setPos(glm::vec3 position) {
-        m_body->SetPos(chrono::ChVector3d(position.x, position.y, position.z));
+        setPos(chrono::ChVector3d(position.x, position.y, position.z));
     }
-    void setPos(chrono::ChVector3d position) { m_body->SetPos(position); }
+    /// @brief Teleport the body, locks the physics system
+    void setPos(chrono::ChVector3d position);
     void setPos(float x, float y, float z) {
-        m_body->SetPos(chrono::ChVector3d(x, y, z));
+        setPos(chrono::ChVector3d(x, y, z));
     }
     glm::vec3 getPos() {
-        auto p = m_body->GetPos();
+        auto p = getReferenceFrame().GetPos();
         return glm::vec3(p.x(), p.y(), p.z());
     }
 
@@ -87,11 +121,55 @@ class RigidBody : public ComponentBase {
     void drawEditorGUI_Properties() override;
 
    private:
+    struct CompoundCollider {
+        ColliderBase* collider;
+        // Frame of the collider relative to the body
+        chrono::ChFramed frame;
+    };
+
     std::shared_ptr<chrono::ChBody> m_body = nullptr;
+    // Set when the body is a ChBodyAuxRef, its reference frame (the pose of
+    // the entity) may then differ from its center of mass
+    chrono::ChBodyAuxRef* m_bodyAuxRef = nullptr;
+    // Slot of the body in the pose buffer of the physics system, -1 if not
+    // tracked
+    int m_poseSlot = -1;
     RigidBody* m_parent = nullptr;
     std::unique_ptr<ConstraintParentChild> m_parentRelConstrain = nullptr;
 
+    double m_mass = 10;
+    // About the center of mass of the body itself, in m_centerOfMass axes
+    chrono::ChMatrix33d m_inertia = chrono::ChMatrix33d::Identity() * 4;
+    // Center of mass of the body itself relative to its reference
+    chrono::ChFramed m_centerOfMass;
+    bool m_compound = false;
+    std::vector<CompoundCollider> m_compoundColliders;
+    // Colliders of the entity itself, shapes at the body reference
+    std::vector<ColliderBase*> m_colliders;
+
+    /// @brief Replace the body by one already in the system, locks the
+    /// physics system
     void hardResetBody(std::shared_ptr<chrono::ChBody> newBody);
+    /// @brief Update the pose buffer after moving the body outside of a step
+    void syncPose();
+    /// @brief Frame of the entity: the reference frame of a ChBodyAuxRef,
+    /// the center of mass frame otherwise
+    const chrono::ChFrameMoving<>& getReferenceFrame() const {
+        if (m_bodyAuxRef != nullptr) return m_bodyAuxRef->GetFrameRefToAbs();
+        return *m_body;
+    }
+    /// @brief Move the body so its reference frame is at the given pose
+    void setReferenceFrame(const chrono::ChFramed& frame);
     void setParent(RigidBody* parent);
+    void addCompoundCollider(ColliderBase& collider,
+                             const chrono::ChFramed& frame);
+    /// @brief Set the mass, the inertia and the center of mass of the body,
+    /// aggregating the compound colliders
+    void updateMassProperties();
+    /// @brief Add the shapes of every collider to the body
+    void addCollisionShapes();
+    /// @brief Replace the shapes of the body by the current ones of its
+    /// colliders, after one of them changed shape
+    void rebuildCollisionShapes();
 };
 }  // namespace v3d
@@ -9,8 +9,8 @@ void v3d::rendering::GizmosManager::draw_point(glm::vec3 a, float size, glm::vec
 }
 
 void v3d::rendering::GizmosManager::draw_line(glm::vec3 a, glm::vec3 b,
-                                              float size, glm::vec4 color) {
-    m_graphicsBackend->drawPrimitiveLine(a, b, size, color);
+                                              glm::vec4 color) {
+    m_graphicsBackend->drawPrimitiveLine(a, b, color);
 }
 void v3d::rendering::GizmosManager::draw_cube(glm::vec3 position,
                                               glm::vec3 scale, glm::vec4 color,
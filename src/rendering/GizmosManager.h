@@ -12,7 +12,9 @@ class GizmosManager {
         : m_graphicsBackend(graphicsBackend) {}
 
     void draw_point(glm::vec3 a, float size = 1, glm::vec4 color = glm::vec4(1.0f));
-    void draw_line(glm::vec3 a, glm::vec3 b, float size = 1, glm::vec4 color = glm::vec4(1.0f));
+    /// @brief 1 pixel wide line, the core profile does not guarantee wider
+    /// GL_LINES
+    void draw_line(glm::vec3 a, glm::vec3 b, glm::vec4 color = glm::vec4(1.0f));
     void draw_cube(glm::vec3 position, glm::vec3 scale = glm::vec3(1),
                    glm::vec4 color = glm::vec4(1), bool wireframe = false);
     void draw_sphere(glm::vec3 position, glm::vec3 scale = glm::vec3(1),
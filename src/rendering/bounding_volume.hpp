@@ -0,0 +1,45 @@
+#pragma once
+
+#include <algorithm>
+
+#include "glm/glm.hpp"
+
+namespace v3d {
+namespace rendering {
+
+/// @brief Axis aligned bounding box
+struct AABB {
+    glm::vec3 min = glm::vec3(0.f);
+    glm::vec3 max = glm::vec3(0.f);
+
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+    glm::vec3 extents() const { return (max - min) * 0.5f; }
+};
+
+struct BoundingSphere {
+    glm::vec3 center = glm::vec3(0.f);
+    /// @brief A negative radius marks an unbounded volume (never culled)
+    float radius = -1.f;
+
+    bool isBounded() const { return radius >= 0.f; }
+
+    /// @brief Transform the sphere by a model matrix. The radius is scaled by
+    /// the largest axis scale, so the result stays conservative under non
+    /// uniform scaling.
+    BoundingSphere transformed(const glm::mat4& model) const {
+        if (!isBounded()) return *this;
+
+        float scaleX = glm::dot(glm::vec3(model[0]), glm::vec3(model[0]));
+        float scaleY = glm::dot(glm::vec3(model[1]), glm::vec3(model[1]));
+        float scaleZ = glm::dot(glm::vec3(model[2]), glm::vec3(model[2]));
+        float maxScale = glm::sqrt(std::max(scaleX, std::max(scaleY, scaleZ)));
+
+        BoundingSphere out;
+        out.center = glm::vec3(model * glm::vec4(center, 1.f));
+        out.radius = radius * maxScale;
+        return out;
+    }
+};
+
+}  // namespace rendering
+}  // namespace v3d
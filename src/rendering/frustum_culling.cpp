@@ -0,0 +1,135 @@
+#include "frustum_culling.h"
+
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define V3D_FRUSTUM_CULLING_SSE
+#include <emmintrin.h>
+#endif
+
+namespace v3d {
+namespace rendering {
+
+Frustum Frustum::fromMatrix(const glm::mat4& m) {
+    // glm is column major, m[col][row]
+    auto row = [&m](int i) { return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]); };
+
+    Frustum frustum;
+    frustum.planes[0] = row(3) + row(0);  // left
+    frustum.planes[1] = row(3) - row(0);  // right
+    frustum.planes[2] = row(3) + row(1);  // bottom
+    frustum.planes[3] = row(3) - row(1);  // top
+    frustum.planes[4] = row(3) + row(2);  // near
+    frustum.planes[5] = row(3) - row(2);  // far
+
+    for (auto& plane : frustum.planes) {
+        float length = glm::length(glm::vec3(plane));
+        if (length > 0.f) plane /= length;
+    }
+    return frustum;
+}
+
+bool Frustum::intersects(const BoundingSphere& sphere) const {
+    if (!sphere.isBounded()) return true;
+    for (const auto& plane : planes) {
+        if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius)
+            return false;
+    }
+    return true;
+}
+
+void FrustumCuller::clear() {
+    m_count = 0;
+    m_x.clear();
+    m_y.clear();
+    m_z.clear();
+    m_radius.clear();
+    m_visible.clear();
+}
+
+void FrustumCuller::reserve(size_t count) {
+    size_t padded = (count + 3) & ~size_t(3);
+    m_x.reserve(padded);
+    m_y.reserve(padded);
+    m_z.reserve(padded);
+    m_radius.reserve(padded);
+    m_visible.reserve(padded);
+}
+
+void FrustumCuller::add(const BoundingSphere& sphere) {
+    m_x.push_back(sphere.center.x);
+    m_y.push_back(sphere.center.y);
+    m_z.push_back(sphere.center.z);
+    m_radius.push_back(sphere.isBounded()
+                           ? sphere.radius
+                           : std::numeric_limits<float>::infinity());
+    m_count++;
+}
+
+size_t FrustumCuller::cull(const Frustum& frustum) {
+    // Pad the SoA arrays so the SIMD loop never reads out of bounds
+    size_t padded = (m_count + 3) & ~size_t(3);
+    m_x.resize(padded, 0.f);
+    m_y.resize(padded, 0.f);
+    m_z.resize(padded, 0.f);
+    m_radius.resize(padded, 0.f);
+    m_visible.resize(padded);
+
+    const long long numBlocks = static_cast<long long>(padded / 4);
+
+#pragma omp parallel for if (m_count > ParallelThreshold) schedule(static)
+    for (long long block = 0; block < numBlocks; block++) {
+        cullRange(frustum, static_cast<size_t>(block) * 4,
+                  static_cast<size_t>(block) * 4 + 4);
+    }
+
+    size_t visibleCount = 0;
+    for (size_t i = 0; i < m_count; i++) visibleCount += m_visible[i];
+    return visibleCount;
+}
+
+void FrustumCuller::cullRange(const Frustum& frustum, size_t begin,
+                              size_t end) {
+#ifdef V3D_FRUSTUM_CULLING_SSE
+    for (size_t i = begin; i < end; i += 4) {
+        const __m128 x = _mm_loadu_ps(&m_x[i]);
+        const __m128 y = _mm_loadu_ps(&m_y[i]);
+        const __m128 z = _mm_loadu_ps(&m_z[i]);
+        const __m128 negRadius =
+            _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&m_radius[i]));
+
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (const auto& plane : frustum.planes) {
+            __m128 dist = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)),
+                           _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+                _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)),
+                           _mm_set1_ps(plane.w)));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, negRadius));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        m_visible[i + 0] = (mask >> 0) & 1;
+        m_visible[i + 1] = (mask >> 1) & 1;
+        m_visible[i + 2] = (mask >> 2) & 1;
+        m_visible[i + 3] = (mask >> 3) & 1;
+    }
+#else
+    for (size_t i = begin; i < end; i++) {
+        bool inside = true;
+        for (const auto& plane : frustum.planes) {
+            float dist = plane.x * m_x[i] + plane.y * m_y[i] +
+                         plane.z * m_z[i] + plane.w;
+            if (dist < -m_radius[i]) {
+                inside = false;
+                break;
+            }
+        }
+        m_visible[i] = inside;
+    }
+#endif
+}
+
+}  // namespace rendering
+}  // namespace v3d
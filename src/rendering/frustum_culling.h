@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "rendering/bounding_volume.hpp"
+
+namespace v3d {
+namespace rendering {
+
+/// @brief View frustum described by 6 normalized planes (left, right, bottom,
+/// top, near, far). A point p is inside a plane if dot(n, p) + d >= 0.
+struct Frustum {
+    glm::vec4 planes[6];
+
+    /// @brief Extract the frustum planes from a view-projection matrix
+    /// (Gribb-Hartmann method).
+    static Frustum fromMatrix(const glm::mat4& viewProjection);
+
+    bool intersects(const BoundingSphere& sphere) const;
+};
+
+/// @brief Culls a batch of world space bounding spheres against a frustum.
+/// Spheres are stored as SoA so four of them are tested per SIMD iteration,
+/// large batches are split across threads.
+class FrustumCuller {
+   public:
+    /// @brief Min num of spheres before the test is run in parallel
+    static constexpr size_t ParallelThreshold = 4096;
+
+    void clear();
+    void reserve(size_t count);
+
+    /// @brief Add a sphere to the batch. Unbounded spheres are always visible.
+    void add(const BoundingSphere& sphere);
+
+    size_t size() const { return m_count; }
+
+    /// @brief Run the visibility test for all the spheres of the batch.
+    /// @return Num of visible spheres
+    size_t cull(const Frustum& frustum);
+
+    /// @brief Visibility result of the last cull, indexed in insertion order
+    bool isVisible(size_t index) const { return m_visible[index] != 0; }
+
+   private:
+    size_t m_count = 0;
+    // Padded to a multiple of 4 for the SIMD path
+    std::vector<float> m_x, m_y, m_z, m_radius;
+    std::vector<uint8_t> m_visible;
+
+    void cullRange(const Frustum& frustum, size_t begin, size_t end);
+};
+
+}  // namespace rendering
+}  // namespace v3d
@@ -0,0 +1,256 @@
+#include "geometry_arena.h"
+
+#include <plog/Log.h>
+
+#include <cstring>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+
+#include "rendering/stream_buffer.h"
+#include "rendering/vertex_compression.h"
+
+namespace v3d {
+namespace rendering {
+
+GeometryPool::GeometryPool(size_t index, const VertexLayout& layout,
+                           GLenum indexType, size_t vertexCapacity,
+                           size_t indexCapacity, GLuint instanceBuffer)
+    : m_index(index),
+      m_layout(layout),
+      m_indexType(indexType),
+      m_indexSize(indexTypeSize(indexType)),
+      m_vertexCapacity(vertexCapacity),
+      m_indexCapacity(indexCapacity) {
+    glGenVertexArrays(1, &m_VAO);
+    glGenBuffers(1, &m_VBO);
+    glGenBuffers(1, &m_EBO);
+
+    glBindVertexArray(m_VAO);
+
+    // Reserve the storage, meshes are uploaded with glBufferSubData
+    glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+    glBufferData(GL_ARRAY_BUFFER, m_vertexCapacity * m_layout.stride, nullptr,
+                 GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indexCapacity * m_indexSize,
+                 nullptr, GL_STATIC_DRAW);
+
+    for (auto vAttribute : m_layout.attributes) {
+        glVertexAttribPointer(vAttribute.location, vAttribute.components,
+                              vAttribute.glType, vAttribute.normalized,
+                              m_layout.stride,
+                              reinterpret_cast<const void*>(vAttribute.offset));
+        glEnableVertexAttribArray(vAttribute.location);
+    }
+
+    // Per draw data, fetched with baseInstance of each indirect command
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    for (GLuint i = 0; i < 4; i++) {
+        GLuint location = InstanceAttributeLocation + i;
+        glVertexAttribPointer(
+            location, 4, GL_FLOAT, GL_FALSE, sizeof(DrawInstanceData),
+            reinterpret_cast<const void*>(offsetof(DrawInstanceData, model) +
+                                          i * sizeof(glm::vec4)));
+        glVertexAttribDivisor(location, 1);
+        glEnableVertexAttribArray(location);
+    }
+    for (GLuint i = 0; i < 3; i++) {
+        GLuint location = InstanceAttributeLocation + 4 + i;
+        glVertexAttribPointer(
+            location, 3, GL_FLOAT, GL_FALSE, sizeof(DrawInstanceData),
+            reinterpret_cast<const void*>(
+                offsetof(DrawInstanceData, normalMatrix) +
+                i * sizeof(glm::vec3)));
+        glVertexAttribDivisor(location, 1);
+        glEnableVertexAttribArray(location);
+    }
+    glVertexAttribIPointer(
+        MaterialIndexLocation, 1, GL_UNSIGNED_INT, sizeof(DrawInstanceData),
+        reinterpret_cast<const void*>(
+            offsetof(DrawInstanceData, materialIndex)));
+    glVertexAttribDivisor(MaterialIndexLocation, 1);
+    glEnableVertexAttribArray(MaterialIndexLocation);
+
+    glBindVertexArray(0);
+
+    PLOGD << "Geometry pool " << m_index << " created: " << m_vertexCapacity
+          << " vertices (stride " << m_layout.stride << "), "
+          << m_indexCapacity << " indices of " << m_indexSize << " bytes\n";
+}
+
+GeometryPool::~GeometryPool() {
+    glDeleteVertexArrays(1, &m_VAO);
+    glDeleteBuffers(1, &m_VBO);
+    glDeleteBuffers(1, &m_EBO);
+}
+
+GeometryAllocation GeometryPool::allocate(const void* vertexData,
+                                          size_t numVertices,
+                                          const void* indices,
+                                          size_t numIndices) {
+    assert(canFit(numVertices, numIndices) && "Geometry pool overflow");
+
+    GeometryAllocation allocation;
+    allocation.pool = this;
+    allocation.baseVertex = static_cast<GLint>(m_numVertices);
+    allocation.firstIndex = static_cast<GLuint>(m_numIndices);
+    allocation.numIndices = static_cast<GLuint>(numIndices);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+    glBufferSubData(GL_ARRAY_BUFFER, m_numVertices * m_layout.stride,
+                    numVertices * m_layout.stride, vertexData);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // The element buffer binding is part of the VAO state
+    glBindVertexArray(m_VAO);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, m_numIndices * m_indexSize,
+                    numIndices * m_indexSize, indices);
+    glBindVertexArray(0);
+
+    m_numVertices += numVertices;
+    m_numIndices += numIndices;
+    return allocation;
+}
+
+GeometryArena::GeometryArena(StreamBuffer* streamBuffer)
+    : m_streamBuffer(streamBuffer) {
+    assert(m_streamBuffer != nullptr && "GeometryArena requires a stream buffer");
+}
+
+GeometryAllocation GeometryArena::allocate(const VertexLayout& layout,
+                                           const void* vertexData,
+                                           size_t numVertices,
+                                           const void* indices,
+                                           size_t numIndices,
+                                           GLenum indexType) {
+    GeometryPool* pool = nullptr;
+    for (auto& candidate : m_pools) {
+        if (candidate->getLayout() == layout &&
+            candidate->getIndexType() == indexType &&
+            candidate->canFit(numVertices, numIndices)) {
+            pool = candidate.get();
+            break;
+        }
+    }
+
+    if (pool == nullptr) {
+        m_pools.push_back(std::make_unique<GeometryPool>(
+            m_pools.size(), layout, indexType,
+            std::max(DefaultPoolVertices, numVertices),
+            std::max(DefaultPoolIndices, numIndices),
+            m_streamBuffer->getBuffer()));
+        pool = m_pools.back().get();
+    }
+
+    return pool->allocate(vertexData, numVertices, indices, numIndices);
+}
+
+void GeometryArena::clearDraws() {
+    for (auto& [key, batch] : m_batches) {
+        batch.commands.clear();
+        batch.instances.clear();
+    }
+    m_numDraws = 0;
+    m_instances.clear();
+    m_flatCommands.clear();
+}
+
+void GeometryArena::addDraw(const MeshOpenGL* mesh, const glm::mat4& model,
+                            Shader* program, GLuint materialIndex) {
+    assert(mesh->isArenaAllocated() && "Mesh not allocated in the arena");
+    DrawBatch& batch = m_batches[{program, mesh->getPool()->getIndex()}];
+
+    DrawElementsIndirectCommand command;
+    command.count = static_cast<GLuint>(mesh->getNumIndices());
+    command.instanceCount = 1;
+    command.firstIndex = mesh->getFirstIndex();
+    command.baseVertex = mesh->getBaseVertex();
+    command.baseInstance = 0;  // Assigned on submit
+    batch.commands.push_back(command);
+
+    batch.instances.push_back(
+        {model * mesh->getVertexTransform(),
+         glm::transpose(glm::inverse(glm::mat3(model))), materialIndex});
+    m_numDraws++;
+}
+
+void GeometryArena::submitDraws(
+    const std::function<void(Shader*)>& bindProgram) {
+    m_numMultiDraws = 0;
+    if (m_numDraws == 0) return;
+
+    // Instance data is aligned to its own size so the region offset maps to
+    // a whole instance index
+    StreamBuffer::Allocation instanceAlloc = m_streamBuffer->allocate(
+        m_numDraws * sizeof(DrawInstanceData), sizeof(DrawInstanceData));
+    StreamBuffer::Allocation commandAlloc = m_streamBuffer->allocate(
+        m_numDraws * sizeof(DrawElementsIndirectCommand),
+        sizeof(DrawElementsIndirectCommand));
+    if (!instanceAlloc.isValid() || !commandAlloc.isValid()) return;
+
+    const GLuint firstInstance =
+        static_cast<GLuint>(instanceAlloc.offset / sizeof(DrawInstanceData));
+
+    // Flatten the batches so every one draws a contiguous range of the
+    // indirect buffer, and point each command to its instance data
+    struct BatchRange {
+        Shader* program;
+        size_t pool, first, count;
+    };
+    std::vector<BatchRange> ranges;
+    for (auto& [key, batch] : m_batches) {
+        if (batch.commands.empty()) continue;
+        ranges.push_back({key.first, key.second, m_flatCommands.size(),
+                          batch.commands.size()});
+        for (size_t i = 0; i < batch.commands.size(); i++) {
+            DrawElementsIndirectCommand command = batch.commands[i];
+            command.baseInstance =
+                firstInstance + static_cast<GLuint>(m_instances.size());
+            m_flatCommands.push_back(command);
+            m_instances.push_back(batch.instances[i]);
+        }
+    }
+
+    std::memcpy(instanceAlloc.data, m_instances.data(), instanceAlloc.size);
+    std::memcpy(commandAlloc.data, m_flatCommands.data(), commandAlloc.size);
+    m_streamBuffer->flush();
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_streamBuffer->getBuffer());
+
+    for (size_t r = 0; r < ranges.size(); r++) {
+        const BatchRange& range = ranges[r];
+        if (r == 0 || range.program != ranges[r - 1].program)
+            bindProgram(range.program);
+
+        const GeometryPool& pool = *m_pools[range.pool];
+        glBindVertexArray(pool.getVAO());
+        glMultiDrawElementsIndirect(
+            GL_TRIANGLES, pool.getIndexType(),
+            reinterpret_cast<const void*>(
+                commandAlloc.offset +
+                range.first * sizeof(DrawElementsIndirectCommand)),
+            static_cast<GLsizei>(range.count), 0);
+        m_numMultiDraws++;
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+size_t GeometryArena::getUsedBytes() const {
+    size_t bytes = 0;
+    for (auto& pool : m_pools) bytes += pool->getUsedBytes();
+    return bytes;
+}
+
+size_t GeometryArena::getCapacityBytes() const {
+    size_t bytes = 0;
+    for (auto& pool : m_pools) bytes += pool->getCapacityBytes();
+    return bytes;
+}
+
+}  // namespace rendering
+}  // namespace v3d
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "Mesh.h"
+#include "glm/glm.hpp"
+
+class Shader;
+
+namespace v3d {
+namespace rendering {
+
+class GeometryPool;
+class StreamBuffer;
+
+/// @brief Region of a GeometryPool owned by a mesh
+struct GeometryAllocation {
+    GeometryPool* pool = nullptr;
+    GLint baseVertex = 0;
+    GLuint firstIndex = 0;
+    GLuint numIndices = 0;
+
+    bool isValid() const { return pool != nullptr; }
+};
+
+/// @brief Command layout consumed by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+/// @brief Per draw data read by the indirect shaders as instanced attributes
+struct DrawInstanceData {
+    glm::mat4 model;
+    glm::mat3 normalMatrix;
+    GLuint materialIndex;  // Record in the material buffer of the program
+};
+
+/**
+ * @brief Large vertex/index buffers shared by all the meshes with the same
+ * VertexLayout and index type. Meshes are bump allocated and never released individually,
+ * the storage lives as long as the arena.
+ *
+ * The VAO sources the per draw instance data from the stream buffer, the
+ * indirect commands point to it through baseInstance.
+ */
+class GeometryPool {
+   public:
+    /// @brief First attribute location used by the per draw instance data
+    static constexpr GLuint InstanceAttributeLocation = 8;
+    /// @brief Integer attribute holding DrawInstanceData::materialIndex
+    static constexpr GLuint MaterialIndexLocation = 15;
+
+    GeometryPool(size_t index, const VertexLayout& layout, GLenum indexType,
+                 size_t vertexCapacity, size_t indexCapacity,
+                 GLuint instanceBuffer);
+    ~GeometryPool();
+
+    GeometryPool(const GeometryPool&) = delete;
+    GeometryPool& operator=(const GeometryPool&) = delete;
+
+    bool canFit(size_t numVertices, size_t numIndices) const {
+        return m_numVertices + numVertices <= m_vertexCapacity &&
+               m_numIndices + numIndices <= m_indexCapacity;
+    }
+
+    /// @param indices Indices of the pool index type
+    GeometryAllocation allocate(const void* vertexData, size_t numVertices,
+                                const void* indices, size_t numIndices);
+
+    /// @brief Index of the pool inside its arena
+    size_t getIndex() const { return m_index; }
+    const VertexLayout& getLayout() const { return m_layout; }
+    GLenum getIndexType() const { return m_indexType; }
+    GLuint getVAO() const { return m_VAO; }
+    GLuint getVBO() const { return m_VBO; }
+    GLuint getEBO() const { return m_EBO; }
+    size_t getUsedBytes() const {
+        return m_numVertices * m_layout.stride + m_numIndices * m_indexSize;
+    }
+    size_t getCapacityBytes() const {
+        return m_vertexCapacity * m_layout.stride +
+               m_indexCapacity * m_indexSize;
+    }
+
+   private:
+    size_t m_index = 0;
+    VertexLayout m_layout;
+    GLenum m_indexType = GL_UNSIGNED_INT;
+    size_t m_indexSize = sizeof(GLuint);
+    GLuint m_VAO = 0, m_VBO = 0, m_EBO = 0;
+    size_t m_vertexCapacity = 0, m_indexCapacity = 0;
+    size_t m_numVertices = 0, m_numIndices = 0;
+};
+
+/**
+ * @brief Suballocates mesh geometry from a few large GL buffers grouped by
+ * VertexLayout, so meshes sharing a layout can be submitted together with a
+ * single glMultiDrawElementsIndirect call.
+ */
+class GeometryArena {
+   public:
+    /// @brief Default pool size, bigger meshes get a pool of their own size
+    static constexpr size_t DefaultPoolVertices = 1 << 18;
+    static constexpr size_t DefaultPoolIndices = 3 << 18;
+
+    /// @param streamBuffer Per frame buffer used for the instance data and the
+    /// indirect commands. Must outlive the arena.
+    explicit GeometryArena(StreamBuffer* streamBuffer);
+    ~GeometryArena() = default;
+
+    GeometryArena(const GeometryArena&) = delete;
+    GeometryArena& operator=(const GeometryArena&) = delete;
+
+    /// @brief Upload the geometry of a mesh into a pool with matching layout
+    /// and index type
+    /// @param indexType GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    GeometryAllocation allocate(const VertexLayout& layout,
+                                const void* vertexData, size_t numVertices,
+                                const void* indices, size_t numIndices,
+                                GLenum indexType = GL_UNSIGNED_INT);
+
+    // Per frame indirect draw submission
+
+    void clearDraws();
+    /// @brief Record a draw of an arena allocated mesh, the mesh vertex
+    /// transform is applied before model
+    /// @param program Program drawing the mesh, nullptr for the default one
+    /// @param materialIndex Index of the material record read by program
+    void addDraw(const MeshOpenGL* mesh, const glm::mat4& model,
+                 Shader* program = nullptr, GLuint materialIndex = 0);
+    /// @brief Write the recorded draws into the stream buffer and issue one
+    /// multi draw per program and pool
+    /// @param bindProgram Called before the draws of each program, with
+    /// nullptr for the draws recorded without program
+    void submitDraws(const std::function<void(Shader*)>& bindProgram);
+
+    size_t getNumPools() const { return m_pools.size(); }
+    size_t getNumDraws() const { return m_numDraws; }
+    /// @brief Num of glMultiDrawElementsIndirect calls of the last submit
+    size_t getNumMultiDraws() const { return m_numMultiDraws; }
+    size_t getUsedBytes() const;
+    size_t getCapacityBytes() const;
+
+   private:
+    std::vector<std::unique_ptr<GeometryPool>> m_pools;
+
+    struct DrawBatch {
+        std::vector<DrawElementsIndirectCommand> commands;
+        std::vector<DrawInstanceData> instances;
+    };
+
+    // Per frame draw lists, bucketed by program and pool index. Ordered so
+    // the draws of a program are submitted together. Buckets are kept
+    // between frames to reuse their storage.
+    std::map<std::pair<Shader*, size_t>, DrawBatch> m_batches;
+    size_t m_numDraws = 0;
+    std::vector<DrawInstanceData> m_instances;
+    std::vector<DrawElementsIndirectCommand> m_flatCommands;
+    size_t m_numMultiDraws = 0;
+
+    StreamBuffer* m_streamBuffer = nullptr;
+};
+
+}  // namespace rendering
+}  // namespace v3d
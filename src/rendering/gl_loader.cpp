@@ -0,0 +1,24 @@
+#include "gl_loader.h"
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+namespace {
+void* glfwProcLoader(const char* name) {
+    return reinterpret_cast<void*>(glfwGetProcAddress(name));
+}
+
+v3d::rendering::GLProcLoader s_loader = glfwProcLoader;
+}  // namespace
+
+namespace v3d {
+namespace rendering {
+
+void setGLProcLoader(GLProcLoader loader) {
+    s_loader = loader != nullptr ? loader : glfwProcLoader;
+}
+
+void* getGLProcAddress(const char* name) { return s_loader(name); }
+
+}  // namespace rendering
+}  // namespace v3d
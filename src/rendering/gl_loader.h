@@ -0,0 +1,17 @@
+#pragma once
+
+namespace v3d {
+namespace rendering {
+
+/// @brief Function used to resolve GL entry points of the current context
+using GLProcLoader = void* (*)(const char* name);
+
+/// @brief Override the GL entry point loader, needed for contexts not created
+/// by GLFW (e.g. EGL surfaceless). Defaults to glfwGetProcAddress.
+void setGLProcLoader(GLProcLoader loader);
+
+/// @brief Resolve a GL entry point with the current loader
+void* getGLProcAddress(const char* name);
+
+}  // namespace rendering
+}  // namespace v3d
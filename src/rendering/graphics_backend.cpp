@@ -1,7 +1,114 @@
 #include "graphics_backend.h"
 
+#include <glm/gtc/matrix_transform.hpp>
+#include <limits>
+
+#include "Mesh.h"
+#include "imgui.h"
+#include "rendering/render_thread.h"
+#include "window.h"
+
 void v3d::rendering::GraphicsBackend::update() {
     frameUpdate();
     drawGizmos();
 }
 void v3d::rendering::GraphicsBackend::present() { presentFrame(); }
+
+void v3d::rendering::GraphicsBackend::runOnRenderThread(
+    const std::function<void()>& work) {
+    if (m_renderThread != nullptr)
+        m_renderThread->runSync(work);
+    else
+        work();
+}
+
+glm::mat4 v3d::rendering::GraphicsBackend::getCameraProjection() const {
+    float aspect = m_window != nullptr && m_window->getHeight() > 0
+                       ? 1.f * m_window->getWidth() / m_window->getHeight()
+                       : 16.f / 9.f;
+    return glm::perspective(glm::radians(m_camera.Zoom), aspect, 0.1f,
+                            100.0f);
+}
+
+void v3d::rendering::GraphicsBackend::cullRenderTargets(
+    const glm::mat4& viewProjection,
+    const std::vector<IRenderable*>& renderTargets) {
+    m_visibleRenderTargets.clear();
+
+    m_worldSpheres.clear();
+    m_worldSpheres.reserve(renderTargets.size());
+    for (auto renderTarget : renderTargets) {
+        const Mesh* mesh = renderTarget->getRenderMesh();
+        if (mesh == nullptr) {
+            m_worldSpheres.emplace_back();  // Unbounded, always visible
+            continue;
+        }
+        m_worldSpheres.push_back(mesh->getBoundingSphere().transformed(
+            renderTarget->getModelMatrix()));
+    }
+
+    if (!m_frustumCullingEnabled) {
+        m_visibleRenderTargets = renderTargets;
+        m_cullingStats = {renderTargets.size(), 0, renderTargets.size()};
+    } else {
+        m_culler.clear();
+        m_culler.reserve(m_worldSpheres.size());
+        for (const auto& sphere : m_worldSpheres) m_culler.add(sphere);
+
+        m_culler.cull(Frustum::fromMatrix(viewProjection));
+
+        for (size_t i = 0; i < renderTargets.size(); i++) {
+            if (m_culler.isVisible(i))
+                m_visibleRenderTargets.push_back(renderTargets[i]);
+            else
+                m_worldSpheres[i].radius = -1.f;  // Skipped by the LOD pass
+        }
+
+        m_cullingStats.total = renderTargets.size();
+        m_cullingStats.drawn = m_visibleRenderTargets.size();
+        m_cullingStats.culled = m_cullingStats.total - m_cullingStats.drawn;
+    }
+
+    selectRenderTargetLods(viewProjection, renderTargets);
+}
+
+void v3d::rendering::GraphicsBackend::selectRenderTargetLods(
+    const glm::mat4& viewProjection,
+    const std::vector<IRenderable*>& renderTargets) {
+    m_cullingStats.reducedLod = 0;
+
+    // Pixels per unit of clip space y at w = 1: the y row of the projection
+    // scaled by half the viewport height. The view rotation keeps its length.
+    const float height = m_window != nullptr
+                             ? static_cast<float>(m_window->getHeight())
+                             : 1080.f;
+    const float pixelScale =
+        glm::length(glm::vec3(viewProjection[0][1], viewProjection[1][1],
+                              viewProjection[2][1])) *
+        height * 0.5f;
+
+    for (size_t i = 0; i < renderTargets.size(); i++) {
+        const BoundingSphere& sphere = m_worldSpheres[i];
+        if (!sphere.isBounded()) continue;
+
+        // Full resolution when the camera is inside the sphere
+        float w = (viewProjection * glm::vec4(sphere.center, 1.f)).w;
+        float screenRadius =
+            w > sphere.radius ? sphere.radius * pixelScale / w
+                              : std::numeric_limits<float>::max();
+
+        if (renderTargets[i]->selectLod(screenRadius, m_lodSelection) > 0)
+            m_cullingStats.reducedLod++;
+    }
+}
+
+void v3d::rendering::GraphicsBackend::renderDebbugGUI() {
+    ImGui::Checkbox("Frustum Culling", &m_frustumCullingEnabled);
+    ImGui::Text("Render targets: %zu", m_cullingStats.total);
+    ImGui::Text("Drawn: %zu  Culled: %zu", m_cullingStats.drawn,
+                m_cullingStats.culled);
+    ImGui::Checkbox("LOD Selection", &m_lodSelection.enabled);
+    ImGui::SliderFloat("LOD Pixel Error", &m_lodSelection.maxPixelError, 0.1f,
+                       16.f, "%.1f px");
+    ImGui::Text("Reduced LOD: %zu", m_cullingStats.reducedLod);
+}
@@ -1,9 +1,12 @@
 #pragma once
 
 #include <algorithm>
+#include <functional>
 #include <string>
 #include <vector>
 
+#include "camera.hpp"
+#include "rendering/frustum_culling.h"
 #include "rendering/primitives.hpp"
 #include "rendering/rendering_def.h"
 #include "window.h"
@@ -13,6 +16,20 @@ class Mesh;
 class Engine;
 
 namespace rendering {
+class GeometryArena;
+class ShaderVariantSet;
+class RenderThread;
+struct RenderSnapshot;
+
+/// @brief Frustum culling results of the last frame
+struct CullingStats {
+    size_t total = 0;
+    size_t culled = 0;
+    size_t drawn = 0;
+    // Drawn targets using a simplified level of detail
+    size_t reducedLod = 0;
+};
+
 class GraphicsBackend {
     friend class Engine;
 
@@ -28,6 +45,37 @@ class GraphicsBackend {
 
     virtual Mesh* createMesh(std::string filePath) = 0;
 
+    /// @brief Shared geometry storage for meshes drawn with multi-draw
+    /// indirect. Null if the backend does not support it.
+    virtual GeometryArena* getGeometryArena() { return nullptr; }
+
+    /// @brief Compile time variants of a single file shader, loaded once per
+    /// path. Null if the backend does not support them.
+    virtual ShaderVariantSet* getShaderVariants(const std::string& shaderPath) {
+        return nullptr;
+    }
+
+    // Render thread. The frame is split in captureFrame, run by the game
+    // thread without any graphics API call, and renderFrame, run by the
+    // thread owning the context. update() does both on the calling thread.
+
+    /// @brief Whether captureFrame/renderFrame are implemented
+    virtual bool supportsRenderThread() const { return false; }
+    /// @brief Record the frame into the snapshot: camera, visible render
+    /// targets, material changes and gizmos
+    virtual void captureFrame(RenderSnapshot& snapshot) {}
+    /// @brief Draw a snapshot, the GUI and the presentation are left to the
+    /// caller
+    virtual void renderFrame(RenderSnapshot& snapshot) {}
+    /// @brief Set while a render thread owns the context
+    void setRenderThread(RenderThread* renderThread) {
+        m_renderThread = renderThread;
+    }
+    /// @brief Run work needing the graphics context from the game thread.
+    /// With a render thread it runs there after the frames already
+    /// submitted, blocking until done.
+    void runOnRenderThread(const std::function<void()>& work);
+
     /**
      * @brief Registers a render target object to the list of render targets.
      *
@@ -84,17 +132,59 @@ class GraphicsBackend {
         m_immediateGgizmosTargets.push_back(std::move(gizmosTarget));
     }
 
+    const CullingStats& getCullingStats() const { return m_cullingStats; }
+
+    /// @brief Camera the frames are rendered and culled from
+    Camera& getCamera() { return m_camera; }
+
+    virtual void renderDebbugGUI();
+
     GizmosManager* gizmos;
     MeshPrimitives m_primitives;  // FIXME: Make private/protected
 
    protected:
     Window* m_window = nullptr;
+    RenderThread* m_renderThread = nullptr;
+
+    Camera m_camera = Camera(glm::vec3(0, 2.5, 10));
+    glm::mat4 getCameraView() { return m_camera.GetViewMatrix(); }
+    /// @brief Perspective projection of the camera, with the aspect ratio of
+    /// the window (16:9 without window)
+    glm::mat4 getCameraProjection() const;
 
     std::vector<IRenderable*> m_renderTargets;
+    // Render targets that passed the culling of the current frame
+    std::vector<IRenderable*> m_visibleRenderTargets;
     std::vector<IGizmosRenderable*> m_gizmosTargets;
     // Internal storage of immediate render targets
     std::vector<std::unique_ptr<IGizmosRenderable>> m_immediateGgizmosTargets;
 
+    bool m_frustumCullingEnabled = true;
+    CullingStats m_cullingStats;
+    FrustumCuller m_culler;
+    // World bounding sphere of each render target, unbounded when culled
+    std::vector<BoundingSphere> m_worldSpheres;
+    LodSelection m_lodSelection;
+
+    /**
+     * @brief Fills m_visibleRenderTargets with the render targets whose world
+     * space bounding sphere intersects the view frustum, then selects their
+     * level of detail.
+     *
+     * @param viewProjection Camera view-projection matrix of the frame.
+     */
+    void cullRenderTargets(const glm::mat4& viewProjection) {
+        cullRenderTargets(viewProjection, m_renderTargets);
+    }
+    /// @param renderTargets Targets drawn this frame, when the backend
+    /// replaces some of the registered ones (e.g. static batches)
+    void cullRenderTargets(const glm::mat4& viewProjection,
+                           const std::vector<IRenderable*>& renderTargets);
+    /// @brief Let the visible render targets pick their level of detail
+    /// from their projected bounding sphere radius
+    void selectRenderTargetLods(const glm::mat4& viewProjection,
+                                const std::vector<IRenderable*>& renderTargets);
+
     virtual void initPrimitives() = 0;
 
     virtual void frameUpdate() = 0;
@@ -120,7 +210,8 @@ class GraphicsBackend {
 
     // Primitive draw
     virtual void drawPrimitivePoint(glm::vec3 a, float size, glm::vec4 color) {};
-    virtual void drawPrimitiveLine(glm::vec3 a, glm::vec3 b, float size, glm::vec4 color) {};
+    /// @brief Lines are 1 pixel wide
+    virtual void drawPrimitiveLine(glm::vec3 a, glm::vec3 b, glm::vec4 color) {};
     virtual void drawPrimitiveCube(glm::vec3 position, glm::vec3 scale,
                                      glm::vec4 color,
                                      bool wireframe = false) {};
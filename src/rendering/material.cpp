@@ -0,0 +1,161 @@
+#include "material.h"
+
+#include <cstring>
+
+#include "imgui.h"
+#include "rendering/shader.h"
+
+namespace v3d {
+namespace rendering {
+
+Material::Material(const std::string& name, ShaderVariantSet* shader)
+    : Asset(shader->getShaderPath(), name), m_shader(shader) {
+    const MaterialLayout& layout = m_shader->getMaterialLayout();
+    m_data.resize(layout.getStride(), 0);
+
+    // Colors default to white, everything else to zero
+    for (const auto& parameter : layout.getParameters()) {
+        if (parameter.type == MaterialParameterType::VEC4)
+            setVector(parameter.name, glm::vec4(1.f));
+    }
+}
+
+void Material::setKey(ShaderVariantKey key) {
+    if (key == m_variantKey) return;
+    m_variantKey = key;
+    m_variant = nullptr;
+    m_indirectVariant = nullptr;
+}
+
+void Material::setKeyword(const std::string& name, bool enabled) {
+    setKey(m_shader->setKeyword(m_variantKey, name, enabled));
+}
+
+void Material::setKeyword(const std::string& name, const std::string& value) {
+    setKey(m_shader->setKeyword(m_variantKey, name, value));
+}
+
+Shader* Material::getShader(bool indirect) {
+    if (indirect) {
+        if (m_indirectVariant == nullptr)
+            m_indirectVariant = m_shader->getVariant(
+                m_variantKey | ShaderVariantSet::IndirectDrawBit);
+        return m_indirectVariant;
+    }
+
+    if (m_variant == nullptr) m_variant = m_shader->getVariant(m_variantKey);
+    return m_variant;
+}
+
+unsigned char* Material::parameterData(const std::string& name,
+                                       MaterialParameterType type) {
+    const MaterialParameter* parameter =
+        m_shader->getMaterialLayout().find(name);
+    if (parameter == nullptr || parameter->type != type) {
+        PLOGW << "Material " << assetName << ": unknown parameter " << name
+              << "\n";
+        return nullptr;
+    }
+    m_dirty = true;
+    return m_data.data() + parameter->offset;
+}
+
+void Material::setFloat(const std::string& name, float value) {
+    unsigned char* data = parameterData(name, MaterialParameterType::FLOAT);
+    if (data != nullptr) std::memcpy(data, &value, sizeof(value));
+}
+
+void Material::setInt(const std::string& name, int32_t value) {
+    unsigned char* data = parameterData(name, MaterialParameterType::INT);
+    if (data != nullptr) std::memcpy(data, &value, sizeof(value));
+}
+
+void Material::setVector(const std::string& name, const glm::vec2& value) {
+    unsigned char* data = parameterData(name, MaterialParameterType::VEC2);
+    if (data != nullptr) std::memcpy(data, &value, sizeof(value));
+}
+
+void Material::setVector(const std::string& name, const glm::vec3& value) {
+    unsigned char* data = parameterData(name, MaterialParameterType::VEC3);
+    if (data != nullptr) std::memcpy(data, &value, sizeof(value));
+}
+
+void Material::setVector(const std::string& name, const glm::vec4& value) {
+    unsigned char* data = parameterData(name, MaterialParameterType::VEC4);
+    if (data != nullptr) std::memcpy(data, &value, sizeof(value));
+}
+
+float Material::getFloat(const std::string& name) const {
+    const MaterialParameter* parameter =
+        m_shader->getMaterialLayout().find(name);
+    if (parameter == nullptr || parameter->type != MaterialParameterType::FLOAT)
+        return 0.f;
+    float value;
+    std::memcpy(&value, m_data.data() + parameter->offset, sizeof(value));
+    return value;
+}
+
+glm::vec4 Material::getVector(const std::string& name) const {
+    const MaterialParameter* parameter =
+        m_shader->getMaterialLayout().find(name);
+    if (parameter == nullptr) return glm::vec4(0.f);
+
+    glm::vec4 value(0.f);
+    size_t size = std::min<size_t>(parameter->size, sizeof(value));
+    std::memcpy(&value, m_data.data() + parameter->offset, size);
+    return value;
+}
+
+void Material::drawEditorGUI_Properties() {
+    Asset::drawEditorGUI_Properties();
+
+    for (const auto& parameter : m_shader->getMaterialLayout().getParameters()) {
+        void* data = m_data.data() + parameter.offset;
+        bool changed = false;
+        switch (parameter.type) {
+            case MaterialParameterType::FLOAT:
+                changed = ImGui::DragFloat(parameter.name.c_str(),
+                                           static_cast<float*>(data), 0.01f);
+                break;
+            case MaterialParameterType::INT:
+                changed = ImGui::DragInt(parameter.name.c_str(),
+                                         static_cast<int*>(data));
+                break;
+            case MaterialParameterType::VEC2:
+                changed = ImGui::DragFloat2(parameter.name.c_str(),
+                                            static_cast<float*>(data), 0.01f);
+                break;
+            case MaterialParameterType::VEC3:
+                changed = ImGui::DragFloat3(parameter.name.c_str(),
+                                            static_cast<float*>(data), 0.01f);
+                break;
+            case MaterialParameterType::VEC4:
+                changed = ImGui::ColorEdit4(parameter.name.c_str(),
+                                            static_cast<float*>(data));
+                break;
+        }
+        if (changed) m_dirty = true;
+    }
+
+    for (const auto& keyword : m_shader->getKeywords()) {
+        uint64_t value = (m_variantKey & keyword.mask()) >> keyword.offset;
+        if (keyword.isBool()) {
+            bool enabled = value != 0;
+            if (ImGui::Checkbox(keyword.name.c_str(), &enabled))
+                setKeyword(keyword.name, enabled);
+            continue;
+        }
+        if (value >= keyword.values.size()) value = 0;
+        if (ImGui::BeginCombo(keyword.name.c_str(),
+                              keyword.values[value].c_str())) {
+            for (size_t i = 0; i < keyword.values.size(); i++) {
+                if (ImGui::Selectable(keyword.values[i].c_str(), i == value))
+                    setKeyword(keyword.name, keyword.values[i]);
+            }
+            ImGui::EndCombo();
+        }
+    }
+}
+
+}  // namespace rendering
+}  // namespace v3d
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "asset.h"
+#include "glm/glm.hpp"
+#include "rendering/shader_variants.h"
+
+class Shader;
+
+namespace v3d {
+namespace rendering {
+
+/**
+ * @brief Material asset: the shader variant used to draw a render target and
+ * its parameters.
+ *
+ * The parameters follow the MaterialLayout of the shader, so a material can
+ * be copied as is into the shared material buffer and the draws only carry
+ * its index. Keywords select a compile time variant of the shader, resolved
+ * lazily and kept until a keyword changes.
+ */
+class Material : public Asset {
+   public:
+    static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+    /// @param shader Variants of the material shader, must outlive the
+    /// material. Shaders without the material inputs (SimpleShader...) are
+    /// rejected when compiled and the material draws with the default shader,
+    /// see ShaderVariantSet::getVariant
+    Material(const std::string& name, ShaderVariantSet* shader);
+
+    void setKeyword(const std::string& name, bool enabled);
+    void setKeyword(const std::string& name, const std::string& value);
+
+    /// @brief Set a parameter, ignored if the shader does not declare it
+    /// with a matching type
+    void setFloat(const std::string& name, float value);
+    void setInt(const std::string& name, int32_t value);
+    void setVector(const std::string& name, const glm::vec2& value);
+    void setVector(const std::string& name, const glm::vec3& value);
+    void setVector(const std::string& name, const glm::vec4& value);
+
+    float getFloat(const std::string& name) const;
+    glm::vec4 getVector(const std::string& name) const;
+
+    /// @brief Shorthand for the dye_color parameter
+    void setColor(const glm::vec4& color) { setVector("dye_color", color); }
+
+    ShaderVariantSet* getShaderVariants() const { return m_shader; }
+    ShaderVariantKey getVariantKey() const { return m_variantKey; }
+    /// @brief Program of the selected variant, compiled on first use, null
+    /// if the shader is not a material shader
+    /// @param indirect Variant reading the per draw data from instanced
+    /// attributes, used by multi-draw indirect
+    Shader* getShader(bool indirect = false);
+
+    /// @brief Packed parameters, MaterialLayout::getStride() bytes
+    const std::vector<unsigned char>& getData() const { return m_data; }
+    bool isDirty() const { return m_dirty; }
+    void clearDirty() { m_dirty = false; }
+
+    /// @brief Slot in the material buffer of its shader, assigned by the
+    /// backend
+    uint32_t getBufferIndex() const { return m_bufferIndex; }
+    void setBufferIndex(uint32_t index) { m_bufferIndex = index; }
+
+    void drawEditorGUI_Properties() override;
+
+   private:
+    ShaderVariantSet* m_shader = nullptr;
+    ShaderVariantKey m_variantKey = 0;
+    Shader* m_variant = nullptr;          // Resolved variant of m_variantKey
+    Shader* m_indirectVariant = nullptr;  // Same, multi-draw indirect
+
+    std::vector<unsigned char> m_data;
+    bool m_dirty = true;
+    uint32_t m_bufferIndex = InvalidIndex;
+
+    void setKey(ShaderVariantKey key);
+    /// @brief Write pointer of a parameter, null if missing or mismatching
+    unsigned char* parameterData(const std::string& name,
+                                 MaterialParameterType type);
+};
+
+}  // namespace rendering
+}  // namespace v3d
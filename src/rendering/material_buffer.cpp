@@ -0,0 +1,65 @@
+#include "material_buffer.h"
+
+#include <plog/Log.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "rendering/material.h"
+
+namespace v3d {
+namespace rendering {
+
+MaterialBuffer::MaterialBuffer(uint32_t stride) : m_stride(stride) {
+    glGenBuffers(1, &m_buffer);
+}
+
+MaterialBuffer::~MaterialBuffer() { glDeleteBuffers(1, &m_buffer); }
+
+uint32_t MaterialBuffer::getIndex(Material* material) {
+    uint32_t index = material->getBufferIndex();
+    if (index == Material::InvalidIndex) {
+        index = static_cast<uint32_t>(m_numRecords++);
+        material->setBufferIndex(index);
+        m_shadow.resize(std::max(m_shadow.size(), m_numRecords * m_stride));
+    }
+    return index;
+}
+
+void MaterialBuffer::write(uint32_t index,
+                           const std::vector<unsigned char>& data) {
+    std::memcpy(m_shadow.data() + size_t(index) * m_stride, data.data(),
+                std::min<size_t>(data.size(), m_stride));
+
+    m_dirtyBegin = std::min<size_t>(m_dirtyBegin, index);
+    m_dirtyEnd = std::max<size_t>(m_dirtyEnd, index + 1);
+}
+
+void MaterialBuffer::flush() {
+    if (m_dirtyBegin >= m_dirtyEnd) return;
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffer);
+    if (m_numRecords > m_capacity) {
+        // Grow geometrically and upload everything
+        m_capacity = std::max<size_t>(m_numRecords, m_capacity * 2);
+        m_shadow.resize(m_capacity * m_stride);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, m_shadow.size(),
+                     m_shadow.data(), GL_DYNAMIC_DRAW);
+        PLOGV << "Material buffer resized to " << m_capacity << " records\n";
+    } else {
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, m_dirtyBegin * m_stride,
+                        (m_dirtyEnd - m_dirtyBegin) * m_stride,
+                        m_shadow.data() + m_dirtyBegin * m_stride);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    m_dirtyBegin = SIZE_MAX;
+    m_dirtyEnd = 0;
+}
+
+void MaterialBuffer::bind() const {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, Binding, m_buffer);
+}
+
+}  // namespace rendering
+}  // namespace v3d
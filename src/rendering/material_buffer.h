@@ -0,0 +1,57 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace v3d {
+namespace rendering {
+
+class Material;
+
+/**
+ * @brief Shader storage buffer holding the packed parameters of all the
+ * materials of a shader, one record of MaterialLayout::getStride() bytes per
+ * material. Draws reference their material by index so draws with different
+ * parameters don't need any uniform update in between.
+ *
+ * Slots are assigned on first use and never released, materials are
+ * expected to live as long as the backend.
+ */
+class MaterialBuffer {
+   public:
+    /// @brief Binding point of the material SSBO in the material shaders
+    static constexpr GLuint Binding = 0;
+
+    explicit MaterialBuffer(uint32_t stride);
+    ~MaterialBuffer();
+
+    MaterialBuffer(const MaterialBuffer&) = delete;
+    MaterialBuffer& operator=(const MaterialBuffer&) = delete;
+
+    /// @brief Index of the material record, assigning a slot on first use
+    uint32_t getIndex(Material* material);
+    /// @brief Write the parameters of a record, uploaded on the next flush
+    void write(uint32_t index, const std::vector<unsigned char>& data);
+
+    /// @brief Upload the records written since the last flush
+    void flush();
+    void bind() const;
+
+    size_t getNumMaterials() const { return m_numRecords; }
+    uint32_t getStride() const { return m_stride; }
+
+   private:
+    GLuint m_buffer = 0;
+    uint32_t m_stride = 0;
+    size_t m_numRecords = 0;
+    size_t m_capacity = 0;  // Records allocated in the GL buffer
+
+    std::vector<unsigned char> m_shadow;
+    size_t m_dirtyBegin = SIZE_MAX, m_dirtyEnd = 0;  // Records
+};
+
+}  // namespace rendering
+}  // namespace v3d
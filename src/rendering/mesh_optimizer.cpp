@@ -0,0 +1,390 @@
+#include "mesh_optimizer.h"
+
+#include <glad/glad.h>
+#include <plog/Log.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <string_view>
+#include <unordered_map>
+
+#include "glm/glm.hpp"
+
+namespace v3d {
+namespace rendering {
+
+namespace {
+constexpr unsigned int InvalidIndex = ~0u;
+constexpr size_t NoTriangle = SIZE_MAX;
+
+/// @brief FIFO post transform cache model. Timestamps avoid moving entries,
+/// a vertex is cached if it was inserted less than size insertions ago.
+class FifoCache {
+   public:
+    FifoCache(size_t numVertices, unsigned int size)
+        : m_timestamps(numVertices, 0), m_time(size + 1), m_size(size) {}
+
+    /// @return 1 on miss
+    unsigned int access(unsigned int vertex) {
+        if (m_time - m_timestamps[vertex] > m_size) {
+            m_timestamps[vertex] = m_time++;
+            return 1;
+        }
+        return 0;
+    }
+    void reset() { m_time += m_size + 1; }
+
+   private:
+    std::vector<unsigned int> m_timestamps;
+    unsigned int m_time;
+    unsigned int m_size;
+};
+
+// Forsyth's scoring, tuned for a LRU cache of 32 entries
+constexpr size_t ForsythCacheSize = 32;
+constexpr float CacheDecayPower = 1.5f;
+constexpr float LastTriangleScore = 0.75f;
+constexpr float ValenceBoostScale = 2.0f;
+constexpr float ValenceBoostPower = 0.5f;
+
+float forsythScore(int cachePosition, unsigned int remainingTriangles) {
+    if (remainingTriangles == 0) return -1.f;
+
+    float score = 0.f;
+    if (cachePosition >= 0) {
+        // The vertices of the last triangle get a fixed score so the next
+        // triangle doesn't just reuse its edge
+        if (cachePosition < 3) {
+            score = LastTriangleScore;
+        } else {
+            float scaler = 1.f / (ForsythCacheSize - 3);
+            score = std::pow(1.f - (cachePosition - 3) * scaler,
+                             CacheDecayPower);
+        }
+    }
+
+    // Favour the vertices with few triangles left, to finish them off
+    score += ValenceBoostScale *
+             std::pow(static_cast<float>(remainingTriangles),
+                      -ValenceBoostPower);
+    return score;
+}
+}  // namespace
+
+VertexCacheStatistics analyzeVertexCache(const unsigned int* indices,
+                                         size_t numIndices,
+                                         size_t numVertices,
+                                         unsigned int cacheSize) {
+    VertexCacheStatistics stats;
+    if (numIndices < 3 || numVertices == 0) return stats;
+
+    FifoCache cache(numVertices, cacheSize);
+    size_t misses = 0;
+    for (size_t i = 0; i < numIndices; i++) misses += cache.access(indices[i]);
+
+    stats.acmr = static_cast<float>(misses) / (numIndices / 3);
+    stats.atvr = static_cast<float>(misses) / numVertices;
+    return stats;
+}
+
+size_t deduplicateVertices(std::vector<unsigned char>& vertices,
+                           size_t stride, std::vector<unsigned int>& indices) {
+    const size_t numVertices = vertices.size() / stride;
+
+    std::vector<unsigned char> unique;
+    unique.reserve(vertices.size());
+    std::vector<unsigned int> remap(numVertices);
+
+    // The keys point into the source buffer, which outlives the map
+    std::unordered_map<std::string_view, unsigned int> lookup;
+    lookup.reserve(numVertices);
+    for (size_t v = 0; v < numVertices; v++) {
+        std::string_view key(
+            reinterpret_cast<const char*>(vertices.data() + v * stride),
+            stride);
+        auto [it, inserted] = lookup.emplace(
+            key, static_cast<unsigned int>(unique.size() / stride));
+        if (inserted) unique.insert(unique.end(), key.begin(), key.end());
+        remap[v] = it->second;
+    }
+
+    for (auto& index : indices) index = remap[index];
+    vertices.swap(unique);
+    return vertices.size() / stride;
+}
+
+void optimizeVertexCache(std::vector<unsigned int>& indices,
+                         size_t numVertices) {
+    const size_t numTriangles = indices.size() / 3;
+    if (numTriangles == 0) return;
+
+    // Triangles of each vertex, the first remaining[v] are not emitted yet
+    std::vector<unsigned int> offsets(numVertices + 1, 0);
+    for (auto index : indices) offsets[index + 1]++;
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<unsigned int> remaining(numVertices, 0);
+    for (size_t t = 0; t < numTriangles; t++) {
+        for (size_t k = 0; k < 3; k++) {
+            unsigned int v = indices[t * 3 + k];
+            adjacency[offsets[v] + remaining[v]++] =
+                static_cast<unsigned int>(t);
+        }
+    }
+
+    std::vector<float> vertexScore(numVertices);
+    for (size_t v = 0; v < numVertices; v++)
+        vertexScore[v] = forsythScore(-1, remaining[v]);
+
+    auto scoreTriangle = [&](size_t t) {
+        return vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] +
+               vertexScore[indices[t * 3 + 2]];
+    };
+
+    std::vector<bool> emitted(numTriangles, false);
+    size_t best = 0;
+    float bestScore = -1.f;
+    for (size_t t = 0; t < numTriangles; t++) {
+        float score = scoreTriangle(t);
+        if (score > bestScore) {
+            bestScore = score;
+            best = t;
+        }
+    }
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    std::vector<unsigned int> cache, nextCache;
+    cache.reserve(ForsythCacheSize + 3);
+    nextCache.reserve(ForsythCacheSize + 3);
+    size_t cursor = 0;
+
+    for (size_t n = 0; n < numTriangles; n++) {
+        // No candidate around the cache, continue in input order
+        if (best == NoTriangle) {
+            while (emitted[cursor]) cursor++;
+            best = cursor;
+        }
+
+        const unsigned int* triangle = &indices[best * 3];
+        result.insert(result.end(), triangle, triangle + 3);
+        emitted[best] = true;
+
+        for (size_t k = 0; k < 3; k++) {
+            unsigned int v = triangle[k];
+            unsigned int* begin = &adjacency[offsets[v]];
+            unsigned int* end = begin + remaining[v];
+            std::iter_swap(std::find(begin, end, best), end - 1);
+            remaining[v]--;
+        }
+
+        // The triangle vertices move to the front of the cache
+        nextCache.assign(triangle, triangle + 3);
+        for (auto v : cache) {
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                nextCache.push_back(v);
+        }
+        for (size_t i = ForsythCacheSize; i < nextCache.size(); i++) {
+            vertexScore[nextCache[i]] =
+                forsythScore(-1, remaining[nextCache[i]]);
+        }
+        if (nextCache.size() > ForsythCacheSize)
+            nextCache.resize(ForsythCacheSize);
+        cache.swap(nextCache);
+
+        for (size_t i = 0; i < cache.size(); i++) {
+            vertexScore[cache[i]] =
+                forsythScore(static_cast<int>(i), remaining[cache[i]]);
+        }
+
+        // Next triangle: best one touching the cache
+        best = NoTriangle;
+        bestScore = -1.f;
+        for (auto v : cache) {
+            for (unsigned int i = 0; i < remaining[v]; i++) {
+                unsigned int t = adjacency[offsets[v] + i];
+                float score = scoreTriangle(t);
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = t;
+                }
+            }
+        }
+    }
+
+    indices.swap(result);
+}
+
+void optimizeOverdraw(std::vector<unsigned int>& indices,
+                      const std::vector<unsigned char>& vertices,
+                      const VertexLayout& layout, float threshold) {
+    const size_t numTriangles = indices.size() / 3;
+    const size_t numVertices = vertices.size() / layout.stride;
+    if (numTriangles < 2) return;
+
+    const VertexAttribute* posAttribute = nullptr;
+    for (const auto& vAttribute : layout.attributes) {
+        if (vAttribute.location == 0) posAttribute = &vAttribute;
+    }
+    if (posAttribute == nullptr || posAttribute->glType != GL_FLOAT ||
+        posAttribute->components < 3) {
+        PLOGW << "Overdraw optimization skipped, unsupported position "
+                 "attribute\n";
+        return;
+    }
+    auto position = [&](unsigned int v) {
+        float p[3];
+        std::memcpy(p,
+                    vertices.data() + v * layout.stride + posAttribute->offset,
+                    sizeof(p));
+        return glm::vec3(p[0], p[1], p[2]);
+    };
+
+    // Hard boundaries: triangles missing all their vertices, the vertex
+    // cache order restarts there so clusters can move freely
+    FifoCache cache(numVertices, 16);
+    std::vector<size_t> hardClusters;
+    for (size_t t = 0; t < numTriangles; t++) {
+        unsigned int misses = cache.access(indices[t * 3]) +
+                              cache.access(indices[t * 3 + 1]) +
+                              cache.access(indices[t * 3 + 2]);
+        if (t == 0 || misses == 3) hardClusters.push_back(t);
+    }
+    hardClusters.push_back(numTriangles);
+
+    // Soft boundaries: split a hard cluster where the part drawn so far is
+    // already within the threshold of the cluster ACMR
+    std::vector<size_t> clusters;
+    for (size_t c = 0; c + 1 < hardClusters.size(); c++) {
+        const size_t start = hardClusters[c], end = hardClusters[c + 1];
+
+        cache.reset();
+        size_t clusterMisses = 0;
+        for (size_t i = start * 3; i < end * 3; i++)
+            clusterMisses += cache.access(indices[i]);
+        const float clusterAcmr =
+            static_cast<float>(clusterMisses) / (end - start);
+
+        cache.reset();
+        size_t misses = 0, clusterStart = start;
+        clusters.push_back(start);
+        for (size_t t = start; t + 1 < end; t++) {
+            for (size_t k = 0; k < 3; k++)
+                misses += cache.access(indices[t * 3 + k]);
+            float acmr = static_cast<float>(misses) / (t + 1 - clusterStart);
+            if (acmr <= clusterAcmr * threshold) {
+                clusterStart = t + 1;
+                clusters.push_back(clusterStart);
+                misses = 0;
+                cache.reset();
+            }
+        }
+    }
+    clusters.push_back(numTriangles);
+
+    // Sort the clusters by how much they face away from the mesh center,
+    // outer surfaces first so they occlude the inner ones
+    const size_t numClusters = clusters.size() - 1;
+    std::vector<glm::vec3> centroids(numClusters, glm::vec3(0.f));
+    std::vector<glm::vec3> normals(numClusters, glm::vec3(0.f));
+    glm::vec3 meshCentroid(0.f);
+    float meshArea = 0.f;
+    for (size_t c = 0; c < numClusters; c++) {
+        float clusterArea = 0.f;
+        for (size_t t = clusters[c]; t < clusters[c + 1]; t++) {
+            glm::vec3 a = position(indices[t * 3]);
+            glm::vec3 b = position(indices[t * 3 + 1]);
+            glm::vec3 d = position(indices[t * 3 + 2]);
+            glm::vec3 normal = glm::cross(b - a, d - a);
+            float area = glm::length(normal);
+            centroids[c] += (a + b + d) * (area / 3.f);
+            normals[c] += normal;
+            clusterArea += area;
+        }
+        meshCentroid += centroids[c];
+        meshArea += clusterArea;
+        if (clusterArea > 0.f) centroids[c] /= clusterArea;
+    }
+    if (meshArea > 0.f) meshCentroid /= meshArea;
+
+    std::vector<float> sortKey(numClusters, 0.f);
+    for (size_t c = 0; c < numClusters; c++) {
+        float length = glm::length(normals[c]);
+        if (length > 0.f)
+            sortKey[c] =
+                glm::dot(centroids[c] - meshCentroid, normals[c] / length);
+    }
+
+    std::vector<size_t> order(numClusters);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return sortKey[a] > sortKey[b];
+    });
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (auto c : order) {
+        result.insert(result.end(), indices.begin() + clusters[c] * 3,
+                      indices.begin() + clusters[c + 1] * 3);
+    }
+    indices.swap(result);
+}
+
+size_t optimizeVertexFetch(std::vector<unsigned char>& vertices,
+                           size_t stride, std::vector<unsigned int>& indices) {
+    const size_t numVertices = vertices.size() / stride;
+
+    std::vector<unsigned int> remap(numVertices, InvalidIndex);
+    unsigned int next = 0;
+    for (auto& index : indices) {
+        if (remap[index] == InvalidIndex) remap[index] = next++;
+        index = remap[index];
+    }
+
+    std::vector<unsigned char> reordered(next * stride);
+    for (size_t v = 0; v < numVertices; v++) {
+        if (remap[v] == InvalidIndex) continue;
+        std::memcpy(reordered.data() + remap[v] * stride,
+                    vertices.data() + v * stride, stride);
+    }
+    vertices.swap(reordered);
+    return next;
+}
+
+MeshOptimizationStatistics optimizeMesh(
+    std::vector<unsigned char>& vertices, const VertexLayout& layout,
+    std::vector<unsigned int>& indices,
+    const MeshOptimizationSettings& settings) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    MeshOptimizationStatistics stats;
+    stats.verticesBefore = vertices.size() / layout.stride;
+    stats.before = analyzeVertexCache(indices.data(), indices.size(),
+                                      stats.verticesBefore);
+
+    size_t numVertices = stats.verticesBefore;
+    if (settings.deduplicateVertices)
+        numVertices = deduplicateVertices(vertices, layout.stride, indices);
+    if (settings.optimizeVertexCache) optimizeVertexCache(indices, numVertices);
+    if (settings.optimizeOverdraw)
+        optimizeOverdraw(indices, vertices, layout,
+                         settings.overdrawThreshold);
+    if (settings.optimizeVertexFetch)
+        numVertices = optimizeVertexFetch(vertices, layout.stride, indices);
+
+    stats.verticesAfter = numVertices;
+    stats.after =
+        analyzeVertexCache(indices.data(), indices.size(), numVertices);
+
+    auto end = std::chrono::high_resolution_clock::now();
+    stats.time =
+        std::chrono::duration<double, std::milli>(end - start).count();
+    return stats;
+}
+
+}  // namespace rendering
+}  // namespace v3d
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Mesh.h"
+
+namespace v3d {
+namespace rendering {
+
+/// @brief Steps of the import time mesh optimization, run in this order
+struct MeshOptimizationSettings {
+    bool enabled = false;
+    /// @brief Merge the bitwise identical vertices
+    bool deduplicateVertices = true;
+    /// @brief Reorder the triangles for the post transform vertex cache
+    bool optimizeVertexCache = true;
+    /// @brief Reorder clusters of triangles front to back from the outside
+    /// of the mesh, trading a bit of the vertex cache efficiency
+    bool optimizeOverdraw = true;
+    /// @brief Max ACMR increase accepted by the overdraw step, 1.05 = 5%
+    float overdrawThreshold = 1.05f;
+    /// @brief Reorder the vertices by first use, dropping the unused ones
+    bool optimizeVertexFetch = true;
+};
+
+/// @brief Post transform vertex cache efficiency of an index buffer
+struct VertexCacheStatistics {
+    /// @brief Average cache miss ratio, transformed vertices per triangle
+    /// (0.5 best, 3 worst)
+    float acmr = 0.f;
+    /// @brief Average transformed vertex ratio, transformed vertices per
+    /// vertex (1 best)
+    float atvr = 0.f;
+};
+
+struct MeshOptimizationStatistics {
+    size_t verticesBefore = 0;
+    size_t verticesAfter = 0;
+    VertexCacheStatistics before;
+    VertexCacheStatistics after;
+    double time = 0;  // ms
+};
+
+/// @brief Simulate a FIFO cache of cacheSize entries, the usual hardware
+/// model
+VertexCacheStatistics analyzeVertexCache(const unsigned int* indices,
+                                         size_t numIndices,
+                                         size_t numVertices,
+                                         unsigned int cacheSize = 16);
+
+/// @return New num of vertices
+size_t deduplicateVertices(std::vector<unsigned char>& vertices,
+                           size_t stride, std::vector<unsigned int>& indices);
+
+/// @brief Tom Forsyth's linear-speed vertex cache optimization
+void optimizeVertexCache(std::vector<unsigned int>& indices,
+                         size_t numVertices);
+
+/// @brief Sander et al. cluster sorting: split the cache optimized triangle
+/// order in clusters and draw first the ones facing outward. The vertex
+/// positions are read from the attribute at location 0.
+void optimizeOverdraw(std::vector<unsigned int>& indices,
+                      const std::vector<unsigned char>& vertices,
+                      const VertexLayout& layout, float threshold);
+
+/// @return New num of vertices
+size_t optimizeVertexFetch(std::vector<unsigned char>& vertices,
+                           size_t stride, std::vector<unsigned int>& indices);
+
+/// @brief Run the enabled steps on an indexed triangle list
+MeshOptimizationStatistics optimizeMesh(
+    std::vector<unsigned char>& vertices, const VertexLayout& layout,
+    std::vector<unsigned int>& indices,
+    const MeshOptimizationSettings& settings);
+
+}  // namespace rendering
+}  // namespace v3d
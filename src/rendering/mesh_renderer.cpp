@@ -1,6 +1,7 @@
 
 #include "mesh_renderer.h"
 
+#include <algorithm>
 #include <glm/gtc/quaternion.hpp>
 
 #include "Mesh.h"
@@ -41,26 +42,43 @@ void MeshRenderer::unregisterRenderTarget() {
     }
 }
 
-void MeshRenderer::renderElement() { m_mesh->draw(); }
+const Mesh* MeshRenderer::getRenderMesh() const {
+    return m_mesh != nullptr ? m_mesh->getLod(m_lodLevel) : nullptr;
+}
+
+size_t MeshRenderer::selectLod(float screenRadius,
+                               const rendering::LodSelection& settings) {
+    if (m_mesh == nullptr || !settings.enabled) return m_lodLevel = 0;
+
+    // The level errors are relative to the bounding sphere radius, so the
+    // projected radius scales them to pixels
+    const float refine = settings.maxPixelError * (1.f + settings.hysteresis);
+    const float coarsen = settings.maxPixelError * (1.f - settings.hysteresis);
+    size_t level = std::min(m_lodLevel, m_mesh->getNumLods() - 1);
+    while (level > 0 && m_mesh->getLodError(level) * screenRadius > refine)
+        level--;
+    while (level + 1 < m_mesh->getNumLods() &&
+           m_mesh->getLodError(level + 1) * screenRadius < coarsen)
+        level++;
+    return m_lodLevel = level;
+}
+
+void MeshRenderer::renderElement() { getRenderMesh()->draw(); }
 void MeshRenderer::renderElementInstanced() {
     throw exception::NotImplemented();
 }
 
-void MeshRenderer::setUniforms(Shader* shader) {
+glm::mat4 MeshRenderer::getModelMatrix() const {
     glm::mat4 model = glm::mat4(1.0f);
-    glm::vec3 pos = m_transform->getPos();
+    glm::vec3 pos;
+    glm::quat q;
+    m_transform->getRenderPose(pos, q);
     glm::vec3 scale = m_transform->getScale();
     // glm::vec3 axis = m_transform->getRotAxis();
     // float angle = m_transform->getRotAngle();
     // std::cout << "Rotation Axis: (" << axis.x << ", " << axis.y << ", " <<
     // axis.z << ") Angle: " << angle << std::endl;
 
-    glm::vec3 rotAngles = m_transform->getRotationCardanAngles();
-
-    glm::mat4 RotationMatrix = glm::mat4_cast(m_transform->getRotation());
-
-    glm::quat q = glm::quat(rotAngles);  // pitch=x, yaw=y, roll=z
-
     model = glm::translate(model, pos);
 
     // model = glm::rotate(model, glm::radians(angle), axis);
@@ -70,8 +88,24 @@ void MeshRenderer::setUniforms(Shader* shader) {
 
     model = glm::scale(model, scale);
 
+    return model;
+}
+
+bool MeshRenderer::isStatic() const {
+    return m_static && m_transform != nullptr && !m_transform->isSimulated();
+}
+
+uint64_t MeshRenderer::getTransformVersion() const {
+    return m_transform != nullptr ? m_transform->getVersion() : 0;
+}
+
+void MeshRenderer::setUniforms(Shader* shader) {
+    glm::mat4 model = getModelMatrix();
     glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
 
+    // Quantized positions are expanded to the mesh local space first
+    if (m_mesh != nullptr)
+        model = model * getRenderMesh()->getVertexTransform();
     shader->setMat4("model", model);
     shader->setMat3("normalMatrix", normalMatrix);
 }
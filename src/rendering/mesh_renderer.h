@@ -22,6 +22,7 @@ class MeshRenderer : public rendering::IRenderable, public ComponentBase {
 
     void setMesh(const Mesh* mesh) {
         m_mesh = mesh;
+        m_lodLevel = 0;
         registerRenderTarget();
     };
     void resetMesh() {
@@ -29,9 +30,30 @@ class MeshRenderer : public rendering::IRenderable, public ComponentBase {
         m_mesh = nullptr;
     };
 
+    /// @brief Mesh of the selected level of detail
+    const Mesh* getRenderMesh() const override;
+    glm::mat4 getModelMatrix() const override;
+    uint64_t getTransformVersion() const override;
+
+    void setMaterial(rendering::Material* material) { m_material = material; }
+    rendering::Material* getMaterial() const override { return m_material; }
+
+    size_t selectLod(float screenRadius,
+                     const rendering::LodSelection& settings) override;
+    size_t getLodLevel() const { return m_lodLevel; }
+
+    /// @brief Flag the renderer as never moving, see IRenderable::isStatic
+    void setStatic(bool isStatic) { m_static = isStatic; }
+    /// @brief The flag is ignored while the transform is simulated, the
+    /// renderer is drawn on its own then
+    bool isStatic() const override;
+
    private:
     Transform* m_transform = nullptr;
     const Mesh* m_mesh = nullptr;
+    rendering::Material* m_material = nullptr;
+    size_t m_lodLevel = 0;
+    bool m_static = false;
 
     void renderElement() override;
     void renderElementInstanced() override;
@@ -0,0 +1,336 @@
+#include "mesh_simplifier.h"
+
+#include <glad/glad.h>
+#include <plog/Log.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <queue>
+#include <string_view>
+#include <unordered_map>
+
+#include "glm/glm.hpp"
+
+namespace v3d {
+namespace rendering {
+
+namespace {
+/// @brief Symmetric 4x4 matrix summing squared distances to planes, plus the
+/// total weight to normalize the error to a distance
+struct Quadric {
+    double a2 = 0, ab = 0, ac = 0, ad = 0;
+    double b2 = 0, bc = 0, bd = 0;
+    double c2 = 0, cd = 0;
+    double d2 = 0;
+    double weight = 0;
+
+    static Quadric fromPlane(const glm::dvec3& normal, double d,
+                             double weight) {
+        Quadric q;
+        q.a2 = normal.x * normal.x * weight;
+        q.ab = normal.x * normal.y * weight;
+        q.ac = normal.x * normal.z * weight;
+        q.ad = normal.x * d * weight;
+        q.b2 = normal.y * normal.y * weight;
+        q.bc = normal.y * normal.z * weight;
+        q.bd = normal.y * d * weight;
+        q.c2 = normal.z * normal.z * weight;
+        q.cd = normal.z * d * weight;
+        q.d2 = d * d * weight;
+        q.weight = weight;
+        return q;
+    }
+
+    Quadric& operator+=(const Quadric& o) {
+        a2 += o.a2, ab += o.ab, ac += o.ac, ad += o.ad;
+        b2 += o.b2, bc += o.bc, bd += o.bd;
+        c2 += o.c2, cd += o.cd;
+        d2 += o.d2;
+        weight += o.weight;
+        return *this;
+    }
+
+    /// @brief Weighted mean squared distance of p to the planes
+    double error(const glm::dvec3& p) const {
+        double e = a2 * p.x * p.x + 2 * ab * p.x * p.y + 2 * ac * p.x * p.z +
+                   2 * ad * p.x + b2 * p.y * p.y + 2 * bc * p.y * p.z +
+                   2 * bd * p.y + c2 * p.z * p.z + 2 * cd * p.z + d2;
+        return weight > 0 ? std::max(e, 0.0) / weight : 0.0;
+    }
+};
+
+struct Collapse {
+    float error;  // Squared distance
+    unsigned int from, to;
+    unsigned int fromVersion, toVersion;
+
+    bool operator>(const Collapse& other) const { return error > other.error; }
+};
+
+// Border edges weigh more than the faces so open borders stay in place
+constexpr double BorderWeight = 10.0;
+// Collapses turning a triangle normal more than ~75 degrees are rejected
+constexpr double MinNormalDot = 0.25;
+
+uint64_t edgeKey(unsigned int a, unsigned int b) {
+    if (a > b) std::swap(a, b);
+    return (uint64_t(a) << 32) | b;
+}
+
+const VertexAttribute* findFloatAttribute(const VertexLayout& layout,
+                                          uint32_t location) {
+    for (const auto& vAttribute : layout.attributes) {
+        if (vAttribute.location == location && vAttribute.glType == GL_FLOAT &&
+            vAttribute.components >= 3)
+            return &vAttribute;
+    }
+    return nullptr;
+}
+}  // namespace
+
+std::vector<unsigned int> simplifyMesh(const void* vertexData,
+                                       size_t numVertices,
+                                       const VertexLayout& layout,
+                                       const unsigned int* indices,
+                                       size_t numIndices,
+                                       size_t targetIndexCount, float maxError,
+                                       float* resultError) {
+    if (resultError != nullptr) *resultError = 0.f;
+
+    const VertexAttribute* posAttribute = findFloatAttribute(layout, 0);
+    const VertexAttribute* normalAttribute = findFloatAttribute(layout, 1);
+    if (posAttribute == nullptr) {
+        PLOGW << "Unable to simplify mesh, unsupported position attribute\n";
+        return {};
+    }
+
+    const auto* data = static_cast<const unsigned char*>(vertexData);
+    auto readVec3 = [&](const VertexAttribute* attribute, size_t v) {
+        float value[3];
+        std::memcpy(value, data + v * layout.stride + attribute->offset,
+                    sizeof(value));
+        return glm::vec3(value[0], value[1], value[2]);
+    };
+
+    // Weld the vertices sharing a position, the simplification works on
+    // the welded vertices and keeps the wedges (attribute variants) of each
+    std::vector<unsigned int> weld(numVertices);
+    std::vector<glm::dvec3> positions(numVertices);
+    std::vector<std::vector<unsigned int>> wedges(numVertices);
+    {
+        std::unordered_map<std::string_view, unsigned int> lookup;
+        lookup.reserve(numVertices);
+        for (size_t v = 0; v < numVertices; v++) {
+            std::string_view key(reinterpret_cast<const char*>(
+                                     data + v * layout.stride +
+                                     posAttribute->offset),
+                                 3 * sizeof(float));
+            auto [it, inserted] =
+                lookup.emplace(key, static_cast<unsigned int>(v));
+            weld[v] = it->second;
+            wedges[it->second].push_back(static_cast<unsigned int>(v));
+            positions[v] = readVec3(posAttribute, v);
+        }
+    }
+
+    const size_t numTriangles = numIndices / 3;
+    std::vector<std::array<unsigned int, 3>> triangles(numTriangles);
+    std::vector<bool> alive(numTriangles, false);
+    std::vector<std::vector<unsigned int>> vertexTriangles(numVertices);
+    std::vector<Quadric> quadrics(numVertices);
+    std::unordered_map<uint64_t, unsigned int> edgeUse;
+    edgeUse.reserve(numIndices);
+    size_t numAlive = 0;
+
+    for (size_t t = 0; t < numTriangles; t++) {
+        auto& triangle = triangles[t];
+        for (size_t k = 0; k < 3; k++) triangle[k] = weld[indices[t * 3 + k]];
+        if (triangle[0] == triangle[1] || triangle[1] == triangle[2] ||
+            triangle[0] == triangle[2])
+            continue;
+
+        alive[t] = true;
+        numAlive++;
+        for (size_t k = 0; k < 3; k++) {
+            vertexTriangles[triangle[k]].push_back(static_cast<unsigned int>(t));
+            edgeUse[edgeKey(triangle[k], triangle[(k + 1) % 3])]++;
+        }
+
+        // Face plane, weighted by area
+        const glm::dvec3& p0 = positions[triangle[0]];
+        glm::dvec3 normal =
+            glm::cross(positions[triangle[1]] - p0, positions[triangle[2]] - p0);
+        double area2 = glm::length(normal);
+        if (area2 <= 0) continue;
+        normal /= area2;
+        Quadric q = Quadric::fromPlane(normal, -glm::dot(normal, p0),
+                                       area2 * 0.5);
+        for (size_t k = 0; k < 3; k++) quadrics[triangle[k]] += q;
+    }
+
+    // Open border edges: plane through the edge, perpendicular to the face
+    std::vector<bool> border(numVertices, false);
+    for (size_t t = 0; t < numTriangles; t++) {
+        if (!alive[t]) continue;
+        const auto& triangle = triangles[t];
+        const glm::dvec3& p0 = positions[triangle[0]];
+        glm::dvec3 faceNormal =
+            glm::cross(positions[triangle[1]] - p0, positions[triangle[2]] - p0);
+        for (size_t k = 0; k < 3; k++) {
+            unsigned int a = triangle[k], b = triangle[(k + 1) % 3];
+            if (edgeUse[edgeKey(a, b)] != 1) continue;
+            border[a] = border[b] = true;
+
+            glm::dvec3 edge = positions[b] - positions[a];
+            glm::dvec3 normal = glm::cross(edge, faceNormal);
+            double length = glm::length(normal);
+            if (length <= 0) continue;
+            normal /= length;
+            Quadric q = Quadric::fromPlane(
+                normal, -glm::dot(normal, positions[a]),
+                glm::dot(edge, edge) * BorderWeight);
+            quadrics[a] += q;
+            quadrics[b] += q;
+        }
+    }
+
+    std::vector<unsigned int> version(numVertices, 0);
+    std::vector<bool> removed(numVertices, false);
+
+    auto collapseError = [&](unsigned int from, unsigned int to) {
+        // Border vertices only slide along the border
+        if (border[from] && !border[to])
+            return std::numeric_limits<double>::infinity();
+        Quadric q = quadrics[from];
+        q += quadrics[to];
+        return q.error(positions[to]);
+    };
+
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<>> heap;
+    auto pushEdge = [&](unsigned int a, unsigned int b) {
+        double ab = collapseError(a, b), ba = collapseError(b, a);
+        if (std::isinf(ab) && std::isinf(ba)) return;
+        if (ba < ab) std::swap(a, b);
+        heap.push({static_cast<float>(std::min(ab, ba)), a, b, version[a],
+                   version[b]});
+    };
+    for (const auto& [key, uses] : edgeUse) {
+        pushEdge(static_cast<unsigned int>(key >> 32),
+                 static_cast<unsigned int>(key & 0xffffffffu));
+    }
+
+    // Collapse moving every triangle of from without flipping any
+    auto isValid = [&](unsigned int from, unsigned int to) {
+        for (auto t : vertexTriangles[from]) {
+            if (!alive[t]) continue;
+            const auto& triangle = triangles[t];
+            if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+                continue;
+
+            glm::dvec3 p[3], q[3];
+            for (size_t k = 0; k < 3; k++) {
+                p[k] = positions[triangle[k]];
+                q[k] = triangle[k] == from ? positions[to] : p[k];
+            }
+            glm::dvec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+            glm::dvec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+            double lengths = glm::length(before) * glm::length(after);
+            if (lengths <= 0 || glm::dot(before, after) < MinNormalDot * lengths)
+                return false;
+        }
+        return true;
+    };
+
+    const double maxError2 = double(maxError) * maxError;
+    double worstError2 = 0;
+    std::vector<unsigned int> neighbours;
+    while (!heap.empty() && numAlive * 3 > targetIndexCount) {
+        Collapse collapse = heap.top();
+        heap.pop();
+        if (removed[collapse.from] || removed[collapse.to] ||
+            version[collapse.from] != collapse.fromVersion ||
+            version[collapse.to] != collapse.toVersion)
+            continue;
+        if (collapse.error > maxError2) break;
+        if (!isValid(collapse.from, collapse.to)) continue;
+
+        const unsigned int from = collapse.from, to = collapse.to;
+        for (auto t : vertexTriangles[from]) {
+            if (!alive[t]) continue;
+            auto& triangle = triangles[t];
+            if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+                alive[t] = false;
+                numAlive--;
+                continue;
+            }
+            for (auto& v : triangle) {
+                if (v == from) v = to;
+            }
+            vertexTriangles[to].push_back(t);
+        }
+        vertexTriangles[from].clear();
+
+        quadrics[to] += quadrics[from];
+        removed[from] = true;
+        version[to]++;
+        worstError2 = std::max(worstError2, double(collapse.error));
+
+        // Drop the dead triangles and requeue the edges around to
+        auto& toTriangles = vertexTriangles[to];
+        toTriangles.erase(std::remove_if(toTriangles.begin(), toTriangles.end(),
+                                         [&](unsigned int t) {
+                                             return !alive[t];
+                                         }),
+                          toTriangles.end());
+        neighbours.clear();
+        for (auto t : toTriangles) {
+            for (auto v : triangles[t]) {
+                if (v != to) neighbours.push_back(v);
+            }
+        }
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()),
+                         neighbours.end());
+        for (auto v : neighbours) pushEdge(to, v);
+    }
+
+    // Back to the input vertices: untouched corners keep their vertex, moved
+    // ones take the wedge of the new position with the closest normal
+    std::vector<unsigned int> result;
+    result.reserve(numAlive * 3);
+    for (size_t t = 0; t < numTriangles; t++) {
+        if (!alive[t]) continue;
+        for (size_t k = 0; k < 3; k++) {
+            unsigned int source = indices[t * 3 + k];
+            unsigned int target = triangles[t][k];
+            if (weld[source] == target) {
+                result.push_back(source);
+                continue;
+            }
+
+            unsigned int best = wedges[target].front();
+            if (normalAttribute != nullptr && wedges[target].size() > 1) {
+                glm::vec3 normal = readVec3(normalAttribute, source);
+                float bestDot = -2.f;
+                for (auto wedge : wedges[target]) {
+                    float d = glm::dot(normal, readVec3(normalAttribute, wedge));
+                    if (d > bestDot) {
+                        bestDot = d;
+                        best = wedge;
+                    }
+                }
+            }
+            result.push_back(best);
+        }
+    }
+
+    if (resultError != nullptr)
+        *resultError = static_cast<float>(std::sqrt(worstError2));
+    return result;
+}
+
+}  // namespace rendering
+}  // namespace v3d
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Mesh.h"
+
+namespace v3d {
+namespace rendering {
+
+/// @brief LOD chain generated for every imported mesh
+struct MeshLodSettings {
+    bool enabled = false;
+    /// @brief Max geometric error of each level, finest first, relative to
+    /// the mesh bounding sphere radius
+    std::vector<float> errors = {0.005f, 0.02f, 0.06f};
+    /// @brief Triangle count target of each level relative to the previous
+    /// one. The error bound has priority, levels may keep more triangles.
+    float reduction = 0.5f;
+    /// @brief A level keeping more than this ratio of the previous level
+    /// triangles ends the chain, it would not pay its memory
+    float minReduction = 0.85f;
+};
+
+/**
+ * @brief Quadric error metric simplification (Garland and Heckbert) by edge
+ * collapse.
+ *
+ * Vertices are welded by position so the attribute seams don't stop the
+ * collapses, every collapse moves a vertex onto one of its neighbours, no
+ * vertex is created. The output indices reference the input vertex buffer,
+ * corners whose position moved take the vertex of the new position with the
+ * closest normal. Open borders are kept by edge constraint quadrics.
+ *
+ * @param targetIndexCount Stop once the result has this many indices or less
+ * @param maxError Stop before a collapse moving the surface further than
+ * this distance, in mesh units
+ * @param resultError Output, largest error of the applied collapses
+ * @return Indices of the simplified mesh, empty if the positions are not
+ * float3 at location 0
+ */
+std::vector<unsigned int> simplifyMesh(const void* vertexData,
+                                       size_t numVertices,
+                                       const VertexLayout& layout,
+                                       const unsigned int* indices,
+                                       size_t numIndices,
+                                       size_t targetIndexCount, float maxError,
+                                       float* resultError = nullptr);
+
+}  // namespace rendering
+}  // namespace v3d
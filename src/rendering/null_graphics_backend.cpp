@@ -0,0 +1,387 @@
+#include "null_graphics_backend.hpp"
+
+#include <plog/Log.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "Mesh.h"
+#include "OBJ-Loader-master/Source/OBJ_Loader.h"
+#include "imgui.h"
+#include "rendering/geometry_arena.h"
+#include "rendering/material.h"
+#include "rendering/static_batcher.h"
+
+namespace v3d {
+namespace rendering {
+
+namespace {
+// Uniforms set once per frame: view, projection and dye color
+constexpr size_t FrameUniformBytes = 2 * sizeof(glm::mat4) + sizeof(glm::vec4);
+// Uniforms set per draw: model and normal matrix
+constexpr size_t DrawUniformBytes = sizeof(glm::mat4) + sizeof(glm::mat3);
+// Streamed per draw of a multi-draw: instance data and indirect command
+constexpr size_t MultiDrawBytes =
+    sizeof(DrawInstanceData) + sizeof(DrawElementsIndirectCommand);
+// Line gizmos vertex: position and color
+constexpr size_t GizmosLineVertexBytes = sizeof(glm::vec3) + sizeof(glm::vec4);
+}  // namespace
+
+/**
+ * @brief Stand-in of a StaticBatch: only the size and the bounds of the
+ * merged geometry are kept, drawn like any forward target.
+ */
+class NullStaticBatch : public IRenderable {
+   public:
+    explicit NullStaticBatch(Material* material) : m_material(material) {}
+
+    void renderElement() override {}
+    void renderElementInstanced() override {}
+    void setUniforms(Shader* shader) override {}
+
+    const Mesh* getRenderMesh() const override { return &m_mesh; }
+    Material* getMaterial() const override { return m_material; }
+
+    void clearFrameSources() { m_frameSources.clear(); }
+    void addFrameSource(IRenderable* target, const Mesh* mesh) {
+        m_frameSources.push_back(
+            {target, mesh, target->getTransformVersion()});
+    }
+    size_t getNumFrameSources() const { return m_frameSources.size(); }
+
+    /// @brief Merge the sources of the frame if they changed since the last
+    /// merge, like StaticBatcher::update
+    void update();
+
+   private:
+    struct Source {
+        IRenderable* target;
+        const Mesh* mesh;
+        uint64_t transformVersion;
+
+        bool operator==(const Source& other) const {
+            return target == other.target && mesh == other.mesh &&
+                   transformVersion == other.transformVersion;
+        }
+    };
+
+    class MergedMesh : public Mesh {
+       public:
+        void draw() const override {}
+        void set(size_t numVertices, size_t numIndices,
+                 const BoundingSphere& sphere) {
+            m_numVertices = numVertices;
+            m_numIndices = numIndices;
+            m_vertexBytes = numVertices * StaticBatcher::VertexBytes;
+            m_indexBytes = numIndices * sizeof(uint32_t);
+            m_uncompressedBytes = m_vertexBytes + m_indexBytes;
+            m_boundingSphere = sphere;
+        }
+    };
+
+    Material* m_material = nullptr;
+    std::vector<Source> m_sources;
+    std::vector<Source> m_frameSources;
+    MergedMesh m_mesh;
+};
+
+void NullStaticBatch::update() {
+    if (m_frameSources == m_sources) return;
+    m_sources = m_frameSources;
+
+    // The world spheres of the sources, enclosed around their mean center
+    std::vector<BoundingSphere> spheres;
+    spheres.reserve(m_sources.size());
+    glm::vec3 center(0.f);
+    bool bounded = true;
+    size_t numVertices = 0, numIndices = 0;
+    for (const auto& source : m_sources) {
+        numVertices += source.mesh->getNumVertices();
+        numIndices += source.mesh->getNumIndices();
+        spheres.push_back(source.mesh->getBoundingSphere().transformed(
+            source.target->getModelMatrix()));
+        bounded = bounded && spheres.back().isBounded();
+        center += spheres.back().center;
+    }
+
+    BoundingSphere sphere;
+    if (bounded) {
+        center /= static_cast<float>(spheres.size());
+        float radius = 0.f;
+        for (const auto& source : spheres)
+            radius = std::max(
+                radius, glm::length(source.center - center) + source.radius);
+        sphere.center = center;
+        sphere.radius = radius;
+    }
+    m_mesh.set(numVertices, numIndices, sphere);
+}
+
+NullGraphicsBackend::NullGraphicsBackend(Window* window)
+    : GraphicsBackend(window) {
+    initPrimitives();
+}
+
+NullGraphicsBackend::~NullGraphicsBackend() {
+    if (m_numFrames == 0) return;
+
+    const double frames = static_cast<double>(m_numFrames);
+    PLOGI << "Null backend statistics over " << m_numFrames << " frames:"
+          << " draw calls " << m_total.drawCalls / frames << ", triangles "
+          << m_total.triangles / frames << ", instances "
+          << m_total.instances / frames << ", state changes "
+          << m_total.stateChanges / frames << ", gizmo primitives "
+          << m_total.gizmoPrimitives / frames << ", upload bytes "
+          << m_total.uploadBytes / frames << ", fetch bytes "
+          << m_total.fetchBytes / frames << " per frame\n";
+}
+
+Mesh* NullGraphicsBackend::createMesh(std::string filePath) {
+    objl::Loader obj_loader;
+
+    PLOGD << "Loading model " << filePath << "...\n";
+    if (!obj_loader.LoadFile(filePath)) {
+        PLOGD << "Failed to Load File " << filePath
+              << ". May have failed to find it or it was not an .obj file.\n";
+        return nullptr;
+    }
+
+    auto mesh = std::make_unique<MeshNull>(obj_loader.LoadedMeshes[0]);
+    m_pendingUploadBytes += mesh->getVertexBytes() + mesh->getIndexBytes();
+
+    Mesh* mesh_ptr = mesh.get();
+    m_meshList.push_back(std::move(mesh));
+    return mesh_ptr;
+}
+
+void NullGraphicsBackend::addImportedMesh(const Mesh& mesh) {
+    m_pendingUploadBytes += mesh.getVertexBytes() + mesh.getIndexBytes();
+
+    const size_t numVertices = mesh.getNumVertices();
+    const size_t numIndices = mesh.getNumIndices();
+    if (numVertices == 0 || numIndices == 0) return;
+    // The layout is told apart by its stride, compressed or not
+    const size_t stride = mesh.getVertexBytes() / numVertices;
+    const size_t indexSize = mesh.getIndexBytes() / numIndices;
+
+    size_t pool = 0;
+    while (pool < m_pools.size()) {
+        const auto& usage = m_pools[pool];
+        if (usage.stride == stride && usage.indexSize == indexSize &&
+            usage.numVertices + numVertices <= usage.vertexCapacity &&
+            usage.numIndices + numIndices <= usage.indexCapacity)
+            break;
+        pool++;
+    }
+    if (pool == m_pools.size())
+        m_pools.push_back(
+            {stride, indexSize,
+             std::max(GeometryArena::DefaultPoolVertices, numVertices),
+             std::max(GeometryArena::DefaultPoolIndices, numIndices)});
+
+    m_pools[pool].numVertices += numVertices;
+    m_pools[pool].numIndices += numIndices;
+    m_meshPools[&mesh] = pool;
+}
+
+void NullGraphicsBackend::initPrimitives() {
+    PLOGD << "Loading primitives\n";
+    m_primitives.m_cube = createMesh("resources/primitives/3D/cube.obj");
+    m_primitives.m_sphere = createMesh("resources/primitives/3D/sphere.obj");
+}
+
+void NullGraphicsBackend::frameUpdate() {
+    m_frame = FrameStatistics();
+    m_numGizmosLines = 0;
+    if (!m_recording) return;
+
+    m_frame.uploadBytes += m_pendingUploadBytes;
+    m_pendingUploadBytes = 0;
+
+    updateStaticBatches();
+    cullRenderTargets(getCameraProjection() * getCameraView(),
+                      m_frameTargets);
+
+    // Default program bind and the frame uniforms
+    m_frame.stateChanges++;
+    m_frame.uploadBytes += FrameUniformBytes;
+
+    // Pooled meshes are grouped into multi-draws, the rest is drawn one by
+    // one. The vertex array bind is only accounted when the mesh changes,
+    // redundant binds are not counted.
+    for (auto& [key, meshes] : m_multiDraws) meshes.clear();
+    ProgramKey boundProgram{nullptr, 0};
+    const Mesh* boundMesh = nullptr;
+    for (auto renderTarget : m_visibleRenderTargets) {
+        const Mesh* mesh = renderTarget->getRenderMesh();
+        if (mesh == nullptr) continue;
+
+        auto pool = m_multiDrawIndirectEnabled ? m_meshPools.find(mesh)
+                                               : m_meshPools.end();
+        const bool indirect = pool != m_meshPools.end();
+
+        ProgramKey program{nullptr, 0};
+        if (Material* material = renderTarget->getMaterial()) {
+            program = {material->getShaderVariants(),
+                       material->getVariantKey() |
+                           (indirect ? ShaderVariantSet::IndirectDrawBit
+                                     : 0)};
+        }
+
+        if (indirect) {
+            m_multiDraws[{program, pool->second}].push_back(mesh);
+            continue;
+        }
+
+        if (program != boundProgram) {
+            m_frame.stateChanges++;
+            m_frame.uploadBytes += FrameUniformBytes;
+            boundProgram = program;
+        }
+        if (mesh != boundMesh) {
+            m_frame.stateChanges++;
+            boundMesh = mesh;
+        }
+
+        m_frame.drawCalls++;
+        m_frame.instances++;
+        m_frame.uploadBytes += DrawUniformBytes;
+        if (program.first != nullptr) m_frame.uploadBytes += sizeof(int32_t);
+        recordMeshDraw(mesh);
+    }
+
+    // One multi-draw per program and pool, the instance data and the
+    // commands are streamed every frame
+    for (const auto& [key, meshes] : m_multiDraws) {
+        if (meshes.empty()) continue;
+        m_frame.stateChanges += 2;  // Program and pool vertex array
+        m_frame.drawCalls++;
+        m_frame.instances += meshes.size();
+        m_frame.uploadBytes +=
+            FrameUniformBytes + meshes.size() * MultiDrawBytes;
+        for (auto mesh : meshes) recordMeshDraw(mesh);
+    }
+}
+
+void NullGraphicsBackend::updateStaticBatches() {
+    m_frameTargets.clear();
+    m_frameTargets.reserve(m_renderTargets.size());
+    for (auto& [material, batch] : m_staticBatches) batch->clearFrameSources();
+
+    // Batches hold the full resolution of their targets
+    LodSelection fullResolution;
+    fullResolution.enabled = false;
+
+    for (auto renderTarget : m_renderTargets) {
+        if (!m_staticBatchingEnabled || !renderTarget->isStatic()) {
+            m_frameTargets.push_back(renderTarget);
+            continue;
+        }
+
+        renderTarget->selectLod(std::numeric_limits<float>::max(),
+                                fullResolution);
+        const Mesh* mesh = renderTarget->getRenderMesh();
+        if (mesh == nullptr) {
+            m_frameTargets.push_back(renderTarget);
+            continue;
+        }
+
+        auto& batch = m_staticBatches[renderTarget->getMaterial()];
+        if (!batch)
+            batch = std::make_unique<NullStaticBatch>(
+                renderTarget->getMaterial());
+        batch->addFrameSource(renderTarget, mesh);
+    }
+
+    // Batches left without targets are released
+    for (auto it = m_staticBatches.begin(); it != m_staticBatches.end();) {
+        if (it->second->getNumFrameSources() == 0) {
+            it = m_staticBatches.erase(it);
+            continue;
+        }
+        it->second->update();
+        m_frameTargets.push_back(it->second.get());
+        ++it;
+    }
+}
+
+void NullGraphicsBackend::recordMeshDraw(const Mesh* mesh) {
+    m_frame.triangles += mesh->getNumTriangles();
+    m_frame.fetchBytes += mesh->getVertexBytes() + mesh->getIndexBytes();
+}
+
+void NullGraphicsBackend::presentFrame() {
+    if (!m_recording) return;
+
+    m_lastFrame = m_frame;
+    m_total += m_frame;
+    m_numFrames++;
+}
+
+void NullGraphicsBackend::postDrawGizmosHook() {
+    if (!m_recording || m_numGizmosLines == 0) return;
+
+    // Single batched line draw
+    m_frame.stateChanges += 2;  // Program and vertex array
+    m_frame.drawCalls++;
+    m_frame.instances++;
+    m_frame.uploadBytes +=
+        2 * sizeof(glm::mat4) + m_numGizmosLines * 2 * GizmosLineVertexBytes;
+}
+
+void NullGraphicsBackend::recordPrimitiveDraw(const Mesh* mesh,
+                                              bool wireframe) {
+    m_frame.gizmoPrimitives++;
+    m_frame.stateChanges += 2;  // Program and vertex array
+    if (wireframe) m_frame.stateChanges += 2;  // Polygon mode set and reset
+    m_frame.drawCalls++;
+    m_frame.instances++;
+    m_frame.uploadBytes += FrameUniformBytes + DrawUniformBytes;
+    if (mesh != nullptr) recordMeshDraw(mesh);
+}
+
+void NullGraphicsBackend::drawPrimitivePoint(glm::vec3 a, float size,
+                                             glm::vec4 color) {
+    // Points are not drawn by any backend yet, only accounted as a gizmo
+    if (m_recording) m_frame.gizmoPrimitives++;
+}
+
+void NullGraphicsBackend::drawPrimitiveLine(glm::vec3 a, glm::vec3 b,
+                                            glm::vec4 color) {
+    if (!m_recording) return;
+    m_frame.gizmoPrimitives++;
+    m_numGizmosLines++;
+}
+
+void NullGraphicsBackend::drawPrimitiveCube(glm::vec3 position,
+                                            glm::vec3 scale, glm::vec4 color,
+                                            bool wireframe) {
+    if (m_recording) recordPrimitiveDraw(m_primitives.m_cube, wireframe);
+}
+
+void NullGraphicsBackend::drawPrimitiveSphere(glm::vec3 position,
+                                              glm::vec3 scale,
+                                              glm::vec4 color,
+                                              bool wireframe) {
+    if (m_recording) recordPrimitiveDraw(m_primitives.m_sphere, wireframe);
+}
+
+void NullGraphicsBackend::renderDebbugGUI() {
+    GraphicsBackend::renderDebbugGUI();
+    ImGui::Checkbox("Record draw statistics", &m_recording);
+    ImGui::Checkbox("Multi-Draw Indirect", &m_multiDrawIndirectEnabled);
+    ImGui::Checkbox("Static Batching", &m_staticBatchingEnabled);
+    ImGui::Text("Static batches: %zu  Geometry pools: %zu",
+                m_staticBatches.size(), m_pools.size());
+    ImGui::Text("Draw calls: %zu  Instances: %zu", m_lastFrame.drawCalls,
+                m_lastFrame.instances);
+    ImGui::Text("Triangles: %zu", m_lastFrame.triangles);
+    ImGui::Text("State changes: %zu", m_lastFrame.stateChanges);
+    ImGui::Text("Gizmo primitives: %zu", m_lastFrame.gizmoPrimitives);
+    ImGui::Text("Upload: %.1f KB", m_lastFrame.uploadBytes / 1024.0);
+    ImGui::Text("Vertex fetch: %.1f KB", m_lastFrame.fetchBytes / 1024.0);
+    ImGui::Text("Recorded frames: %zu", m_numFrames);
+}
+
+}  // namespace rendering
+}  // namespace v3d
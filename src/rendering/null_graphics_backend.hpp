@@ -1,27 +1,140 @@
 #pragma once
 
+#include <map>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "glm/glm.hpp"
 #include "rendering/graphics_backend.h"
+#include "rendering/shader_variants.h"
 
 namespace v3d {
 namespace rendering {
+class NullStaticBatch;
 
+/// @brief Work a GPU backend would have issued for a frame
+struct FrameStatistics {
+    size_t drawCalls = 0;
+    size_t triangles = 0;
+    size_t instances = 0;
+    /// @brief Shader program and vertex array binds, plus fixed function
+    /// toggles (wireframe)
+    size_t stateChanges = 0;
+    size_t gizmoPrimitives = 0;
+    /// @brief Uniform, per draw and gizmos data plus the geometry of the
+    /// meshes created since the previous frame
+    size_t uploadBytes = 0;
+    /// @brief Vertex and index data read by the draws. Upper bound, every
+    /// vertex is counted once per draw regardless of the post transform
+    /// cache.
+    size_t fetchBytes = 0;
+
+    FrameStatistics& operator+=(const FrameStatistics& other) {
+        drawCalls += other.drawCalls;
+        triangles += other.triangles;
+        instances += other.instances;
+        stateChanges += other.stateChanges;
+        gizmoPrimitives += other.gizmoPrimitives;
+        uploadBytes += other.uploadBytes;
+        fetchBytes += other.fetchBytes;
+        return *this;
+    }
+};
+
+/**
+ * @brief Graphics backend that renders nothing.
+ *
+ * Meshes are created as MeshNull and, while recording, every frame goes
+ * through the same steps as the OpenGL backend, accounting the draws instead
+ * of issuing them: static targets merged per material, culling from the
+ * camera, imported meshes grouped into one multi-draw indirect per program
+ * and geometry pool, the rest drawn one by one. This gives deterministic,
+ * GPU free numbers of the render preparation cost and of the draw counts.
+ */
 class NullGraphicsBackend : public GraphicsBackend {
    public:
-    NullGraphicsBackend(Window* window) : GraphicsBackend(window) {}
+    NullGraphicsBackend(Window* window);
+    ~NullGraphicsBackend() override;
 
-    Mesh* createMesh(std::string filePath) override {
-        // TODO: Implement MeshNull, load the data but do nothing
-        return nullptr;
-    };
+    Mesh* createMesh(std::string filePath) override;
+    /// @brief Account the geometry of a mesh created outside of createMesh
+    /// (imported models) as uploaded on the next frame, and place it in a
+    /// geometry pool the way GeometryArena does
+    void addImportedMesh(const Mesh& mesh);
+
+    /// @brief Enable/disable the statistics recording, when disabled frames
+    /// are discarded
+    void setRecording(bool recording) { m_recording = recording; }
+    bool isRecording() const { return m_recording; }
+
+    /// @brief Statistics of the last presented frame
+    const FrameStatistics& getFrameStatistics() const { return m_lastFrame; }
+    /// @brief Statistics accumulated over all the recorded frames
+    const FrameStatistics& getTotalStatistics() const { return m_total; }
+    size_t getNumRecordedFrames() const { return m_numFrames; }
+
+    void renderDebbugGUI() override;
 
    protected:
-    void initPrimitives() override {};
-    void frameUpdate() override {};
-    void presentFrame() override {};
+    void initPrimitives() override;
+    void frameUpdate() override;
+    void presentFrame() override;
+
+    void postDrawGizmosHook() override;
+
+    void drawPrimitivePoint(glm::vec3 a, float size, glm::vec4 color) override;
+    void drawPrimitiveLine(glm::vec3 a, glm::vec3 b, glm::vec4 color) override;
+    void drawPrimitiveCube(glm::vec3 position, glm::vec3 scale,
+                           glm::vec4 color, bool wireframe = false) override;
+    void drawPrimitiveSphere(glm::vec3 position, glm::vec3 scale,
+                             glm::vec4 color, bool wireframe = false) override;
 
    private:
+    std::vector<std::unique_ptr<Mesh>> m_meshList;
+
+    bool m_recording = true;
+    bool m_multiDrawIndirectEnabled = true;
+    bool m_staticBatchingEnabled = true;
+
+    FrameStatistics m_frame;
+    FrameStatistics m_lastFrame;
+    FrameStatistics m_total;
+    size_t m_numFrames = 0;
+
+    // Geometry created outside of a frame, accounted on the next one
+    size_t m_pendingUploadBytes = 0;
+    // Line gizmos are batched into a single draw at the end of the frame
+    size_t m_numGizmosLines = 0;
+
+    /// @brief Fill level of a pool of the GeometryArena
+    struct GeometryPoolUsage {
+        size_t stride;
+        size_t indexSize;
+        size_t vertexCapacity, indexCapacity;
+        size_t numVertices = 0, numIndices = 0;
+    };
+    std::vector<GeometryPoolUsage> m_pools;
+    // Pool of each imported mesh, the meshes of createMesh own their buffers
+    std::unordered_map<const Mesh*, size_t> m_meshPools;
+
+    // Program of a draw: variant set and key, no set is the default program
+    using ProgramKey = std::pair<const ShaderVariantSet*, ShaderVariantKey>;
+    // Multi-draws of the frame per program and pool, kept to reuse the
+    // storage
+    std::map<std::pair<ProgramKey, size_t>, std::vector<const Mesh*>>
+        m_multiDraws;
+
+    std::map<Material*, std::unique_ptr<NullStaticBatch>> m_staticBatches;
+    // Dynamic render targets followed by the static batches
+    std::vector<IRenderable*> m_frameTargets;
+
+    /// @brief Same split as StaticBatcher::update, into m_frameTargets
+    void updateStaticBatches();
+    void recordMeshDraw(const Mesh* mesh);
+    void recordPrimitiveDraw(const Mesh* mesh, bool wireframe);
 };
 }  // namespace rendering
-}  // namespace v3d
\ No newline at end of file
+}  // namespace v3d
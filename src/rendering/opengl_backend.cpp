@@ -3,6 +3,9 @@
 
 #include <plog/Log.h>
 
+#include <chrono>
+#include <cstddef>
+#include <cstring>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
@@ -12,14 +15,18 @@
 #include "camera.hpp"
 #include "engine.h"
 #include "glm/glm.hpp"
+#include "imgui.h"
+#include "rendering/gl_loader.h"
+#include "rendering/material.h"
 #include "rendering/shader.h"
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
-    glViewport(0, 0, width, height);
+    // The viewport is set each frame from the framebuffer size, the context
+    // may be current on the render thread
     // PLOGV << "Window resized to " << width << "x" << height << std::endl;
 }
-// Camera
-Camera cam = Camera(glm::vec3(0, 2.5, 10));
+// Camera of the backend receiving the input
+Camera* cam = nullptr;
 bool moveCam = false;
 // timing
 float deltaTime = 0.0f;  // time between current frame and last frame
@@ -29,19 +36,19 @@ void processInput(GLFWwindow* window) {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
-    if (moveCam) {
+    if (moveCam && cam != nullptr) {
         if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-            cam.ProcessKeyboard(Camera_Movement::FORWARD, deltaTime);
+            cam->ProcessKeyboard(Camera_Movement::FORWARD, deltaTime);
         if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-            cam.ProcessKeyboard(Camera_Movement::BACKWARD, deltaTime);
+            cam->ProcessKeyboard(Camera_Movement::BACKWARD, deltaTime);
         if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-            cam.ProcessKeyboard(Camera_Movement::LEFT, deltaTime);
+            cam->ProcessKeyboard(Camera_Movement::LEFT, deltaTime);
         if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-            cam.ProcessKeyboard(Camera_Movement::RIGHT, deltaTime);
+            cam->ProcessKeyboard(Camera_Movement::RIGHT, deltaTime);
         if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
-            cam.ProcessKeyboard(Camera_Movement::UP, deltaTime);
+            cam->ProcessKeyboard(Camera_Movement::UP, deltaTime);
         if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
-            cam.ProcessKeyboard(Camera_Movement::DOWN, deltaTime);
+            cam->ProcessKeyboard(Camera_Movement::DOWN, deltaTime);
     }
 }
 
@@ -63,7 +70,7 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
     lastX = xpos;
     lastY = ypos;
 
-    if (moveCam) cam.ProcessMouseMovement(xoffset, yoffset);
+    if (moveCam && cam != nullptr) cam->ProcessMouseMovement(xoffset, yoffset);
 
     // std::cout << xpos << ",	" << ypos << std::endl;
 }
@@ -86,7 +93,7 @@ void mouse_button_callback(GLFWwindow* window, int button, int action,
 // glfw: whenever the mouse scroll wheel scrolls, this callback is called
 // ----------------------------------------------------------------------
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
-    if (moveCam) cam.ProcessMouseScroll(yoffset);
+    if (moveCam && cam != nullptr) cam->ProcessMouseScroll(yoffset);
 }
 
 bool bunny_loaded = false;
@@ -94,19 +101,20 @@ bool bunny_loaded = false;
 // TODO: Integrate with camera
 glm::mat4 model = glm::rotate(glm::mat4(1.0f), glm::radians(-55.0f),
                               glm::vec3(1.0f, 0.0f, 0.0f));
-glm::mat4 view;
-glm::mat4 projection;
 
 Shader* shader;
 Shader* shaderGrid;
+Shader* shaderIndirect;
+Shader* shaderGizmosLine;
 
 namespace v3d {
 namespace rendering {
 OpenGlBackend::OpenGlBackend(Window* window) : GraphicsBackend(window) {
+    cam = &m_camera;
     PLOGI << "Initializing OpenGL" << std::endl;
 
     PLOGD << "Initializing GLAD" << std::endl;
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+    if (!gladLoadGLLoader((GLADloadproc)getGLProcAddress)) {
         PLOGE << "Failed to initialize GLAD" << std::endl;
         throw std::runtime_error("Failed to initialize GLAD");
     }
@@ -120,8 +128,50 @@ OpenGlBackend::OpenGlBackend(Window* window) : GraphicsBackend(window) {
     glfwSetScrollCallback(m_window->getWindow(), scroll_callback);
     glfwSetMouseButtonCallback(m_window->getWindow(), mouse_button_callback);
 
-    shader = new Shader("resources/shaders/SimpleShader.glsl");
-    shaderGrid = new Shader("resources/shaders/GridShader.glsl");
+    // Programs are loaded from the binary cache when possible, the rest is
+    // compiled as a batch
+    const auto shaderLoadStart = std::chrono::steady_clock::now();
+    m_shaderCache = std::make_unique<ShaderCache>(ShaderCacheDirectory);
+    Shader::setProgramCache(m_shaderCache.get());
+
+    std::vector<Shader*> shaders =
+        Shader::loadBatch({"resources/shaders/SimpleShader.glsl",
+                           "resources/shaders/GridShader.glsl",
+                           "resources/shaders/SimpleIndirectShader.glsl",
+                           "resources/shaders/GizmosLineShader.glsl"});
+    shader = shaders[0];
+    shaderGrid = shaders[1];
+    shaderIndirect = shaders[2];
+    shaderGizmosLine = shaders[3];
+
+    m_shaderLoadTime = std::chrono::duration<double, std::milli>(
+                           std::chrono::steady_clock::now() - shaderLoadStart)
+                           .count();
+    PLOGI << "Shaders loaded in " << m_shaderLoadTime << " ms ("
+          << m_shaderCache->getNumHits() << " from cache, "
+          << m_shaderCache->getNumMisses() << " compiled"
+          << (parallel_compile::isAvailable() ? " in parallel" : "") << ")\n";
+
+    m_streamBuffer = std::make_unique<StreamBuffer>(StreamBufferRegionSize);
+    m_geometryArena = std::make_unique<GeometryArena>(m_streamBuffer.get());
+    m_staticBatcher = std::make_unique<StaticBatcher>(
+        [this](const std::function<void()>& work) { runOnRenderThread(work); });
+
+    // Line gizmos read their vertices straight from the stream buffer
+    glGenVertexArrays(1, &m_gizmosLinesVAO);
+    glBindVertexArray(m_gizmosLinesVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_streamBuffer->getBuffer());
+    using GizmosLineVertex = RenderSnapshot::GizmosLineVertex;
+    glVertexAttribPointer(
+        0, 3, GL_FLOAT, GL_FALSE, sizeof(GizmosLineVertex),
+        reinterpret_cast<const void*>(offsetof(GizmosLineVertex, position)));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(
+        1, 4, GL_FLOAT, GL_FALSE, sizeof(GizmosLineVertex),
+        reinterpret_cast<const void*>(offsetof(GizmosLineVertex, color)));
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 
     glEnable(GL_DEPTH_TEST);
     glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
@@ -135,6 +185,11 @@ OpenGlBackend::OpenGlBackend(Window* window) : GraphicsBackend(window) {
     initPrimitives();
 }
 
+OpenGlBackend::~OpenGlBackend() {
+    Shader::setProgramCache(nullptr);
+    if (cam == &m_camera) cam = nullptr;
+}
+
 GLuint createGridVAO(int halfSize, float spacing, GLsizei& vertexCount) {
     std::vector<float> vertices;
 
@@ -202,104 +257,306 @@ void drawGrid() {
 }  // namespace v3d
 
 void v3d::rendering::OpenGlBackend::frameUpdate() {
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    m_frameSnapshot.clear();
+    captureScene(m_frameSnapshot);
+    renderScene(m_frameSnapshot);
+}
+
+void v3d::rendering::OpenGlBackend::captureFrame(RenderSnapshot& frame) {
+    captureScene(frame);
 
+    m_capturing = true;
+    drawGizmos();
+    m_capturing = false;
+    frame.gizmosLines.swap(m_gizmosLines);
+    frame.gizmosPrimitives.swap(m_gizmosPrimitives);
+    m_gizmosLines.clear();
+    m_gizmosPrimitives.clear();
+}
+
+void v3d::rendering::OpenGlBackend::renderFrame(RenderSnapshot& frame) {
+    renderScene(frame);
+    renderGizmos(frame, frame.gizmosLines, frame.gizmosPrimitives);
+}
+
+glm::ivec2 v3d::rendering::OpenGlBackend::getViewportSize() {
+    glm::ivec2 size;
+    glfwGetFramebufferSize(m_window->getWindow(), &size.x, &size.y);
+    return size;
+}
+
+void v3d::rendering::OpenGlBackend::captureScene(RenderSnapshot& frame) {
     float currentFrame = glfwGetTime();
     deltaTime = currentFrame - lastFrame;
     lastFrame = currentFrame;
 
     processInput(m_window->getWindow());
 
-    // Rotate over time
-    const float radius = 5.f;
-    const float frequency = 1.f;
-    float camX = sin(glfwGetTime() * frequency) * radius;
-    float camZ = cos(glfwGetTime() * frequency) * radius;
+    frame.viewport = getViewportSize();
+    frame.view = getCameraView();
+    frame.projection = getCameraProjection();
+
+    m_staticBatcher->update(m_renderTargets, m_frameRenderTargets);
+    cullRenderTargets(frame.projection * frame.view, m_frameRenderTargets);
+
+    // The shader variant is resolved when drawing, it depends on the draw
+    // path. Material parameters are copied only when modified.
+    for (auto renderTarget : m_visibleRenderTargets) {
+        auto mesh =
+            dynamic_cast<const MeshOpenGL*>(renderTarget->getRenderMesh());
+        if (mesh == nullptr) continue;
+
+        RenderSnapshot::Draw draw{mesh, renderTarget->getModelMatrix(),
+                                  nullptr, 0, nullptr};
+        Material* material = renderTarget->getMaterial();
+        if (material != nullptr) {
+            draw.shader = material->getShaderVariants();
+            draw.variantKey = material->getVariantKey();
+            draw.material = material;
+            if (material->isDirty()) {
+                frame.materialUpdates.push_back(
+                    {material, draw.shader, material->getData()});
+                material->clearDirty();
+            }
+        }
+        frame.draws.push_back(draw);
+    }
+}
+
+void v3d::rendering::OpenGlBackend::renderScene(const RenderSnapshot& frame) {
+    m_streamBuffer->beginFrame();
 
-    view = cam.GetViewMatrix();
-    projection = glm::perspective(
-        glm::radians(cam.Zoom),
-        1.f * m_window->getWidth() / m_window->getHeight(), 0.1f, 100.0f);
+    glViewport(0, 0, frame.viewport.x, frame.viewport.y);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     shader->bind();
-    shader->setMat4("view", view);
-    shader->setMat4("projection", projection);
+    shader->setMat4("view", frame.view);
+    shader->setMat4("projection", frame.projection);
     shader->setVector("dye_color", glm::vec4(1, 1, 1, 1));
 
     drawGrid();
 
-    for (auto renderTarget : m_renderTargets) {
-        renderTarget->setUniforms(shader);
-        renderTarget->renderElement();
+    for (const auto& update : frame.materialUpdates) {
+        MaterialBuffer* buffer = getMaterialBuffer(update.shader);
+        buffer->write(buffer->getIndex(update.material), update.data);
+    }
+
+    // Meshes living in the geometry arena are batched into indirect draws,
+    // everything else is drawn one by one. Material parameters live in a
+    // buffer per shader and each draw carries the index of its record, so
+    // draws with different parameters don't need uniform changes.
+    m_geometryArena->clearDraws();
+    m_forwardDraws.clear();
+    m_programMaterialBuffers.clear();
+    for (const auto& frameDraw : frame.draws) {
+        auto mesh = static_cast<const MeshOpenGL*>(frameDraw.mesh);
+        const bool indirect =
+            m_multiDrawIndirectEnabled && mesh->isArenaAllocated();
+
+        ForwardDraw draw{mesh, frameDraw.model, nullptr, 0};
+        if (frameDraw.shader != nullptr) {
+            draw.program = frameDraw.shader->getVariant(
+                frameDraw.variantKey |
+                (indirect ? ShaderVariantSet::IndirectDrawBit : 0));
+            MaterialBuffer* buffer = getMaterialBuffer(frameDraw.shader);
+            draw.materialIndex = buffer->getIndex(frameDraw.material);
+            if (draw.program != nullptr)
+                m_programMaterialBuffers[draw.program] = buffer;
+        }
+
+        if (indirect) {
+            m_geometryArena->addDraw(mesh, draw.model, draw.program,
+                                     draw.materialIndex);
+            continue;
+        }
+        m_forwardDraws.push_back(draw);
+    }
+
+    for (auto& [variants, buffer] : m_materialBuffers) buffer->flush();
+
+    Shader* boundShader = shader;
+    for (const auto& draw : m_forwardDraws) {
+        Shader* targetShader = draw.program != nullptr ? draw.program : shader;
+        if (targetShader != boundShader) {
+            bindProgram(targetShader, frame);
+            boundShader = targetShader;
+        }
+
+        if (draw.program != nullptr)
+            targetShader->setInt("materialIndex", draw.materialIndex);
+        // Quantized positions are expanded to the mesh local space first
+        targetShader->setMat4("model",
+                              draw.model * draw.mesh->getVertexTransform());
+        targetShader->setMat3(
+            "normalMatrix", glm::transpose(glm::inverse(glm::mat3(draw.model))));
+        draw.mesh->draw();
+    }
+
+    m_geometryArena->submitDraws([this, &frame](Shader* program) {
+        if (program != nullptr) {
+            bindProgram(program, frame);
+            return;
+        }
+        shaderIndirect->bind();
+        shaderIndirect->setMat4("view", frame.view);
+        shaderIndirect->setMat4("projection", frame.projection);
+        shaderIndirect->setVector("dye_color", glm::vec4(1, 1, 1, 1));
+    });
+}
+
+void v3d::rendering::OpenGlBackend::bindProgram(Shader* program,
+                                                const RenderSnapshot& frame) {
+    program->bind();
+    program->setMat4("view", frame.view);
+    program->setMat4("projection", frame.projection);
+
+    auto it = m_programMaterialBuffers.find(program);
+    if (it != m_programMaterialBuffers.end()) it->second->bind();
+}
+
+v3d::rendering::MaterialBuffer*
+v3d::rendering::OpenGlBackend::getMaterialBuffer(ShaderVariantSet* variants) {
+    auto& buffer = m_materialBuffers[variants];
+    if (!buffer)
+        buffer = std::make_unique<MaterialBuffer>(
+            variants->getMaterialLayout().getStride());
+    return buffer.get();
+}
+
+v3d::rendering::ShaderVariantSet*
+v3d::rendering::OpenGlBackend::getShaderVariants(
+    const std::string& shaderPath) {
+    auto& variants = m_shaderVariants[shaderPath];
+    if (!variants) variants = std::make_unique<ShaderVariantSet>(shaderPath);
+    return variants.get();
+}
+
+void v3d::rendering::OpenGlBackend::renderDebbugGUI() {
+    GraphicsBackend::renderDebbugGUI();
+    ImGui::Checkbox("Multi-Draw Indirect", &m_multiDrawIndirectEnabled);
+    bool staticBatching = m_staticBatcher->isEnabled();
+    if (ImGui::Checkbox("Static Batching", &staticBatching))
+        m_staticBatcher->setEnabled(staticBatching);
+    ImGui::Text("Static batches: %zu (%zu targets), %zu rebuilds, last %.1f ms",
+                m_staticBatcher->getNumBatches(),
+                m_staticBatcher->getNumBatchedTargets(),
+                m_staticBatcher->getNumRebuilds(),
+                m_staticBatcher->getLastRebuildTime());
+    ImGui::Text("Indirect draws: %zu in %zu multi-draw calls",
+                m_geometryArena->getNumDraws(),
+                m_geometryArena->getNumMultiDraws());
+    ImGui::Text("Geometry pools: %zu (%.1f / %.1f MB)",
+                m_geometryArena->getNumPools(),
+                m_geometryArena->getUsedBytes() / (1024.0 * 1024.0),
+                m_geometryArena->getCapacityBytes() / (1024.0 * 1024.0));
+    ImGui::Text("Stream buffer: %s, %.1f / %.1f KB per frame",
+                m_streamBuffer->isPersistent() ? "persistent" : "sub data",
+                m_streamBuffer->getFrameUsage() / 1024.0,
+                m_streamBuffer->getRegionSize() / 1024.0);
+    ImGui::Text("Stream stalls: %zu  Overflows: %zu",
+                m_streamBuffer->getNumStalls(),
+                m_streamBuffer->getNumOverflows());
+    ImGui::Text("Shaders: %.1f ms, %zu cached, %zu compiled", m_shaderLoadTime,
+                m_shaderCache->getNumHits(), m_shaderCache->getNumMisses());
+    for (auto& [path, variants] : m_shaderVariants) {
+        auto buffer = m_materialBuffers.find(variants.get());
+        ImGui::Text("%s: %zu variants, %zu materials", path.c_str(),
+                    variants->getNumCompiledVariants(),
+                    buffer != m_materialBuffers.end()
+                        ? buffer->second->getNumMaterials()
+                        : size_t(0));
     }
 }
 
 void v3d::rendering::OpenGlBackend::presentFrame() {
+    // All the draws reading this frame region have been issued
+    m_streamBuffer->endFrame();
     glfwSwapBuffers(m_window->getWindow());
 }
 void v3d::rendering::OpenGlBackend::preDrawGizmosHook() {
-    glDisable(GL_DEPTH_TEST);
+    m_gizmosLines.clear();
+    m_gizmosPrimitives.clear();
 }
 void v3d::rendering::OpenGlBackend::postDrawGizmosHook() {
-    glEnable(GL_DEPTH_TEST);
+    // Captured gizmos are drawn by renderFrame
+    if (m_capturing) return;
+    renderGizmos(m_frameSnapshot, m_gizmosLines, m_gizmosPrimitives);
+    m_gizmosLines.clear();
+    m_gizmosPrimitives.clear();
 }
 
 void v3d::rendering::OpenGlBackend::drawPrimitiveLine(glm::vec3 a, glm::vec3 b,
-                                                      float size,
                                                       glm::vec4 color) {
-    return;
+    // Drawn as GL_LINES, the core profile only guarantees 1 pixel wide lines
+    m_gizmosLines.push_back({a, color});
+    m_gizmosLines.push_back({b, color});
 }
 
 void v3d::rendering::OpenGlBackend::drawPrimitiveCube(glm::vec3 position,
                                                       glm::vec3 scale,
                                                       glm::vec4 color,
                                                       bool wireframe) {
-    view = cam.GetViewMatrix();
-    projection = glm::perspective(
-        glm::radians(cam.Zoom),
-        1.f * m_window->getWidth() / m_window->getHeight(), 0.1f, 100.0f);
-
-    shader->bind();
-    shader->setMat4("view", view);
-    shader->setMat4("projection", projection);
-    shader->setVector("dye_color", color);
-
     glm::mat4 pmodel = glm::translate(glm::mat4(1.0f), position);
-    glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(pmodel)));
     pmodel = glm::scale(pmodel, scale);
-
-    shader->setMat4("model", pmodel);
-    shader->setMat3("normalMatrix", normalMatrix);
-
-    if (wireframe) glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    m_primitives.m_cube->draw();
-    if (wireframe) glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    m_gizmosPrimitives.push_back(
+        {m_primitives.m_cube, pmodel, color, wireframe});
 }
 
 void v3d::rendering::OpenGlBackend::drawPrimitiveSphere(glm::vec3 position,
                                                         glm::vec3 scale,
                                                         glm::vec4 color,
                                                         bool wireframe) {
-    view = cam.GetViewMatrix();
-    projection = glm::perspective(
-        glm::radians(cam.Zoom),
-        1.f * m_window->getWidth() / m_window->getHeight(), 0.1f, 100.0f);
-
-    shader->bind();
-    shader->setMat4("view", view);
-    shader->setMat4("projection", projection);
-    shader->setVector("dye_color", color);
-
     glm::mat4 pmodel = glm::translate(glm::mat4(1.0f), position);
-    glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(pmodel)));
     pmodel = glm::scale(pmodel, scale);
+    m_gizmosPrimitives.push_back(
+        {m_primitives.m_sphere, pmodel, color, wireframe});
+}
 
-    shader->setMat4("model", pmodel);
-    shader->setMat3("normalMatrix", normalMatrix);
+void v3d::rendering::OpenGlBackend::renderGizmos(
+    const RenderSnapshot& frame,
+    const std::vector<RenderSnapshot::GizmosLineVertex>& lines,
+    const std::vector<RenderSnapshot::GizmosPrimitive>& primitives) {
+    glDisable(GL_DEPTH_TEST);
+
+    shader->bind();
+    shader->setMat4("view", frame.view);
+    shader->setMat4("projection", frame.projection);
+    // Gizmos are not rotated
+    shader->setMat3("normalMatrix", glm::mat3(1.0f));
+    for (const auto& primitive : primitives) {
+        shader->setVector("dye_color", primitive.color);
+        shader->setMat4("model", primitive.model);
+
+        if (primitive.wireframe) glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        primitive.mesh->draw();
+        if (primitive.wireframe) glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    }
 
-    if (wireframe) glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    m_primitives.m_sphere->draw();
-    if (wireframe) glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    using GizmosLineVertex = RenderSnapshot::GizmosLineVertex;
+    if (!lines.empty()) {
+        // Aligned to the vertex size so the offset maps to the first vertex
+        const size_t bytes = lines.size() * sizeof(GizmosLineVertex);
+        StreamBuffer::Allocation allocation =
+            m_streamBuffer->allocate(bytes, sizeof(GizmosLineVertex));
+
+        if (allocation.isValid()) {
+            std::memcpy(allocation.data, lines.data(), bytes);
+            m_streamBuffer->flush();
+
+            shaderGizmosLine->bind();
+            shaderGizmosLine->setMat4("view", frame.view);
+            shaderGizmosLine->setMat4("projection", frame.projection);
+
+            glBindVertexArray(m_gizmosLinesVAO);
+            glDrawArrays(GL_LINES,
+                         static_cast<GLint>(allocation.offset /
+                                            sizeof(GizmosLineVertex)),
+                         static_cast<GLsizei>(lines.size()));
+            glBindVertexArray(0);
+        }
+    }
+
+    glEnable(GL_DEPTH_TEST);
 }
 
 v3d::Mesh* v3d::rendering::OpenGlBackend::createMesh(std::string filePath) {
@@ -1,9 +1,18 @@
 #pragma once
 
 #include <iostream>
+#include <memory>
+#include <unordered_map>
 
 #include "Mesh.h"
+#include "rendering/geometry_arena.h"
 #include "rendering/graphics_backend.h"
+#include "rendering/material_buffer.h"
+#include "rendering/render_snapshot.h"
+#include "rendering/shader_cache.h"
+#include "rendering/shader_variants.h"
+#include "rendering/static_batcher.h"
+#include "rendering/stream_buffer.h"
 
 namespace v3d {
 namespace rendering {
@@ -11,8 +20,19 @@ namespace rendering {
 class OpenGlBackend : public GraphicsBackend {
    public:
     OpenGlBackend(Window* window);
+    ~OpenGlBackend() override;
 
     Mesh* createMesh(std::string filePath) override;
+    GeometryArena* getGeometryArena() override {
+        return m_geometryArena.get();
+    }
+    ShaderVariantSet* getShaderVariants(const std::string& shaderPath) override;
+
+    void renderDebbugGUI() override;
+
+    bool supportsRenderThread() const override { return true; }
+    void captureFrame(RenderSnapshot& frame) override;
+    void renderFrame(RenderSnapshot& frame) override;
 
    protected:
     void initPrimitives() override;
@@ -22,14 +42,72 @@ class OpenGlBackend : public GraphicsBackend {
     void postDrawGizmosHook() override;
 
     // Primitive draw
-    void drawPrimitiveLine(glm::vec3 a, glm::vec3 b, float size, glm::vec4 color) override;
+    void drawPrimitiveLine(glm::vec3 a, glm::vec3 b, glm::vec4 color) override;
     void drawPrimitiveCube(glm::vec3 position, glm::vec3 scale, glm::vec4 color,
                            bool wireframe) override;
     void drawPrimitiveSphere(glm::vec3 position, glm::vec3 scale,
                              glm::vec4 color, bool wireframe) override;
 
+    /// @brief Size of the default framebuffer, in pixels
+    virtual glm::ivec2 getViewportSize();
+
+    // Per frame dynamic data, 3 frames in flight
+    static constexpr size_t StreamBufferRegionSize = 4 * 1024 * 1024;
+    std::unique_ptr<StreamBuffer> m_streamBuffer;
+
    private:
     std::vector<MeshOpenGL*> m_meshList;
+
+    static constexpr const char* ShaderCacheDirectory = "shader_cache";
+    std::unique_ptr<ShaderCache> m_shaderCache;
+    double m_shaderLoadTime = 0;  // ms
+    std::unordered_map<std::string, std::unique_ptr<ShaderVariantSet>>
+        m_shaderVariants;
+
+    // Packed material parameters, one buffer per shader
+    std::unordered_map<ShaderVariantSet*, std::unique_ptr<MaterialBuffer>>
+        m_materialBuffers;
+    // Material buffer read by each program drawn this frame
+    std::unordered_map<Shader*, MaterialBuffer*> m_programMaterialBuffers;
+
+    struct ForwardDraw {
+        const MeshOpenGL* mesh;
+        glm::mat4 model;
+        Shader* program;  // nullptr for the default shader
+        GLuint materialIndex;
+    };
+    std::vector<ForwardDraw> m_forwardDraws;
+
+    std::unique_ptr<GeometryArena> m_geometryArena;
+    bool m_multiDrawIndirectEnabled = true;
+
+    // Static render targets merged per material
+    std::unique_ptr<StaticBatcher> m_staticBatcher;
+    // Registered render targets with the static ones replaced by batches
+    std::vector<IRenderable*> m_frameRenderTargets;
+
+    // Frame drawn by update() when there is no render thread
+    RenderSnapshot m_frameSnapshot;
+    // Gizmos are recorded into the snapshot instead of drawn
+    bool m_capturing = false;
+
+    // Gizmos recorded since the last draw, lines are streamed and drawn in a
+    // single call
+    std::vector<RenderSnapshot::GizmosLineVertex> m_gizmosLines;
+    std::vector<RenderSnapshot::GizmosPrimitive> m_gizmosPrimitives;
+    unsigned int m_gizmosLinesVAO = 0;
+
+    /// @brief Record the scene of the frame, without graphics calls
+    void captureScene(RenderSnapshot& frame);
+    /// @brief Draw the scene of a captured frame
+    void renderScene(const RenderSnapshot& frame);
+    void renderGizmos(
+        const RenderSnapshot& frame,
+        const std::vector<RenderSnapshot::GizmosLineVertex>& lines,
+        const std::vector<RenderSnapshot::GizmosPrimitive>& primitives);
+    MaterialBuffer* getMaterialBuffer(ShaderVariantSet* variants);
+    /// @brief Bind a program with the frame camera and its material buffer
+    void bindProgram(Shader* program, const RenderSnapshot& frame);
 };
 }  // namespace rendering
 }  // namespace v3d
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include "opengl_offscreen_backend.h"
+
+#include <glad/glad.h>
+#include <plog/Log.h>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+#include "imgui.h"
+#include "utils/image_writer.hpp"
+
+namespace v3d {
+namespace rendering {
+
+OpenGlOffscreenBackend::OpenGlOffscreenBackend(Window* window,
+                                               const OffscreenSettings& settings)
+    : OpenGlBackend(window),
+      m_settings(settings),
+      m_width(window->getWidth()),
+      m_height(window->getHeight()) {
+    PLOGI << "Initializing OpenGL offscreen framebuffer " << m_width << "x"
+          << m_height << std::endl;
+    PLOGI << "GL renderer: " << glGetString(GL_RENDERER) << " ("
+          << glGetString(GL_VERSION) << ")" << std::endl;
+
+    glGenFramebuffers(1, &m_FBO);
+    glGenRenderbuffers(1, &m_colorRBO);
+    glGenRenderbuffers(1, &m_depthRBO);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, m_colorRBO);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, m_width, m_height);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depthRBO);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_width,
+                          m_height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                              GL_RENDERBUFFER, m_colorRBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                              GL_RENDERBUFFER, m_depthRBO);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        PLOGE << "Offscreen framebuffer is not complete" << std::endl;
+        throw std::runtime_error("Offscreen framebuffer is not complete");
+    }
+
+    if (m_settings.dumpFormat != FrameDumpFormat::NONE) {
+        std::filesystem::create_directories(m_settings.dumpDirectory);
+        m_readbackBuffer.resize(static_cast<size_t>(m_width) * m_height * 4);
+        PLOGI << "Dumping frames to " << m_settings.dumpDirectory << std::endl;
+    }
+
+    m_startTime = m_intervalStart = Clock::now();
+}
+
+OpenGlOffscreenBackend::~OpenGlOffscreenBackend() {
+    const double seconds =
+        std::chrono::duration<double>(Clock::now() - m_startTime).count();
+    if (m_frameCount > 0 && seconds > 0) {
+        PLOGI << "Offscreen render throughput: " << m_frameCount
+              << " frames in " << seconds << " s, "
+              << m_frameCount / seconds << " fps, "
+              << 1000.0 * seconds / m_frameCount << " ms/frame ("
+              << m_dumpCount << " dumps, " << 1000.0 * m_dumpSeconds
+              << " ms dumping)" << std::endl;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &m_FBO);
+    glDeleteRenderbuffers(1, &m_colorRBO);
+    glDeleteRenderbuffers(1, &m_depthRBO);
+}
+
+void OpenGlOffscreenBackend::frameUpdate() {
+    // Everything of the frame, including the GUI, lands in the FBO
+    glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+    OpenGlBackend::frameUpdate();
+}
+
+void OpenGlOffscreenBackend::presentFrame() {
+    m_streamBuffer->endFrame();
+
+    m_frameCount++;
+    if (m_settings.dumpFormat != FrameDumpFormat::NONE &&
+        m_settings.dumpInterval > 0 &&
+        (m_frameCount - 1) % m_settings.dumpInterval == 0)
+        dumpFrame();
+
+    if (m_settings.statsInterval > 0 &&
+        m_frameCount % m_settings.statsInterval == 0)
+        logThroughput();
+}
+
+void OpenGlOffscreenBackend::dumpFrame() {
+    const auto dumpStart = Clock::now();
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_FBO);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE,
+                 m_readbackBuffer.data());
+
+    // GL origin is bottom left, images are stored top to bottom
+    const size_t rowSize = static_cast<size_t>(m_width) * 4;
+    std::vector<uint8_t> row(rowSize);
+    for (uint32_t y = 0; y < m_height / 2; y++) {
+        uint8_t* top = m_readbackBuffer.data() + y * rowSize;
+        uint8_t* bottom = m_readbackBuffer.data() + (m_height - 1 - y) * rowSize;
+        std::memcpy(row.data(), top, rowSize);
+        std::memcpy(top, bottom, rowSize);
+        std::memcpy(bottom, row.data(), rowSize);
+    }
+
+    char fileName[64];
+    std::snprintf(fileName, sizeof(fileName), "frame_%06llu.%s",
+                  static_cast<unsigned long long>(m_frameCount - 1),
+                  m_settings.dumpFormat == FrameDumpFormat::PNG ? "png"
+                                                                : "rgba");
+    const std::string path =
+        (std::filesystem::path(m_settings.dumpDirectory) / fileName).string();
+
+    bool written =
+        m_settings.dumpFormat == FrameDumpFormat::PNG
+            ? utils::writePNG(path, m_width, m_height, m_readbackBuffer.data())
+            : utils::writeRaw(path, m_readbackBuffer.data(),
+                              m_readbackBuffer.size());
+    if (!written) PLOGE << "Failed to write frame dump " << path << std::endl;
+
+    m_dumpCount++;
+    m_dumpSeconds +=
+        std::chrono::duration<double>(Clock::now() - dumpStart).count();
+}
+
+void OpenGlOffscreenBackend::logThroughput() {
+    const auto now = Clock::now();
+    const double seconds =
+        std::chrono::duration<double>(now - m_intervalStart).count();
+    m_intervalStart = now;
+    if (seconds <= 0) return;
+
+    m_lastIntervalFps = m_settings.statsInterval / seconds;
+    PLOGI << "Offscreen frames " << m_frameCount << ": " << m_lastIntervalFps
+          << " fps, " << 1000.0 * seconds / m_settings.statsInterval
+          << " ms/frame" << std::endl;
+}
+
+void OpenGlOffscreenBackend::renderDebbugGUI() {
+    OpenGlBackend::renderDebbugGUI();
+    ImGui::Text("Offscreen %ux%u, frame %llu, %.1f fps", m_width, m_height,
+                static_cast<unsigned long long>(m_frameCount),
+                m_lastIntervalFps);
+}
+
+}  // namespace rendering
+}  // namespace v3d
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "rendering/opengl_backend.h"
+
+namespace v3d {
+namespace rendering {
+
+enum class FrameDumpFormat { NONE, PNG, RAW };
+
+struct OffscreenSettings {
+    OffscreenContextAPI contextApi = OffscreenContextAPI::EGL;
+    FrameDumpFormat dumpFormat = FrameDumpFormat::NONE;
+    std::string dumpDirectory = "frames";
+    /// @brief Dump one frame every dumpInterval frames
+    uint32_t dumpInterval = 1;
+    /// @brief Frames between render throughput logs
+    uint32_t statsInterval = 120;
+};
+
+/**
+ * @brief OpenGL backend rendering into a framebuffer object, without a
+ * visible window or display server. The context comes from the offscreen
+ * Window (EGL surfaceless or OSMesa), so it runs on CI or compute nodes with
+ * a software rasterizer such as Mesa llvmpipe.
+ */
+class OpenGlOffscreenBackend : public OpenGlBackend {
+   public:
+    OpenGlOffscreenBackend(Window* window, const OffscreenSettings& settings);
+    ~OpenGlOffscreenBackend() override;
+
+    void renderDebbugGUI() override;
+
+    /// @brief The surfaceless contexts are kept on the creating thread
+    bool supportsRenderThread() const override { return false; }
+
+   protected:
+    void frameUpdate() override;
+    void presentFrame() override;
+    glm::ivec2 getViewportSize() override {
+        return glm::ivec2(m_width, m_height);
+    }
+
+   private:
+    OffscreenSettings m_settings;
+    uint32_t m_width = 0, m_height = 0;
+    unsigned int m_FBO = 0, m_colorRBO = 0, m_depthRBO = 0;
+
+    std::vector<uint8_t> m_readbackBuffer;
+
+    // Throughput stats
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point m_startTime;
+    Clock::time_point m_intervalStart;
+    uint64_t m_frameCount = 0;
+    uint64_t m_dumpCount = 0;
+    double m_dumpSeconds = 0;
+    double m_lastIntervalFps = 0;
+
+    void dumpFrame();
+    void logThroughput();
+};
+
+}  // namespace rendering
+}  // namespace v3d
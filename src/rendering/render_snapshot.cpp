@@ -0,0 +1,55 @@
+#include "render_snapshot.h"
+
+namespace v3d {
+namespace rendering {
+
+GuiSnapshot::~GuiSnapshot() {
+    for (auto drawList : m_drawLists) IM_DELETE(drawList);
+}
+
+void GuiSnapshot::capture(const ImDrawData* drawData) {
+    clear();
+    if (drawData == nullptr || !drawData->Valid) return;
+
+    m_drawData.Valid = true;
+    m_drawData.TotalIdxCount = drawData->TotalIdxCount;
+    m_drawData.TotalVtxCount = drawData->TotalVtxCount;
+    m_drawData.DisplayPos = drawData->DisplayPos;
+    m_drawData.DisplaySize = drawData->DisplaySize;
+    m_drawData.FramebufferScale = drawData->FramebufferScale;
+    m_drawData.OwnerViewport = drawData->OwnerViewport;
+    // Processed by the game thread before the capture
+    m_drawData.Textures = nullptr;
+
+    for (int i = 0; i < drawData->CmdListsCount; i++) {
+        if (static_cast<size_t>(i) >= m_drawLists.size())
+            m_drawLists.push_back(
+                IM_NEW(ImDrawList)(ImGui::GetDrawListSharedData()));
+
+        ImDrawList* copy = m_drawLists[i];
+        const ImDrawList* source = drawData->CmdLists[i];
+        copy->CmdBuffer = source->CmdBuffer;
+        copy->IdxBuffer = source->IdxBuffer;
+        copy->VtxBuffer = source->VtxBuffer;
+        copy->Flags = source->Flags;
+        m_drawData.CmdLists.push_back(copy);
+    }
+    m_drawData.CmdListsCount = m_drawData.CmdLists.Size;
+    m_valid = true;
+}
+
+void GuiSnapshot::clear() {
+    m_valid = false;
+    m_drawData.Clear();
+}
+
+void RenderSnapshot::clear() {
+    draws.clear();
+    materialUpdates.clear();
+    gizmosLines.clear();
+    gizmosPrimitives.clear();
+    gui.clear();
+}
+
+}  // namespace rendering
+}  // namespace v3d
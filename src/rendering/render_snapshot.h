@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "imgui.h"
+#include "rendering/shader_variants.h"
+
+namespace v3d {
+class Mesh;
+
+namespace rendering {
+class Material;
+
+/**
+ * @brief Copy of the ImGui draw data of a frame.
+ *
+ * ImGui rewrites its draw lists on the next NewFrame, the copy lets the
+ * render thread draw a frame while the game thread builds the GUI of the
+ * next one. The texture requests are not copied, they must be processed
+ * before the capture (see ImGui_ImplOpenGL3_UpdateTexture). The copied draw
+ * lists are reused from frame to frame.
+ */
+class GuiSnapshot {
+   public:
+    GuiSnapshot() = default;
+    ~GuiSnapshot();
+
+    GuiSnapshot(const GuiSnapshot&) = delete;
+    GuiSnapshot& operator=(const GuiSnapshot&) = delete;
+
+    void capture(const ImDrawData* drawData);
+    void clear();
+    /// @return Null if nothing was captured
+    ImDrawData* getDrawData() { return m_valid ? &m_drawData : nullptr; }
+
+   private:
+    bool m_valid = false;
+    ImDrawData m_drawData;
+    std::vector<ImDrawList*> m_drawLists;
+};
+
+/**
+ * @brief Everything needed to draw a frame, recorded by the game thread and
+ * consumed by the render thread. It only references immutable resources
+ * (meshes, shaders) and copies all the scene state, so the game thread is
+ * free to update the scene while the frame is being drawn.
+ */
+struct RenderSnapshot {
+    glm::mat4 view = glm::mat4(1.f);
+    glm::mat4 projection = glm::mat4(1.f);
+    glm::ivec2 viewport = glm::ivec2(0);
+
+    struct Draw {
+        const Mesh* mesh;
+        glm::mat4 model;
+        /// @brief Shader of the material, null for the default shader
+        ShaderVariantSet* shader;
+        ShaderVariantKey variantKey;
+        Material* material;
+    };
+    /// @brief Visible render targets, after culling and LOD selection
+    std::vector<Draw> draws;
+
+    /// @brief New parameters of the materials modified since the last frame
+    struct MaterialUpdate {
+        Material* material;
+        ShaderVariantSet* shader;
+        std::vector<unsigned char> data;
+    };
+    std::vector<MaterialUpdate> materialUpdates;
+
+    struct GizmosLineVertex {
+        glm::vec3 position;
+        glm::vec4 color;
+    };
+    std::vector<GizmosLineVertex> gizmosLines;
+
+    struct GizmosPrimitive {
+        const Mesh* mesh;
+        glm::mat4 model;
+        glm::vec4 color;
+        bool wireframe;
+    };
+    std::vector<GizmosPrimitive> gizmosPrimitives;
+
+    GuiSnapshot gui;
+
+    /// @brief Reset for the next capture, keeping the storage
+    void clear();
+};
+
+}  // namespace rendering
+}  // namespace v3d
@@ -0,0 +1,165 @@
+#include "render_thread.h"
+
+#include <plog/Log.h>
+
+#include <chrono>
+#include <stdexcept>
+
+#include "window.h"
+
+namespace v3d {
+namespace rendering {
+
+RenderThread::RenderThread(Window* window, size_t numSnapshots,
+                           RenderFunction render)
+    : m_window(window), m_render(std::move(render)) {
+    if (numSnapshots < 2)
+        throw std::invalid_argument(
+            "RenderThread requires at least 2 snapshots");
+
+    for (size_t i = 0; i < numSnapshots; i++) {
+        m_snapshots.push_back(std::make_unique<RenderSnapshot>());
+        m_freeSnapshots.push_back(m_snapshots.back().get());
+    }
+
+    // A context can only be current on one thread at a time
+    glfwMakeContextCurrent(nullptr);
+    m_thread = std::thread(&RenderThread::threadMain, this);
+    m_threadId = m_thread.get_id();
+
+    PLOGI << "Render thread started, " << numSnapshots
+          << " frame snapshots\n";
+}
+
+RenderThread::~RenderThread() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_taskCondition.notify_all();
+    m_thread.join();
+
+    glfwMakeContextCurrent(m_window->getWindow());
+    PLOGI << "Render thread stopped\n";
+}
+
+RenderSnapshot& RenderThread::beginFrame() {
+    const auto waitStart = std::chrono::steady_clock::now();
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_doneCondition.wait(lock, [this] {
+            return !m_freeSnapshots.empty() || m_error != nullptr;
+        });
+        if (m_error != nullptr) {
+            lock.unlock();
+            rethrowError();
+        }
+        m_recording = m_freeSnapshots.back();
+        m_freeSnapshots.pop_back();
+    }
+    m_lastWaitTime = std::chrono::duration<double, std::milli>(
+                         std::chrono::steady_clock::now() - waitStart)
+                         .count();
+
+    m_recording->clear();
+    return *m_recording;
+}
+
+void RenderThread::submitFrame() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_recording == nullptr)
+            throw std::logic_error("RenderThread::submitFrame without frame");
+        m_tasks.push_back({m_recording, nullptr, nullptr});
+        m_recording = nullptr;
+        m_numPending++;
+    }
+    m_taskCondition.notify_one();
+}
+
+void RenderThread::runSync(const std::function<void()>& work) {
+    if (std::this_thread::get_id() == m_threadId) {
+        work();
+        return;
+    }
+
+    bool done = false;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_tasks.push_back({nullptr, work, &done});
+        m_numPending++;
+        m_taskCondition.notify_one();
+        m_doneCondition.wait(lock, [&done] { return done; });
+    }
+    rethrowError();
+}
+
+void RenderThread::waitIdle() {
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_doneCondition.wait(lock, [this] { return m_numPending == 0; });
+    }
+    rethrowError();
+}
+
+double RenderThread::getLastRenderTime() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lastRenderTime;
+}
+
+void RenderThread::threadMain() {
+    glfwMakeContextCurrent(m_window->getWindow());
+
+    while (true) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_taskCondition.wait(
+                lock, [this] { return m_stop || !m_tasks.empty(); });
+            // Queued frames are drawn before stopping
+            if (m_tasks.empty()) break;
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        try {
+            if (task.snapshot != nullptr)
+                m_render(*task.snapshot);
+            else
+                task.work();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_error == nullptr) m_error = std::current_exception();
+        }
+        const double time = std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - start)
+                                .count();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (task.snapshot != nullptr) {
+                m_freeSnapshots.push_back(task.snapshot);
+                m_lastRenderTime = time;
+            }
+            if (task.done != nullptr) *task.done = true;
+            m_numPending--;
+        }
+        m_doneCondition.notify_all();
+    }
+
+    glfwMakeContextCurrent(nullptr);
+}
+
+void RenderThread::rethrowError() {
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        error = m_error;
+        m_error = nullptr;
+    }
+    if (error != nullptr) std::rethrow_exception(error);
+}
+
+}  // namespace rendering
+}  // namespace v3d
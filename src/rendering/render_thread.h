@@ -0,0 +1,101 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "rendering/render_snapshot.h"
+
+namespace v3d {
+class Window;
+
+namespace rendering {
+
+/**
+ * @brief Thread owning the graphics context and drawing the frames recorded
+ * by the game thread.
+ *
+ * Frames are recorded into a ring of snapshots: while the render thread draws
+ * frame N the game thread records frame N+1 (double buffering, more frames
+ * in flight add latency but absorb spikes). beginFrame blocks when every
+ * snapshot is still queued.
+ *
+ * Work needing the context outside of a frame (resource creation) is
+ * queued with runSync, it runs after the frames already submitted so it
+ * never changes a resource under a queued snapshot.
+ */
+class RenderThread {
+   public:
+    using RenderFunction = std::function<void(RenderSnapshot&)>;
+
+    /// @param window Window of the context, released by the calling thread
+    /// and made current on the render thread
+    /// @param numSnapshots Snapshots in the ring, 2 or more
+    /// @param render Draws and presents a snapshot, called on the render
+    /// thread
+    RenderThread(Window* window, size_t numSnapshots, RenderFunction render);
+    /// @brief Draw the queued frames and give the context back to the
+    /// calling thread
+    ~RenderThread();
+
+    RenderThread(const RenderThread&) = delete;
+    RenderThread& operator=(const RenderThread&) = delete;
+
+    /// @brief Snapshot to record the next frame into, cleared
+    RenderSnapshot& beginFrame();
+    /// @brief Queue the snapshot returned by beginFrame
+    void submitFrame();
+
+    /// @brief Run work on the render thread and wait for it. Runs inline
+    /// when called from the render thread.
+    void runSync(const std::function<void()>& work);
+    /// @brief Wait until every submitted frame has been drawn
+    void waitIdle();
+
+    size_t getNumSnapshots() const { return m_snapshots.size(); }
+    /// @brief Time the game thread waited for a free snapshot in the last
+    /// beginFrame, ms
+    double getLastWaitTime() const { return m_lastWaitTime; }
+    /// @brief Duration of the last drawn frame on the render thread, ms
+    double getLastRenderTime();
+
+   private:
+    struct Task {
+        RenderSnapshot* snapshot;  // Frame to draw, or
+        std::function<void()> work;
+        bool* done;  // Set once the work ran, signaled with m_doneCondition
+    };
+
+    Window* m_window;
+    RenderFunction m_render;
+    std::vector<std::unique_ptr<RenderSnapshot>> m_snapshots;
+
+    std::mutex m_mutex;
+    std::condition_variable m_taskCondition;  // Task queued or stop
+    std::condition_variable m_doneCondition;  // Task done
+    std::deque<Task> m_tasks;
+    std::vector<RenderSnapshot*> m_freeSnapshots;
+    RenderSnapshot* m_recording = nullptr;
+    size_t m_numPending = 0;  // Queued or running tasks
+    bool m_stop = false;
+    // First error of the render thread, rethrown on the game thread
+    std::exception_ptr m_error;
+
+    double m_lastWaitTime = 0;
+    double m_lastRenderTime = 0;
+
+    std::thread::id m_threadId;
+    std::thread m_thread;
+
+    void threadMain();
+    void rethrowError();
+};
+
+}  // namespace rendering
+}  // namespace v3d
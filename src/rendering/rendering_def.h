@@ -1,15 +1,45 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 
+#include "glm/glm.hpp"
 #include "rendering/GizmosManager.h"
 
 class Shader;
 
 namespace v3d {
+class Mesh;
+
 namespace rendering {
-enum class GraphicsBackendType { NONE, OPENGL_API, VULKAN_API };
-enum class WindowBackendHint { NONE, OPENGL_API, VULKAN_API };
+class Material;
+
+enum class GraphicsBackendType {
+    NONE,
+    OPENGL_API,
+    VULKAN_API,
+    OPENGL_OFFSCREEN_API
+};
+enum class WindowBackendHint {
+    NONE,
+    OPENGL_API,
+    VULKAN_API,
+    OPENGL_OFFSCREEN_API
+};
+
+/// @brief Context creation API used to render without a window system
+enum class OffscreenContextAPI { EGL, OSMESA };
+
+/// @brief Screen space LOD selection of the render targets
+struct LodSelection {
+    bool enabled = true;
+    /// @brief Max projected geometric error of the drawn level, in pixels
+    float maxPixelError = 1.f;
+    /// @brief Dead band around maxPixelError, relative to it, before
+    /// switching level. Avoids popping back and forth at a boundary.
+    float hysteresis = 0.25f;
+};
 
 class IRenderable {
    public:
@@ -19,6 +49,26 @@ class IRenderable {
 
     // Set uniforms values before rendering
     virtual void setUniforms(Shader* shader) = 0;
+
+    /// @brief Mesh drawn by the render target, used to get its bounds.
+    /// Targets without mesh are never culled.
+    virtual const Mesh* getRenderMesh() const { return nullptr; }
+    /// @brief World transform of the render target
+    virtual glm::mat4 getModelMatrix() const { return glm::mat4(1.f); }
+    /// @brief Changes whenever getModelMatrix() may have changed, see
+    /// Transform::getVersion
+    virtual uint64_t getTransformVersion() const { return 0; }
+    /// @brief Material used to draw the target, null uses the backend default
+    virtual Material* getMaterial() const { return nullptr; }
+    /// @brief Pick the level of detail drawn until the next selection
+    /// @param screenRadius Projected bounding sphere radius, in pixels
+    /// @return Selected level, 0 is the full resolution
+    virtual size_t selectLod(float screenRadius, const LodSelection& settings) {
+        return 0;
+    }
+    /// @brief Static targets never move, backends may merge them with the
+    /// other static targets sharing their material
+    virtual bool isStatic() const { return false; }
 };
 
 class IGizmosRenderable {
@@ -2,6 +2,10 @@
 
 #include <stdio.h>
 
+#include <thread>
+
+#include "rendering/shader_cache.h"
+
 #define _vertBegin "//#Begin_vert"
 #define _vertEnd "//#End_vert"
 #define _fragBegin "//#Begin_frag"
@@ -85,36 +89,78 @@ Shader::Shader(const char* vertexShader, const char* fragmentShader,
     glDeleteShader(fragment);
 }
 
+v3d::rendering::ShaderCache* Shader::s_programCache = nullptr;
+
 void Shader::loadFile() {
     // log_printf(log_level_e::LOG_INFO,
     // "ERROR::SHADER::CONSTRUCTOR_NOT_IMPLEMENTED\n SHADER: %s", shaderPath);
 
     PLOGD << "Loading Shader: " << filePath.c_str() << "\n";
 
-    // 1. retrieve the vertex/fragment source code from filePath
-    std::string vertexCode;
-    std::string fragmentCode;
-    std::string geometryCode;
-    bool hasGeometryCode = false;
-    std::string shaderCode;
+    if (!readSource()) return;
+    beginBuild();
+    endBuild();
+}
+
+std::vector<Shader*> Shader::loadBatch(
+    const std::vector<std::string>& shaderPaths) {
+    v3d::rendering::parallel_compile::enable();
+
+    std::vector<Shader*> shaders;
+    std::vector<Shader*> pending;
+    for (const auto& shaderPath : shaderPaths) {
+        Shader* shader = new Shader();
+        shader->filePath = shaderPath;
+        shader->assetName = shaderPath;
+        shaders.push_back(shader);
+
+        PLOGD << "Loading Shader: " << shaderPath << "\n";
+        if (!shader->readSource()) continue;
+        shader->beginBuild();
+        pending.push_back(shader);
+    }
+
+    // Finish the programs in completion order
+    while (!pending.empty()) {
+        size_t numPending = pending.size();
+        for (auto it = pending.begin(); it != pending.end();) {
+            if (v3d::rendering::parallel_compile::isProgramReady((*it)->m_ID)) {
+                (*it)->endBuild();
+                it = pending.erase(it);
+            } else {
+                it++;
+            }
+        }
+        if (pending.size() == numPending) std::this_thread::yield();
+    }
+
+    return shaders;
+}
+
+bool Shader::readSource() {
+    m_vertexCode.clear();
+    m_fragmentCode.clear();
+    m_geometryCode.clear();
+    m_hasGeometryCode = false;
+
     std::ifstream shaderFile;
 
     // ensure ifstream objects can throw exceptions:
     shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
 
     try {
-        // open files
-        shaderFile.open(filePath);
-        std::stringstream shaderStream;
-
-        // read file's buffer contents into streams
-        shaderStream << shaderFile.rdbuf();
+        // read the whole file at once
+        shaderFile.open(filePath, std::ios::binary | std::ios::ate);
+        std::streamsize size = shaderFile.tellg();
+        shaderFile.seekg(0, std::ios::beg);
+        m_shaderCode.resize(static_cast<size_t>(size));
+        shaderFile.read(m_shaderCode.data(), size);
 
         // close file handlers
         shaderFile.close();
 
-        // convert stream into string
-        shaderCode = shaderStream.str();
+        const std::string& shaderCode = m_shaderCode;
+        const std::string& defines = m_defines;
 
         // vertex Shader
         size_t vertOffset = shaderCode.find(_vertBegin);
@@ -126,7 +172,8 @@ void Shader::loadFile() {
                 PLOGE << "ERROR::SHADER::VERTEX_SHADER: //#End_vert not found";
                 errorOnLoad = true;
             } else
-                vertexCode = shaderCode.substr(vertOffset, vertLenght);
+                m_vertexCode = injectDefines(
+                    shaderCode.substr(vertOffset, vertLenght), defines);
         } else {
             PLOGE << "ERROR::SHADER::VERTEX_SHADER: Vertex code not found";
             errorOnLoad = true;
@@ -143,7 +190,8 @@ void Shader::loadFile() {
                     << "ERROR::SHADER::FRAGMENT_SHADER: //#End_frag not found";
                 errorOnLoad = true;
             } else
-                fragmentCode = shaderCode.substr(fragOffset, fragLenght);
+                m_fragmentCode = injectDefines(
+                    shaderCode.substr(fragOffset, fragLenght), defines);
         } else {
             PLOGE << "ERROR::SHADER::FRAGMENT_SHADER: Fragment code not found";
             errorOnLoad = true;
@@ -154,93 +202,115 @@ void Shader::loadFile() {
         size_t geoEndOffset = shaderCode.find(_geogEnd);
         size_t geoLenght = geoEndOffset - geoOffset;
 
-        size_t p = std::string::npos;
-
         if (geoOffset != std::string::npos)
             if (geoEndOffset == std::string::npos) {
-                hasGeometryCode = false;
+                m_hasGeometryCode = false;
                 PLOGE << "ERROR::SHADER::GEOMETRY_SHADER: //#End_geo not found";
                 errorOnLoad = true;
             } else {
-                hasGeometryCode = true;
-                geometryCode = shaderCode.substr(geoOffset, geoLenght);
+                m_hasGeometryCode = true;
+                m_geometryCode = injectDefines(
+                    shaderCode.substr(geoOffset, geoLenght), defines);
             }
         else
-            hasGeometryCode = false;
+            m_hasGeometryCode = false;
 
     } catch (std::ifstream::failure& e) {
         PLOGE << "	ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ";
         perror("	ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ");
         errorOnLoad = true;
-        return;
+        return false;
     }
 
-    if (errorOnLoad) return;
+    if (errorOnLoad) return false;
 
-    const char* vShaderCode = vertexCode.c_str();
-    const char* fShaderCode = fragmentCode.c_str();
-    const char* gShaderCode = geometryCode.c_str();
+    getProperties(m_shaderCode);
+    return true;
+}
 
-    getProperties(shaderCode);
+void Shader::beginBuild() {
+    m_ID = glCreateProgram();
+    PLOGV << "	Shader Program ID: " << m_ID << "\n";
 
-    // 2. compile shaders
-    unsigned int vertex = 0, fragment = 0, geometry = 0;
+    if (s_programCache != nullptr) {
+        m_cacheKey = s_programCache->makeKey(m_shaderCode, m_defines);
+        m_loadedFromCache = s_programCache->loadProgram(m_cacheKey, m_ID);
+        if (m_loadedFromCache) {
+            PLOGV << "	Loaded from the program cache\n";
+            return;
+        }
+    }
 
-    // vertex shader
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
-    glCompileShader(vertex);
-    checkCompileErrors(vertex, "VERTEX");
+    const char* vShaderCode = m_vertexCode.c_str();
+    const char* fShaderCode = m_fragmentCode.c_str();
+    const char* gShaderCode = m_geometryCode.c_str();
 
-    // fragment Shader
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
-    glCompileShader(fragment);
-    checkCompileErrors(fragment, "FRAGMENT");
+    // 1. compile shaders, the status is only queried once linked so the
+    // compiles don't block
+    m_vertex = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(m_vertex, 1, &vShaderCode, NULL);
+    glCompileShader(m_vertex);
+
+    m_fragment = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(m_fragment, 1, &fShaderCode, NULL);
+    glCompileShader(m_fragment);
 
     // geometry Shader (optional)
-    if (hasGeometryCode) {
-        geometry = glCreateShader(GL_GEOMETRY_SHADER);
-        glShaderSource(geometry, 1, &gShaderCode, NULL);
-        glCompileShader(geometry);
-        checkCompileErrors(geometry, "GEOMETRY");
+    if (m_hasGeometryCode) {
+        m_geometry = glCreateShader(GL_GEOMETRY_SHADER);
+        glShaderSource(m_geometry, 1, &gShaderCode, NULL);
+        glCompileShader(m_geometry);
     }
 
-    // shader Program
-    m_ID = glCreateProgram();
-    PLOGV << "	Shader Program ID: " << m_ID << "\n";
-    glAttachShader(m_ID, vertex);
-    glAttachShader(m_ID, fragment);
-    if (hasGeometryCode) glAttachShader(m_ID, geometry);
+    // 2. link shaders program
+    glAttachShader(m_ID, m_vertex);
+    glAttachShader(m_ID, m_fragment);
+    if (m_hasGeometryCode) glAttachShader(m_ID, m_geometry);
 
-    // 3. link shaders program
+    if (s_programCache != nullptr)
+        glProgramParameteri(m_ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(m_ID);
-    checkCompileErrors(m_ID, "PROGRAM");
+}
+
+void Shader::endBuild() {
+    if (m_loadedFromCache) return;
+
+    int success = 0;
+    glGetProgramiv(m_ID, GL_LINK_STATUS, &success);
+    if (!success) {
+        checkCompileErrors(m_vertex, "VERTEX");
+        checkCompileErrors(m_fragment, "FRAGMENT");
+        if (m_hasGeometryCode) checkCompileErrors(m_geometry, "GEOMETRY");
+        checkCompileErrors(m_ID, "PROGRAM");
+    } else if (s_programCache != nullptr) {
+        s_programCache->storeProgram(m_cacheKey, m_ID);
+    }
 
     // delete the shaders as they're linked into our program now and no longer
     // necessary
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
-    if (hasGeometryCode) glDeleteShader(geometry);
+    glDeleteShader(m_vertex);
+    glDeleteShader(m_fragment);
+    if (m_hasGeometryCode) glDeleteShader(m_geometry);
+    m_vertex = m_fragment = m_geometry = 0;
 }
 
-void Shader::getProperties(const std::string& shaderCode) {
+std::vector<std::string> Shader::readPropertyBlock(
+    const std::string& shaderCode) {
+    std::vector<std::string> properties;
     size_t propBegin, propEnd;
 
     propBegin = shaderCode.find(_propBegin);
 
     if (propBegin == shaderCode.npos) {  // Propeties not found
         PLOGD << "	Shader Properties not found.";
-        hasPropeties = false;
-        return;
+        return properties;
     }
 
     propEnd = shaderCode.find(_propEnd);
 
     if (propEnd == shaderCode.npos) {
         PLOGE << "ERROR::SHADER::PROPERTIES: //#End_prop not found";
-        hasPropeties = false;
-        return;
+        return properties;
     }
 
     propBegin +=
@@ -252,14 +322,55 @@ void Shader::getProperties(const std::string& shaderCode) {
     std::stringstream ss(propertiesCode);
     std::string to;
 
-    if (propertiesCode.size() > 0) {
-        while (std::getline(ss, to, '\n')) {
-            shaderProperties.push_back(to);
-        }
-        hasPropeties = true;
-    } else {
-        hasPropeties = false;
+    while (std::getline(ss, to, '\n')) {
+        if (!to.empty() && to.back() == '\r') to.pop_back();
+        properties.push_back(to);
     }
+    return properties;
+}
+
+void Shader::getProperties(const std::string& shaderCode) {
+    std::vector<std::string> properties = readPropertyBlock(shaderCode);
+    shaderProperties.insert(shaderProperties.end(), properties.begin(),
+                            properties.end());
+    hasPropeties = !properties.empty();
+}
+
+ShaderProperty ShaderProperty::parse(const std::string& line) {
+    ShaderProperty property;
+
+    size_t begin = line.find('(');
+    size_t end = line.rfind(')');
+    if (begin == std::string::npos || end == std::string::npos || end < begin)
+        return property;
+
+    // (type name displayName [option|option...])
+    std::stringstream ss(line.substr(begin + 1, end - begin - 1));
+    std::string options;
+    ss >> property.type >> property.name >> property.displayName >> options;
+
+    std::stringstream optionStream(options);
+    std::string option;
+    while (std::getline(optionStream, option, '|')) {
+        if (!option.empty()) property.options.push_back(option);
+    }
+    return property;
+}
+
+std::string Shader::injectDefines(const std::string& stageCode,
+                                  const std::string& defines) {
+    if (defines.empty()) return stageCode;
+
+    // Defines have to follow the #version directive
+    size_t version = stageCode.find("#version");
+    if (version == std::string::npos) return defines + stageCode;
+
+    size_t lineEnd = stageCode.find('\n', version);
+    if (lineEnd == std::string::npos) return stageCode + "\n" + defines;
+
+    std::string code = stageCode;
+    code.insert(lineEnd + 1, defines);
+    return code;
 }
 
 void ComputeShader::loadFile() {
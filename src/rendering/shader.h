@@ -19,6 +19,29 @@
 #include "asset.h"
 #include "glm/glm.hpp"
 
+namespace v3d {
+namespace rendering {
+class ShaderCache;
+}  // namespace rendering
+}  // namespace v3d
+
+/// @brief Entry of a //#Begin_prop block: (type name displayName [options])
+/// Enum properties list their values separated by '|', e.g.
+/// (enum shadow_filter shadowFilter PCF|HARD)
+struct ShaderProperty {
+    std::string type;
+    std::string name;
+    std::string displayName;
+    std::vector<std::string> options;  // Enum values
+
+    /// @brief Bool and enum properties are compiled as shader variants
+    bool isVariantKeyword() const {
+        return (type == "bool") || (type == "enum" && !options.empty());
+    }
+
+    static ShaderProperty parse(const std::string& line);
+};
+
 class Shader : public v3d::Asset {
    public:
     // constructor generates the shader on the fly
@@ -40,6 +63,14 @@ class Shader : public v3d::Asset {
         loadFile();
     }
 
+    // Single file shader compiled with extra #define lines inserted after the
+    // #version directive of every stage (see ShaderVariantSet)
+    Shader(const std::string& shaderPath, const std::string& shaderName,
+           const std::string& defines)
+        : Asset(shaderPath, shaderName), m_defines(defines) {
+        loadFile();
+    }
+
     ~Shader() {
         glDeleteProgram(m_ID);  // Free resources
     }
@@ -48,6 +79,18 @@ class Shader : public v3d::Asset {
 
     virtual void loadFile();
 
+    /// @brief Program binary cache used by the single file shaders, null
+    /// disables caching. Must outlive its use.
+    static void setProgramCache(v3d::rendering::ShaderCache* cache) {
+        s_programCache = cache;
+    }
+
+    /// @brief Load several single file shaders. Every program missing the
+    /// cache is compiled and linked before waiting on any of them, so the
+    /// driver can build them in parallel (GL_KHR_parallel_shader_compile).
+    static std::vector<Shader*> loadBatch(
+        const std::vector<std::string>& shaderPaths);
+
     // activate the shader
     // ------------------------------------------------------------------------
     void bind() const { glUseProgram(m_ID); }
@@ -101,10 +144,41 @@ class Shader : public v3d::Asset {
     bool hasPropeties = false;
     std::vector<std::string> shaderProperties;
 
+    const std::string& getDefines() const { return m_defines; }
+
+    /// @brief Lines of the //#Begin_prop block of a shader source
+    static std::vector<std::string> readPropertyBlock(
+        const std::string& shaderCode);
+    /// @brief Insert defines after the #version directive of a stage
+    static std::string injectDefines(const std::string& stageCode,
+                                     const std::string& defines);
+
    protected:
     Shader() : v3d::Asset("", "") { m_ID = -1; }
 
     unsigned int m_ID;
+    std::string m_defines;
+
+    static v3d::rendering::ShaderCache* s_programCache;
+
+    // Single file build state, see readSource/beginBuild/endBuild
+    std::string m_shaderCode;
+    std::string m_vertexCode;
+    std::string m_fragmentCode;
+    std::string m_geometryCode;
+    bool m_hasGeometryCode = false;
+    unsigned int m_vertex = 0, m_fragment = 0, m_geometry = 0;
+    uint64_t m_cacheKey = 0;
+    bool m_loadedFromCache = false;
+
+    /// @brief Read the file and split its stages
+    /// @return false on error, errorOnLoad is set
+    bool readSource();
+    /// @brief Create the program from the cache, or issue the compile and
+    /// link without waiting on the result
+    void beginBuild();
+    /// @brief Check the link result (blocking) and store it in the cache
+    void endBuild();
 
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
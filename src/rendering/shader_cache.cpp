@@ -0,0 +1,212 @@
+#include "shader_cache.h"
+
+#include <plog/Log.h>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "rendering/gl_loader.h"
+#include "utils/utils.hpp"
+
+// GL_KHR_parallel_shader_compile, not part of the GL 4.3 glad loader
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace {
+constexpr uint32_t CacheMagic = 0x53443356;  // "V3DS"
+constexpr uint32_t CacheVersion = 1;
+
+struct CacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t format;
+    uint32_t size;
+};
+
+std::string glString(GLenum name) {
+    const char* str = reinterpret_cast<const char*>(glGetString(name));
+    return str != nullptr ? str : "";
+}
+
+bool hasExtension(const char* name) {
+    GLint numExtensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+    for (GLint i = 0; i < numExtensions; i++) {
+        const char* extension =
+            reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (extension != nullptr && std::strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+typedef void(APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC_V3D)(
+    GLuint count);
+
+struct ParallelCompileState {
+    bool initialized = false;
+    bool available = false;
+};
+
+ParallelCompileState& parallelCompileState() {
+    static ParallelCompileState state;
+    return state;
+}
+}  // namespace
+
+namespace v3d {
+namespace rendering {
+
+ShaderCache::ShaderCache(std::string directory)
+    : m_directory(std::move(directory)) {
+    GLint numFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    m_supported = numFormats > 0;
+
+    m_driver = glString(GL_VENDOR) + "|" + glString(GL_RENDERER) + "|" +
+               glString(GL_VERSION);
+
+    if (!m_supported) {
+        PLOGW << "Program binaries not supported by the driver, shader cache "
+                 "disabled\n";
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(m_directory, error);
+    if (error) {
+        PLOGW << "Failed to create shader cache directory " << m_directory
+              << ": " << error.message() << "\n";
+        m_supported = false;
+    }
+}
+
+uint64_t ShaderCache::makeKey(const std::string& source,
+                              const std::string& defines) const {
+    std::string keySource;
+    keySource.reserve(source.size() + defines.size() + m_driver.size() + 2);
+    keySource.append(source).append(1, '\0');
+    keySource.append(defines).append(1, '\0');
+    keySource.append(m_driver);
+    return utils::fnv1a_64(keySource);
+}
+
+std::string ShaderCache::entryPath(uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin",
+                  static_cast<unsigned long long>(key));
+    return (std::filesystem::path(m_directory) / name).string();
+}
+
+bool ShaderCache::loadProgram(uint64_t key, GLuint program) {
+    if (!m_supported) return false;
+
+    std::ifstream file(entryPath(key), std::ios::binary);
+    CacheHeader header{};
+    std::vector<char> binary;
+    if (file && file.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+        header.magic == CacheMagic && header.version == CacheVersion) {
+        binary.resize(header.size);
+        if (!file.read(binary.data(), binary.size())) binary.clear();
+    }
+
+    if (binary.empty()) {
+        m_numMisses++;
+        return false;
+    }
+
+    glProgramBinary(program, header.format, binary.data(),
+                    static_cast<GLsizei>(binary.size()));
+
+    GLint success = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (success != GL_TRUE) {
+        // Stale binary (driver update with the same version string...), it
+        // gets overwritten once the program is rebuilt
+        PLOGD << "Cached program binary rejected by the driver\n";
+        m_numMisses++;
+        return false;
+    }
+
+    m_numHits++;
+    return true;
+}
+
+void ShaderCache::storeProgram(uint64_t key, GLuint program) {
+    if (!m_supported) return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+    CacheHeader header{CacheMagic, CacheVersion, format,
+                       static_cast<uint32_t>(length)};
+
+    // Written to a temporary file first so a crash never leaves a truncated
+    // entry behind
+    const std::string path = entryPath(key);
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), binary.size());
+        if (!file) {
+            PLOGW << "Failed to write shader cache entry " << tmpPath << "\n";
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tmpPath, path, error);
+    if (error)
+        PLOGW << "Failed to write shader cache entry " << path << ": "
+              << error.message() << "\n";
+}
+
+namespace parallel_compile {
+bool enable() {
+    auto& state = parallelCompileState();
+    if (state.initialized) return state.available;
+    state.initialized = true;
+
+    if (!hasExtension("GL_KHR_parallel_shader_compile") &&
+        !hasExtension("GL_ARB_parallel_shader_compile"))
+        return false;
+
+    auto maxThreads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC_V3D>(
+        getGLProcAddress("glMaxShaderCompilerThreadsKHR"));
+    if (maxThreads == nullptr)
+        maxThreads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC_V3D>(
+            getGLProcAddress("glMaxShaderCompilerThreadsARB"));
+    if (maxThreads == nullptr) return false;
+
+    // 0xFFFFFFFF lets the driver pick the number of threads
+    maxThreads(0xFFFFFFFFu);
+    state.available = true;
+    PLOGD << "Parallel shader compile enabled\n";
+    return true;
+}
+
+bool isAvailable() { return parallelCompileState().available; }
+
+bool isProgramReady(GLuint program) {
+    if (!isAvailable()) return true;
+    GLint completed = GL_TRUE;
+    glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &completed);
+    return completed == GL_TRUE;
+}
+}  // namespace parallel_compile
+
+}  // namespace rendering
+}  // namespace v3d
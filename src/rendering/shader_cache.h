@@ -0,0 +1,69 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace v3d {
+namespace rendering {
+
+/**
+ * @brief On disk cache of linked shader programs (glGetProgramBinary).
+ *
+ * Entries are keyed by a hash of the shader source, its defines and the
+ * driver string, so a driver update or a source change simply misses and
+ * the program is recompiled and stored again. A binary rejected by the
+ * driver is treated as a miss.
+ */
+class ShaderCache {
+   public:
+    /// @param directory Directory of the cache files, created if missing
+    explicit ShaderCache(std::string directory);
+
+    /// @brief True if the driver exposes at least one program binary format
+    bool isSupported() const { return m_supported; }
+
+    /// @brief Cache key of a program. Requires a current context.
+    uint64_t makeKey(const std::string& source,
+                     const std::string& defines = "") const;
+
+    /// @brief Load a cached binary into program
+    /// @return true if the program was found and linked successfully
+    bool loadProgram(uint64_t key, GLuint program);
+    /// @brief Store the binary of a linked program. The program should have
+    /// been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+    void storeProgram(uint64_t key, GLuint program);
+
+    size_t getNumHits() const { return m_numHits; }
+    size_t getNumMisses() const { return m_numMisses; }
+
+   private:
+    std::string m_directory;
+    std::string m_driver;
+    bool m_supported = false;
+
+    size_t m_numHits = 0;
+    size_t m_numMisses = 0;
+
+    std::string entryPath(uint64_t key) const;
+};
+
+/**
+ * @brief GL_KHR_parallel_shader_compile helpers. Without the extension
+ * compiles still run asynchronously on drivers that do it on their own, but
+ * completion can't be polled and has to be waited on.
+ */
+namespace parallel_compile {
+/// @brief Enable driver side compiler threads if the extension is available.
+/// @return true if the extension is available
+bool enable();
+bool isAvailable();
+/// @brief True once the program link finished, always true without the
+/// extension (querying the link status then blocks)
+bool isProgramReady(GLuint program);
+}  // namespace parallel_compile
+
+}  // namespace rendering
+}  // namespace v3d
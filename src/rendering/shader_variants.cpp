@@ -0,0 +1,239 @@
+#include "shader_variants.h"
+
+#include <plog/Log.h>
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+
+#include "rendering/geometry_arena.h"
+#include "rendering/shader.h"
+
+namespace v3d {
+namespace rendering {
+
+namespace {
+std::string toDefineName(const std::string& name) {
+    std::string define = name;
+    std::transform(define.begin(), define.end(), define.begin(), [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c))
+                   ? static_cast<char>(
+                         std::toupper(static_cast<unsigned char>(c)))
+                   : '_';
+    });
+    return define;
+}
+
+uint32_t bitsFor(size_t numValues) {
+    uint32_t bits = 1;
+    while ((size_t(1) << bits) < numValues) bits++;
+    return bits;
+}
+
+uint32_t alignUp(uint32_t value, uint32_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+/// @brief Why a variant can't draw materials, empty if it can. The renderer
+/// only feeds the material buffer and the per draw inputs below.
+std::string findMissingMaterialInputs(const Shader& program, bool indirect) {
+    const GLuint id = program.ID();
+    GLint linked = GL_FALSE;
+    glGetProgramiv(id, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE) return "not linked";
+
+    if (glGetProgramResourceIndex(id, GL_SHADER_STORAGE_BLOCK, "Materials") ==
+        GL_INVALID_INDEX)
+        return "no Materials buffer block";
+
+    if (!indirect) {
+        if (glGetUniformLocation(id, "materialIndex") < 0)
+            return "no materialIndex uniform";
+        return "";
+    }
+    if (glGetAttribLocation(id, "aModel") !=
+        static_cast<GLint>(GeometryPool::InstanceAttributeLocation))
+        return "aModel is not the instanced attribute";
+    if (glGetAttribLocation(id, "aMaterialIndex") !=
+        static_cast<GLint>(GeometryPool::MaterialIndexLocation))
+        return "aMaterialIndex is not the instanced attribute";
+    return "";
+}
+}  // namespace
+
+bool MaterialLayout::addParameter(const std::string& name,
+                                  const std::string& type) {
+    MaterialParameter parameter;
+    parameter.name = name;
+
+    // std430 base alignment and size
+    uint32_t alignment = 0;
+    if (type == "float") {
+        parameter.type = MaterialParameterType::FLOAT;
+        alignment = parameter.size = 4;
+    } else if (type == "int") {
+        parameter.type = MaterialParameterType::INT;
+        alignment = parameter.size = 4;
+    } else if (type == "vec2") {
+        parameter.type = MaterialParameterType::VEC2;
+        alignment = parameter.size = 8;
+    } else if (type == "vec3") {
+        parameter.type = MaterialParameterType::VEC3;
+        alignment = 16;
+        parameter.size = 12;
+    } else if (type == "vec4" || type == "color") {
+        parameter.type = MaterialParameterType::VEC4;
+        alignment = parameter.size = 16;
+    } else {
+        return false;
+    }
+
+    parameter.offset = alignUp(m_size, alignment);
+    m_size = parameter.offset + parameter.size;
+    m_alignment = std::max(m_alignment, alignment);
+    m_parameters.push_back(std::move(parameter));
+    return true;
+}
+
+const MaterialParameter* MaterialLayout::find(const std::string& name) const {
+    for (const auto& parameter : m_parameters) {
+        if (parameter.name == name) return &parameter;
+    }
+    return nullptr;
+}
+
+uint32_t MaterialLayout::getStride() const {
+    return alignUp(std::max(m_size, 4u), m_alignment);
+}
+
+ShaderVariantSet::ShaderVariantSet(std::string shaderPath)
+    : m_shaderPath(std::move(shaderPath)) {
+    std::ifstream shaderFile(m_shaderPath, std::ios::binary);
+    if (!shaderFile) {
+        PLOGE << "ERROR::SHADER::VARIANTS: Failed to read " << m_shaderPath
+              << "\n";
+        return;
+    }
+    std::stringstream shaderStream;
+    shaderStream << shaderFile.rdbuf();
+
+    uint32_t offset = 0;
+    for (const auto& line : Shader::readPropertyBlock(shaderStream.str())) {
+        ShaderProperty property = ShaderProperty::parse(line);
+        if (!property.isVariantKeyword()) {
+            m_materialLayout.addParameter(property.name, property.type);
+            continue;
+        }
+
+        ShaderKeyword keyword;
+        keyword.name = property.name;
+        keyword.define = toDefineName(property.name);
+        keyword.values = property.options;
+        keyword.bits = keyword.isBool() ? 1 : bitsFor(keyword.values.size());
+        keyword.offset = offset;
+
+        if (offset + keyword.bits > MaxKeyBits) {
+            PLOGE << "ERROR::SHADER::VARIANTS: Too many keywords in "
+                  << m_shaderPath << ", " << keyword.name << " ignored\n";
+            break;
+        }
+        offset += keyword.bits;
+        m_keywords.push_back(std::move(keyword));
+    }
+
+    PLOGD << "Shader " << m_shaderPath << ": " << m_keywords.size()
+          << " variant keywords, "
+          << m_materialLayout.getParameters().size()
+          << " material parameters (" << m_materialLayout.getStride()
+          << " bytes)\n";
+}
+
+ShaderVariantSet::~ShaderVariantSet() = default;
+
+const ShaderKeyword* ShaderVariantSet::findKeyword(
+    const std::string& name) const {
+    for (const auto& keyword : m_keywords) {
+        if (keyword.name == name) return &keyword;
+    }
+    return nullptr;
+}
+
+ShaderVariantKey ShaderVariantSet::setKeyword(ShaderVariantKey key,
+                                              const std::string& name,
+                                              bool enabled) const {
+    const ShaderKeyword* keyword = findKeyword(name);
+    if (keyword == nullptr || !keyword->isBool()) {
+        PLOGW << "Unknown bool keyword " << name << " in " << m_shaderPath
+              << "\n";
+        return key;
+    }
+    return (key & ~keyword->mask()) |
+           (static_cast<uint64_t>(enabled) << keyword->offset);
+}
+
+ShaderVariantKey ShaderVariantSet::setKeyword(ShaderVariantKey key,
+                                              const std::string& name,
+                                              const std::string& value) const {
+    const ShaderKeyword* keyword = findKeyword(name);
+    if (keyword == nullptr || keyword->isBool()) {
+        PLOGW << "Unknown enum keyword " << name << " in " << m_shaderPath
+              << "\n";
+        return key;
+    }
+
+    auto it = std::find(keyword->values.begin(), keyword->values.end(), value);
+    if (it == keyword->values.end()) {
+        PLOGW << "Unknown value " << value << " of keyword " << name << "\n";
+        return key;
+    }
+    uint64_t index = static_cast<uint64_t>(it - keyword->values.begin());
+    return (key & ~keyword->mask()) | (index << keyword->offset);
+}
+
+std::string ShaderVariantSet::makeDefines(ShaderVariantKey key) const {
+    std::string defines;
+    for (const auto& keyword : m_keywords) {
+        uint64_t value = (key & keyword.mask()) >> keyword.offset;
+        if (!keyword.isBool()) {
+            for (size_t i = 0; i < keyword.values.size(); i++) {
+                defines += "#define " + keyword.define + "_" +
+                           toDefineName(keyword.values[i]) + " " +
+                           std::to_string(i) + "\n";
+            }
+            // Out of range values fall back to the default
+            if (value >= keyword.values.size()) value = 0;
+        }
+        defines += "#define " + keyword.define + " " + std::to_string(value) +
+                   "\n";
+    }
+    defines += (key & IndirectDrawBit) ? "#define V3D_INDIRECT_DRAW 1\n"
+                                       : "#define V3D_INDIRECT_DRAW 0\n";
+    return defines;
+}
+
+Shader* ShaderVariantSet::getVariant(ShaderVariantKey key) {
+    auto it = m_variants.find(key);
+    if (it != m_variants.end()) return it->second.get();
+
+    PLOGD << "Compiling variant " << key << " of " << m_shaderPath << "\n";
+    auto variant = std::make_unique<Shader>(m_shaderPath, m_shaderPath,
+                                            makeDefines(key));
+
+    // Rejected variants are kept as null, the draws fall back to the default
+    // shaders instead of reading garbage
+    const std::string missing =
+        findMissingMaterialInputs(*variant, (key & IndirectDrawBit) != 0);
+    if (!missing.empty()) {
+        PLOGE << "ERROR::SHADER::VARIANTS: " << m_shaderPath
+              << " is not a material shader (" << missing << "), variant "
+              << key << " rejected\n";
+        variant.reset();
+    }
+    Shader* variant_ptr = variant.get();
+    m_variants.emplace(key, std::move(variant));
+    return variant_ptr;
+}
+
+}  // namespace rendering
+}  // namespace v3d
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Shader;
+
+namespace v3d {
+namespace rendering {
+
+/// @brief Packed value of every keyword of a ShaderVariantSet, 0 selects the
+/// default variant (bools off, enums on their first value)
+using ShaderVariantKey = uint64_t;
+
+/**
+ * @brief Compile time switch of a shader generated from a bool or enum
+ * property. It is exposed to GLSL as defines named after the upper-cased
+ * property name:
+ *  - bool: USE_TRANSPARENCY 0|1
+ *  - enum: SHADOW_FILTER_PCF 0, SHADOW_FILTER_HARD 1 and SHADOW_FILTER set
+ *    to the selected value
+ */
+struct ShaderKeyword {
+    std::string name;
+    std::string define;
+    std::vector<std::string> values;  // Empty for bools
+    uint32_t offset = 0;              // Bit offset in the variant key
+    uint32_t bits = 1;
+
+    bool isBool() const { return values.empty(); }
+    uint64_t mask() const { return ((uint64_t(1) << bits) - 1) << offset; }
+};
+
+enum class MaterialParameterType { FLOAT, INT, VEC2, VEC3, VEC4 };
+
+struct MaterialParameter {
+    std::string name;
+    MaterialParameterType type;
+    uint32_t offset = 0;  // Byte offset in the material record
+    uint32_t size = 0;
+};
+
+/**
+ * @brief std430 layout of the material parameters of a shader: its non
+ * keyword, non sampler properties in declaration order. The shader declares
+ * a struct with the same members, in the same order, to read them from the
+ * material buffer.
+ *
+ * Types: float, int, vec2, vec3, vec4 and color (vec4).
+ */
+class MaterialLayout {
+   public:
+    /// @return false if the property type is not a material parameter
+    bool addParameter(const std::string& name, const std::string& type);
+
+    const MaterialParameter* find(const std::string& name) const;
+    const std::vector<MaterialParameter>& getParameters() const {
+        return m_parameters;
+    }
+    /// @brief Size of a record in a std430 array of the material struct
+    uint32_t getStride() const;
+    bool empty() const { return m_parameters.empty(); }
+
+   private:
+    std::vector<MaterialParameter> m_parameters;
+    uint32_t m_size = 0;
+    uint32_t m_alignment = 4;
+};
+
+/**
+ * @brief All the compile time variants of a single file shader.
+ *
+ * The keywords are read from the //#Begin_prop block. Variants are compiled
+ * on first use and kept by key, the program binary cache makes the next runs
+ * cheap. A variant defines every keyword to its value, test them with #if.
+ * Shaders that need to work without a variant set must first define the
+ * undefined keywords to their default, GLSL rejects them in #if.
+ */
+class ShaderVariantSet {
+   public:
+    /// @brief Reserved key bit selecting the multi-draw indirect variant,
+    /// exposed as V3D_INDIRECT_DRAW
+    static constexpr ShaderVariantKey IndirectDrawBit = uint64_t(1) << 63;
+    static constexpr uint32_t MaxKeyBits = 63;
+
+    explicit ShaderVariantSet(std::string shaderPath);
+    ~ShaderVariantSet();
+
+    ShaderVariantSet(const ShaderVariantSet&) = delete;
+    ShaderVariantSet& operator=(const ShaderVariantSet&) = delete;
+
+    const std::string& getShaderPath() const { return m_shaderPath; }
+    const std::vector<ShaderKeyword>& getKeywords() const { return m_keywords; }
+    const ShaderKeyword* findKeyword(const std::string& name) const;
+    const MaterialLayout& getMaterialLayout() const { return m_materialLayout; }
+
+    /// @brief Set a bool keyword in key, unknown keywords are ignored
+    ShaderVariantKey setKeyword(ShaderVariantKey key, const std::string& name,
+                                bool enabled) const;
+    /// @brief Set an enum keyword in key, unknown keywords/values are ignored
+    ShaderVariantKey setKeyword(ShaderVariantKey key, const std::string& name,
+                                const std::string& value) const;
+
+    /// @brief #define lines of a variant
+    std::string makeDefines(ShaderVariantKey key) const;
+
+    /// @brief Get a variant, compiling it on first use
+    /// @return Null if the shader can't draw materials: it must read the
+    /// Materials buffer block with the materialIndex uniform, or with the
+    /// instanced aModel/aMaterialIndex attributes of GeometryPool when
+    /// V3D_INDIRECT_DRAW is set (see MaterialShader.glsl)
+    Shader* getVariant(ShaderVariantKey key);
+
+    size_t getNumCompiledVariants() const { return m_variants.size(); }
+
+   private:
+    std::string m_shaderPath;
+    std::vector<ShaderKeyword> m_keywords;
+    MaterialLayout m_materialLayout;
+    std::unordered_map<ShaderVariantKey, std::unique_ptr<Shader>> m_variants;
+};
+
+}  // namespace rendering
+}  // namespace v3d
@@ -0,0 +1,228 @@
+#include "static_batcher.h"
+
+#include <glad/glad.h>
+#include <plog/Log.h>
+
+#include <vulkan/vulkan_core.h>
+
+#include <chrono>
+#include <limits>
+
+#include "rendering/shader.h"
+#include "rendering/vertex_compression.h"
+#include "utils/exception.hpp"
+
+namespace v3d {
+namespace rendering {
+
+namespace {
+/// @brief Vertex of the merged geometry, world space
+struct BatchVertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 textureCoord;
+    glm::vec4 color;
+    glm::vec3 tangent;
+    glm::vec3 bitangent;
+};
+static_assert(sizeof(BatchVertex) == StaticBatcher::VertexBytes,
+              "StaticBatcher::VertexBytes out of sync with BatchVertex");
+
+const VertexLayout BatchVertexLayout = {
+    sizeof(BatchVertex),
+    {
+        {0, 3, GL_FLOAT, VK_FORMAT_R32G32B32_SFLOAT, false,
+         offsetof(BatchVertex, position)},
+        {1, 3, GL_FLOAT, VK_FORMAT_R32G32B32_SFLOAT, false,
+         offsetof(BatchVertex, normal)},
+        {2, 2, GL_FLOAT, VK_FORMAT_R32G32_SFLOAT, false,
+         offsetof(BatchVertex, textureCoord)},
+        {3, 4, GL_FLOAT, VK_FORMAT_R32G32B32A32_SFLOAT, false,
+         offsetof(BatchVertex, color)},
+        {4, 3, GL_FLOAT, VK_FORMAT_R32G32B32_SFLOAT, false,
+         offsetof(BatchVertex, tangent)},
+        {5, 3, GL_FLOAT, VK_FORMAT_R32G32B32_SFLOAT, false,
+         offsetof(BatchVertex, bitangent)},
+    }};
+
+const VertexAttribute* findAttribute(const VertexLayout& layout,
+                                     uint32_t location) {
+    for (const auto& vAttribute : layout.attributes) {
+        if (vAttribute.location == location) return &vAttribute;
+    }
+    return nullptr;
+}
+
+glm::vec4 readAttribute(const unsigned char* vertex,
+                        const VertexAttribute* attribute,
+                        const glm::vec4& fallback) {
+    if (attribute == nullptr) return fallback;
+    return decodeAttribute(vertex, *attribute, fallback);
+}
+
+glm::vec3 safeNormalize(const glm::vec3& v) {
+    float length2 = glm::dot(v, v);
+    return length2 > 1e-12f ? v / glm::sqrt(length2) : v;
+}
+}  // namespace
+
+void StaticBatch::renderElement() { m_mesh->draw(); }
+void StaticBatch::renderElementInstanced() {
+    throw exception::NotImplemented();
+}
+
+void StaticBatch::setUniforms(Shader* shader) {
+    // Already in world space, only the quantization is left
+    shader->setMat4("model", m_mesh->getVertexTransform());
+    shader->setMat3("normalMatrix", glm::mat3(1.f));
+}
+
+void StaticBatcher::update(const std::vector<IRenderable*>& renderTargets,
+                           std::vector<IRenderable*>& frameTargets) {
+    frameTargets.clear();
+    frameTargets.reserve(renderTargets.size());
+    m_numBatchedTargets = 0;
+    for (auto& [key, sources] : m_frameSources) sources.clear();
+
+    // Batches hold the full resolution of their targets
+    LodSelection fullResolution;
+    fullResolution.enabled = false;
+
+    for (auto renderTarget : renderTargets) {
+        if (!m_enabled || !renderTarget->isStatic()) {
+            frameTargets.push_back(renderTarget);
+            continue;
+        }
+
+        renderTarget->selectLod(std::numeric_limits<float>::max(),
+                                fullResolution);
+        auto mesh =
+            dynamic_cast<const MeshOpenGL*>(renderTarget->getRenderMesh());
+        if (mesh == nullptr) {
+            frameTargets.push_back(renderTarget);
+            continue;
+        }
+
+        m_frameSources[renderTarget->getMaterial()].push_back(
+            {renderTarget, mesh, renderTarget->getTransformVersion(),
+             glm::mat4(1.f)});
+    }
+
+    // Batches left without targets are released
+    std::vector<std::unique_ptr<StaticBatch>> released;
+    for (auto it = m_frameSources.begin(); it != m_frameSources.end();) {
+        if (!it->second.empty()) {
+            ++it;
+            continue;
+        }
+        auto batch = m_batches.find(it->first);
+        if (batch != m_batches.end()) {
+            released.push_back(std::move(batch->second));
+            m_batches.erase(batch);
+        }
+        it = m_frameSources.erase(it);
+    }
+
+    std::vector<StaticBatch*> modified;
+    for (auto& [material, sources] : m_frameSources) {
+        auto& batch = m_batches[material];
+        if (!batch) batch = std::make_unique<StaticBatch>(material);
+
+        if (batch->m_sources != sources) {
+            for (auto& source : sources)
+                source.model = source.target->getModelMatrix();
+            batch->m_sources = sources;
+            modified.push_back(batch.get());
+        }
+        m_numBatchedTargets += sources.size();
+    }
+
+    if (!released.empty()) m_runOnContext([&] { released.clear(); });
+    for (auto batch : modified) rebuild(*batch);
+
+    for (auto& [key, batch] : m_batches)
+        if (batch->m_mesh) frameTargets.push_back(batch.get());
+}
+
+void StaticBatcher::rebuild(StaticBatch& batch) {
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<BatchVertex> vertices;
+    std::vector<unsigned int> indices;
+
+    for (const auto& source : batch.m_sources) {
+        auto mesh = static_cast<const MeshOpenGL*>(source.mesh);
+        const std::vector<unsigned char>& sourceVertices =
+            mesh->getVertexData();
+        const std::vector<unsigned int>& sourceIndices = mesh->getIndexData();
+
+        const VertexLayout& layout = mesh->getVertexLayout();
+        const VertexAttribute* position = findAttribute(layout, 0);
+        const VertexAttribute* normal = findAttribute(layout, 1);
+        const VertexAttribute* textureCoord = findAttribute(layout, 2);
+        const VertexAttribute* color = findAttribute(layout, 3);
+        const VertexAttribute* tangent = findAttribute(layout, 4);
+        const VertexAttribute* bitangent = findAttribute(layout, 5);
+        if (position == nullptr) continue;
+
+        const glm::mat4 positionTransform =
+            source.model * mesh->getVertexTransform();
+        const glm::mat3 directionTransform = glm::mat3(source.model);
+        const glm::mat3 normalMatrix =
+            glm::transpose(glm::inverse(directionTransform));
+
+        const auto baseVertex = static_cast<unsigned int>(vertices.size());
+        const size_t numVertices = sourceVertices.size() / layout.stride;
+        for (size_t v = 0; v < numVertices; v++) {
+            const unsigned char* vertex =
+                sourceVertices.data() + v * layout.stride;
+            BatchVertex result;
+
+            glm::vec3 p = readAttribute(vertex, position, glm::vec4(0.f));
+            result.position = positionTransform * glm::vec4(p, 1.f);
+
+            glm::vec3 n = readAttribute(vertex, normal, glm::vec4(0, 1, 0, 0));
+            result.normal = safeNormalize(normalMatrix * n);
+
+            result.textureCoord =
+                readAttribute(vertex, textureCoord, glm::vec4(0.f));
+            result.color = readAttribute(vertex, color, glm::vec4(1.f));
+
+            // Compressed meshes only store the bitangent sign
+            glm::vec4 t = readAttribute(vertex, tangent, glm::vec4(1, 0, 0, 1));
+            glm::vec3 b =
+                bitangent != nullptr
+                    ? glm::vec3(readAttribute(vertex, bitangent, glm::vec4(0.f)))
+                    : glm::cross(n, glm::vec3(t)) * (t.w < 0.f ? -1.f : 1.f);
+            result.tangent = safeNormalize(directionTransform * glm::vec3(t));
+            result.bitangent = safeNormalize(directionTransform * b);
+
+            vertices.push_back(result);
+        }
+
+        for (auto index : sourceIndices) indices.push_back(baseVertex + index);
+    }
+
+    m_runOnContext([&] {
+        batch.m_mesh.reset();
+        if (indices.empty()) return;
+        batch.m_mesh = std::make_unique<MeshOpenGL>(
+            vertices.data(), vertices.size() * sizeof(BatchVertex),
+            BatchVertexLayout, indices.data(), indices.size());
+        batch.m_mesh->m_name = "StaticBatch";
+        computeMeshBounds(vertices.data(), vertices.size(), BatchVertexLayout,
+                          batch.m_mesh->m_aabb, batch.m_mesh->m_boundingSphere);
+    });
+
+    m_numRebuilds++;
+    m_lastRebuildTime = std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+    PLOGD << "Rebuilt static batch of " << batch.m_sources.size()
+          << " render targets in " << m_lastRebuildTime << " ms: "
+          << vertices.size() << " vertices, " << indices.size() / 3
+          << " triangles\n";
+}
+
+}  // namespace rendering
+}  // namespace v3d
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "Mesh.h"
+#include "glm/glm.hpp"
+#include "rendering/rendering_def.h"
+
+namespace v3d {
+namespace rendering {
+
+/**
+ * @brief Render target drawing the merged geometry of static render targets
+ * sharing a material. The vertices are baked in world space, the batch is
+ * drawn with an identity model matrix in a single draw call.
+ *
+ * Batches are never compressed: they span the world, quantizing the
+ * positions over the bounds of the whole batch would lose most of their
+ * precision.
+ */
+class StaticBatch : public IRenderable {
+    friend class StaticBatcher;
+
+   public:
+    explicit StaticBatch(Material* material) : m_material(material) {}
+    ~StaticBatch() override = default;
+
+    void renderElement() override;
+    void renderElementInstanced() override;
+    void setUniforms(Shader* shader) override;
+
+    const Mesh* getRenderMesh() const override { return m_mesh.get(); }
+    Material* getMaterial() const override { return m_material; }
+
+    size_t getNumSources() const { return m_sources.size(); }
+
+   private:
+    /// @brief Render target merged into the batch, as it was when merged
+    struct Source {
+        IRenderable* target;
+        const Mesh* mesh;
+        uint64_t transformVersion;
+        /// @brief Only read when the batch is rebuilt
+        glm::mat4 model;
+
+        bool operator==(const Source& other) const {
+            return target == other.target && mesh == other.mesh &&
+                   transformVersion == other.transformVersion;
+        }
+    };
+
+    Material* m_material = nullptr;
+    std::vector<Source> m_sources;
+    std::unique_ptr<MeshOpenGL> m_mesh;
+};
+
+/**
+ * @brief Merges the render targets flagged static (IRenderable::isStatic)
+ * into one StaticBatch per material.
+ *
+ * The sources of every batch are compared each frame, a batch is only
+ * rebuilt when a target was added, removed, moved (its transform version
+ * changed) or changed mesh. The model matrices are only computed then. The
+ * geometry is baked from the system memory copy of the source meshes
+ * (MeshOpenGL::getVertexData), there is no GPU readback.
+ *
+ * Batch meshes are created and released through the context runner, so the
+ * batcher can run on a thread not owning the graphics context.
+ */
+class StaticBatcher {
+   public:
+    /// @brief Runs work needing the graphics context and waits for it
+    using ContextRunner = std::function<void(const std::function<void()>&)>;
+
+    /// @brief Size of a vertex of the merged geometry: position, normal,
+    /// texture coordinate, color, tangent and bitangent
+    static constexpr size_t VertexBytes = 18 * sizeof(float);
+
+    explicit StaticBatcher(ContextRunner runOnContext)
+        : m_runOnContext(std::move(runOnContext)) {}
+    ~StaticBatcher() = default;
+
+    StaticBatcher(const StaticBatcher&) = delete;
+    StaticBatcher& operator=(const StaticBatcher&) = delete;
+
+    /// @brief Split the render targets of the frame in the dynamic ones and
+    /// the static batches
+    /// @param frameTargets Output, the dynamic targets followed by the
+    /// batches
+    void update(const std::vector<IRenderable*>& renderTargets,
+                std::vector<IRenderable*>& frameTargets);
+
+    bool isEnabled() const { return m_enabled; }
+    void setEnabled(bool enabled) { m_enabled = enabled; }
+
+    size_t getNumBatches() const { return m_batches.size(); }
+    /// @brief Num of render targets drawn through a batch
+    size_t getNumBatchedTargets() const { return m_numBatchedTargets; }
+    size_t getNumRebuilds() const { return m_numRebuilds; }
+    /// @brief Duration of the last rebuild, ms
+    double getLastRebuildTime() const { return m_lastRebuildTime; }
+
+   private:
+    std::map<Material*, std::unique_ptr<StaticBatch>> m_batches;
+    // Static targets of the frame per batch, kept to reuse the storage
+    std::map<Material*, std::vector<StaticBatch::Source>> m_frameSources;
+    ContextRunner m_runOnContext;
+
+    bool m_enabled = true;
+    size_t m_numBatchedTargets = 0;
+    size_t m_numRebuilds = 0;
+    double m_lastRebuildTime = 0;
+
+    /// @brief Bake the sources of the batch and replace its mesh
+    void rebuild(StaticBatch& batch);
+};
+
+}  // namespace rendering
+}  // namespace v3d
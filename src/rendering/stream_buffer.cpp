@@ -0,0 +1,182 @@
+#include "stream_buffer.h"
+
+#include <plog/Log.h>
+
+#include <cstring>
+
+#include "rendering/gl_loader.h"
+
+// ARB_buffer_storage (core in GL 4.4), not part of the GL 4.3 glad loader
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+namespace {
+typedef void(APIENTRYP PFNGLBUFFERSTORAGEPROC_V3D)(GLenum target,
+                                                  GLsizeiptr size,
+                                                  const void* data,
+                                                  GLbitfield flags);
+
+PFNGLBUFFERSTORAGEPROC_V3D loadBufferStorage() {
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    bool supported = major > 4 || (major == 4 && minor >= 4);
+
+    if (!supported) {
+        GLint numExtensions = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+        for (GLint i = 0; i < numExtensions && !supported; i++) {
+            const char* extension = reinterpret_cast<const char*>(
+                glGetStringi(GL_EXTENSIONS, i));
+            supported = extension != nullptr &&
+                        std::strcmp(extension, "GL_ARB_buffer_storage") == 0;
+        }
+    }
+    if (!supported) return nullptr;
+
+    auto proc = reinterpret_cast<PFNGLBUFFERSTORAGEPROC_V3D>(
+        v3d::rendering::getGLProcAddress("glBufferStorage"));
+    if (proc == nullptr)
+        proc = reinterpret_cast<PFNGLBUFFERSTORAGEPROC_V3D>(
+            v3d::rendering::getGLProcAddress("glBufferStorageARB"));
+    return proc;
+}
+
+PFNGLBUFFERSTORAGEPROC_V3D getBufferStorage() {
+    // Resolved once, requires a current context
+    static PFNGLBUFFERSTORAGEPROC_V3D proc = loadBufferStorage();
+    return proc;
+}
+}  // namespace
+
+namespace v3d {
+namespace rendering {
+
+bool StreamBuffer::isPersistentMappingSupported() {
+    return getBufferStorage() != nullptr;
+}
+
+StreamBuffer::StreamBuffer(size_t regionSize) : m_regionSize(regionSize) {
+    const size_t totalSize = m_regionSize * NumRegions;
+
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+
+    auto bufferStorage = getBufferStorage();
+    if (bufferStorage != nullptr) {
+        const GLbitfield flags =
+            GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        bufferStorage(GL_ARRAY_BUFFER, totalSize, nullptr, flags);
+        m_mapped = static_cast<unsigned char*>(
+            glMapBufferRange(GL_ARRAY_BUFFER, 0, totalSize, flags));
+        m_persistent = m_mapped != nullptr;
+        if (!m_persistent)
+            PLOGW << "Failed to persistently map stream buffer, falling back "
+                     "to buffer sub data uploads\n";
+    }
+
+    if (!m_persistent) {
+        // Mutable storage can not be respecified after a failed immutable
+        // allocation, start from a fresh buffer
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glDeleteBuffers(1, &m_buffer);
+        glGenBuffers(1, &m_buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+        glBufferData(GL_ARRAY_BUFFER, totalSize, nullptr, GL_DYNAMIC_DRAW);
+        m_shadow.resize(totalSize);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    PLOGD << "Stream buffer created: " << NumRegions << " x " << m_regionSize
+          << " bytes, " << (m_persistent ? "persistent mapping" : "sub data")
+          << "\n";
+
+    // Start on the last region so the first beginFrame uses region 0
+    m_region = NumRegions - 1;
+    m_regionBegin = m_head = m_region * m_regionSize;
+}
+
+StreamBuffer::~StreamBuffer() {
+    for (auto& fence : m_fences) {
+        if (fence != nullptr) glDeleteSync(fence);
+    }
+
+    if (m_persistent) {
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    glDeleteBuffers(1, &m_buffer);
+}
+
+void StreamBuffer::beginFrame() {
+    m_region = (m_region + 1) % NumRegions;
+    m_regionBegin = m_head = m_region * m_regionSize;
+    m_flushed = 0;
+
+    GLsync& fence = m_fences[m_region];
+    if (fence == nullptr) return;
+
+    // Wait until the GPU finished reading the region written NumRegions
+    // frames ago, normally it is already signaled
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        m_numStalls++;
+        do {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                      1000000);  // 1 ms
+        } while (result == GL_TIMEOUT_EXPIRED);
+    }
+    if (result == GL_WAIT_FAILED) PLOGE << "Stream buffer fence wait failed\n";
+
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void StreamBuffer::endFrame() {
+    GLsync& fence = m_fences[m_region];
+    if (fence != nullptr) glDeleteSync(fence);
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+StreamBuffer::Allocation StreamBuffer::allocate(size_t size,
+                                                size_t alignment) {
+    Allocation allocation;
+    if (alignment == 0) alignment = 1;
+
+    size_t offset = (m_head + alignment - 1) / alignment * alignment;
+    if (offset + size > m_regionBegin + m_regionSize) {
+        m_numOverflows++;
+        PLOGW << "Stream buffer region full, " << size
+              << " bytes requested\n";
+        return allocation;
+    }
+
+    allocation.offset = offset;
+    allocation.size = size;
+    allocation.data =
+        m_persistent ? m_mapped + offset : m_shadow.data() + offset;
+    m_head = offset + size;
+    return allocation;
+}
+
+void StreamBuffer::flush() {
+    if (m_persistent) return;  // Coherent mapping, nothing to do
+
+    size_t begin = m_regionBegin + m_flushed;
+    if (begin >= m_head) return;
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+    glBufferSubData(GL_ARRAY_BUFFER, begin, m_head - begin,
+                    m_shadow.data() + begin);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    m_flushed = m_head - m_regionBegin;
+}
+
+}  // namespace rendering
+}  // namespace v3d
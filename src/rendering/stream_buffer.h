@@ -0,0 +1,91 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace v3d {
+namespace rendering {
+
+/**
+ * @brief Ring buffer for per frame dynamic data (instance data, indirect
+ * commands, gizmos vertices...).
+ *
+ * The buffer is split in NumRegions regions, one per frame in flight. Each
+ * frame writes into its own region and a fence is placed when the frame is
+ * done, the region is only reused once the GPU has signaled that fence. With
+ * ARB_buffer_storage the storage is persistently and coherently mapped so
+ * writes go straight to GPU visible memory without implicit synchronization
+ * or buffer orphaning. Without it writes go to a CPU shadow copy that is
+ * uploaded by flush().
+ */
+class StreamBuffer {
+   public:
+    static constexpr size_t NumRegions = 3;
+
+    struct Allocation {
+        void* data = nullptr;  // Write pointer, null if the region is full
+        size_t offset = 0;     // Byte offset from the start of the buffer
+        size_t size = 0;
+
+        bool isValid() const { return data != nullptr; }
+    };
+
+    /// @param regionSize Bytes available per frame
+    explicit StreamBuffer(size_t regionSize);
+    ~StreamBuffer();
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    /// @brief True if glBufferStorage is available (GL 4.4 or
+    /// ARB_buffer_storage)
+    static bool isPersistentMappingSupported();
+
+    /// @brief Move to the next region, waiting for the GPU to release it
+    void beginFrame();
+    /// @brief Fence the current region once all its draws have been issued
+    void endFrame();
+
+    /// @brief Reserve bytes from the current region.
+    /// @param alignment Offset alignment, not required to be a power of two
+    /// so offsets can be a multiple of a vertex stride.
+    Allocation allocate(size_t size, size_t alignment = 16);
+
+    /// @brief Make the writes of the current region visible to the GPU.
+    /// Needs to be called before issuing draws that read the data.
+    void flush();
+
+    GLuint getBuffer() const { return m_buffer; }
+    size_t getRegionSize() const { return m_regionSize; }
+    bool isPersistent() const { return m_persistent; }
+
+    /// @brief Bytes written in the current region
+    size_t getFrameUsage() const { return m_head - m_regionBegin; }
+    /// @brief Num of frames that waited on a fence
+    size_t getNumStalls() const { return m_numStalls; }
+    /// @brief Num of allocations rejected because the region was full
+    size_t getNumOverflows() const { return m_numOverflows; }
+
+   private:
+    GLuint m_buffer = 0;
+    size_t m_regionSize = 0;
+    bool m_persistent = false;
+
+    unsigned char* m_mapped = nullptr;        // Persistent mapping
+    std::vector<unsigned char> m_shadow;      // Fallback write storage
+    size_t m_flushed = 0;                     // Fallback, bytes uploaded
+
+    std::array<GLsync, NumRegions> m_fences{};
+    size_t m_region = 0;
+    size_t m_regionBegin = 0;
+    size_t m_head = 0;
+
+    size_t m_numStalls = 0;
+    size_t m_numOverflows = 0;
+};
+
+}  // namespace rendering
+}  // namespace v3d
@@ -0,0 +1,219 @@
+#include "vertex_compression.h"
+
+#include <plog/Log.h>
+
+#include <algorithm>
+#include <cstring>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+#include <limits>
+#include <vulkan/vulkan_core.h>
+
+namespace v3d {
+namespace rendering {
+
+namespace {
+/// @brief Reads float attributes of an interleaved vertex buffer
+class AttributeReader {
+   public:
+    AttributeReader(const void* vertexData, const VertexLayout& layout,
+                    uint32_t location)
+        : m_data(static_cast<const unsigned char*>(vertexData)),
+          m_stride(layout.stride) {
+        for (const auto& vAttribute : layout.attributes) {
+            if (vAttribute.location == location &&
+                vAttribute.glType == GL_FLOAT) {
+                m_attribute = &vAttribute;
+                break;
+            }
+        }
+    }
+
+    bool isValid() const { return m_attribute != nullptr; }
+
+    glm::vec4 read(size_t vertex, const glm::vec4& fallback) const {
+        if (m_attribute == nullptr) return fallback;
+        float value[4];
+        size_t components = std::min<size_t>(m_attribute->components, 4);
+        std::memcpy(value,
+                    m_data + vertex * m_stride + m_attribute->offset,
+                    components * sizeof(float));
+        glm::vec4 result = fallback;
+        for (size_t i = 0; i < components; i++) result[i] = value[i];
+        return result;
+    }
+
+   private:
+    const unsigned char* m_data;
+    size_t m_stride;
+    const VertexAttribute* m_attribute = nullptr;
+};
+
+uint16_t quantizeUnorm16(float value) {
+    return glm::packUnorm1x16(glm::clamp(value, 0.f, 1.f));
+}
+
+glm::vec3 safeNormalize(const glm::vec3& v, const glm::vec3& fallback) {
+    float length2 = glm::dot(v, v);
+    return length2 > 1e-12f ? v / glm::sqrt(length2) : fallback;
+}
+}  // namespace
+
+size_t indexTypeSize(GLenum indexType) {
+    return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t)
+                                          : sizeof(uint32_t);
+}
+
+CompressedGeometry compressGeometry(const void* vertexData, size_t numVertices,
+                                    const VertexLayout& layout,
+                                    const unsigned int* indices,
+                                    size_t numIndices) {
+    CompressedGeometry geometry;
+
+    AttributeReader position(vertexData, layout, 0);
+    AttributeReader normal(vertexData, layout, 1);
+    AttributeReader textureCoord(vertexData, layout, 2);
+    AttributeReader color(vertexData, layout, 3);
+    AttributeReader tangent(vertexData, layout, 4);
+    AttributeReader bitangent(vertexData, layout, 5);
+
+    if (!position.isValid() || numVertices == 0) {
+        PLOGW << "Unable to compress mesh, unsupported position attribute\n";
+        return geometry;
+    }
+
+    // Positions are quantized over the mesh bounds
+    glm::vec3 min(std::numeric_limits<float>::max());
+    glm::vec3 max(std::numeric_limits<float>::lowest());
+    for (size_t i = 0; i < numVertices; i++) {
+        glm::vec3 p = position.read(i, glm::vec4(0.f));
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    glm::vec3 extent = max - min;
+    for (int c = 0; c < 3; c++) {
+        if (extent[c] <= 0.f) extent[c] = 1.f;
+    }
+    geometry.vertexTransform =
+        glm::scale(glm::translate(glm::mat4(1.f), min), extent);
+
+    geometry.vertices.resize(numVertices * sizeof(CompressedVertex));
+    auto* vertices =
+        reinterpret_cast<CompressedVertex*>(geometry.vertices.data());
+    for (size_t i = 0; i < numVertices; i++) {
+        CompressedVertex& v = vertices[i];
+
+        glm::vec3 p = (glm::vec3(position.read(i, glm::vec4(0.f))) - min) /
+                      extent;
+        v.position[0] = quantizeUnorm16(p.x);
+        v.position[1] = quantizeUnorm16(p.y);
+        v.position[2] = quantizeUnorm16(p.z);
+        v.position[3] = std::numeric_limits<uint16_t>::max();
+
+        glm::vec3 n = safeNormalize(normal.read(i, glm::vec4(0, 1, 0, 0)),
+                                    glm::vec3(0, 1, 0));
+        v.normal = glm::packSnorm3x10_1x2(glm::vec4(n, 0.f));
+
+        glm::vec2 uv = textureCoord.read(i, glm::vec4(0.f));
+        v.textureCoord[0] = glm::packHalf1x16(uv.x);
+        v.textureCoord[1] = glm::packHalf1x16(uv.y);
+
+        uint32_t rgba = glm::packUnorm4x8(
+            glm::clamp(color.read(i, glm::vec4(1.f)), 0.f, 1.f));
+        std::memcpy(v.color, &rgba, sizeof(rgba));
+
+        // Tangent frame: the bitangent handedness is kept in the sign bit
+        glm::vec3 t = safeNormalize(tangent.read(i, glm::vec4(1, 0, 0, 0)),
+                                    glm::vec3(1, 0, 0));
+        float sign = 1.f;
+        if (bitangent.isValid()) {
+            glm::vec3 b = bitangent.read(i, glm::vec4(0.f));
+            if (glm::dot(glm::cross(n, t), b) < 0.f) sign = -1.f;
+        }
+        v.tangent = glm::packSnorm3x10_1x2(glm::vec4(t, sign));
+    }
+
+    geometry.layout.stride = sizeof(CompressedVertex);
+    geometry.layout.attributes = {
+        {0, 4, GL_UNSIGNED_SHORT, VK_FORMAT_R16G16B16A16_UNORM, true,
+         offsetof(CompressedVertex, position)},
+        {1, 4, GL_INT_2_10_10_10_REV, VK_FORMAT_A2B10G10R10_SNORM_PACK32, true,
+         offsetof(CompressedVertex, normal)},
+        {2, 2, GL_HALF_FLOAT, VK_FORMAT_R16G16_SFLOAT, false,
+         offsetof(CompressedVertex, textureCoord)},
+        {3, 4, GL_UNSIGNED_BYTE, VK_FORMAT_R8G8B8A8_UNORM, true,
+         offsetof(CompressedVertex, color)},
+        {4, 4, GL_INT_2_10_10_10_REV, VK_FORMAT_A2B10G10R10_SNORM_PACK32, true,
+         offsetof(CompressedVertex, tangent)},
+    };
+
+    // 16 bit indices when every vertex is addressable
+    if (numVertices <= std::numeric_limits<uint16_t>::max() + size_t(1)) {
+        geometry.indexType = GL_UNSIGNED_SHORT;
+        geometry.indices.resize(numIndices * sizeof(uint16_t));
+        auto* shortIndices =
+            reinterpret_cast<uint16_t*>(geometry.indices.data());
+        for (size_t i = 0; i < numIndices; i++)
+            shortIndices[i] = static_cast<uint16_t>(indices[i]);
+    } else {
+        geometry.indexType = GL_UNSIGNED_INT;
+        geometry.indices.resize(numIndices * sizeof(uint32_t));
+        std::memcpy(geometry.indices.data(), indices,
+                    geometry.indices.size());
+    }
+
+    return geometry;
+}
+
+glm::vec4 decodeAttribute(const void* vertex, const VertexAttribute& attribute,
+                          const glm::vec4& fallback) {
+    const auto* data =
+        static_cast<const unsigned char*>(vertex) + attribute.offset;
+    const size_t components = std::min<size_t>(attribute.components, 4);
+    glm::vec4 result = fallback;
+
+    switch (attribute.glType) {
+        case GL_FLOAT: {
+            float value[4];
+            std::memcpy(value, data, components * sizeof(float));
+            for (size_t i = 0; i < components; i++) result[i] = value[i];
+            break;
+        }
+        case GL_HALF_FLOAT: {
+            uint16_t value[4];
+            std::memcpy(value, data, components * sizeof(uint16_t));
+            for (size_t i = 0; i < components; i++)
+                result[i] = glm::unpackHalf1x16(value[i]);
+            break;
+        }
+        case GL_UNSIGNED_SHORT: {
+            uint16_t value[4];
+            std::memcpy(value, data, components * sizeof(uint16_t));
+            for (size_t i = 0; i < components; i++)
+                result[i] = attribute.normalized ? glm::unpackUnorm1x16(value[i])
+                                                 : float(value[i]);
+            break;
+        }
+        case GL_UNSIGNED_BYTE: {
+            for (size_t i = 0; i < components; i++)
+                result[i] = attribute.normalized ? data[i] / 255.f
+                                                 : float(data[i]);
+            break;
+        }
+        case GL_INT_2_10_10_10_REV: {
+            uint32_t value;
+            std::memcpy(&value, data, sizeof(value));
+            glm::vec4 unpacked = glm::unpackSnorm3x10_1x2(value);
+            for (size_t i = 0; i < components; i++) result[i] = unpacked[i];
+            break;
+        }
+        default:
+            PLOGW << "Unable to decode vertex attribute type "
+                  << attribute.glType << "\n";
+            break;
+    }
+    return result;
+}
+
+}  // namespace rendering
+}  // namespace v3d
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Mesh.h"
+#include "glm/glm.hpp"
+
+namespace v3d {
+namespace rendering {
+
+/**
+ * @brief Vertex format produced by compressGeometry, 24 bytes per vertex.
+ *
+ * | location | data                | format                              |
+ * |----------|---------------------|-------------------------------------|
+ * | 0        | position            | unorm16 x4, relative to the bounds  |
+ * | 1        | normal              | snorm 10:10:10:2                    |
+ * | 2        | texture coordinates | half float x2                       |
+ * | 3        | color               | unorm8 x4                           |
+ * | 4        | tangent, w sign     | snorm 10:10:10:2                    |
+ *
+ * The packed formats are expanded by the vertex fetch, shaders keep reading
+ * vec3/vec2/vec4 inputs. Positions need the mesh vertex transform, see
+ * Mesh::getVertexTransform(). The bitangent is cross(normal, tangent.xyz) *
+ * tangent.w.
+ */
+struct CompressedVertex {
+    uint16_t position[4];
+    uint32_t normal;
+    uint16_t textureCoord[2];
+    uint8_t color[4];
+    uint32_t tangent;
+};
+static_assert(sizeof(CompressedVertex) == 24,
+              "CompressedVertex must be tightly packed");
+
+/// @brief Vertex and index data ready to be uploaded
+struct CompressedGeometry {
+    std::vector<unsigned char> vertices;
+    VertexLayout layout;
+    /// @brief Quantized position to mesh local space
+    glm::mat4 vertexTransform = glm::mat4(1.f);
+
+    std::vector<unsigned char> indices;
+    /// @brief GL_UNSIGNED_SHORT when every index fits, else GL_UNSIGNED_INT
+    GLenum indexType = GL_UNSIGNED_INT;
+};
+
+/// @brief Size in bytes of an index of type GL_UNSIGNED_SHORT/INT
+size_t indexTypeSize(GLenum indexType);
+
+/**
+ * @brief Convert a mesh to the CompressedVertex format and the smallest
+ * index type. The attributes are read from the source layout by location
+ * (0 position, 1 normal, 2 texture coordinates, 3 color, 4 tangent,
+ * 5 bitangent), missing ones get a default value.
+ * @return Empty vertices if the source has no float position
+ */
+CompressedGeometry compressGeometry(const void* vertexData, size_t numVertices,
+                                    const VertexLayout& layout,
+                                    const unsigned int* indices,
+                                    size_t numIndices);
+
+/**
+ * @brief Read an attribute of a vertex as the vertex fetch would expand it.
+ * Supports the float formats and the packed formats of CompressedVertex.
+ * @param vertex Start of the vertex
+ * @param fallback Value of the components missing from the attribute
+ */
+glm::vec4 decodeAttribute(const void* vertex, const VertexAttribute& attribute,
+                          const glm::vec4& fallback);
+
+}  // namespace rendering
+}  // namespace v3d
@@ -10,10 +10,12 @@ namespace v3d {
 entity_ptr Scene::instantiateEntity(std::string name, entity_ptr parent) {
     entity_ptr entity = createEntity(parent);
     entity->m_name = name;
-    instantiateEntityComponent<RigidBody>(entity);
+    // Physics is opt-in: a RigidBody (and its ChBody) is only added when a
+    // component asks for it
     instantiateEntityComponent<Transform>(entity);
     entity->m_transform = getComponentOfType<Transform>(entity.index());
-    entity->m_rigidBody = getComponentOfType<RigidBody>(entity.index());
+    // Kinematic transforms follow the parent, no constraint is involved
+    if (parent) entity->m_transform->setParent(parent->m_transform);
     return entity;
 }
 entity_ptr Scene::getEntity(entityID_t entityID) {
@@ -32,10 +34,7 @@ void Scene::init() {
 
     m_root = createEntity();
     m_root->m_name = "root";
-    instantiateEntityComponent<RigidBody>(m_root);
     instantiateEntityComponent<Transform>(m_root);
     m_root->m_transform = getComponentOfType<Transform>(m_root.index());
-    m_root->m_rigidBody = getComponentOfType<RigidBody>(m_root.index());
-    m_root->m_rigidBody->setFixed(true);
 }
 }  // namespace v3d
@@ -207,6 +207,11 @@ class Scene {
         // the frame update
     }
 
+    void start() {
+        m_components.for_each(
+            [](ComponentBase& component) { component.start(); });
+    }
+
     void update(double delta) {
         m_components.for_each(
             [delta](ComponentBase& component) { component.update(delta); });
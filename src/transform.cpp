@@ -1,50 +1,170 @@
 
 #include "transform.h"
 
+#include <algorithm>
+#include <atomic>
+
 #include "physics/rigidbody.h"
 #include "scene.h"
 
 namespace v3d {
 
+namespace {
+// Shared by all the transforms, the newest stamp of a parent chain only grows
+std::atomic<uint64_t> s_changeStamp{0};
+}  // namespace
+
 // auto Transform::dependencies() {
 //     return std::tuple<RigidBody>{};
 // }
 
 void Transform::init() {
-    // Set the rigidbody of the transform to this instance
+    // Entities without RigidBody keep a kinematic transform, a body created
+    // later attaches itself (see RigidBody::init)
     auto rigidBody = m_scene->getComponentOfType<RigidBody>(m_entity);
-    assert(rigidBody != nullptr &&
-           "Failed to initialize Transform. Missing required component "
-           "Transform from the entity");
-    m_rigidBody = rigidBody;
+    if (rigidBody != nullptr && rigidBody->m_body) attachRigidBody(rigidBody);
 };
 
+void Transform::attachRigidBody(RigidBody* rigidBody) {
+    // The body starts at the current pose of the transform
+    const glm::vec3 pos = getPos();
+    const glm::quat rot = getRotation();
+    auto lock = m_scene->getPhysics()->lockSystem();
+    m_rigidBody = rigidBody;
+    m_rigidBody->setReferenceFrame(
+        chrono::ChFramed(chrono::ChVector3d(pos.x, pos.y, pos.z),
+                         chrono::ChQuaterniond(rot.w, rot.x, rot.y, rot.z)));
+    m_rigidBody->syncPose();
+
+    if (m_parent != nullptr && m_parent->m_rigidBody != nullptr)
+        m_rigidBody->setParent(m_parent->m_rigidBody);
+    markChanged();
+}
+
+void Transform::markChanged() { m_version = ++s_changeStamp; }
+
+uint64_t Transform::getVersion() const {
+    if (m_parent == nullptr) return m_version;
+    return std::max(m_version, m_parent->getVersion());
+}
+
+bool Transform::isSimulated() const {
+    if (m_rigidBody != nullptr && !m_rigidBody->isFixed()) return true;
+    return m_parent != nullptr && m_parent->isSimulated();
+}
+
 glm::vec3 Transform::getPos() {
-    auto pos = m_rigidBody->m_body->GetPos();
-    return glm::vec3(pos.x(), pos.y(), pos.z());
+    if (m_rigidBody != nullptr) {
+        // Snapshot of the last step, no Chrono access
+        if (m_scene->getPhysics()->hasPose(m_rigidBody->m_poseSlot))
+            return m_scene->getPhysics()->getPoses().getPos(
+                m_rigidBody->m_poseSlot);
+        auto pos = m_rigidBody->getReferenceFrame().GetPos();
+        return glm::vec3(pos.x(), pos.y(), pos.z());
+    }
+    if (m_parent == nullptr) return m_localPosition;
+    return m_parent->getPos() + m_parent->getRotation() * m_localPosition;
 }
 
 glm::vec3 Transform::getScale() { return m_scale; }
 
 glm::quat Transform::getRotation() {
-    auto quat = m_rigidBody->m_body->GetRot();
-    double t = quat.e0() + quat.e1() + quat.e2() + quat.e3();
-    return glm::quat(quat.e0(), quat.e1(), quat.e2(), quat.e3());
+    if (m_rigidBody != nullptr) {
+        if (m_scene->getPhysics()->hasPose(m_rigidBody->m_poseSlot))
+            return m_scene->getPhysics()->getPoses().getRotation(
+                m_rigidBody->m_poseSlot);
+        auto quat = m_rigidBody->getReferenceFrame().GetRot();
+        return glm::quat(quat.e0(), quat.e1(), quat.e2(), quat.e3());
+    }
+    if (m_parent == nullptr) return m_localRotation;
+    return m_parent->getRotation() * m_localRotation;
 }
 
 glm::vec3 Transform::getRotationCardanAngles() {
-    auto quat = m_rigidBody->m_body->GetRot();
-    auto t = quat.GetCardanAnglesXYZ();
+    const glm::quat rot = getRotation();
+    auto t = chrono::ChQuaterniond(rot.w, rot.x, rot.y, rot.z)
+                 .GetCardanAnglesXYZ();
     return glm::vec3(t.x(), t.y(), t.z());
 }
 
-void Transform::setParent(Transform* parent) {
-    m_parent = parent;
-    if (parent == nullptr) {
-        m_rigidBody->setParent(nullptr);
+void Transform::setPos(const glm::vec3& position) {
+    if (m_rigidBody != nullptr) {
+        m_rigidBody->setPos(position);
+    } else if (m_parent == nullptr) {
+        m_localPosition = position;
     } else {
-        m_rigidBody->setParent(parent->m_rigidBody);
+        m_localPosition = glm::inverse(m_parent->getRotation()) *
+                          (position - m_parent->getPos());
     }
+    markChanged();
+}
+
+void Transform::setRotation(const glm::quat& rotation) {
+    if (m_rigidBody != nullptr) {
+        auto lock = m_scene->getPhysics()->lockSystem();
+        m_rigidBody->setReferenceFrame(chrono::ChFramed(
+            m_rigidBody->getReferenceFrame().GetPos(),
+            chrono::ChQuaterniond(rotation.w, rotation.x, rotation.y,
+                                  rotation.z)));
+        m_rigidBody->syncPose();
+    } else if (m_parent == nullptr) {
+        m_localRotation = rotation;
+    } else {
+        m_localRotation = glm::inverse(m_parent->getRotation()) * rotation;
+    }
+    markChanged();
+}
+
+void Transform::getRenderPose(glm::vec3& position, glm::vec3& cardanAngles) {
+    glm::quat rotation;
+    getRenderPose(position, rotation);
+    const auto angles =
+        chrono::ChQuaterniond(rotation.w, rotation.x, rotation.y, rotation.z)
+            .GetCardanAnglesXYZ();
+    cardanAngles = glm::vec3(angles.x(), angles.y(), angles.z());
+}
+
+void Transform::getRenderPose(glm::vec3& position, glm::quat& rotation) {
+    if (m_rigidBody != nullptr &&
+        m_scene->getPhysics()->hasPose(m_rigidBody->m_poseSlot)) {
+        m_scene->getPhysics()->getInterpolatedPose(m_rigidBody->m_poseSlot,
+                                                   position, rotation);
+    } else if (m_rigidBody != nullptr) {
+        position = getPos();
+        rotation = getRotation();
+    } else if (m_parent == nullptr) {
+        position = m_localPosition;
+        rotation = m_localRotation;
+    } else {
+        // Kinematic children follow the interpolated pose of the parent
+        glm::vec3 parentPosition;
+        glm::quat parentRotation;
+        m_parent->getRenderPose(parentPosition, parentRotation);
+        position = parentPosition + parentRotation * m_localPosition;
+        rotation = parentRotation * m_localRotation;
+    }
+}
+
+void Transform::setParent(Transform* parent) {
+    if (m_rigidBody != nullptr) {
+        m_parent = parent;
+        // Only bodies are constrained, a kinematic parent has no body to fix
+        // the child to
+        if (parent == nullptr || parent->m_rigidBody == nullptr) {
+            m_rigidBody->setParent(nullptr);
+        } else {
+            m_rigidBody->setParent(parent->m_rigidBody);
+        }
+        markChanged();
+        return;
+    }
+
+    // Keep the world pose, the local pose is now relative to the new parent
+    const glm::vec3 pos = getPos();
+    const glm::quat rot = getRotation();
+    m_parent = parent;
+    setPos(pos);
+    setRotation(rot);
 }
 
 void Transform::drawEditorGUI_Properties() {
@@ -53,8 +173,7 @@ void Transform::drawEditorGUI_Properties() {
     glm::vec3 og_position = getPos();
     float position[3] = {og_position.x, og_position.y, og_position.z};
     if (ImGui::InputFloat3("Position", position, "%.3f")) {
-        m_rigidBody->setPos(
-            chrono::ChVector3(position[0], position[1], position[2]));
+        setPos(glm::vec3(position[0], position[1], position[2]));
     }
 }
 
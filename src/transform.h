@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 #include "component.h"
 #include "glm/glm.hpp"
 #include "glm/gtc/quaternion.hpp"
@@ -23,19 +25,55 @@ class Transform : public ComponentBase {
     void start() override {};
     void update(double deltaTime) override {};
 
+    /// @brief World position
     glm::vec3 getPos();
     glm::vec3 getScale();
+    /// @brief World rotation
     glm::quat getRotation();
     glm::vec3 getRotationCardanAngles();
+    /// @brief Pose to draw, interpolated between the last two physics steps
+    void getRenderPose(glm::vec3& position, glm::quat& rotation);
+    void getRenderPose(glm::vec3& position, glm::vec3& cardanAngles);
+
+    void setPos(const glm::vec3& position);
+    void setRotation(const glm::quat& rotation);
+    void setScale(const glm::vec3& scale) {
+        m_scale = scale;
+        markChanged();
+    }
+    void setScale(float x, float y, float z) { setScale(glm::vec3(x, y, z)); }
 
-    void setScale(const glm::vec3& scale) { m_scale = scale; }
-    void setScale(float x, float y, float z) { m_scale = glm::vec3(x, y, z); }
+    /// @brief Stamp of the last change of the world transform, made through
+    /// this transform or one of its parents. Grows on every change, so moves
+    /// are detected without comparing matrices. Moves of the physics steps
+    /// are not stamped, see isSimulated.
+    uint64_t getVersion() const;
+    /// @brief True when this transform or one of its parents follows a non
+    /// fixed RigidBody, it may move on every step
+    bool isSimulated() const;
+
+    /// @brief True when the pose is simulated by a RigidBody, otherwise the
+    /// transform is kinematic and follows its parent
+    bool hasRigidBody() const { return m_rigidBody != nullptr; }
+    RigidBody* getRigidBody() const { return m_rigidBody; }
+    Transform* getParent() const { return m_parent; }
 
    private:
+    friend class Scene;
+    friend class RigidBody;
+
     Transform* m_parent = nullptr;
+    // Pose of a kinematic transform, relative to the parent
+    glm::vec3 m_localPosition = glm::vec3(0, 0, 0);
+    glm::quat m_localRotation = glm::quat(1, 0, 0, 0);
     glm::vec3 m_scale = glm::vec3(1, 1, 1);
     RigidBody* m_rigidBody = nullptr;
+    // Stamp of the last change of the local pose, scale or parent
+    uint64_t m_version = 0;
 
+    void markChanged();
     void setParent(Transform* parent);
+    /// @brief Hand the pose over to the body, called by RigidBody::init
+    void attachRigidBody(RigidBody* rigidBody);
 };
 }  // namespace v3d
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace v3d {
+namespace utils {
+
+namespace detail {
+inline const std::array<uint32_t, 256>& crc32Table() {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[n] = c;
+        }
+        return t;
+    }();
+    return table;
+}
+
+inline uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+    const auto& table = crc32Table();
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+inline void appendU32BE(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+inline void appendChunk(std::vector<uint8_t>& out, const char* type,
+                        const std::vector<uint8_t>& data) {
+    appendU32BE(out, static_cast<uint32_t>(data.size()));
+    size_t typeOffset = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    appendU32BE(out, crc32(out.data() + typeOffset, data.size() + 4));
+}
+}  // namespace detail
+
+/**
+ * @brief Write an 8 bit RGBA image as PNG.
+ *
+ * The image data is stored with uncompressed deflate blocks, files are larger
+ * than a real encoder would produce but writing is fast and dependency free,
+ * which is what frame dumps need.
+ *
+ * @param path Output file path
+ * @param width Image width
+ * @param height Image height
+ * @param rgba Pixel data, rows top to bottom, 4 bytes per pixel
+ * @return false if the file could not be written
+ */
+inline bool writePNG(const std::string& path, uint32_t width, uint32_t height,
+                     const uint8_t* rgba) {
+    const size_t rowSize = static_cast<size_t>(width) * 4;
+
+    // Raw scanlines, each prefixed with filter type 0 (none)
+    std::vector<uint8_t> raw;
+    raw.reserve((rowSize + 1) * height);
+    for (uint32_t y = 0; y < height; y++) {
+        raw.push_back(0);
+        raw.insert(raw.end(), rgba + y * rowSize, rgba + (y + 1) * rowSize);
+    }
+
+    // zlib stream made of stored deflate blocks
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    const size_t maxBlock = 65535;
+    size_t offset = 0;
+    do {
+        size_t blockSize = std::min(maxBlock, raw.size() - offset);
+        bool last = offset + blockSize >= raw.size();
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(static_cast<uint8_t>(blockSize));
+        zlib.push_back(static_cast<uint8_t>(blockSize >> 8));
+        zlib.push_back(static_cast<uint8_t>(~blockSize));
+        zlib.push_back(static_cast<uint8_t>(~blockSize >> 8));
+        zlib.insert(zlib.end(), raw.begin() + offset,
+                    raw.begin() + offset + blockSize);
+        offset += blockSize;
+    } while (offset < raw.size());
+    uint32_t a = 1, b = 0;  // adler32
+    for (uint8_t byte : raw) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    detail::appendU32BE(zlib, (b << 16) | a);
+
+    std::vector<uint8_t> header;
+    detail::appendU32BE(header, width);
+    detail::appendU32BE(header, height);
+    header.push_back(8);  // bit depth
+    header.push_back(6);  // color type RGBA
+    header.push_back(0);  // compression
+    header.push_back(0);  // filter
+    header.push_back(0);  // interlace
+
+    std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    detail::appendChunk(png, "IHDR", header);
+    detail::appendChunk(png, "IDAT", zlib);
+    detail::appendChunk(png, "IEND", {});
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return false;
+    file.write(reinterpret_cast<const char*>(png.data()), png.size());
+    return static_cast<bool>(file);
+}
+
+/// @brief Write raw pixel data as is, no header
+inline bool writeRaw(const std::string& path, const uint8_t* data,
+                     size_t size) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return false;
+    file.write(reinterpret_cast<const char*>(data), size);
+    return static_cast<bool>(file);
+}
+
+}  // namespace utils
+}  // namespace v3d
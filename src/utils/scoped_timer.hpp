@@ -0,0 +1,31 @@
+#pragma once
+
+#include <chrono>
+
+namespace v3d {
+namespace utils {
+
+/// @brief Adds the wall time between its construction and destruction to a
+/// total, ms
+class ScopedTimer {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit ScopedTimer(double& total)
+        : m_total(total), m_start(Clock::now()) {}
+    ~ScopedTimer() {
+        m_total += std::chrono::duration<double, std::milli>(Clock::now() -
+                                                             m_start)
+                       .count();
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+   private:
+    double& m_total;
+    Clock::time_point m_start;
+};
+
+}  // namespace utils
+}  // namespace v3d
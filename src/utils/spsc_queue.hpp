@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace v3d {
+namespace utils {
+
+/// @brief Lock-free bounded queue between a single producer thread and a
+/// single consumer thread.
+///
+/// A ring of capacity slots (rounded up to a power of two). The producer
+/// only writes the tail and the consumer only the head, each on its own
+/// cache line.
+/// @tparam T Value type, default constructible and copy assignable
+template <typename T>
+class SpscQueue {
+   public:
+    explicit SpscQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size *= 2;
+        m_slots.resize(size);
+        m_mask = size - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    size_t capacity() const { return m_slots.size(); }
+
+    /// @brief Producer side
+    /// @return False if the queue is full, the value is not queued
+    bool push(const T& value) {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == m_slots.size())
+            return false;
+        m_slots[tail & m_mask] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @brief Consumer side
+    /// @return False if the queue is empty
+    bool pop(T& value) {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) return false;
+        value = m_slots[head & m_mask];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+   private:
+    std::vector<T> m_slots;
+    size_t m_mask;
+    alignas(64) std::atomic<size_t> m_head{0};  // Next slot to pop
+    alignas(64) std::atomic<size_t> m_tail{0};  // Next slot to push
+};
+
+}  // namespace utils
+}  // namespace v3d
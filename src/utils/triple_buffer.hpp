@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace v3d {
+namespace utils {
+
+/// @brief Lock-free triple buffer handing the latest value from a single
+/// writer thread to a single reader thread.
+///
+/// The writer fills writeBuffer() and publishes it, the reader takes the
+/// newest published buffer with update(). Neither side ever waits: the
+/// writer always has a buffer the reader doesn't hold, and values published
+/// while the reader is busy are overwritten by the newer ones.
+/// @tparam T Value type, default constructible
+template <typename T>
+class TripleBuffer {
+   public:
+    TripleBuffer() = default;
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    /// @brief Buffer owned by the writer, filled before publish()
+    T& writeBuffer() { return m_buffers[m_back]; }
+
+    /// @brief Make the write buffer the newest value, the writer continues
+    /// on the previous middle buffer
+    void publish() {
+        const uint8_t previous = m_middle.exchange(
+            static_cast<uint8_t>(m_back | FreshBit), std::memory_order_acq_rel);
+        m_back = previous & IndexMask;
+    }
+
+    /// @brief Take the newest published value, if any
+    /// @return True if readBuffer() changed
+    bool update() {
+        if ((m_middle.load(std::memory_order_relaxed) & FreshBit) == 0)
+            return false;
+        const uint8_t previous =
+            m_middle.exchange(m_front, std::memory_order_acq_rel);
+        m_front = previous & IndexMask;
+        return true;
+    }
+
+    /// @brief Buffer owned by the reader, the value taken by the last
+    /// update()
+    const T& readBuffer() const { return m_buffers[m_front]; }
+    T& readBuffer() { return m_buffers[m_front]; }
+
+   private:
+    static constexpr uint8_t IndexMask = 0x3;
+    // Set on the middle index when the writer published since the last
+    // update()
+    static constexpr uint8_t FreshBit = 0x4;
+
+    T m_buffers[3];
+    uint8_t m_front = 0;  // Reader
+    uint8_t m_back = 1;   // Writer
+    std::atomic<uint8_t> m_middle{2};
+};
+
+}  // namespace utils
+}  // namespace v3d
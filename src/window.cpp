@@ -4,12 +4,37 @@
 #include <plog/Log.h>
 
 #include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+#include "rendering/gl_loader.h"
+
+#ifdef V3D_WITH_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+namespace {
+void* eglProcLoader(const char* name) {
+    return reinterpret_cast<void*>(eglGetProcAddress(name));
+}
+}  // namespace
+#endif
 
 namespace v3d {
 
+void Window::initPlatformHint(rendering::WindowBackendHint api) {
+    // Offscreen rendering must not depend on a display server
+    if (api == rendering::WindowBackendHint::OPENGL_OFFSCREEN_API)
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+    else
+        glfwInitHint(GLFW_PLATFORM, GLFW_ANY_PLATFORM);
+}
+
 Window::Window(const char* title, rendering::WindowBackendHint api,
                uint32_t width, uint32_t height, float windowScale,
-               bool enableVsync) {
+               bool enableVsync, rendering::OffscreenContextAPI offscreenContext) {
+    bool useEGLContext = false;
+
     PLOGI << "Initializing window with size " << m_width << "x" << m_height
           << " and title \"" << title << "\"" << std::endl;
 
@@ -30,6 +55,27 @@ Window::Window(const char* title, rendering::WindowBackendHint api,
             glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
             // glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_API);
             break;
+        case rendering::WindowBackendHint::OPENGL_OFFSCREEN_API:
+            PLOGI << "  - Offscreen mode ("
+                  << (offscreenContext == rendering::OffscreenContextAPI::EGL
+                          ? "EGL surfaceless"
+                          : "OSMesa")
+                  << ")";
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+            if (offscreenContext == rendering::OffscreenContextAPI::OSMESA) {
+                glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_API);
+                glfwWindowHint(GLFW_CONTEXT_CREATION_API,
+                               GLFW_OSMESA_CONTEXT_API);
+                glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+                glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+                glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+            } else {
+                // GLFW can not create surfaceless EGL contexts, the window
+                // is only used for input/imgui and the context is made below
+                glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+                useEGLContext = true;
+            }
+            break;
         default:
             break;
     }
@@ -50,17 +96,110 @@ Window::Window(const char* title, rendering::WindowBackendHint api,
         throw std::runtime_error("Failed to create GLFW window");
     }
 
+    m_glfwWindowInitialized = true;
+
+    if (useEGLContext) {
+        createEGLContext();
+        return;
+    }
+
     glfwMakeContextCurrent(m_window);
 
     glfwSwapInterval(enableVsync ? 1 : 0);  // Enable/Disable vsync
+}
 
-    m_glfwWindowInitialized = true;
+void Window::setVsync(bool enableVsync) {
+    if (glfwGetCurrentContext() == nullptr) return;
+    glfwSwapInterval(enableVsync ? 1 : 0);
 }
 
 Window::~Window() {
+    destroyEGLContext();
     if (m_glfwWindowInitialized) {
         glfwDestroyWindow(m_window);
     }
 }
 
+void Window::createEGLContext() {
+#ifdef V3D_WITH_EGL
+    EGLDisplay display = EGL_NO_DISPLAY;
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+        eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (getPlatformDisplay)
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                     EGL_DEFAULT_DISPLAY, nullptr);
+    if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major = 0, minor = 0;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+        PLOGE << "Failed to initialize EGL display" << std::endl;
+        throw std::runtime_error("Failed to initialize EGL display");
+    }
+    m_eglDisplay = display;
+
+    const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+    if (!extensions ||
+        !std::strstr(extensions, "EGL_KHR_surfaceless_context")) {
+        PLOGE << "EGL_KHR_surfaceless_context not supported" << std::endl;
+        throw std::runtime_error("EGL surfaceless context not supported");
+    }
+
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        PLOGE << "Failed to bind EGL OpenGL API" << std::endl;
+        throw std::runtime_error("Failed to bind EGL OpenGL API");
+    }
+
+    const EGLint configAttribs[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+                                    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                                    EGL_NONE};
+    EGLConfig config;
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) ||
+        numConfigs == 0) {
+        PLOGE << "No suitable EGL config found" << std::endl;
+        throw std::runtime_error("No suitable EGL config found");
+    }
+
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4, EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE};
+    EGLContext context =
+        eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT) {
+        PLOGE << "Failed to create EGL context" << std::endl;
+        throw std::runtime_error("Failed to create EGL context");
+    }
+    m_eglContext = context;
+
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        PLOGE << "Failed to make EGL context current" << std::endl;
+        throw std::runtime_error("Failed to make EGL context current");
+    }
+
+    rendering::setGLProcLoader(eglProcLoader);
+
+    PLOGI << "EGL " << major << "." << minor
+          << " surfaceless context created" << std::endl;
+#else
+    PLOGE << "Vector3D was built without EGL support" << std::endl;
+    throw std::runtime_error("Vector3D was built without EGL support");
+#endif
+}
+
+void Window::destroyEGLContext() {
+#ifdef V3D_WITH_EGL
+    if (m_eglDisplay == nullptr) return;
+
+    eglMakeCurrent(m_eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                   EGL_NO_CONTEXT);
+    if (m_eglContext != nullptr) eglDestroyContext(m_eglDisplay, m_eglContext);
+    eglTerminate(m_eglDisplay);
+    rendering::setGLProcLoader(nullptr);
+
+    m_eglContext = nullptr;
+    m_eglDisplay = nullptr;
+#endif
+}
+
 }  // namespace v3d
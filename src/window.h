@@ -24,11 +24,22 @@ class Window {
      * @param height Window initial height
      * @param windowScale Scale the window size preserving the aspect ratio
      * @param swapInterval 
+     * @param offscreenContext Context API used with
+     *            WindowBackendHint::OPENGL_OFFSCREEN_API. The window is
+     *            created on the GLFW null platform (see
+     *            initPlatformHint), OSMesa contexts are created by GLFW while
+     *            EGL contexts are created surfaceless by the window itself.
      */
     Window(const char* title, rendering::WindowBackendHint api, uint32_t width,
-           uint32_t height, float windowScale = 1.f, bool enableVsync = true);
+           uint32_t height, float windowScale = 1.f, bool enableVsync = true,
+           rendering::OffscreenContextAPI offscreenContext =
+               rendering::OffscreenContextAPI::EGL);
     ~Window();
 
+    /// @brief Set the GLFW init hints required by the api, must be called
+    /// before glfwInit.
+    static void initPlatformHint(rendering::WindowBackendHint api);
+
     GLFWwindow* getWindow() { return m_window; }
 
     // void setSize(uint32_t width, uint32_t height) {
@@ -45,11 +56,22 @@ class Window {
             return false;
     }
     void pollEvents() { glfwPollEvents(); }
+    /// @brief Sync the buffer swaps to the display refresh. Applies to the
+    /// context current on the calling thread, ignored without one (Vulkan,
+    /// EGL offscreen).
+    void setVsync(bool enableVsync);
 
    private:
     bool m_glfwWindowInitialized = false;
     GLFWwindow* m_window;
     uint32_t m_width = 800, m_height = 600;
+
+    // Surfaceless EGL context of offscreen windows (EGLDisplay/EGLContext)
+    void* m_eglDisplay = nullptr;
+    void* m_eglContext = nullptr;
+
+    void createEGLContext();
+    void destroyEGLContext();
 };
 
 }  // namespace v3d